@@ -131,8 +131,6 @@ typedef enum {
 #define RGB565_G(c)     (255*(((c) & 0x07E0) >> 5)/((1<<6)-1))
 #define RGB565_B(c)     (255*((c) & 0x001F)/((1<<5)-1))
 
-// #define RGB2GRAY(r,g,b) ((r)*0.26F + (g)*0.65F + (b)*0.09F)
-#define RGB2GRAY(r,g,b) ((r)/4 + 2*(g)/3 + (b)/12)      // faster??
 
 /* define debug subsystems
  */
@@ -184,11 +182,14 @@ extern int liveweb_ro_port;
 extern int liveweb_rw_port;
 extern int liveweb_max;
 extern int liveweb_to;
+extern int liveweb_maxfps;
 extern const int liveweb_maxmax;
 extern int restful_port;
 extern bool skip_skip;
 extern bool init_iploc;
 extern bool want_kbcursor;
+extern int map_nthreads;
+extern int cache_budget_mb;
 extern const char *init_locip;
 extern time_t usr_datetime;
 extern const char *getI2CFilename(void);
@@ -11,6 +11,8 @@
  *
  * Both systems use a memory array named fb_canvas as a pixel-by-pixel rendering surface. This is
  * periodically copied to fb_stage on change. _USE_FB0 uses a third copy fb_cursor in which to draw cursor.
+ * _USE_X11 shares fb_stage with the X server using MIT-SHM if possible: the segment is fb_stage itself so
+ * changed tiles are still copied from fb_canvas into it but no longer sent over the X connection.
  * FB_X0 and FB_Y0 are the upper left coords on the hardware of drawing area FB_YRES x FB_XRES.
  *
  * Earth map pixels are mmap'd from local day and night files.
@@ -147,9 +149,22 @@ Adafruit_RA8875::Adafruit_RA8875(uint8_t CS, uint8_t RST)
         // init the protected region flag
         pr_draw = false;
 
+        // fb_stage starts out different everywhere
+        memset (fb_tiles, TILE_DIRTY, sizeof(fb_tiles));
+        memset (stage_tile_seq, 0, sizeof(stage_tile_seq));
+        stage_seq = 0;
+
+        // no overlays yet
+        memset (fb_ovl_tiles, 0, sizeof(fb_ovl_tiles));
+        fb_ovl_track = false;
+
+        // no glyphs decoded yet
+        n_glyph_atlas = 0;
+
         // insure earth map pointers are NULL until set
         DEARTH_BIG = NULL;
         NEARTH_BIG = NULL;
+        earth_pix_gen = 0;
 
         // not ready until proven
         ready = false;
@@ -167,6 +182,8 @@ void Adafruit_RA8875::setEarthPix (char *day_pixels, char *night_pixels, int wid
 
         EARTH_BIG_W = width;
         EARTH_BIG_H = height;
+
+        earth_pix_gen++;
 }
 
 #if defined(_USE_X11)
@@ -180,6 +197,17 @@ static int myXIOErrorHandler (Display *dpy)
     (void) dpy;
     pthread_exit(NULL);
 }
+
+/* set when XShmAttach() fails, which is reported as an X error, not a return value.
+ */
+static volatile bool shm_attach_failed;
+static int myShmErrorHandler (Display *dpy, XErrorEvent *ep)
+{
+    (void) dpy;
+    (void) ep;
+    shm_attach_failed = true;
+    return (0);
+}
 #endif // _USE_X11
 
 bool Adafruit_RA8875::begin (int not_used)
@@ -206,6 +234,14 @@ bool Adafruit_RA8875::begin (int not_used)
         }
         memset (fb_canvas, 0, fb_nbytes);       // black
 
+        // get memory for the earth layer, see restoreEarth()
+        fb_base = (fbpix_t *) malloc (fb_nbytes);
+        if (!fb_base) {
+            ::printf ("Can not malloc(%d) for earth layer\n", fb_nbytes);
+            exit(1);
+        }
+        memset (fb_base, 0, fb_nbytes);
+
         // get memory for the staging area used to find dirty pixels
         fb_stage = (fbpix_t *) malloc (fb_nbytes);
         if (!fb_stage) {
@@ -318,17 +354,29 @@ bool Adafruit_RA8875::begin (int not_used)
 	}
 	memset (fb_canvas, 0, fb_nbytes);       // black
 
-	// get memory for the staging area used to find dirty pixels
-	fb_stage = (fbpix_t *) malloc (fb_nbytes);
-	if (!fb_stage) {
-	    ::printf ("Can not malloc(%d) for stage\n", fb_nbytes);
+	// get memory for the earth layer, see restoreEarth()
+	fb_base = (fbpix_t *) malloc (fb_nbytes);
+	if (!fb_base) {
+	    ::printf ("Can not malloc(%d) for earth layer\n", fb_nbytes);
 	    exit(1);
 	}
-	memset (fb_stage, 1, fb_nbytes);        // unlikely color
+	memset (fb_base, 0, fb_nbytes);
 
-	// create XImage using staging area
-	img = XCreateImage(display, visual, visdepth, ZPixmap, 0, (char*)fb_stage, FB_XRES, FB_YRES,
-                BITSPFBPIX, 0);
+	// get memory for the staging area used to find dirty pixels and create XImage using it.
+        // share with the server if possible so drawCanvas() need not send the pixels over the connection.
+        use_shm = createShmStage();
+        if (use_shm) {
+            ::printf ("X11: using MIT-SHM\n");
+        } else {
+            fb_stage = (fbpix_t *) malloc (fb_nbytes);
+            if (!fb_stage) {
+                ::printf ("Can not malloc(%d) for stage\n", fb_nbytes);
+                exit(1);
+            }
+            img = XCreateImage(display, visual, visdepth, ZPixmap, 0, (char*)fb_stage, FB_XRES, FB_YRES,
+                    BITSPFBPIX, 0);
+        }
+	memset (fb_stage, 1, fb_nbytes);        // unlikely color
 
 	// create window with initial size, user might resize later
 	XSetWindowAttributes wa;
@@ -512,12 +560,14 @@ bool Adafruit_RA8875::begin (int not_used)
 	memset (fb_canvas, 0, fb_nbytes);       // black
 	fb_stage = (fbpix_t *) malloc (fb_nbytes);
 	fb_cursor = (fbpix_t *) malloc (fb_nbytes);
-	if (!fb_stage || !fb_cursor) {
-	    ::printf ("Can not malloc(%d) for stage or cursor\n", fb_nbytes);
+	fb_base = (fbpix_t *) malloc (fb_nbytes);
+	if (!fb_stage || !fb_cursor || !fb_base) {
+	    ::printf ("Can not malloc(%d) for stage, cursor or earth layer\n", fb_nbytes);
 	    close(fb_fd);
 	    exit(1);
 	}
 	memset (fb_stage, 1, fb_nbytes);        // unlikely color
+	memset (fb_base, 0, fb_nbytes);
 
 	// set up a reentrantable lock
 	pthread_mutexattr_t fb_attr;
@@ -613,21 +663,17 @@ void Adafruit_RA8875::getTextBounds(const char *string, int16_t x, int16_t y,
 
 void Adafruit_RA8875::print (char c)
 {
-	plotChar (c);
+	plotString (&c, 1);
 }
 
 void Adafruit_RA8875::print (char *s)
 {
-	char c;
-	while ((c = *s++) != '\0')
-	    plotChar (c);
+	plotString (s, strlen(s));
 }
 
 void Adafruit_RA8875::print (const char *s)
 {
-	char c;
-	while ((c = *s++) != '\0')
-	    plotChar (c);
+	plotString (s, strlen(s));
 }
 
 void Adafruit_RA8875::print (int i, int b)
@@ -635,32 +681,28 @@ void Adafruit_RA8875::print (int i, int b)
 	char buf[32];
         const char *fmt = (b == 16 ? "%x" : "%d");
 	int sl = snprintf (buf, sizeof(buf), fmt, i);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::print (float f, int p)
 {
 	char buf[32];
 	int sl = snprintf (buf, sizeof(buf), "%.*f", p, f);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::print (long l)
 {
 	char buf[32];
 	int sl = snprintf (buf, sizeof(buf), "%ld", l);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::print (long long ll)
 {
 	char buf[32];
 	int sl = snprintf (buf, sizeof(buf), "%lld", ll);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::printf (const char *fmt, ...)
@@ -786,13 +828,17 @@ bool Adafruit_RA8875::setBackingStore (uint8_t *&backing_store, int x0, int y0,
         const size_t row_bytes = w * sizeof(fbpix_t);
         // TODO : check for failure
 
-        fbpix_t *fb_row = &fb_canvas[y0*FB_XRES + x0];
-        uint8_t *bs_walk = backing_store;
-        for (int y = y0; y < y0+h; y++) {
-            memcpy (fb_row, bs_walk, row_bytes);
-            bs_walk += row_bytes;
-            fb_row += FB_XRES;
-        }
+        pthread_mutex_lock (&fb_lock);
+            fbpix_t *fb_row = &fb_canvas[y0*FB_XRES + x0];
+            uint8_t *bs_walk = backing_store;
+            for (int y = y0; y < y0+h; y++) {
+                memcpy (fb_row, bs_walk, row_bytes);
+                bs_walk += row_bytes;
+                fb_row += FB_XRES;
+            }
+            markDirty (x0, y0, w, h);
+            fb_dirty = true;
+        pthread_mutex_unlock (&fb_lock);
 
         free (backing_store);
         backing_store = NULL;
@@ -817,6 +863,45 @@ bool Adafruit_RA8875::getRawPix(uint8_t *rgb24, int npix)
         return (true);
 }
 
+/* same as getRawPix() but only update the pixels within each tiles[FB_TILE_N] that is set.
+ */
+bool Adafruit_RA8875::getRawPix(uint8_t *rgb24, int npix, const uint8_t *tiles)
+{
+        if (npix != FB_XRES * FB_YRES) {
+            ::printf ("getRawPix: %d != %d\n", npix, FB_XRES * FB_YRES);
+            return (false);
+        }
+        for (int t = 0; t < FB_TILE_N; t++) {
+            if (!tiles[t])
+                continue;
+            int x0 = (t % FB_TILE_NX) * FB_TILE_W;
+            int y0 = (t / FB_TILE_NX) * FB_TILE_H;
+            for (int y = y0; y < y0 + FB_TILE_H; y++) {
+                const fbpix_t *stage_p = &fb_stage[y*FB_XRES + x0];
+                uint8_t *rgb_p = &rgb24[3*(y*FB_XRES + x0)];
+                for (int x = 0; x < FB_TILE_W; x++) {
+                    uint32_t p32 = FBPIXTORGB32(*stage_p++);
+                    *rgb_p++ = p32 >> 16;
+                    *rgb_p++ = p32 >> 8;
+                    *rgb_p++ = p32;
+                }
+            }
+        }
+        return (true);
+}
+
+/* pass back in tiles[FB_TILE_N] whether each tile of fb_stage changed after version seq, then
+ * update seq to the current version. seq 0 marks all tiles.
+ */
+void Adafruit_RA8875::getStageChanges (uint32_t &seq, uint8_t *tiles)
+{
+        pthread_mutex_lock (&fb_lock);
+            for (int t = 0; t < FB_TILE_N; t++)
+                tiles[t] = seq == 0 || stage_tile_seq[t] > seq;
+            seq = stage_seq;
+        pthread_mutex_unlock (&fb_lock);
+}
+
 void Adafruit_RA8875::setFont (const GFXfont *f)
 {
 	if (f)
@@ -1107,6 +1192,18 @@ uint16_t color16)
 	pthread_mutex_unlock (&fb_lock);
 }
 
+/* draw n lines all in one color, each from 4 consecutive raw coords x0 y0 x1 y1 in xy, holding fb_lock just once.
+ */
+void Adafruit_RA8875::drawLinesRaw(const int16_t *xy, int n, int16_t thickness, uint16_t color16)
+{
+	fbpix_t fbpix = RGB16TOFBPIX(color16);
+	pthread_mutex_lock(&fb_lock);
+	    for (int i = 0; i < n; i++, xy += 4)
+	        plotLineRaw (xy[0], xy[1], xy[2], xy[3], thickness, fbpix);
+	    fb_dirty = true;
+	pthread_mutex_unlock (&fb_lock);
+}
+
 /* Adafruit's drawRect of width w draws from x0 through x0+w-1, ie, it draws w pixels wide and skips w-2
  */
 void Adafruit_RA8875::drawRect(int16_t x0, int16_t y0, int16_t w, int16_t h, uint16_t color16)
@@ -1242,6 +1339,14 @@ void Adafruit_RA8875::fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t
         fillTriangleRaw (x0, y0, x1, y1, x2, y2, color16);
 }
 
+/* return the nearest integer to n/d, halves away from zero like roundf().
+ * N.B. d > 0
+ */
+static int roundDiv (int n, int d)
+{
+        return (n >= 0 ? (2*n + d)/(2*d) : -((d - 2*n)/(2*d)));
+}
+
 void Adafruit_RA8875::fillTriangleRaw (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
     uint16_t color16)
 {
@@ -1255,24 +1360,27 @@ void Adafruit_RA8875::fillTriangleRaw (int16_t x0, int16_t y0, int16_t x1, int16
         if (y1 > y2)
            swap2 (x1, y1, x2, y2);
 
+        fbpix = grayFBPix (fbpix);
+
 	pthread_mutex_lock (&fb_lock);
 
             // fill top subtri -- beware flat
             if (y1 != y0 && y2 != y0) {
                 for (int y = y0; y < y1; y += 1) {
-                    int16_t xa = roundf (x0 + (float)(y-y0)*(x1-x0)/(y1-y0));
-                    int16_t xb = roundf (x0 + (float)(y-y0)*(x2-x0)/(y2-y0));
-                    plotLineRaw (xa, y, xb, y, 1, fbpix);
+                    int xa = roundDiv (x0*(y1-y0) + (y-y0)*(x1-x0), y1-y0);
+                    int xb = roundDiv (x0*(y2-y0) + (y-y0)*(x2-x0), y2-y0);
+                    plotSpan (xa, xb, y, fbpix);
                 }
             }
             // fill bottom subtri -- beware flat
             if (y2 != y1 && y2 != y0) {
                 for (int y = y1; y <= y2; y += 1) {
-                    int16_t xa = roundf (x1 + (float)(y-y1)*(x2-x1)/(y2-y1));
-                    int16_t xb = roundf (x0 + (float)(y-y0)*(x2-x0)/(y2-y0));
-                    plotLineRaw (xa, y, xb, y, 1, fbpix);
+                    int xa = roundDiv (x1*(y2-y1) + (y-y1)*(x2-x1), y2-y1);
+                    int xb = roundDiv (x0*(y2-y0) + (y-y0)*(x2-x0), y2-y0);
+                    plotSpan (xa, xb, y, fbpix);
                 }
             }
+            fb_dirty = true;
 
 	pthread_mutex_unlock (&fb_lock);
 }
@@ -1303,10 +1411,14 @@ void Adafruit_RA8875::plotDrawRect (int16_t x0, int16_t y0, int16_t w, int16_t h
  */
 void Adafruit_RA8875::plotFillRect (int16_t x0, int16_t y0, int16_t w, int16_t h, fbpix_t fbpix)
 {
+        // an empty rect draws nothing, do not let plotSpan() swap its ends
+        if (w <= 0 || h <= 0)
+            return;
+
+        fbpix = grayFBPix (fbpix);
 	pthread_mutex_lock (&fb_lock);
-	    for (uint16_t y = y0; y < y0+h; y++)
-		for (uint16_t x = x0; x < x0+w; x++)
-		    plotfb (x, y, fbpix);
+	    for (int y = y0; y < y0+h; y++)
+                plotSpan (x0, x0+w-1, y, fbpix);
 	    fb_dirty = true;
 	pthread_mutex_unlock (&fb_lock);
 }
@@ -1315,16 +1427,32 @@ void Adafruit_RA8875::plotFillRect (int16_t x0, int16_t y0, int16_t w, int16_t h
  */
 void Adafruit_RA8875::plotDrawCircle (int16_t x0, int16_t y0, uint16_t r0, fbpix_t fbpix)
 {
-        // scan a circle from radius r0-1/2 to r0+1/2 to include a whole pixel.
-        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats
-        uint32_t iradius2 = 4*r0*(r0 - 1) + 1;
-        uint32_t oradius2 = 4*r0*(r0 + 1) + 1;
+        // include each pixel whose center lies within r0-1/2 .. r0+1/2.
+        // with integer dx,dy that is r0*(r0-1) < dx^2 + dy^2 <= r0*(r0+1), so each row is the outer span
+        // less the inner span. both half widths only shrink as dy grows so walk them down from the equator.
+        if (r0 == 0)
+            return;
+        int32_t r = r0;
+        int32_t o2 = r*(r + 1);
+        int32_t i2 = r*(r - 1);
+        int32_t wo = r;                                 // outer half width
+        int32_t wi = r - 1;                             // inner half width, -1 when none
+        fbpix = grayFBPix (fbpix);
 	pthread_mutex_lock (&fb_lock);
-	    for (int32_t dy = -2*r0; dy <= 2*r0; dy += 2) {
-                for (int32_t dx = -2*r0; dx <= 2*r0; dx += 2) {
-                    uint32_t xy2 = dx*dx + dy*dy;
-                    if (xy2 >= iradius2 && xy2 <= oradius2)
-			plotfb (x0+dx/2, y0+dy/2, fbpix);
+	    for (int32_t dy = 0; dy <= r; dy++) {
+                while (wo*wo > o2 - dy*dy)
+                    wo--;
+                while (wi >= 0 && wi*wi > i2 - dy*dy)
+                    wi--;
+                for (int32_t sy = dy; sy >= -dy; sy -= 2*dy) {
+                    if (wi < 0)
+                        plotSpan (x0-wo, x0+wo, y0+sy, fbpix);
+                    else {
+                        plotSpan (x0-wo, x0-wi-1, y0+sy, fbpix);
+                        plotSpan (x0+wi+1, x0+wo, y0+sy, fbpix);
+                    }
+                    if (dy == 0)
+                        break;
                 }
             }
 	    fb_dirty = true;
@@ -1336,22 +1464,27 @@ void Adafruit_RA8875::plotDrawCircle (int16_t x0, int16_t y0, uint16_t r0, fbpix
  */
 void Adafruit_RA8875::plotFillCircle(int16_t x0, int16_t y0, uint16_t r0, fbpix_t fbpix)
 {
-        // scan a circle of radius r0+1/2 to include whole pixel.
-        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats
-        uint32_t radius2 = 4*r0*(r0 + 1) + 1;
+        // include each pixel whose center lies within radius r0+1/2.
+        // with integer dx,dy that is dx^2 + dy^2 <= r0*(r0+1) so each row is one span whose
+        // half width only shrinks as dy grows, so walk it down from the equator.
+        int32_t r = r0;
+        int32_t r2 = r*(r + 1);
+        int32_t w = r;
+        fbpix = grayFBPix (fbpix);
 	pthread_mutex_lock (&fb_lock);
-	    for (int32_t dy = -2*r0; dy <= 2*r0; dy += 2) {
-                for (int32_t dx = -2*r0; dx <= 2*r0; dx += 2) {
-                    uint32_t xy2 = dx*dx + dy*dy;
-                    if (xy2 <= radius2)
-			plotfb (x0+dx/2, y0+dy/2, fbpix);
-                }
+	    for (int32_t dy = 0; dy <= r; dy++) {
+                while (w*w > r2 - dy*dy)
+                    w--;
+                plotSpan (x0-w, x0+w, y0+dy, fbpix);
+                if (dy > 0)
+                    plotSpan (x0-w, x0+w, y0-dy, fbpix);
             }
 	    fb_dirty = true;
 	pthread_mutex_unlock (&fb_lock);
 }
 
 
+
 /********************************************************************************************************
  *
  * thick brezenham from https://github.com/ArminJo/Arduino-BlueDisplay/blob/master/src/LocalGUI/ThickLine.hpp
@@ -1650,32 +1783,155 @@ int16_t thick, fbpix_t color)
 
 
 
-/* place the given raw pixel at the given raw frame buffer location.
+/* return color as it will be stored in fb_canvas, ie, after applying gray_type.
+ * the fill primitives call this once per call rather than once per pixel.
  */
-void Adafruit_RA8875::plotfb (int16_t x, int16_t y, fbpix_t color)
+fbpix_t Adafruit_RA8875::grayFBPix (fbpix_t color)
 {
-        // perform gray_type
         switch (gray_type) {
         case GRAY_OFF:
         case GRAY_MAP:
             // no change -- color ok
             break;
-        case GRAY_ALL: {
-            uint32_t rgb = FBPIXTORGB32(color);
-            int r = (rgb >> 16) & 0xff;
-            int g = (rgb >> 8) & 0xff;
-            int b = rgb & 0xff;
-            int gray = RGB2GRAY(r,g,b);
-            color = RGB32TOFBPIX ((gray<<16) | (gray<<8) | (gray));
-            }
+        case GRAY_ALL:
+#if defined(_16BIT_FB)
+            color = grayRGB565 (color);
+#else
+            color = grayRGB32 (color);
+#endif
             break;
         }
+        return (color);
+}
+
+/* fill raw pixels x0 .. x1 inclusive of row y with color, clipped to the frame buffer.
+ * color must already be from grayFBPix(). caller must hold fb_lock.
+ */
+void Adafruit_RA8875::plotSpan (int x0, int x1, int y, fbpix_t color)
+{
+        if (x0 > x1) {
+            int t = x0;
+            x0 = x1;
+            x1 = t;
+        }
+        if (y < 0 || y >= FB_YRES || x1 < 0 || x0 >= FB_XRES)
+            return;
+        if (x0 < 0)
+            x0 = 0;
+        if (x1 >= FB_XRES)
+            x1 = FB_XRES - 1;
+
+        // plain store loop that compilers turn into wide vector stores
+        fbpix_t *pix = &fb_canvas[y*FB_XRES + x0];
+        for (int n = x1 - x0 + 1; n > 0; --n)
+            *pix++ = color;
+
+        const int row = (y/FB_TILE_H)*FB_TILE_NX;
+        for (int tx = x0/FB_TILE_W; tx <= x1/FB_TILE_W; tx++)
+            markTile (row + tx);
+}
+
+/* place the given raw pixel at the given raw frame buffer location.
+ */
+void Adafruit_RA8875::plotfb (int16_t x, int16_t y, fbpix_t color)
+{
+        color = grayFBPix (color);
 
         int index = y*FB_XRES + x;
         if (index < 0 || index >= FB_XRES*FB_YRES)
             ::printf ("no! %d %d\n", x, y);
-        else
+        else {
             fb_canvas[index] = color;
+            markTile ((index/(FB_XRES*FB_TILE_H))*FB_TILE_NX + (index%FB_XRES)/FB_TILE_W);
+        }
+}
+
+/* mark the tiles of fb_canvas touched by the given raw rectangle as changed.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::markDirty (int x, int y, int w, int h)
+{
+        // clip to fb
+        if (x < 0) {
+            w += x;
+            x = 0;
+        }
+        if (y < 0) {
+            h += y;
+            y = 0;
+        }
+        if (x + w > FB_XRES)
+            w = FB_XRES - x;
+        if (y + h > FB_YRES)
+            h = FB_YRES - y;
+        if (w <= 0 || h <= 0)
+            return;
+
+        int tx1 = (x + w - 1)/FB_TILE_W;
+        int ty1 = (y + h - 1)/FB_TILE_H;
+        for (int ty = y/FB_TILE_H; ty <= ty1; ty++)
+            for (int tx = x/FB_TILE_W; tx <= tx1; tx++)
+                markTile (ty*FB_TILE_NX + tx);
+}
+
+/* mark all tiles of fb_canvas as changed.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::markAllDirty (void)
+{
+        for (int t = 0; t < FB_TILE_N; t++)
+            markTile (t);
+}
+
+/* copy the n pixels at canvas_p to stage_p if different, return whether they were.
+ */
+static bool stageSpan (const fbpix_t *canvas_p, fbpix_t *stage_p, int n)
+{
+        if (n <= 0 || memcmp (stage_p, canvas_p, n*sizeof(fbpix_t)) == 0)
+            return (false);
+        memcpy (stage_p, canvas_p, n*sizeof(fbpix_t));
+        return (true);
+}
+
+/* copy the given tile from fb_canvas to fb_stage if it is marked as changed, skipping the protected region
+ * unless pr_draw is set. stamp each changed tile with the next stage_seq; caller must advance stage_seq if
+ * any changed.
+ * return whether any fb_stage pixels changed.
+ * N.B. we assume fb_lock is held
+ */
+bool Adafruit_RA8875::stageTile (int tile)
+{
+        uint8_t flags = fb_tiles[tile];
+        if (!(flags & TILE_DIRTY) && !(pr_draw && flags))
+            return (false);
+
+        int x0 = (tile % FB_TILE_NX) * FB_TILE_W;
+        int y0 = (tile / FB_TILE_NX) * FB_TILE_H;
+        int x1 = x0 + FB_TILE_W;
+        int y1 = y0 + FB_TILE_H;
+
+        // check whether protected region must be skipped within this tile
+        bool skip_pr = !pr_draw && pr_w > 0 && pr_h > 0 && pr_x < x1 && pr_x + pr_w > x0
+                                && pr_y < y1 && pr_y + pr_h > y0;
+        int pr_l = pr_x > x0 ? pr_x : x0;                              // left edge of pr within tile
+        int pr_r = pr_x + pr_w < x1 ? pr_x + pr_w : x1;                // right edge of pr within tile
+
+        bool changed = false;
+        for (int y = y0; y < y1; y++) {
+            const fbpix_t *canvas_p = &fb_canvas[y*FB_XRES];
+            fbpix_t *stage_p = &fb_stage[y*FB_XRES];
+            if (skip_pr && y >= pr_y && y < pr_y + pr_h) {
+                changed |= stageSpan (canvas_p + x0, stage_p + x0, pr_l - x0);
+                changed |= stageSpan (canvas_p + pr_r, stage_p + pr_r, x1 - pr_r);
+            } else
+                changed |= stageSpan (canvas_p + x0, stage_p + x0, FB_TILE_W);
+        }
+
+        fb_tiles[tile] = skip_pr ? TILE_PRPEND : 0;
+        if (changed)
+            stage_tile_seq[tile] = stage_seq + 1;
+
+        return (changed);
 }
 
 /* plot hi res earth lat0,lng0 at app's screen location x0,y0.
@@ -1684,10 +1940,28 @@ void Adafruit_RA8875::plotfb (int16_t x, int16_t y, fbpix_t color)
  */
 void Adafruit_RA8875::plotEarth (uint16_t x0, uint16_t y0, float lat0, float lng0,
 float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
+{
+        uint32_t texels[(FB_XRES/APP_WIDTH)*(FB_XRES/APP_WIDTH)];
+        uint16_t weights[(FB_XRES/APP_WIDTH)*(FB_XRES/APP_WIDTH)];
+        if (getEarthTexels (lat0, lng0, dlatr, dlngr, dlatd, dlngd, texels)) {
+            uint16_t w = pixBlendWeight (fract_day);
+            for (int i = 0; i < SCALESZ*SCALESZ; i++)
+                weights[i] = w;
+            plotEarthTexels (x0, y0, 1, texels, weights);
+        }
+}
+
+/* find the SCALESZ x SCALESZ earth image texels for the app pixel at lat0,lng0, knowing dlat and dlng
+ * going one full step right and down. texels must have room for SCALESZ*SCALESZ entries, row major.
+ * each is stored as EARTH_TEXEL(row,col) so callers may also find its lat and lng.
+ * return whether any earth images are available.
+ */
+bool Adafruit_RA8875::getEarthTexels (float lat0, float lng0, float dlatr, float dlngr, float dlatd,
+float dlngd, uint32_t *texels)
 {
         // beware of no map files
         if (!DEARTH_BIG || !NEARTH_BIG)
-            return;
+            return (false);
 
         // beware lng wrap across date line
         if (dlngr < -180) dlngr += 360;
@@ -1701,12 +1975,7 @@ float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
         dlatd /= SCALESZ;
         dlngd /= SCALESZ;
 
-        // ditto starting loc
-	x0 *= SCALESZ;
-	y0 *= SCALESZ;
-
 	for (int r = 0; r < SCALESZ; r++) {
-	    fbpix_t *frow = &fb_canvas[(y0+r)*FB_XRES + x0];
 	    for (int c = 0; c < SCALESZ; c++) {
                 float lat = lat0 + dlatr*c + dlatd*r;
                 float lng = lng0 + dlngr*c + dlngd*r;
@@ -1714,54 +1983,202 @@ float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
                 int ey = (int)((90-lat)*EARTH_BIG_H/180 + EARTH_BIG_H + 0.5F);
                 ex = (ex + EARTH_BIG_W) % EARTH_BIG_W;
                 ey = (ey + EARTH_BIG_H) % EARTH_BIG_H;
-		uint16_t c16; 
-		if (fract_day == 0) {
-		    c16 = EPIXEL(NEARTH_BIG,ey,ex);
-		} else if (fract_day == 1) {
-		    c16 = EPIXEL(DEARTH_BIG,ey,ex);
-		} else {
-		    // blend from day to night
-		    uint16_t day_pix = EPIXEL(DEARTH_BIG,ey,ex);
-		    uint16_t night_pix = EPIXEL(NEARTH_BIG,ey,ex);
-		    uint8_t day_r = RGB565_R(day_pix);
-		    uint8_t day_g = RGB565_G(day_pix);
-		    uint8_t day_b = RGB565_B(day_pix);
-		    uint8_t night_r = RGB565_R(night_pix);
-		    uint8_t night_g = RGB565_G(night_pix);
-		    uint8_t night_b = RGB565_B(night_pix);
-		    float fract_night = 1 - fract_day;
-		    uint8_t twi_r = (fract_day*day_r + fract_night*night_r);
-		    uint8_t twi_g = (fract_day*day_g + fract_night*night_g);
-		    uint8_t twi_b = (fract_day*day_b + fract_night*night_b);
-		    c16 = RGB565 (twi_r, twi_g, twi_b);
-		}
-		*frow++ = RGB16TOFBPIX(c16);
+                *texels++ = EARTH_TEXEL (ey, ex);
 	    }
 	}
+
+        return (true);
+}
+
+// max frame buffer pixels plotEarthTexels() blends at once
+#define EROW_MAX 256
+
+/* plot the SCALESZ x SCALESZ earth image pixels found with getEarthTexels() for each of n app pixels in a
+ * row starting at app's screen location x0,y0. texels holds n sets of SCALESZ*SCALESZ.
+ * weights is laid out the same as texels and each is PIXBLEND_ONE for all DEARTH, 0 for all NEARTH else blend.
+ */
+void Adafruit_RA8875::plotEarthTexels (uint16_t x0, uint16_t y0, int n, const uint32_t *texels,
+const uint16_t *weights)
+{
+        // beware of no map files
+        if (!DEARTH_BIG || !NEARTH_BIG)
+            return;
+
+        // blend one frame buffer row of a chunk of app pixels at a time
+        uint16_t day[EROW_MAX], night[EROW_MAX], weight[EROW_MAX];
+        const int chunk = EROW_MAX/SCALESZ;
+
+        for (int i0 = 0; i0 < n; i0 += chunk) {
+
+            int n_app = n - i0 < chunk ? n - i0 : chunk;
+            int n_fb = n_app*SCALESZ;
+
+            for (int r = 0; r < SCALESZ; r++) {
+
+                // gather, skipping the image that has no weight
+                const int rc0 = (i0*SCALESZ + r)*SCALESZ;
+                const uint32_t *tp = &texels[rc0];
+                const uint16_t *wp = &weights[rc0];
+                for (int i = 0; i < n_app; i++) {
+                    for (int c = 0; c < SCALESZ; c++) {
+                        int k = i*SCALESZ + c;
+                        uint16_t w = weight[k] = wp[c];
+
+                        // beware texels from a previous map size
+                        uint32_t er = EARTH_TEXEL_R(tp[c]);
+                        uint32_t ec = EARTH_TEXEL_C(tp[c]);
+                        if (er >= (uint32_t)EARTH_BIG_H || ec >= (uint32_t)EARTH_BIG_W)
+                            er = ec = 0;
+
+                        day[k] = w > 0 ? EPIXEL (DEARTH_BIG, er, ec) : 0;
+                        night[k] = w < PIXBLEND_ONE ? EPIXEL (NEARTH_BIG, er, ec) : 0;
+                    }
+                    tp += SCALESZ*SCALESZ;
+                    wp += SCALESZ*SCALESZ;
+                }
+
+                // blend in place then copy to the earth layer and on to canvas
+                blendRGB565Row (day, night, weight, day, n_fb);
+                const int fb_i = (y0*SCALESZ+r)*FB_XRES + (x0+i0)*SCALESZ;
+                fbpix_t *brow = &fb_base[fb_i];
+                for (int k = 0; k < n_fb; k++)
+                    brow[k] = RGB16TOFBPIX(day[k]);
+                memcpy (&fb_canvas[fb_i], brow, n_fb*sizeof(fbpix_t));
+            }
+        }
+
+        // mark after drawing so drawCanvas() can not miss these pixels.
+        // N.B. we are called from the map threads without fb_lock held
+        pthread_mutex_lock (&fb_lock);
+            markDirty (x0*SCALESZ, y0*SCALESZ, n*SCALESZ, SCALESZ);
+            fb_dirty = true;
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* copy the n app pixels in the row starting at app's screen location x0,y0 back to the canvas from the
+ * earth layer as last plotted there by plotEarthTexels(), erasing whatever has been drawn over them since.
+ */
+void Adafruit_RA8875::restoreEarth (uint16_t x0, uint16_t y0, int n)
+{
+        const int n_fb = n*SCALESZ;
+        for (int r = 0; r < SCALESZ; r++) {
+            const int fb_i = (y0*SCALESZ+r)*FB_XRES + x0*SCALESZ;
+            memcpy (&fb_canvas[fb_i], &fb_base[fb_i], n_fb*sizeof(fbpix_t));
+        }
+
+        pthread_mutex_lock (&fb_lock);
+            markDirty (x0*SCALESZ, y0*SCALESZ, n_fb, SCALESZ);
+            fb_dirty = true;
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* start or stop noting which tiles are drawn, see getOverlayTiles().
+ */
+void Adafruit_RA8875::trackOverlays (bool on)
+{
+        pthread_mutex_lock (&fb_lock);
+            if (on)
+                memset (fb_ovl_tiles, 0, sizeof(fb_ovl_tiles));
+            fb_ovl_track = on;
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* pass back in tiles[FB_TILE_N] whether each tile was drawn during the latest trackOverlays().
+ */
+void Adafruit_RA8875::getOverlayTiles (uint8_t *tiles)
+{
+        pthread_mutex_lock (&fb_lock);
+            memcpy (tiles, fb_ovl_tiles, sizeof(fb_ovl_tiles));
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* return the glyph runs of font f, decoding them on first use.
+ * caller must hold fb_lock.
+ */
+const Adafruit_RA8875::GlyphAtlas *Adafruit_RA8875::getGlyphAtlas (const GFXfont *f)
+{
+        for (int i = 0; i < n_glyph_atlas; i++)
+            if (glyph_atlas[i].font == f)
+                return (&glyph_atlas[i]);
+
+        // new font, reuse the last slot if full
+        if (n_glyph_atlas == MAX_GLYPH_ATLAS) {
+            GlyphAtlas &old = glyph_atlas[--n_glyph_atlas];
+            free (old.first);
+            free (old.runs);
+        }
+        GlyphAtlas &ga = glyph_atlas[n_glyph_atlas];
+        int n_glyphs = f->last - f->first + 1;
+        ga.font = f;
+        ga.first = (uint32_t *) malloc ((n_glyphs + 1) * sizeof(uint32_t));
+        ga.runs = NULL;
+        if (!ga.first) {
+            ::printf ("Can not malloc glyph atlas\n");
+            exit(1);
+        }
+
+        // scan each glyph bitmap row by row, collecting each run of set bits
+        int n_runs = 0, n_malloc = 0;
+        for (int g = 0; g < n_glyphs; g++) {
+            const GFXglyph *gp = &f->glyph[g];
+            const uint8_t *bp = &f->bitmap[gp->bitmapOffset];
+            uint32_t bitn = 0;
+            ga.first[g] = n_runs;
+            for (int r = 0; r < gp->height; r++) {
+                int run0 = -1;
+                for (int c = 0; c <= gp->width; c++) {
+                    bool bit = c < gp->width && (bp[bitn/8] & (1 << (7-(bitn%8))));
+                    if (c < gp->width)
+                        bitn++;
+                    if (bit && run0 < 0)
+                        run0 = c;
+                    else if (!bit && run0 >= 0) {
+                        if (n_runs == n_malloc) {
+                            n_malloc += 1024;
+                            ga.runs = (GlyphRun *) realloc (ga.runs, n_malloc * sizeof(GlyphRun));
+                            if (!ga.runs) {
+                                ::printf ("Can not realloc glyph atlas to %d\n", n_malloc);
+                                exit(1);
+                            }
+                        }
+                        GlyphRun &gr = ga.runs[n_runs++];
+                        gr.dx = gp->xOffset + run0;
+                        gr.dy = gp->yOffset + r;
+                        gr.len = c - run0;
+                        run0 = -1;
+                    }
+                }
+            }
+        }
+        ga.first[n_glyphs] = n_runs;
+
+        n_glyph_atlas++;
+        return (&ga);
 }
 
-void Adafruit_RA8875::plotChar (char ch)
+/* draw the n chars of s at the cursor in current_font and text_color, advancing the cursor.
+ * each glyph is drawn as its prepared runs of set pixels, all within one hold of fb_lock.
+ */
+void Adafruit_RA8875::plotString (const char *s, int n)
 {
-	if (ch < current_font->first || ch > current_font->last)
-	    return;     // don't print if don't count length
-	GFXglyph *gp = &current_font->glyph[ch-current_font->first];
-	uint8_t *bp = &current_font->bitmap[gp->bitmapOffset];
-	int16_t x = cursor_x + gp->xOffset;
-	int16_t y = cursor_y + gp->yOffset;
-	uint16_t bitn = 0;
+        fbpix_t color = grayFBPix (text_color);
+
 	pthread_mutex_lock (&fb_lock);
-	    for (uint16_t r = 0; r < gp->height; r++) {
-		for (uint16_t c = 0; c < gp->width; c++) {
-		    uint8_t bit = bp[bitn/8] & (1 << (7-(bitn%8)));
-		    if (bit)
-			plotfb (x+c, y+r, text_color);
-		    bitn++;
-		}
-	    }
+            const GlyphAtlas *ga = getGlyphAtlas (current_font);
+            for (int i = 0; i < n; i++) {
+                char ch = s[i];
+                if (ch < current_font->first || ch > current_font->last)
+                    continue;   // don't print if don't count length
+                int g = ch - current_font->first;
+                for (uint32_t k = ga->first[g]; k < ga->first[g+1]; k++) {
+                    const GlyphRun &gr = ga->runs[k];
+                    int x = (int16_t)(cursor_x + gr.dx);
+                    plotSpan (x, x + gr.len - 1, (int16_t)(cursor_y + gr.dy), color);
+                }
+                cursor_x += current_font->glyph[g].xAdvance;
+            }
 	    fb_dirty = true;
 	pthread_mutex_unlock (&fb_lock);
-
-	cursor_x += gp->xAdvance;
 }
 
 /* store the desired protect drawing region
@@ -1850,48 +2267,29 @@ void *Adafruit_RA8875::fbThreadHelper(void *me)
 // _USE_X11
 void Adafruit_RA8875::drawCanvas()
 {
-        // send one block containing the rectangular bounding box of the changed pixels. smaller
-        // transations would send fewer pixels but each transaction is expensive.. found no happy medium.
+        // stage each changed tile then send each run of changed tiles across a row of tiles as one region.
+        // each transaction is expensive so we don't send every tile separately, but nor do we send one
+        // bounding box spanning every change.
 
         bool any_change = false;
 
-        // bounding box
-        int bb_x0 = 0, bb_y0 = 0, bb_x1 = 0, bb_y1 = 0;
-
-        for (int y = 0; y < FB_YRES; y++) {
-
-            // we assume protected region is at lower right
-            int max_x = pr_draw || pr_w == 0 || y < pr_y ? FB_XRES : pr_x;
-
-            // handy start of this row
-            fbpix_t *stage_p = &fb_stage[y*FB_XRES];
-            fbpix_t *canvas_p = &fb_canvas[y*FB_XRES];
-
-            for (int x = 0; x < FB_XRES; x++) {
-
-                int max_y = pr_draw || pr_h == 0 || x < pr_x ? FB_YRES : pr_y;
-                if (x >= max_x && y >= max_y)
-                    continue;
-
-                if (stage_p[x] != canvas_p[x]) {
-
-                    // update pixel
-                    stage_p[x] = canvas_p[x];
-
-                    // update bounding box
-                    if (!any_change) {
-                        bb_x0 = bb_x1 = x;
-                        bb_y0 = bb_y1 = y;
-                    }
-                    if (x < bb_x0)
-                        bb_x0 = x;
-                    if (x > bb_x1)
-                        bb_x1 = x;
-                    if (y > bb_y1)
-                        bb_y1 = y;
-                    // y can't get any smaller
-
-                    // found something to do
+        for (int ty = 0; ty < FB_TILE_NY; ty++) {
+            int run_tx = -1;                            // first tile of current run, if any
+            for (int tx = 0; tx <= FB_TILE_NX; tx++) {
+                if (tx < FB_TILE_NX && stageTile (ty*FB_TILE_NX + tx)) {
+                    if (run_tx < 0)
+                        run_tx = tx;
+                } else if (run_tx >= 0) {
+                    int x = run_tx*FB_TILE_W;
+                    int y = ty*FB_TILE_H;
+                    int nx = (tx-run_tx)*FB_TILE_W;
+                    int ny = FB_TILE_H;
+                    if (use_shm)
+                        XShmPutImage(display, pixmap, black_gc, img, x, y, x, y, nx, ny, False);
+                    else
+                        XPutImage(display, pixmap, black_gc, img, x, y, x, y, nx, ny);
+                    XCopyArea(display, pixmap, win, black_gc, x, y, nx, ny, FB_X0+x, FB_Y0+y);
+                    run_tx = -1;
                     any_change = true;
                 }
             }
@@ -1899,21 +2297,79 @@ void Adafruit_RA8875::drawCanvas()
 
         if (any_change) {
 
-            // update bounding box (inclusive of both edges)
-            int nx = bb_x1-bb_x0+1;
-            int ny = bb_y1-bb_y0+1;
-            XPutImage(display, pixmap, black_gc, img, bb_x0, bb_y0, bb_x0, bb_y0, nx, ny);
-            XCopyArea(display, pixmap, win, black_gc, bb_x0, bb_y0, nx, ny, FB_X0+bb_x0, FB_Y0+bb_y0);
-
-            // struct timeval tv;
-            // gettimeofday(&tv, NULL);
-            // ::printf ("XCopyArea %ld.%06ld [%6d, %6d] %6d x %6d = %6d\n", tv.tv_sec, tv.tv_usec, bb_x0, bb_y0, nx, ny, nx*ny);
+            // new fb_stage version
+            stage_seq++;
 
-            // let server catch up before next loop
+            // let server catch up before next loop.
+            // N.B. with use_shm this also insures the server is done reading fb_stage before we change it.
             XSync (display, false);
         }
 }
 
+/* try to create fb_stage in memory shared with the X server and img to describe it.
+ * return whether successful, else caller must create both the ordinary way. Reasons this can fail
+ * include the server lacking the MIT-SHM extension or running on a different host.
+ */
+// _USE_X11
+bool Adafruit_RA8875::createShmStage()
+{
+        if (!XShmQueryExtension (display)) {
+            ::printf ("X11: MIT-SHM not available\n");
+            return (false);
+        }
+
+        // image layout must match fb_stage exactly
+        img = XShmCreateImage (display, visual, visdepth, ZPixmap, NULL, &shminfo, FB_XRES, FB_YRES);
+        if (!img) {
+            ::printf ("X11: XShmCreateImage failed\n");
+            return (false);
+        }
+        if (img->bits_per_pixel != BITSPFBPIX || img->bytes_per_line != FB_XRES*BYTESPFBPIX) {
+            ::printf ("X11: MIT-SHM image is %d bits/pixel %d bytes/line\n", img->bits_per_pixel,
+                                img->bytes_per_line);
+            XDestroyImage (img);
+            return (false);
+        }
+
+        // get the shared memory
+        shminfo.shmid = shmget (IPC_PRIVATE, fb_nbytes, IPC_CREAT | 0600);
+        if (shminfo.shmid < 0) {
+            ::printf ("X11: shmget(%d): %s\n", fb_nbytes, strerror(errno));
+            XDestroyImage (img);
+            return (false);
+        }
+        shminfo.shmaddr = img->data = (char *) shmat (shminfo.shmid, NULL, 0);
+        shminfo.readOnly = True;
+        if (shminfo.shmaddr == (char *)-1) {
+            ::printf ("X11: shmat(): %s\n", strerror(errno));
+            shmctl (shminfo.shmid, IPC_RMID, NULL);
+            img->data = NULL;
+            XDestroyImage (img);
+            return (false);
+        }
+
+        // tell the server; failure arrives as an error event so sync and check
+        shm_attach_failed = false;
+        XErrorHandler prev_handler = XSetErrorHandler (myShmErrorHandler);
+        XShmAttach (display, &shminfo);
+        XSync (display, false);
+        XSetErrorHandler (prev_handler);
+
+        // segment is now destroyed automatically after both we and the server detach, even if we crash
+        shmctl (shminfo.shmid, IPC_RMID, NULL);
+
+        if (shm_attach_failed) {
+            ::printf ("X11: XShmAttach failed\n");
+            shmdt (shminfo.shmaddr);
+            img->data = NULL;
+            XDestroyImage (img);
+            return (false);
+        }
+
+        fb_stage = (fbpix_t *) shminfo.shmaddr;
+        return (true);
+}
+
 // _USE_X11
 void Adafruit_RA8875::X11OptionsEngageNow (bool fs)
 {
@@ -2301,7 +2757,11 @@ void Adafruit_RA8875::fbThread ()
 		    XFillRectangle (display, win, black_gc, FB_X0 + FB_XRES, FB_Y0, FB_X0+1, FB_YRES);
 		    XFillRectangle (display, win, black_gc, 0, FB_Y0 + FB_YRES, fb_si.xres, FB_Y0+1);
                     // invalidate staging area to get a full refresh
-                    memset (fb_stage, ~0, fb_nbytes);
+                    pthread_mutex_lock (&fb_lock);
+                        memset (fb_stage, ~0, fb_nbytes);
+                        markAllDirty();
+                        fb_dirty = true;
+                    pthread_mutex_unlock (&fb_lock);
 
                     saveWinGeom();
 
@@ -2446,24 +2906,13 @@ void Adafruit_RA8875::fbThread ()
 // _WEB_ONLY
 void Adafruit_RA8875::drawCanvas()
 {
-        for (int y = 0; y < FB_YRES; y++) {
-
-            // we assume protected region is at lower right
-            int max_x = pr_draw || pr_w == 0 || y < pr_y ? FB_XRES : pr_x;
-
-            // handy start of this row
-            fbpix_t *stage_p = &fb_stage[y*FB_XRES];
-            fbpix_t *canvas_p = &fb_canvas[y*FB_XRES];
-
-            for (int x = 0; x < FB_XRES; x++) {
-
-                int max_y = pr_draw || pr_h == 0 || x < pr_x ? FB_YRES : pr_y;
-                if (x >= max_x && y >= max_y)
-                    continue;
-
-                stage_p[x] = canvas_p[x];
-            }
-        }
+        // just stage each changed tile
+        bool any_change = false;
+        for (int t = 0; t < FB_TILE_N; t++)
+            if (stageTile (t))
+                any_change = true;
+        if (any_change)
+            stage_seq++;
 }
 
 // _WEB_ONLY
@@ -2869,28 +3318,13 @@ void Adafruit_RA8875::setCursorIfVis (uint16_t row, uint16_t col, fbpix_t color)
 // _USE_FB0
 void Adafruit_RA8875::drawCanvas()
 {
-        // put only the unproteced region unless pr_draw is set
-        if (pr_draw) {
-            // draw everything
-            memcpy (fb_stage, fb_canvas, fb_nbytes);
-        } else {
-            // draw only around the protected area
-            uint16_t bw = FB_XRES*BYTESPFBPIX;                                  // bytes wide
-            uint16_t pr_r = pr_x + pr_w;                                        // right of PR
-            uint16_t pr_b = pr_y + pr_h;                                        // bottom of PR
-            fbpix_t *s_row = fb_stage;                                          // next stage row
-            fbpix_t *c_row = fb_canvas;                                         // next canvas row
-            for (uint16_t y = 0; y < FB_YRES; y++, c_row += FB_XRES, s_row += FB_XRES) {
-                if (y < pr_y) {
-                    memcpy (s_row, c_row, bw);                                  // above
-                } else if (y < pr_b) {
-                    memcpy (s_row, c_row, pr_x*BYTESPFBPIX);                    // left
-                    memcpy (s_row+pr_r, c_row+pr_r, (FB_XRES-pr_r)*BYTESPFBPIX);// right
-                } else {
-                    memcpy (s_row, c_row, bw);                                  // below
-                }
-            }
-        }
+        // stage each changed tile, these skip the protected region unless pr_draw is set
+        bool any_change = false;
+        for (int t = 0; t < FB_TILE_N; t++)
+            if (stageTile (t))
+                any_change = true;
+        if (any_change)
+            stage_seq++;
 }
 
 /* thread that runs forever to update display buffer whenever fb_canvas changes
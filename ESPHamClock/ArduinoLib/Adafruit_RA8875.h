@@ -15,6 +15,9 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
 #endif // _USE_X11
 
@@ -39,6 +42,7 @@ struct fb_var_screeninfo {
 
 
 #include "gfxfont.h"
+#include "pixblend.h"
 extern const GFXfont Courier_Prime_Sans6pt7b;
 
 #define	RA8875_800x480 1
@@ -162,6 +166,7 @@ class Adafruit_RA8875 {
         // non-standard access to full underlying resolution
 	void drawPixelRaw(int16_t x, int16_t y, uint16_t color16);
 	void drawLineRaw(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t thickness, uint16_t color16);
+	void drawLinesRaw(const int16_t *xy, int n, int16_t thickness, uint16_t color16);
 	void fillRectRaw(int16_t x0, int16_t y0, int16_t w, int16_t h, uint16_t color16);
 	void drawRectRaw(int16_t x0, int16_t y0, int16_t w, int16_t h, uint16_t color16);
 	void fillCircleRaw(int16_t x0, int16_t y0, uint16_t r, uint16_t color16);
@@ -172,6 +177,23 @@ class Adafruit_RA8875 {
 	void plotEarth (uint16_t x0, uint16_t y0, float lat0, float lng0,
             float dlatr, float dlngr, float dlatd, float dlngd, float fract_day);
 
+        // same but split so callers may cache the SCALESZ x SCALESZ earth image texels of each app pixel
+        // and blend each with its own weight. each texel is EARTH_TEXEL(row,col) within getEarthSize().
+        bool getEarthTexels (float lat0, float lng0, float dlatr, float dlngr, float dlatd, float dlngd,
+            uint32_t *texels);
+        void plotEarthTexels (uint16_t x0, uint16_t y0, int n, const uint32_t *texels, const uint16_t *weights);
+
+        // plotEarthTexels() also keeps each pixel in a separate earth layer so callers may erase whatever
+        // they draw over the earth by copying it back with restoreEarth() rather than plotting it again.
+        void restoreEarth (uint16_t x0, uint16_t y0, int n);
+        void getEarthSize (int &w, int &h) { w = EARTH_BIG_W; h = EARTH_BIG_H; }
+        #define EARTH_TEXEL(r,c)        (((uint32_t)(r) << 16) | (uint32_t)(c))
+        #define EARTH_TEXEL_R(t)        ((t) >> 16)
+        #define EARTH_TEXEL_C(t)        ((t) & 0xFFFF)
+
+        // changes whenever setEarthPix() is called so callers know their cached texels are stale
+        int getEarthPixGen (void) { return (earth_pix_gen); }
+
         // methods to implement a protected rectangle drawn only with drawPR()
         void setPR (uint16_t x, uint16_t y, uint16_t w, uint16_t h);
         void drawPR(void);
@@ -249,6 +271,47 @@ class Adafruit_RA8875 {
 
 #endif
 
+    public:
+
+        // drawing marks which FB_TILE_W x FB_TILE_H tiles of fb_canvas change so drawCanvas() need only
+        // visit those. each size divides the fb evenly and is a multiple of the liveweb block sizes.
+        #define FB_TILE_W       32
+        #define FB_TILE_H       32
+        #define FB_TILE_NX      (FB_XRES/FB_TILE_W)
+        #define FB_TILE_NY      (FB_YRES/FB_TILE_H)
+        #define FB_TILE_N       (FB_TILE_NX*FB_TILE_NY)
+
+        // pass back in tiles[FB_TILE_N] whether each tile of the displayed image changed after version seq,
+        // then update seq to the current version. start with seq 0 to get all.
+        void getStageChanges (uint32_t &seq, uint8_t *tiles);
+
+        // same as getRawPix() but only updates the pixels in the given tiles[FB_TILE_N]
+        bool getRawPix (uint8_t *rgb24, int npix, const uint8_t *tiles);
+
+        // while trackOverlays(true) also note which tiles drawing touches, starting afresh each time.
+        // getOverlayTiles() passes back that set in tiles[FB_TILE_N] so the next pass may restoreEarth()
+        // only within them, leaving alone whatever else has been drawn over the earth.
+        void trackOverlays (bool on);
+        void getOverlayTiles (uint8_t *tiles);
+
+    private:
+
+        #define TILE_DIRTY      0x1             // fb_tiles: tile changed since last drawCanvas()
+        #define TILE_PRPEND     0x2             // fb_tiles: protected region portion not yet staged
+        uint8_t fb_tiles[FB_TILE_N];            // TILE_* flags for each tile of fb_canvas
+        uint32_t stage_seq;                     // incremented each time drawCanvas() changes fb_stage
+        uint32_t stage_tile_seq[FB_TILE_N];     // stage_seq when each tile of fb_stage last changed
+        uint8_t fb_ovl_tiles[FB_TILE_N];        // set for each tile drawn while fb_ovl_track
+        bool fb_ovl_track;                      // see trackOverlays()
+        void markTile (int tile) {
+            fb_tiles[tile] |= TILE_DIRTY;
+            if (fb_ovl_track)
+                fb_ovl_tiles[tile] = 1;
+        }
+        void markDirty (int x, int y, int w, int h);
+        void markAllDirty (void);
+        bool stageTile (int tile);
+
 #ifdef _USE_X11
 
 	Display *display;
@@ -258,6 +321,8 @@ class Adafruit_RA8875 {
 	GC black_gc;
 	XImage *img;
 	Pixmap pixmap;
+        XShmSegmentInfo shminfo;                // fb_stage shared with server if use_shm
+        bool use_shm;
         Atom wmDeleteMessage;
 
         // used by X11OptionsEngageNow
@@ -269,6 +334,7 @@ class Adafruit_RA8875 {
         int decodeMouseButton (XEvent event);
 
         void saveWinGeom(void);
+        bool createShmStage(void);
 
 #endif // _USE_X11
 
@@ -326,8 +392,24 @@ class Adafruit_RA8875 {
 	volatile bool fb_dirty;
 	fbpix_t *fb_canvas;             // main drawing image buffer
 	fbpix_t *fb_stage;              // temp image during staging to fb hw
+	fbpix_t *fb_base;               // earth layer, see restoreEarth()
 	int fb_nbytes;                  // bytes in each in-memory image buffer
-	void plotChar (char c);
+	void plotString (const char *s, int n);
+
+        // each glyph of a font decoded once into runs of set pixels relative to the cursor.
+        // glyph g of font uses runs[first[g] .. first[g+1]-1], color is applied when drawn.
+        typedef struct {
+            int16_t dx, dy, len;
+        } GlyphRun;
+        typedef struct {
+            const GFXfont *font;
+            uint32_t *first;
+            GlyphRun *runs;
+        } GlyphAtlas;
+        #define MAX_GLYPH_ATLAS 8
+        GlyphAtlas glyph_atlas[MAX_GLYPH_ATLAS];
+        int n_glyph_atlas;
+        const GlyphAtlas *getGlyphAtlas (const GFXfont *f);
 	fbpix_t text_color;
 	uint16_t cursor_x, cursor_y;
 	uint16_t read_x, read_y;
@@ -338,6 +420,8 @@ class Adafruit_RA8875 {
 
         // full res helpers
 	void plotfb (int16_t x, int16_t y, fbpix_t color);
+        fbpix_t grayFBPix (fbpix_t color);
+        void plotSpan (int x0, int x1, int y, fbpix_t color);
         void plotDrawRect (int16_t x0, int16_t y0, int16_t w, int16_t h, fbpix_t fbpix);
         void plotFillRect (int16_t x0, int16_t y0, int16_t w, int16_t h, fbpix_t fbpix);
         void plotDrawCircle (int16_t x0, int16_t y0, uint16_t r0, fbpix_t fbpix);
@@ -354,6 +438,7 @@ class Adafruit_RA8875 {
         uint16_t *DEARTH_BIG;
         uint16_t *NEARTH_BIG;
         int EARTH_BIG_H, EARTH_BIG_W;
+        volatile int earth_pix_gen;
 
         // handy macro to implement the 2d nature of the arrays
         #define EPIXEL(a,r,c)   ((a)[(r)*EARTH_BIG_W + (c)])
@@ -385,6 +385,8 @@ static void usage (const char *errfmt, ...)
             fprintf (stderr, " -0   : restore all original default Setup values\n");
             fprintf (stderr, " -a x : set debug name=level, bogus name gives list\n");
             fprintf (stderr, " -b h : set backend host:port to h; default is %s:%d\n", backend_host, backend_port);
+            fprintf (stderr, " -c m : limit downloaded files to m MB, 0 for no limit; default %d\n",
+                                    cache_budget_mb);
             fprintf (stderr, " -d d : set working directory to d; default is %s\n", defaultAppDir().c_str());
             fprintf (stderr, " -e p : set RESTful web server port to p or -1 to disable; default is %d\n",
                                     RESTFUL_PORT);
@@ -392,6 +394,7 @@ static void usage (const char *errfmt, ...)
             fprintf (stderr, " -g   : init DE using geolocation with current public IP; requires -k\n");
             fprintf (stderr, " -h   : print this help summary then exit\n");
             fprintf (stderr, " -i i : init DE using geolocation with IP i; requires -k\n");
+            fprintf (stderr, " -j n : draw map with n threads, 1 for incremental sweep; default is n cores\n");
             fprintf (stderr, " -k   : start in normal mode, ie, don't offer Setup or wait for Skips\n");
             fprintf (stderr, " -l l : set Mercator or Robinson center longitude to l degrees, +E; requires -k\n");
             fprintf (stderr, " -m   : enable demo mode\n");
@@ -408,6 +411,8 @@ static void usage (const char *errfmt, ...)
             fprintf (stderr, " -S s : set Software server host for OTA download; default is %s\nMust come after -b if used\n",software_host);
             fprintf (stderr, " -t p : throttle max cpu to p percent; default is %.0f\n", DEF_CPU_USAGE*100);
             fprintf (stderr, " -T t : set max timeout for responses from backend\n");
+            fprintf (stderr, " -u n : limit each live web connection to n updates per second; default %d\n",
+                                    liveweb_maxfps);
             fprintf (stderr, " -v   : show version info then exit\n");
             fprintf (stderr, " -w p : set read-write live web server port to p or -1 to disable; default %d\n",
                                     LIVEWEB_RW_PORT);
@@ -516,6 +521,14 @@ static void crackArgs (int ac, char *av[])
                         ac--;
                     }
                     break;
+                case 'c':
+                    if (ac < 2)
+                        usage ("missing MB for -c");
+                    cache_budget_mb = atoi(*++av);
+                    if (cache_budget_mb < 0)
+                        usage ("-c must be >= 0");
+                    ac--;
+                    break;
                 case 'd':
                     if (ac < 2)
                         usage ("missing directory path for -d");
@@ -556,6 +569,14 @@ static void crackArgs (int ac, char *av[])
                     init_locip = *++av;
                     ac--;
                     break;
+                case 'j':
+                    if (ac < 2)
+                        usage ("missing number of threads for -j");
+                    map_nthreads = atoi(*++av);
+                    if (map_nthreads < 1 || map_nthreads > 64)
+                        usage ("-j must be [1,64]");
+                    ac--;
+                    break;
                 case 'k':                       // fallthru
                 case 'K':
                     skip_skip = true;
@@ -630,6 +651,14 @@ static void crackArgs (int ac, char *av[])
                         set_timeout_s(to);
                     }
                     break;
+                case 'u':
+                    if (ac < 2)
+                        usage ("missing max updates per second for -u");
+                    liveweb_maxfps = atoi(*++av);
+                    if (liveweb_maxfps < 1 || liveweb_maxfps > 100)
+                        usage ("-u must be [1,100]");
+                    ac--;
+                    break;
                 case 'v':
                     showVersion();
                     exit(0);
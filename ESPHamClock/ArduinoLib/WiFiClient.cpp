@@ -2,20 +2,121 @@
  */
 
 #include <signal.h>
+#include <poll.h>
 
 #include "IPAddress.h"
 #include "WiFiClient.h"
+#include "../zlib-hc/zlib.h"
 
-// default constructor
-WiFiClient::WiFiClient()
+/* idle keep-alive connections, shared by all instances and threads.
+ * connect() takes one to the same host:port if available and stop() returns one after a complete response.
+ */
+#define POOL_MAX        6                       // max idle connections kept
+#define POOL_IDLE_MAX   10                      // max seconds to keep an idle connection
+typedef struct {
+    char host[64];                              // as given to connect()
+    int port;
+    int fd;                                     // open socket
+    time_t idle_t;                              // when it became idle
+} PoolEntry;
+static PoolEntry pool[POOL_MAX];
+#define RAW_SIZE        (4096*10)               // raw[] size, malloced when first decoding a body
+#define REPLAY_SIZE     1024                    // replay[] size, malloced when first sending on a reused socket
+static int n_pool;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* remove pool[i]
+ * N.B. caller must hold pool_lock
+ */
+static void rmPoolEntry (int i)
+{
+    pool[i] = pool[--n_pool];
+}
+
+/* return an idle connection to host:port, else -1.
+ * N.B. we close any that have been idle too long or that the server has since closed.
+ */
+static int takePooled (const char *host, int port)
 {
-        // init
-    socket = -1;
+    time_t now = time(NULL);
+    int fd = -1;
+
+    pthread_mutex_lock (&pool_lock);
+    for (int i = n_pool; fd < 0 && --i >= 0; ) {
+
+        // discard any too old, whoever they are for
+        if (now - pool[i].idle_t > POOL_IDLE_MAX) {
+            close (pool[i].fd);
+            rmPoolEntry (i);
+            continue;
+        }
+
+        if (pool[i].port != port || strcmp (pool[i].host, host) != 0)
+            continue;
+        int pfd = pool[i].fd;
+        rmPoolEntry (i);
+
+        // anything to read on an idle connection is either EOF or junk so it can't be used
+        struct pollfd pf = {pfd, POLLIN, 0};
+        if (poll (&pf, 1, 0) != 0)
+            close (pfd);
+        else
+            fd = pfd;
+    }
+    pthread_mutex_unlock (&pool_lock);
+
+    if (fd >= 0 && debugLevel (DEBUG_NET, 1))
+        printf ("WiFiCl: reusing %s:%d fd %d\n", host, port, fd);
+
+    return (fd);
+}
+
+/* add an idle connection to host:port, closing the oldest if full
+ */
+static void putPooled (const char *host, int port, int fd)
+{
+    pthread_mutex_lock (&pool_lock);
+    if (n_pool == POOL_MAX) {
+        int oldest = 0;
+        for (int i = 1; i < n_pool; i++)
+            if (pool[i].idle_t < pool[oldest].idle_t)
+                oldest = i;
+        close (pool[oldest].fd);
+        rmPoolEntry (oldest);
+    }
+    PoolEntry &pe = pool[n_pool++];
+    snprintf (pe.host, sizeof(pe.host), "%s", host);
+    pe.port = port;
+    pe.fd = fd;
+    pe.idle_t = time(NULL);
+    pthread_mutex_unlock (&pool_lock);
+
+    if (debugLevel (DEBUG_NET, 1))
+        printf ("WiFiCl: keeping %s:%d fd %d\n", host, port, fd);
+}
+
+/* init a new instance to use fd, -1 if none
+ */
+void WiFiClient::initClient (int fd)
+{
+    socket = fd;
+    read_pending_ms = get_timeout_ms();
     n_peek = 0;
     next_peek = 0;
-    read_pending_ms = get_timeout_ms();
     m_isPipe = false;
     m_pipe = nullptr;
+    zs = NULL;
+    raw = NULL;
+    replay = NULL;
+    pool_host[0] = '\0';
+    pool_port = 0;
+    resetHTTP();
+}
+
+// default constructor
+WiFiClient::WiFiClient()
+{
+    initClient (-1);
 }
 
 // constructor handed an open socket to use
@@ -24,12 +125,54 @@ WiFiClient::WiFiClient(int fd)
     if (fd >= 0 && debugLevel (DEBUG_NET, 1))
         printf ("WiFiCl: new WiFiClient inheriting fd %d\n", fd);
 
-    // init
-    socket = fd;
-    n_peek = 0;
-    next_peek = 0;
-    m_isPipe = false;
-    m_pipe = nullptr;
+    initClient (fd);
+}
+
+// move constructor, such as when returned by WiFiServer. from is left closed.
+WiFiClient::WiFiClient(WiFiClient &&from)
+{
+    read_pending_ms = from.read_pending_ms;
+    socket = from.socket;
+    n_peek = from.n_peek;
+    next_peek = from.next_peek;
+    memcpy (peek, from.peek, n_peek);
+    m_isPipe = from.m_isPipe;
+    m_pipe = from.m_pipe;
+    memcpy (pool_host, from.pool_host, sizeof(pool_host));
+    pool_port = from.pool_port;
+    ka_request = from.ka_request;
+    ka_reused = from.ka_reused;
+    replay = from.replay;
+    n_replay = from.n_replay;
+    n_rx = from.n_rx;
+    raw = from.raw;
+    n_raw = from.n_raw;
+    next_raw = from.next_raw;
+    body = from.body;
+    body_left = from.body_left;
+    body_keep = from.body_keep;
+    body_short = from.body_short;
+    zs = from.zs;
+    zs_more = from.zs_more;
+    zs_end = from.zs_end;
+
+    from.socket = -1;
+    from.m_isPipe = false;
+    from.m_pipe = nullptr;
+    from.replay = NULL;
+    from.raw = NULL;
+    from.zs = NULL;
+    from.resetHTTP();
+}
+
+// destructor, releases the connection if caller did not stop() it
+WiFiClient::~WiFiClient()
+{
+    if (socket >= 0 || m_pipe)
+        stop();
+    resetHTTP();                                // ends any inflater
+    free (raw);
+    free (replay);
 }
 
 // return whether this socket is active
@@ -131,14 +274,14 @@ bool WiFiClient::connectCommand(const char* command)
 
     return true;
 }
-bool WiFiClient::connect(const char *host, int port)
+/* open a new socket to host:port, return fd else -1
+ */
+int WiFiClient::openSocket (const char *host, int port)
 {
     struct addrinfo hints, *aip;
     char port_str[16];
     int sockfd;
-    /* connect is not a command pipe so clear pipe information */
-    m_isPipe = false;
-    m_pipe = nullptr;
+
     /* lookup host address.
      * N.B. must call freeaddrinfo(aip) after successful call before returning
      */
@@ -149,7 +292,7 @@ bool WiFiClient::connect(const char *host, int port)
     int error = ::getaddrinfo (host, port_str, &hints, &aip);
     if (error) {
         printf ("WiFiCl: getaddrinfo(%s:%d): %s\n", host, port, gai_strerror(error));
-        return (false);
+        return (-1);
     }
 
     /* create socket */
@@ -157,7 +300,7 @@ bool WiFiClient::connect(const char *host, int port)
     if (sockfd < 0) {
         freeaddrinfo (aip);
         printf ("WiFiCl: socket(%s:%d): %s\n", host, port, strerror(errno));
-        return (false);
+        return (-1);
     }
 
     /* connect */
@@ -165,7 +308,7 @@ bool WiFiClient::connect(const char *host, int port)
         printf ("WiFiCl: connect(%s:%d): %s\n", host, port, strerror(errno));
         freeaddrinfo (aip);
         close (sockfd);
-        return (false);
+        return (-1);
     }
 
     /* handle write errors inline */
@@ -176,6 +319,26 @@ bool WiFiClient::connect(const char *host, int port)
         printf ("WiFiCl: new %s:%d fd %d\n", host, port, sockfd);
     freeaddrinfo (aip);
 
+    return (sockfd);
+}
+
+bool WiFiClient::connect(const char *host, int port)
+{
+    /* connect is not a command pipe so clear pipe information */
+    m_isPipe = false;
+    m_pipe = nullptr;
+    resetHTTP();
+
+    /* reuse an idle connection to the same server if possible */
+    int sockfd = takePooled (host, port);
+    ka_reused = sockfd >= 0;
+    if (!ka_reused)
+        sockfd = openSocket (host, port);
+    if (sockfd < 0)
+        return (false);
+    snprintf (pool_host, sizeof(pool_host), "%s", host);
+    pool_port = port;
+
     // init much like constructors
     socket = sockfd;
     n_peek = 0;
@@ -207,6 +370,11 @@ void WiFiClient::stop()
             m_pipe = nullptr;
         }
         m_isPipe = false;
+        socket = -1;                            // was fileno(m_pipe)
+    } else if (poolable()) {
+        putPooled (pool_host, pool_port, socket);
+        socket = -1;
+
     } else if (socket >= 0) {
               if (debugLevel (DEBUG_NET, 1))
                 printf ("WiFiCl: stopping fd %d\n", socket);
@@ -218,6 +386,7 @@ void WiFiClient::stop()
             printf ("WiFiCl: fd %d already stopped\n", socket);
     n_peek = 0;
     next_peek = 0;
+    resetHTTP();
 }
 
 bool WiFiClient::connected()
@@ -264,13 +433,20 @@ int WiFiClient::available (int pending_ms)
     if (next_peek < n_peek)
         return (1);
 
+    // decode more if reading an HTTP body
+    if (body != HB_NONE)
+        return (fillBody (pending_ms));
+
     // wait as instructed
     if (!pending(pending_ms))
         return (0);
 
     // read more
     int nr = ::read(socket, peek, sizeof(peek));
+    if (nr <= 0 && replayRequest())
+        return (available (pending_ms));
     if (nr > 0) {
+        n_rx += nr;
         if (debugLevel (DEBUG_NET, 2))
             printf ("WiFiCl: available read(%d,%ld) %d\n", socket, (long)sizeof(peek), nr);
         if (debugLevel (DEBUG_NET, 3))
@@ -329,24 +505,98 @@ int WiFiClient::readArray (uint8_t *array, long count)
     return (n_return);
 }
 
+/* wait as long as read_pending_ms for more then set *bp to up to count of the bytes now buffered and
+ * consider them read. this avoids a copy but *bp is only valid until the next read of any kind.
+ * return count in *bp or 0 when no more.
+ * non-standard
+ */
+int WiFiClient::readView (const uint8_t **bp, long count)
+{
+    int n_return = 0;
+
+    if (available (read_pending_ms)) {
+        int n_available = n_peek - next_peek;
+        n_return = count > n_available ? n_available : count;
+        *bp = &peek[next_peek];
+        next_peek += n_return;
+    }
+
+    if (debugLevel (DEBUG_NET, 2))
+        printf ("WiFiCl: readView(%d,%ld) %d\n", socket, count, n_return);
+    return (n_return);
+}
+
+/* read through the next newline, waiting as long as read_pending_ms for each more buffer.
+ * return in line[] all but the newline and any \r, truncated if necessary to fit in line_size with EOS.
+ * also return length in *ll unless NULL.
+ * return false if EOF before finding newline.
+ * non-standard
+ */
+bool WiFiClient::readLine (char *line, int line_size, int *ll)
+{
+    int n_line = 0;
+
+    for (;;) {
+
+        if (!available (read_pending_ms))
+            return (false);
+
+        // scan what we have for the newline
+        const uint8_t *p0 = &peek[next_peek];
+        int n_buf = n_peek - next_peek;
+        const uint8_t *nl = (const uint8_t *) memchr (p0, '\n', n_buf);
+        int n_scan = nl ? nl - p0 : n_buf;
+
+        // append all but \r while there is room
+        for (const uint8_t *p = p0; p < p0 + n_scan && n_line < line_size - 1; p++)
+            if (*p != '\r')
+                line[n_line++] = *p;
+        next_peek += nl ? n_scan + 1 : n_scan;
+
+        if (nl) {
+            line[n_line] = '\0';
+            if (ll)
+                *ll = n_line;
+            if (debugLevel (DEBUG_NET, 3))
+                printf ("WiFiCl: readLine(%d) %s\n", socket, line);
+            return (true);
+        }
+    }
+}
+
 int WiFiClient::write (const uint8_t *buf, int n)
 {
     // can't if closed
     if (socket < 0)
         return (0);
 
+    // save what is sent on a reused connection in case it must be sent again
+    if (ka_reused && n_rx == 0) {
+        if (!replay && (replay = (char *) malloc (REPLAY_SIZE)) == NULL)
+            n_replay = -1;
+        if (n_replay >= 0 && n_replay + n <= REPLAY_SIZE) {
+            memcpy (replay + n_replay, buf, n);
+            n_replay += n;
+        } else
+            n_replay = -1;
+    }
+
     int nw = 0;
     for (int ntot = 0; ntot < n; ntot += nw) {
         nw = ::write (socket, buf+ntot, n-ntot);
         if (nw < 0) {
             // select says it won't block but it still might be temporarily EAGAIN
             if (errno != EAGAIN) {
+                if (replayRequest())
+                    return (n);
                 printf ("WiFiCl: write(%d) after %d: %s\n", socket, ntot, strerror(errno));
                 stop();             // avoid repeated failed attempts
                 return (0);
             } else
                 nw = 0;             // act like nothing happened
         } else if (nw == 0) {
+            if (replayRequest())
+                return (n);
             printf ("WiFiCl: write(%d) returns 0 after %d\n", socket, ntot);
             stop();             // avoid repeated failed attempts
             return (0);
@@ -477,3 +727,444 @@ IPAddress WiFiClient::remoteIP()
     sscanf (s, "%d.%d.%d.%d", &oct0, &oct1, &oct2, &oct3);
     return (IPAddress(oct0,oct1,oct2,oct3));
 }
+
+/* mark whether the request being sent asks the server to keep the connection open afterwards.
+ * if so, httpSkipHeader() calls setHTTPBody() to find where the response ends so stop() may pool it.
+ */
+void WiFiClient::setHTTPKeepAlive (bool on)
+{
+    ka_request = on;
+}
+
+bool WiFiClient::getHTTPKeepAlive (void)
+{
+    return (ka_request);
+}
+
+/* called just after the header of a response to a keep-alive request to decode the body that follows.
+ * length is the Content-Length else -1, chunked and gzip are per Transfer-Encoding and Content-Encoding,
+ * keep is whether the server will leave the connection open after the body.
+ */
+void WiFiClient::setHTTPBody (long length, bool chunked, bool gzip, bool keep)
+{
+    // any body that arrived along with the header is not yet decoded
+    if (!raw && (raw = (uint8_t *) malloc (RAW_SIZE)) == NULL) {
+        printf ("WiFiCl: fd %d no memory for body\n", socket);
+        n_peek = next_peek = 0;
+        body = HB_DONE;
+        body_keep = false;
+        body_short = true;
+        return;
+    }
+    n_raw = n_peek - next_peek;
+    memcpy (raw, &peek[next_peek], n_raw);
+    next_raw = 0;
+    n_peek = 0;
+    next_peek = 0;
+
+    if (chunked) {
+        body = HB_CHUNK_SIZE;
+    } else if (length >= 0) {
+        body = HB_LENGTH;
+        body_left = length;
+    } else {
+        body = HB_EOF;
+        keep = false;
+    }
+    body_keep = keep;
+    body_short = false;
+
+    if (gzip) {
+        zs = (z_stream *) calloc (1, sizeof(z_stream));
+        if (!zs || inflateInit2 (zs, 16+MAX_WBITS) != Z_OK) {
+            printf ("WiFiCl: fd %d gzip init failed\n", socket);
+            free (zs);
+            zs = NULL;
+            body = HB_DONE;
+            body_keep = false;
+            body_short = true;
+        }
+    }
+
+    if (debugLevel (DEBUG_NET, 2))
+        printf ("WiFiCl: fd %d body length %ld chunked %d gzip %d keep %d\n", socket, length, chunked,
+                                gzip, keep);
+}
+
+/* forget all HTTP state from any previous connection
+ */
+void WiFiClient::resetHTTP (void)
+{
+    if (zs) {
+        inflateEnd (zs);
+        free (zs);
+        zs = NULL;
+    }
+    zs_more = false;
+    zs_end = false;
+    ka_request = false;
+    ka_reused = false;
+    n_replay = 0;
+    n_rx = 0;
+    n_raw = 0;
+    next_raw = 0;
+    body = HB_NONE;
+    body_left = 0;
+    body_keep = false;
+    body_short = false;
+}
+
+/* if a request sent on a reused connection got no response, the server probably closed it while it was
+ * idle so send the request again on a fresh connection. return whether resent.
+ */
+bool WiFiClient::replayRequest (void)
+{
+    if (!ka_reused || n_rx > 0 || n_replay <= 0)
+        return (false);
+
+    if (debugLevel (DEBUG_NET, 1))
+        printf ("WiFiCl: fd %d closed by %s:%d while idle, resending\n", socket, pool_host, pool_port);
+
+    close (socket);
+    ka_reused = false;
+    socket = openSocket (pool_host, pool_port);
+    if (socket < 0)
+        return (false);
+    n_peek = 0;
+    next_peek = 0;
+
+    return (write ((const uint8_t *) replay, n_replay) == n_replay);
+}
+
+/* wait up to ms to add more to raw[], return whether any.
+ */
+bool WiFiClient::readRaw (int ms)
+{
+    // make room
+    if (next_raw == n_raw) {
+        n_raw = 0;
+        next_raw = 0;
+    } else if (n_raw == RAW_SIZE) {
+        memmove (raw, &raw[next_raw], n_raw - next_raw);
+        n_raw -= next_raw;
+        next_raw = 0;
+    }
+
+    if (!pending(ms))
+        return (false);
+
+    int nr = ::read (socket, &raw[n_raw], RAW_SIZE - n_raw);
+    if (nr <= 0) {
+        if (debugLevel (DEBUG_NET, 1))
+            printf ("WiFiCl: body read(%d): %s\n", socket, nr == 0 ? "EOF" : strerror(errno));
+        return (false);
+    }
+    if (debugLevel (DEBUG_NET, 2))
+        printf ("WiFiCl: body read(%d,%ld) %d\n", socket, (long)(RAW_SIZE - n_raw), nr);
+    if (debugLevel (DEBUG_NET, 3))
+        logBuffer (&raw[n_raw], nr);
+    n_raw += nr;
+    n_rx += nr;
+
+    return (true);
+}
+
+/* consume the next line from raw[], waiting up to ms for more if necessary.
+ * the line is returned without its CRLF and may be truncated to fit.
+ * return whether a complete line was found.
+ */
+bool WiFiClient::rawLine (char *line, int line_len, int ms)
+{
+    uint8_t *nl;
+    while ((nl = (uint8_t *) memchr (&raw[next_raw], '\n', n_raw - next_raw)) == NULL) {
+        if (next_raw == 0 && n_raw == RAW_SIZE)
+            return (false);                             // absurdly long
+        if (!readRaw (ms))
+            return (false);
+    }
+
+    int ll = nl - &raw[next_raw];
+    if (ll > 0 && nl[-1] == '\r')
+        ll--;
+    if (ll > line_len - 1)
+        ll = line_len - 1;
+    memcpy (line, &raw[next_raw], ll);
+    line[ll] = '\0';
+    next_raw = nl - raw + 1;
+
+    return (true);
+}
+
+/* inflate up to n_data bytes from data into peek[], return n bytes of data consumed else -1 if trouble.
+ */
+int WiFiClient::inflateBody (const uint8_t *data, int n_data)
+{
+    // ignore anything after the end of the gzip stream
+    if (zs_end) {
+        zs_more = false;
+        return (n_data);
+    }
+
+    zs->next_in = (Bytef *) data;
+    zs->avail_in = n_data;
+    zs->next_out = peek;
+    zs->avail_out = sizeof(peek);
+    int zr = inflate (zs, Z_NO_FLUSH);
+    if (zr != Z_OK && zr != Z_STREAM_END && zr != Z_BUF_ERROR) {
+        printf ("WiFiCl: fd %d gzip: %s\n", socket, zs->msg ? zs->msg : "inflate failed");
+        return (-1);
+    }
+
+    n_peek = sizeof(peek) - zs->avail_out;
+    zs_end = zr == Z_STREAM_END;
+    zs_more = !zs_end && zs->avail_out == 0;
+
+    return (n_data - zs->avail_in);
+}
+
+/* decode more of the HTTP body into peek[], waiting up to ms for more from the server if necessary.
+ * return 1 if peek[] now has more, else 0 if the body is complete or the connection failed.
+ */
+int WiFiClient::fillBody (int ms)
+{
+    n_peek = 0;
+    next_peek = 0;
+
+    while (n_peek == 0) {
+
+        // inflater may still hold output from input it has already consumed
+        if (zs_more) {
+            if (inflateBody (NULL, 0) < 0)
+                goto bad;
+            continue;
+        }
+
+        // find next body bytes in raw[], if any
+        int n_data = 0;
+        char line[200];
+        switch (body) {
+
+        case HB_NONE:
+        case HB_DONE:
+            return (0);
+
+        case HB_LENGTH:
+            if (body_left == 0) {
+                body = HB_DONE;
+                continue;
+            }
+            // fallthru
+
+        case HB_CHUNK_DATA:
+        case HB_EOF:
+            if (next_raw == n_raw && !readRaw (ms)) {
+                if (body != HB_EOF)
+                    goto bad;
+                body = HB_DONE;
+                continue;
+            }
+            n_data = n_raw - next_raw;
+            if (body != HB_EOF && n_data > body_left)
+                n_data = body_left;
+            break;
+
+        case HB_CHUNK_SIZE:
+            if (!rawLine (line, sizeof(line), ms))
+                goto bad;
+            body_left = strtol (line, NULL, 16);
+            body = body_left > 0 ? HB_CHUNK_DATA : HB_TRAILER;
+            continue;
+
+        case HB_CHUNK_END:
+            if (!rawLine (line, sizeof(line), ms))
+                goto bad;
+            body = HB_CHUNK_SIZE;
+            continue;
+
+        case HB_TRAILER:
+            if (!rawLine (line, sizeof(line), ms))
+                goto bad;
+            if (line[0] == '\0')
+                body = HB_DONE;
+            continue;
+        }
+
+        // copy or inflate into peek[]
+        int n_used;
+        if (zs) {
+            n_used = inflateBody (&raw[next_raw], n_data);
+            if (n_used < 0 || (n_used == 0 && n_peek == 0))
+                goto bad;
+        } else {
+            n_used = n_data < (int)sizeof(peek) ? n_data : (int)sizeof(peek);
+            memcpy (peek, &raw[next_raw], n_used);
+            n_peek = n_used;
+        }
+        next_raw += n_used;
+        if (body != HB_EOF) {
+            body_left -= n_used;
+            if (body_left == 0)
+                body = body == HB_CHUNK_DATA ? HB_CHUNK_END : HB_DONE;
+        }
+    }
+
+    return (1);
+
+  bad:
+
+    // connection is unusable but leave it for the caller to stop(), who may not have wanted the rest anyway
+    if (ms > 0 || debugLevel (DEBUG_NET, 1))
+        printf ("WiFiCl: fd %d HTTP body is short\n", socket);
+    n_peek = 0;
+    body = HB_DONE;
+    body_keep = false;
+    body_short = true;
+    return (0);
+}
+
+/* return whether the body set up by setHTTPBody() has been read all the way to the end the server framed
+ * for it, as opposed to the caller stopping early or the connection failing part way.
+ * always true if no body is being decoded because then there is no way to tell.
+ */
+bool WiFiClient::bodyComplete (void)
+{
+    if (body == HB_NONE)
+        return (true);
+    return (body == HB_DONE && !body_short && (!zs || zs_end));
+}
+
+/* return whether socket may be returned to the pool because it has a complete response to a
+ * keep-alive request and the caller has read all of it.
+ */
+bool WiFiClient::poolable (void)
+{
+    if (socket < 0 || !ka_request || !body_keep || next_peek < n_peek)
+        return (false);
+
+    // caller may not have read far enough to see the end, such as the final chunk
+    if (body != HB_DONE && fillBody (0))
+        return (false);
+
+    return (body == HB_DONE && body_keep && next_raw == n_raw);
+}
+
+
+#if defined(_WIFICLIENT_BENCH)
+
+/* stand-alone benchmark of reading lines a byte at a time with read(), as getTCPLine() used to,
+ * compared with readLine(). see the wificlient-bench target in the main Makefile.
+ */
+
+#define BENCH_BYTES     (800*1024)              // about the size of cty
+#define BENCH_SECS      0.5                     // run each method at least this long
+
+bool debugLevel (DebugSubsys s, int level)
+{
+    (void) s;
+    (void) level;
+    return (false);
+}
+
+static char *bench_text;                        // lines to send
+static int bench_len;                           // strlen(bench_text)
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+/* thread that sends bench_text to fd then closes it
+ */
+static void *benchWriter (void *arg)
+{
+    int fd = (int)(long)arg;
+    for (int n = 0, nw; n < bench_len; n += nw)
+        if ((nw = ::write (fd, bench_text + n, bench_len - n)) <= 0)
+            break;
+    close (fd);
+    return (NULL);
+}
+
+/* send bench_text once over a socketpair, return n lines read with readLine() or else read().
+ */
+static long benchPass (bool use_readline)
+{
+    int sv[2];
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        printf ("socketpair: %s\n", strerror(errno));
+        exit(1);
+    }
+    pthread_t tid;
+    pthread_create (&tid, NULL, benchWriter, (void*)(long)sv[1]);
+
+    WiFiClient client(sv[0]);
+    char line[200];
+    long n_lines = 0;
+    if (use_readline) {
+        while (client.readLine (line, sizeof(line), NULL))
+            n_lines++;
+    } else {
+        int i = 0, c;
+        while ((c = client.read()) >= 0) {
+            if (c == '\r')
+                continue;
+            if (c == '\n') {
+                line[i] = '\0';
+                i = 0;
+                n_lines++;
+            } else if (i < (int)sizeof(line)-1)
+                line[i++] = c;
+        }
+    }
+
+    pthread_join (tid, NULL);
+    client.stop();
+    return (n_lines);
+}
+
+static double benchLines (bool use_readline, long &n_check)
+{
+    long n_lines = 0;
+    double t0 = nowSecs(), dt;
+    do {
+        n_check = benchPass (use_readline);
+        n_lines += n_check;
+    } while ((dt = nowSecs() - t0) < BENCH_SECS);
+    return (n_lines/dt/1e6);
+}
+
+int main (int ac, char *av[])
+{
+    (void) ac;
+    (void) av;
+
+    // lines much like cty.txt
+    bench_text = (char *) malloc (BENCH_BYTES + 100);
+    if (!bench_text) {
+        printf ("No memory\n");
+        return (1);
+    }
+    long n_sent = 0;
+    for (bench_len = 0; bench_len < BENCH_BYTES; n_sent++)
+        bench_len += sprintf (bench_text + bench_len, "%c%ldABC,%ld,%.2f,%.2f\r\n",
+                                'A' + (int)(n_sent % 26), n_sent, n_sent % 400, (n_sent % 180) - 90.0,
+                                (n_sent % 360) - 180.0);
+
+    long n_read, n_line;
+    double bytes = benchLines (false, n_read);
+    double lines = benchLines (true, n_line);
+    if (n_read != n_sent || n_line != n_sent) {
+        printf ("Line count mismatch: sent %ld read() %ld readLine() %ld\n", n_sent, n_read, n_line);
+        return (1);
+    }
+
+    printf ("%ld lines of %d bytes\n", n_sent, bench_len);
+    printf ("  read()     %7.2f Mlines/s\n", bytes);
+    printf ("  readLine() %7.2f Mlines/s   %.1fx\n", lines, lines/bytes);
+
+    return (0);
+}
+
+#endif // _WIFICLIENT_BENCH
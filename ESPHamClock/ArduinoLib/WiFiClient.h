@@ -27,6 +27,20 @@
 /* version of Arduino WiFiClient that runs on rasp pi
  */
 
+// how the body of an HTTP response is being decoded, see setHTTPBody()
+typedef enum {
+    HB_NONE,                                // not decoding, read socket as is
+    HB_LENGTH,                              // body_left more bytes
+    HB_EOF,                                 // until server closes
+    HB_CHUNK_SIZE,                          // expecting chunk size line
+    HB_CHUNK_DATA,                          // body_left more bytes in this chunk
+    HB_CHUNK_END,                           // expecting CRLF after chunk data
+    HB_TRAILER,                             // expecting trailer lines until blank
+    HB_DONE,                                // body complete
+} HTTPBodyState;
+
+struct z_stream_s;
+
 #include "Arduino.h"
 #include "IPAddress.h"
 #include "timeout.h"
@@ -37,6 +51,10 @@ public:
 
     WiFiClient();
     WiFiClient(int fd);
+    WiFiClient(WiFiClient &&from);
+    WiFiClient(const WiFiClient &) = delete;
+    WiFiClient &operator= (const WiFiClient &) = delete;
+    ~WiFiClient();
     bool connect (const char *host, int port);
     bool connectCommand (const char *cmd);
     bool connect (IPAddress ip, int port);
@@ -46,6 +64,8 @@ public:
     bool connected();
     int read();
     int readArray (uint8_t *array, long count);
+    int readView (const uint8_t **bp, long count);
+    bool readLine (char *line, int line_size, int *ll);
     operator bool();
     int write (const uint8_t *buf, int n);
     void print (void);
@@ -63,6 +83,12 @@ public:
     void flush(void){};
     IPAddress remoteIP(void);
 
+    // HTTP/1.1 keep-alive support, non-standard
+    void setHTTPKeepAlive (bool on);
+    bool getHTTPKeepAlive (void);
+    void setHTTPBody (long length, bool chunked, bool gzip, bool keep);
+    bool bodyComplete (void);
+
 private:
 
     uint16_t read_pending_ms;               // max read wait time, ms
@@ -78,6 +104,35 @@ private:
     bool m_isPipe;
     FILE* m_pipe;
 
+    // connection pool and HTTP response body decoding
+    char pool_host[64];                     // where socket is connected, for the pool and replay
+    int pool_port;
+    bool ka_request;                        // request asked the server to keep the connection open
+    bool ka_reused;                         // socket came from the pool
+    char *replay;                           // malloced request sent on a reused socket, if any
+    int n_replay;                           // n in replay[], -1 if too long
+    long n_rx;                              // bytes received since connecting
+    uint8_t *raw;                           // malloced body bytes not yet decoded into peek[], if any
+    int n_raw;                              // n useful values in raw[]
+    int next_raw;                           // next raw[] index to use
+    HTTPBodyState body;                     // body decoding state
+    long body_left;                         // bytes left in body or chunk
+    bool body_keep;                         // server will keep connection open after body
+    bool body_short;                        // body ended early, see bodyComplete()
+    struct z_stream_s *zs;                  // inflater if Content-Encoding: gzip
+    bool zs_more;                           // inflater may have more output without more input
+    bool zs_end;                            // inflater has seen the end of the gzip stream
+
+    int openSocket (const char *host, int port);
+    void initClient (int fd);
+    void resetHTTP (void);
+    bool replayRequest (void);
+    bool readRaw (int ms);
+    bool rawLine (char *line, int line_len, int ms);
+    int inflateBody (const uint8_t *data, int n_data);
+    int fillBody (int ms);
+    bool poolable (void);
+
 };
 
 
@@ -0,0 +1,54 @@
+/* RGB565 pixel kernels shared by the earth map day/night blend and the gray scale conversions.
+ *
+ * The row functions process whole runs of pixels using the kernel selected at build time by the
+ * Makefile PIXBLEND variable: _PIXBLEND_SSE2, _PIXBLEND_AVX2, _PIXBLEND_NEON or else plain C.
+ * All kernels use the same fixed point math so they produce identical results.
+ */
+
+#ifndef _PIXBLEND_H
+#define _PIXBLEND_H
+
+#include <stdint.h>
+
+// blend weight of an all-day pixel; weights range 0 (all night) .. PIXBLEND_ONE (all day)
+#define PIXBLEND_ONE    256
+
+// fixed point gray scale weights, sum to 256, about r/4 + 2g/3 + b/12
+#define PIXGRAY_R       64
+#define PIXGRAY_G       171
+#define PIXGRAY_B       21
+#define PIXGRAY(r,g,b)  (((r)*PIXGRAY_R + (g)*PIXGRAY_G + (b)*PIXGRAY_B) >> 8)
+
+/* convert a fraction of day 0..1 to a blend weight
+ */
+static inline uint16_t pixBlendWeight (float fract_day)
+{
+    return ((uint16_t)(fract_day*PIXBLEND_ONE + 0.5F));
+}
+
+/* return the gray version of the given RGB565 pixel.
+ * N.B. matches grayRGB565Row() exactly.
+ */
+static inline uint16_t grayRGB565 (uint16_t c)
+{
+    uint16_t r5 = c >> 11;
+    uint16_t g6 = (c >> 5) & 0x3F;
+    uint16_t b5 = c & 0x1F;
+    uint16_t y = PIXGRAY ((r5<<3)|(r5>>2), (g6<<2)|(g6>>4), (b5<<3)|(b5>>2));
+    return (((y & 0xF8) << 8) | ((y & 0xFC) << 3) | (y >> 3));
+}
+
+/* return the gray version of the given 0xRRGGBB pixel.
+ */
+static inline uint32_t grayRGB32 (uint32_t c)
+{
+    uint32_t y = PIXGRAY ((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+    return ((y << 16) | (y << 8) | y);
+}
+
+extern void blendRGB565Row (const uint16_t *day, const uint16_t *night, const uint16_t *weight,
+    uint16_t *out, int n);
+extern void grayRGB565Row (const uint16_t *in, uint16_t *out, int n);
+extern const char *pixBlendKernel(void);
+
+#endif // _PIXBLEND_H
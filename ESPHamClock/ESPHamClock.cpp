@@ -663,6 +663,8 @@ void loop()
     drawFireworks();                    // only new years midnight
     updateSatPass ();                   // just for the satellite LED
     checkDXCluster ();                  // collect new spots if running
+    pollBGFetch ();                     // install any finished background downloads
+    manageCache ();                     // prune downloaded files now and then
 
     // update stopwatch exclusively, if active
     if (!runStopwatch()) {
@@ -173,7 +173,8 @@ class GenReader
         GenReader (WiFiClient &client, long content_length = 0) {
             my_type = GR_CLIENT;
             my_client = &client;
-            my_clen = content_length;   // ignored if 0
+            my_clen = content_length > 0 ? content_length : -1;   // -1 means unlimited
+            my_next = my_end = NULL;
         }
 
         // instantiate to read from a FILE *p
@@ -181,40 +182,23 @@ class GenReader
         GenReader (FILE *fp) {
             my_type = GR_FILE;
             my_fp = fp;
+            my_next = my_end = NULL;
         }
 
         // instantiate to read from a memory array
         GenReader (const char *a, int n_a)
         {
             my_type = GR_ARRAY;
-            my_array = a;
-            my_array_end = a + n_a;
+            my_next = a;
+            my_end = a + n_a;
         }
 
         // return next byte from the source
         bool getChar (char *bp) {
-            switch (my_type) {
-            case GR_ARRAY:
-                if (my_array < my_array_end) {
-                    *bp = *my_array++;
-                    return (true);
-                }
-                return(false);
-                break;
-            case GR_FILE: {
-                int i = fgetc(my_fp);
-                if (i == EOF || feof(my_fp) || ferror(my_fp))
-                    return (false);
-                *bp = (char)i;
-                return (true);
-                }
-                break;
-            case GR_CLIENT:
-                return ((!my_clen || my_clen-- > 0) && getTCPChar (*my_client, bp));
-                break;
-            default:
+            if (my_next == my_end && !refill())
                 return (false);
-            }
+            *bp = *my_next++;
+            return (true);
         }
 
         // type tests
@@ -230,12 +214,40 @@ class GenReader
             GR_CLIENT
         } GRType;
 
+        // reset my_next and my_end to the next chunk of the source, return whether any
+        bool refill (void) {
+            switch (my_type) {
+            case GR_FILE: {
+                size_t n = fread (my_buf, 1, sizeof(my_buf), my_fp);
+                my_next = my_buf;
+                my_end = my_buf + n;
+                return (n > 0);
+                }
+                break;
+            case GR_CLIENT: {
+                if (my_clen == 0)
+                    return (false);
+                const uint8_t *view = NULL;
+                int n = my_client->readView (&view, my_clen > 0 ? my_clen : LONG_MAX);
+                if (my_clen > 0)
+                    my_clen -= n;
+                my_next = (const char *) view;
+                my_end = my_next + n;
+                return (n > 0);
+                }
+                break;
+            default:
+                return (false);
+            }
+        }
+
         GRType my_type;
         FILE *my_fp;
         WiFiClient *my_client;  // pointer to avoid having to init the reference everywhere with a dummy
-        long my_clen;
-        const char *my_array;
-        const char *my_array_end;
+        long my_clen;           // bytes left to read from my_client, -1 if unlimited
+        const char *my_next;    // next byte to return from the current chunk
+        const char *my_end;     // one past the last byte in the current chunk
+        char my_buf[4096];      // chunk read from my_fp
 };
 
 
@@ -1247,7 +1259,47 @@ extern bool onADIFList (const DXSpot &spot, bool chk_dxcc, bool chk_grid, bool c
  *
  */
 
+typedef enum {
+    ADIFPS_STARTFILE,                                   // initialize all
+    ADIFPS_STARTSPOT,                                   // initialize parser and spot candidate
+    ADIFPS_STARTFIELD,                                  // initialize parser for next field,retain spot so far
+    ADIFPS_SEARCHING,                                   // looking for opening <
+    ADIFPS_INNAME,                                      // after < collecting field name until :
+    ADIFPS_INLENGTH,                                    // after first : building value_len until : or >
+    ADIFPS_INTYPE,                                      // after second : skipping type until >
+    ADIFPS_INVALUE,                                     // after > now collecting value
+    ADIFPS_FINISHED,                                    // spot is complete
+    ADIFPS_SKIPTOEOR,                                   // skip to EOR after finding an error
+} ADIFParseState;
+
+typedef struct {
+    // running state
+    ADIFParseState ps;                                  // what is happening now
+    int line_n;                                         // line number for diagnostics
+
+    // per-field state
+    char name[20];                                      // field name so far, always includes EOS
+    char value[20];                                     // field value so far, always includes EOS
+    unsigned name_seen;                                 // n name chars seen so far (avoids strlen(name))
+    unsigned value_len;                                 // claimed value length so far from field defn
+    unsigned value_seen;                                // n value chars seen so far (avoids strlen(value))
+
+    // per-spot state
+    uint32_t fields;                                    // bit mask of 1 << ADIFFieldBit seen
+    char qso_date[10];                                  // temp QSO_DATE .. need both to get UNIX time
+    char time_on[10];                                   // temp TIME_ON .. need both to get UNIX time
+} ADIFParser;
+
+// complete parser state between reads, so a file that has grown may be read from where the last read left off
+typedef struct {
+    ADIFParser adif;                                    // parser state
+    DXSpot spot;                                        // spot in progress
+    bool use_wl;                                        // whether spots are checked against WLID_ADIF
+} ADIFResume;
+
 extern int readADIFFile (GenReader &gr, DXSpot *&spots, bool use_wl, int &n_bad);
+extern int readADIFFile (GenReader &gr, ADIFResume &rs, DXSpot *&spots, bool use_wl, int &n_bad);
+extern int readMoreADIFFile (GenReader &gr, ADIFResume &rs, DXSpot *&spots, int n_spots, int &n_bad);
 
 
 
@@ -1342,6 +1394,25 @@ extern const char *findHamMode (float kHz);
 
 
 
+/*********************************************************************************************
+ *
+ * bgfetch.cpp
+ *
+ */
+
+typedef bool (*BGFetchFP)(void *data);          // download into data on a worker, return whether ok
+typedef void (*BGDoneFP)(void *data, bool ok);  // take over data on the main thread
+
+extern bool startBGFetch (const char *name, BGFetchFP fetch, BGDoneFP done, void *data);
+extern bool isBGFetchBusy (const char *name);
+extern void pollBGFetch (void);
+extern bool getBGFetchUserAgent (char *ua, size_t ua_len);
+extern bool setBGFetchRemoteAddr (const char *raddr);
+
+
+
+
+
 /*********************************************************************************************
  *
  * blinker.cpp
@@ -1425,8 +1496,29 @@ extern void doNCDXFBoxTouch (TouchType tt, const SCoord &s);
 #define CACHE_FOREVER 0                         // never remove matching files
 #define CACHE_NONE    1                         // remove all files older than 1 second
 
+// classes of downloaded files managed as one cache
+typedef enum {
+    CC_TEXT,                                    // files from openCachedFile()
+    CC_MAP,                                     // core and VOACAP map images
+    CC_SDO,                                     // SDO images
+    CC_N
+} CacheClass;
+
+// report of one CacheClass
+typedef struct {
+    const char *name;                           // class name
+    long ttl;                                   // removed if not used for this long, secs
+    int n_files;                                // files now in cache
+    long long n_bytes;                          // their total size
+    int n_hits, n_downloads, n_evicted, n_expired;      // counters since startup
+} CacheStats;
+
 extern FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size);
 extern bool cleanCache (const char *contains, int max_age);
+extern void noteCacheFile (const char *fn, CacheClass cc, bool downloaded);
+extern void pinCacheFile (const char *fn, bool pinned);
+extern void manageCache (void);
+extern void getCacheStats (CacheStats stats[CC_N]);
 
 
 
@@ -1767,6 +1859,7 @@ extern SCircle moon_c;
 extern uint8_t flash_crc_ok;
 
 extern void drawMoreEarth (void);
+extern void scheduleMapOverlays (void);
 extern void eraseDEMarker (void);
 extern void eraseDEAPMarker (void);
 extern void drawDEMarker (bool force);
@@ -1967,6 +2060,33 @@ extern void drawInfoBox(void);
 
 
 
+/*********************************************************************************************
+ *
+ * hashset.cpp
+ *
+ */
+
+typedef struct {
+    uint8_t *keys;                              // malloced n_slots keys each key_len bytes
+    uint8_t *vals;                              // malloced n_slots values each val_len bytes, if any
+    uint8_t *used;                              // malloced n_slots flags whether each key is in use
+    int key_len;                                // bytes per key
+    int val_len;                                // bytes per value, 0 if just a set
+    int n_slots, n_used;                        // n slots malloced, n in use
+} HashSet;
+
+extern void initHashSet (HashSet &hs, int key_len, int val_len = 0);
+extern void resetHashSet (HashSet &hs);
+extern bool addHashSet (HashSet &hs, const void *key);
+extern bool inHashSet (const HashSet &hs, const void *key);
+extern void *putHashSet (HashSet &hs, const void *key);
+extern void *findHashSet (const HashSet &hs, const void *key);
+extern bool rmHashSet (HashSet &hs, const void *key);
+
+
+
+
+
 /*********************************************************************************************
  *
  * kd3tree.cpp
@@ -2006,6 +2126,32 @@ extern char live_html[];
 
 
 
+/*********************************************************************************************
+ *
+ * llgrid.cpp
+ *
+ */
+
+typedef struct {
+    int *pt_cells, *pt_ids;                     // malloced cell and id of each point as added
+    int *ids;                                   // malloced ids sorted by cell
+    int *cell0;                                 // malloced ids index of first in each cell, n cells + 1
+    int n_pts, n_malloced;                      // n points added, n malloced in each list
+    bool sorted;                                // whether ids and cell0 reflect all points
+    bool filled;                                // set by owner when all its points are added
+} LLGrid;
+
+typedef void (*LLGridVisitor)(int id, void *arg);
+
+extern void resetLLGrid (LLGrid &g);
+extern void addLLGrid (LLGrid &g, const LatLong &ll, int id);
+extern void visitLLGrid (LLGrid &g, const LatLong &ll, float dlat_d, float dlng_d, LLGridVisitor fp, void *arg);
+extern float llGridLngRadius (const LatLong &ll, float r_d);
+
+
+
+
+
 /*********************************************************************************************
  *
  * liveweb.cpp
@@ -2019,6 +2165,21 @@ extern int n_roweb, n_rwweb;
 extern void openLiveWebURL (const char *url);
 extern bool isLiveWebTouch (void);
 
+typedef struct {
+    char addr[50];                                      // client address
+    bool ro;                                            // whether on the r/o port
+    const char *codec;                                  // update encoding
+    long age_s;                                         // seconds since connecting
+    float fps;                                          // updates delivered per second
+    float kbps;                                         // kilobytes per second
+    float send_ms;                                      // average time to send one update
+    float resp_ms;                                      // average time from update until next request
+    unsigned long n_updates;                            // total updates sent
+    unsigned long n_dropped;                            // total frames skipped
+    unsigned long n_bytes;                              // total bytes sent
+} LiveWebStats;
+extern int getLiveWebStats (LiveWebStats **stats);
+
 
 
 
@@ -2393,6 +2554,7 @@ extern void reportEESize (uint16_t &ee_used, uint16_t &ee_size);
 #define ONTA_INTERVAL   70                              // polling interval
 
 extern bool updateOnTheAir (const SBox &box, bool fresh);
+extern bool ontaReady (void);
 extern bool checkOnTheAirTouch (const SCoord &s, const SBox &box);
 extern bool getOnTheAirSpots (DXSpot **spp, uint8_t *nspotsp);
 extern void drawOnTheAirSpotsOnMap (void);
@@ -2594,7 +2756,8 @@ extern uint16_t psk_maxage_mins;        // max age, minutes
 extern uint8_t psk_showdist;            // show distances, else counts
 extern uint8_t psk_showpath;            // whether to draw paths
 
-extern bool updatePSKReporter (const SBox &box, bool force);
+extern bool updatePSKReporter (const SBox &box);
+extern bool pskReady (void);
 extern bool checkPSKTouch (const SCoord &s, const SBox &box);
 extern void initPSKState(void);
 extern void savePSKState(void);
@@ -3265,6 +3428,7 @@ extern void drawNCDXFSpcWxStats(uint16_t color);
 extern bool checkForNewSpaceWx(void);           // check for any new data or ...
 extern bool checkForNewDRAP(void);              // ... a few specific ones
 extern bool checkForNewAurora(void);            // ... a few specific ones
+extern bool spcWxReady (PlotChoice pc);
 extern time_t nextRetrieval (PlotChoice pc, int interval);
 extern void initSpaceWX(void);
 
@@ -3292,10 +3456,11 @@ extern void solveSphere (float A, float b, float cc, float sc, float *cap, float
 
 typedef bool (*SpotFilter)(const DXSpot *sp);
 
-extern bool getClosestSpot (DXSpot *list, int n_list, SpotFilter sfp, LabelOnMapEnd which_ends,
+extern bool getClosestSpot (DXSpot *list, int n_list, LLGrid &grid, SpotFilter sfp, LabelOnMapEnd which_ends,
     LatLong &ll, DXSpot *sp, LatLong *llp);
 extern void drawSpotLabelOnMap (DXSpot &spot, LabelOnMapEnd txrx, LabelOnMapDot dot);
 extern void drawSpotPathOnMap (const DXSpot &spot);
+extern void resetSpotPaths (void);
 extern void ditherLL (LatLong &ll);
 extern void drawSpotDot (int16_t raw_x, int16_t raw_y, uint16_t radius, LabelOnMapEnd txrx, uint16_t color);
 extern void drawVisibleSpots (WatchListId wl_id, const DXSpot *spots, const ScrollState &ss, const SBox &box,
@@ -3545,6 +3710,7 @@ typedef struct {
     int rsp_time;                               // last known response time, millis()
 } NTPServer;
 #define NTP_TOO_LONG 5000U                      // too long response time, millis()
+#define USER_AGENT_LEN 400                      // max User-Agent header line, including EOS
 
 extern void initSys (void);
 extern void initWiFiRetry(void);
@@ -3557,11 +3723,13 @@ extern bool setPlotChoice (PlotPane new_pp, PlotChoice new_ch);
 extern time_t getNTPUTC (NTPServer *);
 extern void scheduleRSSNow(void);
 extern bool getTCPLine (WiFiClient &client, char line[], uint16_t line_len, uint16_t *ll);
+extern void buildUserAgent (char *ua, size_t ua_len);
 extern void sendUserAgent (WiFiClient &client);
-extern void httpHCGET (WiFiClient &client, const char *server, const char *hc_page);
+extern void httpHCGET (WiFiClient &client, const char *server, const char *hc_page, const char *xhdrs = NULL);
 extern bool connecthttpsHCGET (WiFiClient &client, const char *server, const char *hc_page);
 extern bool httpSkipHeader (WiFiClient &client);
 extern bool httpSkipHeader (WiFiClient &client, const char *header, char *value, int value_len);
+extern bool httpSkipHeader (WiFiClient &client, int *status, int n_hdrs, const char *headers[], char *values[], int value_len);
 extern int getNTPServers (const NTPServer **listp);
 extern bool setRSSTitle (const char *title, int &n_titles, int &max_titles);
 extern time_t nextPaneRotation (PlotPane pp);
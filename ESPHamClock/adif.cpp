@@ -4,6 +4,7 @@
  */
 
 #include "HamClock.h"
+#include "zlib.h"                                       // ours, for crc32
 
 
 #define ADIF_COLOR      RGB565 (255,228,225)            // misty rose
@@ -80,12 +81,41 @@ class FileSignature
 // state
 static ADIFSorts adif_sort;                             // current sort code index into adif_pqsf
 static DXSpot *adif_spots;                              // malloced
+static LLGrid adif_grid;                                // spatial index of adif_spots
 static ScrollState adif_ss;                             // scroll controller, n_data is count
 static bool showing_set_adif;                           // set when not checking for local file
 static bool newfile_pending;                            // set when find new file while scrolled away
 static FileSignature fsig;                              // used to decide whether to read file again
 static int n_adif_bad;                                  // n bad spots found, global to maintain context
 
+// onADIFList() test combinations, as bit mask index into adif_worked[]
+enum {
+    AWT_DXCC = (1<<0),
+    AWT_GRID = (1<<1),
+    AWT_PREF = (1<<2),
+    AWT_BAND = (1<<3),
+    AWT_N    = (1<<4),
+};
+
+// one adif_worked key, only those fields being tested are set, the rest are 0
+typedef struct {
+    int dxcc;
+    int band;                                           // HamBandSetting
+    char grid[4];                                       // first 4 chars, upper case, not EOS terminated
+    char pref[MAX_PREF_LEN];                            // upper case
+} ADIFWorkedKey;
+
+static HashSet adif_worked[AWT_N];                      // set of ADIFWorkedKey for each test mask
+static bool adif_worked_ok[AWT_N];                      // whether adif_worked[mask] is built for adif_spots
+static char (*adif_prefs)[MAX_PREF_LEN];                // malloced prefix of each adif_spots, if needed
+
+// state needed to read only what has since been appended to the file
+#define ADIF_SIG_LEN    4096                            // bytes checked at each end of what was read
+static ADIFResume adif_rs;                              // parser state at end of last read
+static bool adif_rs_ok;                                 // whether adif_rs and below match adif_spots
+static long adif_rs_len;                                // n file bytes read so far
+static uint32_t adif_rs_head, adif_rs_tail;             // crc32 of first and last ADIF_SIG_LEN bytes read
+
 
 /* save sort and file name
  */
@@ -133,11 +163,45 @@ static void scrollADIFDown (const SBox &box)
     }
 }
 
+/* fill key with the fields of the given spot called for by mask, leaving the others 0.
+ */
+static void fillADIFWorkedKey (ADIFWorkedKey &key, int mask, const DXSpot &spot, const char *pref)
+{
+    memset (&key, 0, sizeof(key));
+    if (mask & AWT_DXCC)
+        key.dxcc = spot.tx_dxcc;
+    if (mask & AWT_BAND)
+        key.band = findHamBand (spot.kHz);
+    if (mask & AWT_GRID) {
+        for (int i = 0; i < (int)sizeof(key.grid) && spot.tx_grid[i] != '\0'; i++)
+            key.grid[i] = toupper (spot.tx_grid[i]);
+    }
+    if (mask & AWT_PREF) {
+        quietStrncpy (key.pref, pref, sizeof(key.pref));
+        strtoupper (key.pref);
+    }
+}
+
+/* discard the onADIFList() indices of adif_spots
+ */
+static void resetADIFWorked (void)
+{
+    for (int i = 0; i < AWT_N; i++) {
+        resetHashSet (adif_worked[i]);
+        adif_worked_ok[i] = false;
+    }
+    free (adif_prefs);
+    adif_prefs = NULL;
+}
+
 static void resetADIFMem(void)
 {
     free (adif_spots);
     adif_spots = NULL;
     adif_ss.n_data = 0;
+    resetLLGrid (adif_grid);
+    resetADIFWorked();
+    adif_rs_ok = false;
 }
 
 /* draw complete ADIF pane in the given box.
@@ -315,6 +379,143 @@ static void runADIFMenu (const SBox &box)
 
 }
 
+/* find crc32 of n bytes of fp starting at offset.
+ * return whether all could be read.
+ */
+static bool crcADIFRange (FILE *fp, long offset, long n, uint32_t &crc)
+{
+    if (fseek (fp, offset, SEEK_SET) < 0)
+        return (false);
+    crc = crc32 (0L, Z_NULL, 0);
+    Bytef buf[1024];
+    while (n > 0) {
+        size_t n_buf = fread (buf, 1, n < (long)sizeof(buf) ? n : sizeof(buf), fp);
+        if (n_buf == 0)
+            return (false);
+        crc = crc32 (crc, buf, n_buf);
+        n -= n_buf;
+    }
+    return (true);
+}
+
+/* find crc32 of the first and last ADIF_SIG_LEN bytes of the first len bytes of fp.
+ * these are enough to notice a log program rewriting its file rather than appending to it.
+ * return whether all could be read.
+ */
+static bool signADIFFile (FILE *fp, long len, uint32_t &head, uint32_t &tail)
+{
+    long n = len < ADIF_SIG_LEN ? len : ADIF_SIG_LEN;
+    return (crcADIFRange (fp, 0, n, head) && crcADIFRange (fp, len - n, n, tail));
+}
+
+/* after readMoreADIFFile() has added spots beyond n0, update indices and restore order.
+ */
+static void mergeADIFSpots (int n0)
+{
+    // add new spots to any worked index already built, each in its own way
+    for (int i = n0; i < adif_ss.n_data; i++) {
+        char pref[MAX_PREF_LEN];
+        findCallPrefix (adif_spots[i].tx_call, pref);
+        for (int mask = 1; mask < AWT_N; mask++) {
+            if (adif_worked_ok[mask]) {
+                ADIFWorkedKey key;
+                fillADIFWorkedKey (key, mask, adif_spots[i], pref);
+                (void) addHashSet (adif_worked[mask], &key);
+            }
+        }
+    }
+
+    // prefixes follow adif_spots order so just rebuild if needed again
+    free (adif_prefs);
+    adif_prefs = NULL;
+
+    // sort all, new spots need not be newest
+    qsort (adif_spots, adif_ss.n_data, sizeof(DXSpot), adif_pqsf[adif_sort]);
+    resetLLGrid (adif_grid);
+    adif_ss.scrollToNewest();
+}
+
+/* if fp is just the file we read last time with more appended, read and merge only the new portion.
+ * return whether successful, else caller should read the whole file.
+ */
+static bool tailADIFFile (FILE *fp)
+{
+    // must have a complete read of this file
+    if (!adif_rs_ok)
+        return (false);
+
+    // no shorter and same content so far
+    struct stat s;
+    uint32_t head, tail;
+    if (fstat (fileno(fp), &s) < 0 || s.st_size < adif_rs_len
+                || !signADIFFile (fp, adif_rs_len, head, tail)
+                || head != adif_rs_head || tail != adif_rs_tail) {
+        if (debugLevel (DEBUG_ADIF, 1))
+            Serial.printf ("ADIF: file is not just appended\n");
+        return (false);
+    }
+
+    // resume parsing where we left off
+    if (fseek (fp, adif_rs_len, SEEK_SET) < 0)
+        return (false);
+    GenReader gr(fp);
+    int n0 = adif_ss.n_data;
+    int n_bad;
+    adif_ss.n_data = readMoreADIFFile (gr, adif_rs, adif_spots, n0, n_bad);
+    n_adif_bad += n_bad;
+    Serial.printf ("ADIF: appended %d qualifying %d busted spots\n", adif_ss.n_data - n0, n_bad);
+
+    // note new extent for next time
+    adif_rs_len = ftell (fp);
+    adif_rs_ok = adif_rs_len >= 0 && signADIFFile (fp, adif_rs_len, adif_rs_head, adif_rs_tail);
+
+    mergeADIFSpots (n0);
+
+    return (true);
+}
+
+/* read all of fp, which is the ADIF file, and note its extent for tailADIFFile().
+ * a plain file is first read into memory because parsing that is much faster than stdio.
+ * N.B. don't mmap: a logger may truncate the file meanwhile and touching the lost pages raises SIGBUS.
+ */
+static void readADIFFileBuf (FILE *fp)
+{
+    // read what is there now, which may be less than st_size if the file is being rewritten
+    struct stat s;
+    long len = fstat (fileno(fp), &s) == 0 && S_ISREG(s.st_mode) ? s.st_size : 0;
+    char *buf = len > 0 ? (char *) malloc (len) : NULL;
+    if (buf) {
+        long n_read = 0;
+        ssize_t nr = 0;
+        while (n_read < len && (nr = pread (fileno(fp), buf + n_read, len - n_read, n_read)) > 0)
+            n_read += nr;
+        if (nr < 0) {
+            Serial.printf ("ADIF: read %s, using stdio\n", strerror(errno));
+            free (buf);
+            buf = NULL;
+        } else
+            len = n_read;
+    }
+
+    int n_good;
+    if (buf) {
+        // sign exactly what was parsed
+        GenReader gr(buf, len);
+        loadADIFFile (gr, n_good, n_adif_bad);
+        long n = len < ADIF_SIG_LEN ? len : ADIF_SIG_LEN;
+        adif_rs_head = crc32 (crc32 (0L, Z_NULL, 0), (const Bytef *) buf, n);
+        adif_rs_tail = crc32 (crc32 (0L, Z_NULL, 0), (const Bytef *) buf + len - n, n);
+        adif_rs_ok = true;
+        free (buf);
+    } else {
+        GenReader gr(fp);
+        loadADIFFile (gr, n_good, n_adif_bad);
+        len = ftell (fp);
+        adif_rs_ok = len >= 0 && signADIFFile (fp, len, adif_rs_head, adif_rs_tail);
+    }
+    adif_rs_len = len;
+}
+
 /* freshen the ADIF file if used and necessary then update pane if in use.
  * leave with newfile_pending set if file changed but we're currently not in a position to show new entries.
  * N.B. io errors are fatal.
@@ -345,10 +546,9 @@ void freshenADIFFile (void)
         if (!fp)
             fatalError ("ADIF %s: %s", fn_exp, strerror(errno));        // never returns
 
-        // ingest
-        GenReader gr(fp);
-        int n_good;
-        loadADIFFile (gr, n_good, n_adif_bad);
+        // ingest just the new portion if the file has only been appended, else all of it
+        if (!tailADIFFile (fp))
+            readADIFFileBuf (fp);
         fclose (fp);
 
         // update list if showing
@@ -378,7 +578,8 @@ void loadADIFFile (GenReader &gr, int &n_good, int &n_bad)
     loadADIFSettings();
 
     // crack file, adds good entries to adif_spots[]
-    adif_ss.n_data = readADIFFile (gr, adif_spots, true, n_bad);
+    adif_ss.n_data = readADIFFile (gr, adif_rs, adif_spots, true, n_bad);
+    resetADIFWorked();                                  // in case WLID_ADIF used them while empty
 
     // report
     n_good = adif_ss.n_data;
@@ -507,7 +708,7 @@ bool checkADIFTouch (const SCoord &s, const SBox &box)
 bool getClosestADIFSpot (LatLong &ll, DXSpot *sp, LatLong *llp)
 {
     return (adif_spots && findPaneForChoice(PLOT_CH_ADIF) != PANE_NONE
-                && getClosestSpot (adif_spots, adif_ss.n_data, NULL, LOME_BOTH, ll, sp, llp));
+                && getClosestSpot (adif_spots, adif_ss.n_data, adif_grid, NULL, LOME_BOTH, ll, sp, llp));
 }
 
 
@@ -548,32 +749,45 @@ bool getADIFPaneSpot (const SCoord &ms, DXSpot *dxs, LatLong *ll)
 }
 
 /* return whether the given spot matches all the given tests for any ADIF spot.
+ * each combination of tests is indexed the first time it is used for the current adif_spots.
  * N.B. check is limited to spots on ADIF watchlist if any.
  * N.B. if no tests are specified we always return true.
  * N.B. do NOT call freshenADIFFile() here -- it causes an inf loop
  */
 bool onADIFList (const DXSpot &spot, bool chk_dxcc, bool chk_grid, bool chk_pref, bool chk_band)
 {
-    // prep spot
-    HamBandSetting spot_band = findHamBand (spot.kHz);
-    char spot_pref[MAX_PREF_LEN];
-    findCallPrefix (spot.tx_call, spot_pref);
-
-    // compare with each 
-    for (int i = 0; i < adif_ss.n_data; i++) {
-        DXSpot &adif_spot = adif_spots[i];
-        bool pref_match = false;
-        if (chk_pref) {
-            char adif_pref[MAX_PREF_LEN];
-            findCallPrefix (adif_spot.tx_call, adif_pref);
-            pref_match = strcasecmp (spot_pref, adif_pref) == 0;
+    int mask = (chk_dxcc ? AWT_DXCC : 0) | (chk_grid ? AWT_GRID : 0) | (chk_pref ? AWT_PREF : 0)
+                        | (chk_band ? AWT_BAND : 0);
+    if (mask == 0)
+        return (adif_ss.n_data > 0);
+
+    // build index for this combination if first time
+    HashSet &hs = adif_worked[mask];
+    if (!adif_worked_ok[mask]) {
+        if ((mask & AWT_PREF) && !adif_prefs) {
+            adif_prefs = (char (*)[MAX_PREF_LEN]) malloc ((adif_ss.n_data + 1) * MAX_PREF_LEN);
+            if (!adif_prefs)
+                fatalError ("No memory for %d ADIF prefixes", adif_ss.n_data);
+            for (int i = 0; i < adif_ss.n_data; i++)
+                findCallPrefix (adif_spots[i].tx_call, adif_prefs[i]);
         }
-        if (       (!chk_pref || pref_match)
-                && (!chk_dxcc || spot.tx_dxcc == adif_spot.tx_dxcc)
-                && (!chk_band || spot_band == findHamBand (adif_spot.kHz))
-                && (!chk_grid || strncasecmp (spot.tx_grid, adif_spot.tx_grid, 4) == 0))
-            return (true);
+        initHashSet (hs, sizeof(ADIFWorkedKey));
+        for (int i = 0; i < adif_ss.n_data; i++) {
+            ADIFWorkedKey key;
+            fillADIFWorkedKey (key, mask, adif_spots[i], (mask & AWT_PREF) ? adif_prefs[i] : "");
+            (void) addHashSet (hs, &key);
+        }
+        adif_worked_ok[mask] = true;
+        if (debugLevel (DEBUG_ADIF, 1))
+            Serial.printf ("ADIF: worked index %d has %d of %d\n", mask, hs.n_used, adif_ss.n_data);
     }
 
-    return (false);
+    // prep spot
+    char spot_pref[MAX_PREF_LEN] = "";
+    if (mask & AWT_PREF)
+        findCallPrefix (spot.tx_call, spot_pref);
+    ADIFWorkedKey key;
+    fillADIFWorkedKey (key, mask, spot, spot_pref);
+
+    return (inHashSet (hs, &key));
 }
@@ -10,19 +10,6 @@
 
 
 
-typedef enum {
-    ADIFPS_STARTFILE,                                   // initialize all
-    ADIFPS_STARTSPOT,                                   // initialize parser and spot candidate
-    ADIFPS_STARTFIELD,                                  // initialize parser for next field,retain spot so far
-    ADIFPS_SEARCHING,                                   // looking for opening <
-    ADIFPS_INNAME,                                      // after < collecting field name until :
-    ADIFPS_INLENGTH,                                    // after first : building value_len until : or >
-    ADIFPS_INTYPE,                                      // after second : skipping type until >
-    ADIFPS_INVALUE,                                     // after > now collecting value
-    ADIFPS_FINISHED,                                    // spot is complete
-    ADIFPS_SKIPTOEOR,                                   // skip to EOR after finding an error
-} ADIFParseState;
-
 typedef enum {
     AFB_BAND,
     AFB_CALL,
@@ -43,24 +30,6 @@ typedef enum {
     AFB_TIME_ON,
 } ADIFFieldBit;
 
-typedef struct {
-    // running state
-    ADIFParseState ps;                                  // what is happening now
-    int line_n;                                         // line number for diagnostics
-
-    // per-field state
-    char name[20];                                      // field name so far, always includes EOS
-    char value[20];                                     // field value so far, always includes EOS
-    unsigned name_seen;                                 // n name chars seen so far (avoids strlen(name))
-    unsigned value_len;                                 // claimed value length so far from field defn
-    unsigned value_seen;                                // n value chars seen so far (avoids strlen(value))
-
-    // per-spot state
-    uint32_t fields;                                    // bit mask of 1 << ADIFFieldBit seen
-    char qso_date[10];                                  // temp QSO_DATE .. need both to get UNIX time
-    char time_on[10];                                   // temp TIME_ON .. need both to get UNIX time
-} ADIFParser;
-
 #define CHECK_AFB(a,b)   ((a).fields & (1 << (b)))      // handy test for ADIFFieldBit
 #define ADD_AFB(a,b)     ((a).fields |= (1 << (b)))     // handy way to add one ADIFFieldBit
 
@@ -642,32 +611,23 @@ static bool parseADIF (char c, ADIFParser &adif, DXSpot &spot)
     return (finished);
 }
 
-/* general purpose ADIF parser from a GenReader.
- * add malloced DXSpots to spots, add to prefix table and return count.
- * also:
- *   we pass back count of any broken spots or did not qualify WLID_ADIF if used.
- *   use_wl determines whether spots are checked against WLID_ADIF.
- * N.B. must call with spots = NULL and caller is responsible to free (spots).
- * N.B. caller must close gr
+/* parse the rest of gr starting in state rs, appending qualifying spots to spots[] after the n_spots already
+ * there, of which n_malloc are malloced. return new count.
+ * pass back count of broken spots found this time.
  */
-int readADIFFile (GenReader &gr, DXSpot *&spots, bool use_wl, int &n_bad)
+static int parseADIFStream (GenReader &gr, ADIFResume &rs, DXSpot *&spots, int n_spots, int n_malloc, int &n_bad)
 {
     // init counts, timer
     int n_read = 0;
-    int n_good = 0;
-    int n_malloc = 0;
+    int n_good = n_spots;
     const int malloc_more = 1000;
     n_bad = 0;
     struct timeval tv0;
     gettimeofday (&tv0, NULL);
 
-    // reset dxpeds worked list
-    resetDXPedsWorked();
-
     // crack file
-    DXSpot spot;
-    ADIFParser adif;
-    adif.ps = ADIFPS_STARTFILE;
+    ADIFParser &adif = rs.adif;
+    DXSpot &spot = rs.spot;
     char c;
     if (debugLevel (DEBUG_ADIF, 1))
         Serial.printf ("ADIF: WL DE_Call   Grid   DXCC  DX_Call   Grid   DXCC    Lat   Long Mode      kHz\n");
@@ -682,7 +642,7 @@ int readADIFFile (GenReader &gr, DXSpot *&spots, bool use_wl, int &n_bad)
                 addDXPedsWorked (spot);
 
                 // add to list if qualifies watch list
-                bool wl_ok = !use_wl || checkWatchListSpot(WLID_ADIF, spot) != WLS_NO;
+                bool wl_ok = !rs.use_wl || checkWatchListSpot(WLID_ADIF, spot) != WLS_NO;
                 if (wl_ok) {
                     // add to *spots_p
                     if (n_good+1 > n_malloc) {
@@ -710,15 +670,55 @@ int readADIFFile (GenReader &gr, DXSpot *&spots, bool use_wl, int &n_bad)
     }
 
     // rm excess spots
-    spots = (DXSpot *) realloc (spots, n_good * sizeof(DXSpot));
+    if (n_malloc > n_good)
+        spots = (DXSpot *) realloc (spots, n_good * sizeof(DXSpot));
 
     if (debugLevel (DEBUG_ADIF, 1)) {
         struct timeval tv1;
         gettimeofday (&tv1, NULL);
         long usec = TVDELUS (tv0, tv1);
         Serial.printf ("ADIF: file read %d required %ld ms = %ld spots/s\n", n_read, usec/1000,
-                                                                                1000000L*n_read/usec);
+                                                                                1000000L*n_read/(usec+1));
     }
 
     return (n_good);
 }
+
+/* general purpose ADIF parser from a GenReader.
+ * add malloced DXSpots to spots, add to prefix table and return count.
+ * also:
+ *   we pass back count of any broken spots or did not qualify WLID_ADIF if used.
+ *   use_wl determines whether spots are checked against WLID_ADIF.
+ *   rs is left ready for readMoreADIFFile() should more be appended to the same source.
+ * N.B. must call with spots = NULL and caller is responsible to free (spots).
+ * N.B. caller must close gr
+ */
+int readADIFFile (GenReader &gr, ADIFResume &rs, DXSpot *&spots, bool use_wl, int &n_bad)
+{
+    // reset dxpeds worked list
+    resetDXPedsWorked();
+
+    // start fresh
+    rs.adif.ps = ADIFPS_STARTFILE;
+    rs.use_wl = use_wl;
+    return (parseADIFStream (gr, rs, spots, 0, 0, n_bad));
+}
+
+/* same but when the parser state is not needed afterwards
+ */
+int readADIFFile (GenReader &gr, DXSpot *&spots, bool use_wl, int &n_bad)
+{
+    ADIFResume rs;
+    return (readADIFFile (gr, rs, spots, use_wl, n_bad));
+}
+
+/* continue parsing with bytes appended to the source last given to readADIFFile() or readMoreADIFFile()
+ * with the same rs, now available from gr, appending qualifying spots to the n_spots already in spots[].
+ * return new count, pass back count of broken spots found this time.
+ * N.B. result is exactly as if the whole source had been read in one pass.
+ * N.B. caller must close gr
+ */
+int readMoreADIFFile (GenReader &gr, ADIFResume &rs, DXSpot *&spots, int n_spots, int &n_bad)
+{
+    return (parseADIFStream (gr, rs, spots, n_spots, n_spots, n_bad));
+}
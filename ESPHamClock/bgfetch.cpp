@@ -0,0 +1,235 @@
+/* run network downloads on background threads so a slow server never stalls the main loop.
+ *
+ * startBGFetch() queues a job. One of a few worker threads runs its fetch function, which does all the
+ * network io and parsing into a fresh buffer it owns, then the job moves to the done list. pollBGFetch(),
+ * called from loop(), then runs each done function on the main thread where it may swap the new data
+ * into place and redraw. Thus only the done functions may touch the display or shared state.
+ *
+ * The few things the http helpers need from the main thread travel with the job: the User-Agent is built
+ * when the job is queued, and the Remote_Addr a fetch hears back is copied to remote_addr before done.
+ */
+
+#include "HamClock.h"
+
+
+#define BGF_MAXTHREADS  3                       // max worker threads, each is one download at a time
+
+// job states
+typedef enum {
+    BGF_QUEUED,                                 // waiting for a worker
+    BGF_RUNNING,                                // fetch function is running on a worker
+    BGF_DONE,                                   // waiting for pollBGFetch()
+} BGFState;
+
+// one download request
+typedef struct _bgfjob {
+    const char *name;                           // unique name while in use, not copied
+    BGFetchFP fetch;                            // runs on a worker
+    BGDoneFP done;                              // runs in pollBGFetch()
+    void *data;                                 // passed to both
+    bool ok;                                    // fetch result
+    BGFState state;                             // progress
+    pthread_t worker;                           // thread running fetch while BGF_RUNNING
+    char ua[USER_AGENT_LEN];                    // User-Agent built by startBGFetch()
+    char raddr[sizeof(remote_addr)];            // Remote_Addr reported by fetch, if any
+    struct _bgfjob *next;                       // next in bgf_jobs list
+} BGFJob;
+
+// shared state, all guarded by bgf_lock
+static pthread_mutex_t bgf_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bgf_go = PTHREAD_COND_INITIALIZER;        // tell workers a new job is queued
+static BGFJob *bgf_jobs;                        // all jobs in order of arrival
+static int bgf_nthreads;                        // n worker threads running
+static int bgf_nidle;                           // n worker threads waiting for work
+static int bgf_ndone;                           // n jobs in BGF_DONE state
+
+
+
+/* return the oldest job in the given state, else NULL.
+ * N.B. caller must hold bgf_lock
+ */
+static BGFJob *findBGFJob (BGFState state)
+{
+    for (BGFJob *jp = bgf_jobs; jp; jp = jp->next)
+        if (jp->state == state)
+            return (jp);
+    return (NULL);
+}
+
+/* forever thread that runs queued fetch functions
+ */
+static void *bgFetchThread (void *unused)
+{
+    (void) unused;
+    pthread_detach(pthread_self());
+
+    pthread_mutex_lock (&bgf_lock);
+    for (;;) {
+
+        // wait for work
+        BGFJob *jp;
+        bgf_nidle++;
+        while ((jp = findBGFJob (BGF_QUEUED)) == NULL)
+            pthread_cond_wait (&bgf_go, &bgf_lock);
+        bgf_nidle--;
+
+        // run without holding the lock
+        jp->state = BGF_RUNNING;
+        jp->worker = pthread_self();
+        pthread_mutex_unlock (&bgf_lock);
+        bool ok = (*jp->fetch) (jp->data);
+        pthread_mutex_lock (&bgf_lock);
+
+        // hand back to main thread
+        jp->ok = ok;
+        jp->state = BGF_DONE;
+        bgf_ndone++;
+    }
+
+    return (NULL);      // lint
+}
+
+/* return the job being run by the calling thread, else NULL if it is not a worker.
+ * N.B. caller must hold bgf_lock
+ */
+static BGFJob *findMyBGFJob (void)
+{
+    pthread_t me = pthread_self();
+    for (BGFJob *jp = bgf_jobs; jp; jp = jp->next)
+        if (jp->state == BGF_RUNNING && pthread_equal (jp->worker, me))
+            return (jp);
+    return (NULL);
+}
+
+/* return whether the given name is still queued, running or waiting for its done function.
+ * N.B. caller must hold bgf_lock
+ */
+static bool findBGFName (const char *name)
+{
+    for (BGFJob *jp = bgf_jobs; jp; jp = jp->next)
+        if (strcmp (jp->name, name) == 0)
+            return (true);
+    return (false);
+}
+
+/* queue a background download called name.
+ * fetch(data) runs on a worker thread and must touch nothing but data; then done(data, ok) runs on
+ * the main thread during a later pollBGFetch() where it takes over data.
+ * return false, having called neither, if name is already in progress.
+ * N.B. name must remain valid until done has been called.
+ */
+bool startBGFetch (const char *name, BGFetchFP fetch, BGDoneFP done, void *data)
+{
+    // prepare outside the lock, User-Agent looks at much of the main thread state
+    BGFJob *jp = (BGFJob *) calloc (1, sizeof(BGFJob));
+    if (!jp)
+        fatalError ("No memory for background fetch %s", name);
+    jp->name = name;
+    jp->fetch = fetch;
+    jp->done = done;
+    jp->data = data;
+    jp->state = BGF_QUEUED;
+    buildUserAgent (jp->ua, sizeof(jp->ua));
+
+    pthread_mutex_lock (&bgf_lock);
+
+    // one at a time per name
+    if (findBGFName (name)) {
+        pthread_mutex_unlock (&bgf_lock);
+        free (jp);
+        return (false);
+    }
+
+    // append to keep arrival order
+    BGFJob **jpp = &bgf_jobs;
+    while (*jpp)
+        jpp = &(*jpp)->next;
+    *jpp = jp;
+
+    // add another worker if all are busy and we are still allowed
+    if (bgf_nidle == 0 && bgf_nthreads < BGF_MAXTHREADS) {
+        pthread_t tid;
+        int e = pthread_create (&tid, NULL, bgFetchThread, NULL);
+        if (e)
+            fatalError ("Background fetch thread failed: %s", strerror(e));
+        bgf_nthreads++;
+        if (debugLevel (DEBUG_NET, 1))
+            Serial.printf ("BGF: now %d threads\n", bgf_nthreads);
+    }
+
+    pthread_cond_signal (&bgf_go);
+
+    pthread_mutex_unlock (&bgf_lock);
+
+    if (debugLevel (DEBUG_NET, 1))
+        Serial.printf ("BGF: queued %s\n", name);
+
+    return (true);
+}
+
+/* return whether a background download with the given name is in progress.
+ */
+bool isBGFetchBusy (const char *name)
+{
+    pthread_mutex_lock (&bgf_lock);
+    bool busy = findBGFName (name);
+    pthread_mutex_unlock (&bgf_lock);
+    return (busy);
+}
+
+/* if called from a fetch function, copy the User-Agent its job was queued with and return true,
+ * else return false to indicate the caller is the main thread.
+ */
+bool getBGFetchUserAgent (char *ua, size_t ua_len)
+{
+    pthread_mutex_lock (&bgf_lock);
+    BGFJob *jp = findMyBGFJob();
+    if (jp)
+        quietStrncpy (ua, jp->ua, ua_len);
+    pthread_mutex_unlock (&bgf_lock);
+    return (jp != NULL);
+}
+
+/* if called from a fetch function, save raddr for pollBGFetch() to install in remote_addr and return true,
+ * else return false to indicate the caller is the main thread.
+ */
+bool setBGFetchRemoteAddr (const char *raddr)
+{
+    pthread_mutex_lock (&bgf_lock);
+    BGFJob *jp = findMyBGFJob();
+    if (jp)
+        quietStrncpy (jp->raddr, raddr, sizeof(jp->raddr));
+    pthread_mutex_unlock (&bgf_lock);
+    return (jp != NULL);
+}
+
+/* called often from the main thread to run the done function of each finished download.
+ */
+void pollBGFetch (void)
+{
+    for (;;) {
+
+        // remove the oldest finished job, if any
+        pthread_mutex_lock (&bgf_lock);
+        BGFJob *jp = NULL;
+        if (bgf_ndone > 0) {
+            BGFJob **jpp = &bgf_jobs;
+            while ((*jpp)->state != BGF_DONE)
+                jpp = &(*jpp)->next;
+            jp = *jpp;
+            *jpp = jp->next;
+            bgf_ndone--;
+        }
+        pthread_mutex_unlock (&bgf_lock);
+        if (!jp)
+            break;
+
+        // report
+        if (debugLevel (DEBUG_NET, 1))
+            Serial.printf ("BGF: finished %s %s\n", jp->name, jp->ok ? "ok" : "failed");
+        if (jp->raddr[0])
+            quietStrncpy (remote_addr, jp->raddr, sizeof(remote_addr));
+        (*jp->done) (jp->data, jp->ok);
+        free (jp);
+    }
+}
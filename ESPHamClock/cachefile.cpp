@@ -1,7 +1,56 @@
-/* manage cached text files.
+/* manage downloaded files.
+ *
+ * each downloaded file in our_dir -- cached text files, map images and SDO images -- is listed in a manifest
+ * with its CacheClass, size and time of last use. For cached text files it also records the ETag and
+ * Last-Modified of the download, along with the crc and size of its content, so a stale file can be refreshed
+ * with a conditional GET, and a 304 reply or an identical download merely resets its age.
+ *
+ * manageCache() removes files not used within the TTL of their class then, while the total still exceeds
+ * cache_budget_mb, the least recently used. Files marked with pinCacheFile(), such as the map images now
+ * mmapped for display, are neither expired nor evicted and count as used at each check. The manifest is kept in
+ * memory and saved to CACHE_INDEX after each download and each manageCache(), so mere use does not rewrite it.
  */
 
 #include "HamClock.h"
+#include "zlib.h"                                       // ours, for crc32
+
+#define CACHE_INDEX     "cache-index.txt"               // one CacheEntry per line, tab separated
+#define CACHE_GRACE     600                             // never evict a file used this recently, secs
+#define CACHE_CHECK_MS  (600*1000UL)                    // manageCache() interval, millis
+
+// max MB of all files in the manifest, 0 for no limit; map images grow as BUILD_W squared
+int cache_budget_mb = 200 * (BUILD_W/800) * (BUILD_W/800);
+
+// one manifest entry
+typedef struct {
+    char fn[100];                                       // file name in our_dir
+    CacheClass cc;                                      // class
+    long size;                                          // bytes on disk
+    time_t used;                                        // last time it was used, myNow()
+    uint32_t crc;                                       // crc32 of content, CC_TEXT only
+    char etag[100];                                     // ETag, or "" if none, CC_TEXT only
+    char lastmod[50];                                   // Last-Modified, or "" if none, CC_TEXT only
+    bool pinned;                                        // in use now, never removed; not saved
+} CacheEntry;
+
+// per-class name, TTL and counters since startup
+typedef struct {
+    const char *name;                                   // name in CACHE_INDEX and reports
+    long ttl;                                           // remove if not used for this long, secs
+    int n_hits, n_downloads, n_evicted, n_expired;      // counters
+} CacheClassInfo;
+static CacheClassInfo cc_info[CC_N] = {
+    {"Text", 14*24*3600L, 0, 0, 0, 0},                  // CC_TEXT
+    {"Map",   7*24*3600L, 0, 0, 0, 0},                  // CC_MAP
+    {"SDO",   1*24*3600L, 0, 0, 0, 0},                  // CC_SDO
+};
+
+// the manifest, may be used by any thread
+static CacheEntry *manifest;                            // malloced list
+static int n_manifest;                                  // n in list
+static bool manifest_loaded;                            // whether CACHE_INDEX has been read
+static bool manifest_dirty;                             // whether manifest differs from CACHE_INDEX
+static pthread_mutex_t manifest_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 
@@ -53,7 +102,355 @@ static bool fileAgeOk (const char *path, int max_age)
 }
 
 
+/* crack one CACHE_INDEX line into ce, return whether ok.
+ * N.B. line is modified
+ */
+static bool crackIndexLine (char *line, CacheEntry &ce)
+{
+    char *fields[7];
+    int n_fields = 0;
+    for (char *lp = line; n_fields < 7 && lp; n_fields++)
+        fields[n_fields] = strsep (&lp, "\t\n");
+    if (n_fields < 7)
+        return (false);
+
+    int cc;
+    for (cc = 0; cc < CC_N; cc++)
+        if (strcmp (fields[1], cc_info[cc].name) == 0)
+            break;
+    if (cc == CC_N)
+        return (false);
+
+    quietStrncpy (ce.fn, fields[0], sizeof(ce.fn));
+    ce.cc = (CacheClass) cc;
+    ce.size = atol (fields[2]);
+    ce.used = atol (fields[3]);
+    ce.crc = strtoul (fields[4], NULL, 16);
+    quietStrncpy (ce.etag, fields[5], sizeof(ce.etag));
+    quietStrncpy (ce.lastmod, fields[6], sizeof(ce.lastmod));
+    ce.pinned = false;
+    return (ce.fn[0] != '\0');
+}
+
+/* read CACHE_INDEX into manifest if not already.
+ * N.B. caller must hold manifest_lock
+ */
+static void loadManifest (void)
+{
+    if (manifest_loaded)
+        return;
+    manifest_loaded = true;
+
+    char path[1000];
+    snprintf (path, sizeof(path), "%s/%s", our_dir.c_str(), CACHE_INDEX);
+    FILE *fp = fopen (path, "r");
+    if (!fp)
+        return;
+
+    char line[400];
+    CacheEntry ce;
+    while (fgets (line, sizeof(line), fp)) {
+        if (crackIndexLine (line, ce)) {
+            manifest = (CacheEntry *) realloc (manifest, (n_manifest+1)*sizeof(CacheEntry));
+            if (!manifest)
+                fatalError ("No memory for %d cache entries", n_manifest+1);
+            manifest[n_manifest++] = ce;
+        }
+    }
+    fclose (fp);
+
+    if (debugLevel (DEBUG_CACHE, 1))
+        Serial.printf ("Cache: read %d manifest entries\n", n_manifest);
+}
+
+/* write manifest to CACHE_INDEX if it has changed.
+ * N.B. caller must hold manifest_lock
+ */
+static void saveManifest (void)
+{
+    if (!manifest_dirty)
+        return;
+
+    char path[1000], tmp_path[1000];
+    snprintf (path, sizeof(path), "%s/%s", our_dir.c_str(), CACHE_INDEX);
+    snprintf (tmp_path, sizeof(tmp_path), "%s/x.%s", our_dir.c_str(), CACHE_INDEX);
+
+    FILE *fp = fopen (tmp_path, "w");
+    if (!fp) {
+        Serial.printf ("Cache: %s: %s\n", tmp_path, strerror(errno));
+        return;
+    }
+    for (int i = 0; i < n_manifest; i++) {
+        const CacheEntry &ce = manifest[i];
+        fprintf (fp, "%s\t%s\t%ld\t%ld\t%08X\t%s\t%s\n", ce.fn, cc_info[ce.cc].name, ce.size,
+                                        (long)ce.used, ce.crc, ce.etag, ce.lastmod);
+    }
+    if (fclose (fp) != 0 || rename (tmp_path, path) < 0) {
+        Serial.printf ("Cache: %s: %s\n", path, strerror(errno));
+        (void) unlink (tmp_path);
+    } else
+        manifest_dirty = false;
+}
+
+/* return the manifest entry for fn, else NULL.
+ * N.B. caller must hold manifest_lock
+ */
+static CacheEntry *findEntry (const char *fn)
+{
+    for (int i = 0; i < n_manifest; i++)
+        if (strcmp (manifest[i].fn, fn) == 0)
+            return (&manifest[i]);
+    return (NULL);
+}
+
+/* return the manifest entry for fn, adding a fresh one of the given class if new.
+ * N.B. caller must hold manifest_lock
+ */
+static CacheEntry *addEntry (const char *fn, CacheClass cc)
+{
+    CacheEntry *cep = findEntry (fn);
+    if (!cep) {
+        manifest = (CacheEntry *) realloc (manifest, (n_manifest+1)*sizeof(CacheEntry));
+        if (!manifest)
+            fatalError ("No memory for %d cache entries", n_manifest+1);
+        cep = &manifest[n_manifest++];
+        memset (cep, 0, sizeof(*cep));
+        quietStrncpy (cep->fn, fn, sizeof(cep->fn));
+    }
+    cep->cc = cc;
+    manifest_dirty = true;
+    return (cep);
+}
+
+/* remove manifest[i] from the list, and from our_dir too if rm_file.
+ * N.B. caller must hold manifest_lock
+ */
+static void rmEntry (int i, bool rm_file)
+{
+    if (rm_file) {
+        char path[1000];
+        snprintf (path, sizeof(path), "%s/%s", our_dir.c_str(), manifest[i].fn);
+        if (unlink (path) < 0 && errno != ENOENT)
+            Serial.printf ("Cache: unlink(%s): %s\n", path, strerror(errno));
+    }
+    manifest[i] = manifest[--n_manifest];               // order does not matter
+    manifest_dirty = true;
+}
+
+/* remove the least recently used files until the manifest total is within cache_budget_mb,
+ * sparing any pinned or used within CACHE_GRACE.
+ * N.B. caller must hold manifest_lock
+ */
+static void enforceBudget (void)
+{
+    if (cache_budget_mb <= 0)
+        return;
+
+    long long total = 0;
+    for (int i = 0; i < n_manifest; i++)
+        total += manifest[i].size;
+
+    const long long budget = cache_budget_mb * 1000000LL;
+    const time_t now = myNow();
+    while (total > budget) {
+
+        // find oldest that is not pinned or too recent
+        int oldest = -1;
+        for (int i = 0; i < n_manifest; i++)
+            if (!manifest[i].pinned && now - manifest[i].used > CACHE_GRACE
+                                && (oldest < 0 || manifest[i].used < manifest[oldest].used))
+                oldest = i;
+        if (oldest < 0) {
+            Serial.printf ("Cache: %lld bytes exceeds budget but all are in use\n", total);
+            break;
+        }
+
+        CacheEntry &ce = manifest[oldest];
+        Serial.printf ("Cache: evict %s %ld bytes unused %ld s\n", ce.fn, ce.size, (long)(now - ce.used));
+        cc_info[ce.cc].n_evicted++;
+        total -= ce.size;
+        rmEntry (oldest, true);
+    }
+}
+
+/* note fn in our_dir, of the given class, was just used, and whether it was freshly downloaded to do so.
+ */
+void noteCacheFile (const char *fn, CacheClass cc, bool downloaded)
+{
+    char path[1000];
+    snprintf (path, sizeof(path), "%s/%s", our_dir.c_str(), fn);
+    struct stat sbuf;
+    bool exists = stat (path, &sbuf) == 0;
+
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+
+    if (exists) {
+        CacheEntry *cep = addEntry (fn, cc);
+        cep->size = sbuf.st_size;
+        cep->used = myNow();
+        if (downloaded)
+            cc_info[cc].n_downloads++;
+        else
+            cc_info[cc].n_hits++;
+    } else {
+        CacheEntry *cep = findEntry (fn);
+        if (cep)
+            rmEntry (cep - manifest, false);
+    }
+
+    // persist and check space now when something new arrives, else leave for manageCache()
+    if (downloaded) {
+        enforceBudget();
+        saveManifest();
+    }
+
+    pthread_mutex_unlock (&manifest_lock);
+}
+
+/* mark whether fn in our_dir is in use indefinitely, such as a map image while it is mmapped.
+ * a pinned file is never expired or evicted and counts as used at each manageCache().
+ * N.B. fn must already have been listed by noteCacheFile() for pinning to have any effect.
+ */
+void pinCacheFile (const char *fn, bool pinned)
+{
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+
+    CacheEntry *cep = findEntry (fn);
+    if (cep) {
+        cep->pinned = pinned;
+        cep->used = myNow();
+        manifest_dirty = true;
+    }
+
+    pthread_mutex_unlock (&manifest_lock);
+}
+
+/* call often: every CACHE_CHECK_MS remove files not used within their class TTL or more than fit
+ * cache_budget_mb, then save the manifest.
+ * N.B. only files listed by noteCacheFile() are ever considered.
+ */
+void manageCache (void)
+{
+    static uint32_t check_ms;
+    if (!timesUp (&check_ms, CACHE_CHECK_MS))
+        return;
+
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+
+    const time_t now = myNow();
+    for (int i = n_manifest; --i >= 0; ) {
+        CacheEntry &ce = manifest[i];
+        char path[1000];
+        snprintf (path, sizeof(path), "%s/%s", our_dir.c_str(), ce.fn);
+        struct stat sbuf;
+        if (stat (path, &sbuf) < 0) {
+            // removed by other means such as cleanCache()
+            if (debugLevel (DEBUG_CACHE, 1))
+                Serial.printf ("Cache: %s is gone\n", ce.fn);
+            rmEntry (i, false);
+        } else if (ce.pinned) {
+            // still in use so its age starts from now
+            ce.used = now;
+            manifest_dirty = true;
+            if (ce.size != sbuf.st_size)
+                ce.size = sbuf.st_size;
+        } else if (now - ce.used > cc_info[ce.cc].ttl) {
+            Serial.printf ("Cache: expire %s unused %ld > %ld s\n", ce.fn, (long)(now - ce.used),
+                                        cc_info[ce.cc].ttl);
+            cc_info[ce.cc].n_expired++;
+            rmEntry (i, true);
+        } else if (ce.size != sbuf.st_size) {
+            ce.size = sbuf.st_size;
+            manifest_dirty = true;
+        }
+    }
+
+    enforceBudget();
+    saveManifest();
+
+    pthread_mutex_unlock (&manifest_lock);
+}
+
+/* pass back current state of each class.
+ */
+void getCacheStats (CacheStats stats[CC_N])
+{
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+
+    for (int cc = 0; cc < CC_N; cc++) {
+        CacheStats &cs = stats[cc];
+        const CacheClassInfo &ci = cc_info[cc];
+        cs.name = ci.name;
+        cs.ttl = ci.ttl;
+        cs.n_files = 0;
+        cs.n_bytes = 0;
+        cs.n_hits = ci.n_hits;
+        cs.n_downloads = ci.n_downloads;
+        cs.n_evicted = ci.n_evicted;
+        cs.n_expired = ci.n_expired;
+    }
+    for (int i = 0; i < n_manifest; i++) {
+        stats[manifest[i].cc].n_files++;
+        stats[manifest[i].cc].n_bytes += manifest[i].size;
+    }
+
+    pthread_mutex_unlock (&manifest_lock);
+}
+
+/* find the validators of the CC_TEXT file fn, return whether found.
+ */
+static bool findValidators (const char *fn, CacheEntry &ce)
+{
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+    CacheEntry *cep = findEntry (fn);
+    bool found = cep && cep->cc == CC_TEXT;
+    if (found)
+        ce = *cep;
+
+    pthread_mutex_unlock (&manifest_lock);
+
+    return (found);
+}
+
+/* save the validators of a fresh download of the CC_TEXT file fn.
+ */
+static void saveValidators (const char *fn, uint32_t crc, long size, const char *etag, const char *lastmod)
+{
+    pthread_mutex_lock (&manifest_lock);
+
+    loadManifest();
+    CacheEntry *cep = addEntry (fn, CC_TEXT);
+    cep->crc = crc;
+    cep->size = size;
+    quietStrncpy (cep->etag, etag, sizeof(cep->etag));
+    quietStrncpy (cep->lastmod, lastmod, sizeof(cep->lastmod));
+
+    pthread_mutex_unlock (&manifest_lock);
+}
+
+/* set the modification time of the given file to now so it is as good as a fresh download
+ */
+static void touchFile (const char *path)
+{
+    struct timeval tv[2];
+    tv[0].tv_sec = tv[1].tv_sec = myNow();
+    tv[0].tv_usec = tv[1].tv_usec = 0;
+    if (utimes (path, tv) < 0)
+        Serial.printf ("Cache: utimes(%s) %s\n", path, strerror(errno));
+}
+
 /* open the given local file or download fresh if too old or too small.
+ * if the local file is just too old, ask the server to send it only if it has changed.
  * if download fails retain fn as long as it's large enough, tolerating too old.
  */
 FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size)
@@ -62,10 +459,12 @@ FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size
     char fn_path[1000];
     snprintf (fn_path, sizeof(fn_path), "%s/%s", our_dir.c_str(), fn);
     FILE *fp = fopen (fn_path, "r");
+    bool have_local = fp != NULL;
     if (fp) {
         // file exists, now check the age and size
         if (fileSizeOk (fn_path, min_size) && fileAgeOk (fn_path, max_age)) {
             // still good!
+            noteCacheFile (fn, CC_TEXT, false);
             return (fp);
         } else {
             // open again after download
@@ -75,6 +474,20 @@ FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size
     } else
         Serial.printf ("Cache: %s not found -- downloading %s\n", fn, url);
 
+    // if we still have a usable copy, ask for the file only if the server's copy has since changed
+    CacheEntry cv;
+    bool downloaded = false;
+    char xhdrs[300];
+    bool have_cv = have_local && fileSizeOk (fn_path, min_size) && findValidators (fn, cv);
+    xhdrs[0] = '\0';
+    if (have_cv) {
+        int xl = 0;
+        if (cv.etag[0])
+            xl += snprintf (xhdrs+xl, sizeof(xhdrs)-xl, "If-None-Match: %s\r\n", cv.etag);
+        if (cv.lastmod[0])
+            xl += snprintf (xhdrs+xl, sizeof(xhdrs)-xl, "If-Modified-Since: %s\r\n", cv.lastmod);
+    }
+
     // download
     WiFiClient cache_client;
     Serial.println (url);
@@ -83,20 +496,36 @@ FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size
         updateClocks(false);
 
         // query web page
-        httpHCGET (cache_client, backend_host, url);
+        httpHCGET (cache_client, backend_host, url, xhdrs);
 
-        // skip header
-        if (!httpSkipHeader (cache_client)) {
+        // skip header but capture status, validators and length, and Remote_Addr as usual
+        char etag[100], lastmod[100], raddr[100], c_len[100];
+        const char *hdrs[4] = {"ETag: ", "Last-Modified: ", "Remote_Addr: ", "Content-Length: "};
+        char *values[4] = {etag, lastmod, raddr, c_len};
+        int status;
+        if (!httpSkipHeader (cache_client, &status, 4, hdrs, values, sizeof(etag))) {
             Serial.printf ("Cache: %s head short\n", url);
             goto out;
         }
+        quietStrncpy (remote_addr, raddr, sizeof(remote_addr));
+
+        // unchanged?
+        if (status == 304 && have_cv) {
+            touchFile (fn_path);
+            Serial.printf ("Cache: %s not modified\n", fn);
+            goto out;
+        }
+        if (status != 200) {
+            Serial.printf ("Cache: %s status %d\n", url, status);
+            goto out;
+        }
 
         // start new temp file near first so it can be renamed
         char tmp_path[1000];
         snprintf (tmp_path, sizeof(tmp_path), "%s/x.%s", our_dir.c_str(), fn);
         fp = fopen (tmp_path, "w");
         if (!fp) {
-            Serial.printf ("Cache: %s: x.%s\n", fn, strerror(errno));
+            Serial.printf ("Cache: %s: %s\n", tmp_path, strerror(errno));
             goto out;
         }
 
@@ -104,23 +533,54 @@ FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size
         if (fchown (fileno(fp), getuid(), getgid()) < 0)
             Serial.printf ("Cache: chown(%s,%d,%d) %s\n", tmp_path, getuid(), getgid(), strerror(errno));
 
-        // download
-        char buf[1024];
+        // download as is, noting crc and size
+        const uint8_t *buf;
+        int n_buf;
         bool io_ok = true;
-        while (io_ok && getTCPLine (cache_client, buf, sizeof(buf), NULL)) {
-            if (fprintf (fp, "%s\n", buf) < 1) {
+        uint32_t crc = crc32 (0L, Z_NULL, 0);
+        long size = 0;
+        while (io_ok && (n_buf = cache_client.readView (&buf, 0x10000)) > 0) {
+            crc = crc32 (crc, buf, n_buf);
+            size += n_buf;
+            if (fwrite (buf, 1, n_buf, fp) != (size_t)n_buf) {
                 io_ok = false;
                 Serial.printf ("Cache: write(%s) %s\n", tmp_path, strerror(errno));
             }
         }
+
+        // a body cut short looks like a normal end to readView() so check before trusting it.
+        // N.B. httpSkipHeader() clears c_len if gzip because then it is not the size we wrote
+        if (io_ok && !cache_client.bodyComplete()) {
+            io_ok = false;
+            Serial.printf ("Cache: %s download is short after %ld bytes\n", url, size);
+        }
+        if (io_ok && c_len[0] && atol(c_len) != size) {
+            io_ok = false;
+            Serial.printf ("Cache: %s download is %ld bytes but Content-Length is %s\n", url, size, c_len);
+        }
+
+        // insure it is all on disk before rename makes it the real file
+        if (fflush (fp) != 0 || fsync (fileno(fp)) < 0) {
+            io_ok = false;
+            Serial.printf ("Cache: sync(%s) %s\n", tmp_path, strerror(errno));
+        }
         fclose (fp);
 
-        // tmp replaces fn_path if io and size ok
+        // tmp replaces fn_path if io and size ok, unless it's the same anyway
         if (io_ok && fileSizeOk (tmp_path, min_size)) {
-            if (rename (tmp_path, fn_path) == 0)
+            if (have_cv && cv.crc == crc && cv.size == size) {
+                touchFile (fn_path);
+                Serial.printf ("Cache: %s unchanged\n", fn);
+            } else if (rename (tmp_path, fn_path) == 0)
                 Serial.printf ("Cache: fresh %s installed\n", fn);
-            else
+            else {
                 Serial.printf ("Cache: rename(%s,%s) %s\n", tmp_path, fn_path, strerror(errno));
+                io_ok = false;
+            }
+            if (io_ok) {
+                saveValidators (fn, crc, size, etag, lastmod);
+                downloaded = true;
+            }
         }
 
         // clean up tmp
@@ -137,8 +597,10 @@ FILE *openCachedFile (const char *fn, const char *url, int max_age, int min_size
 
     // open again but now tolerate too old if must
     fp = fopen (fn_path, "r");
-    if (fp && fileSizeOk (fn_path, min_size))
+    if (fp && fileSizeOk (fn_path, min_size)) {
+        noteCacheFile (fn, CC_TEXT, downloaded);
         return (fp);
+    }
 
     Serial.printf ("Cache: updating %s failed\n", fn);
     return (NULL);
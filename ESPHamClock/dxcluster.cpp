@@ -5,6 +5,11 @@
  * We actually keep two lists:
  *   dxc_spots: the complete raw list, not filtered nor sorted; length in n_dxspots.
  *   dxwl_spots: watchlist-filtered and time-sorted for display; length in dxc_ss.n_data.
+ *
+ * Each new or updated spot in dxc_spots is also noted in the dxc_expq ring in order of arrival, so expiring
+ * old spots need only look at the oldest end of the ring. Duplicates are found with dxc_index of the
+ * dxc_spots index of each spot by tx_call and band. A spot is removed by moving the last into its place.
+ * Thus adding, updating and expiring a spot are each O(1).
  * 
  */
 
@@ -30,17 +35,37 @@ static const uint8_t dxc_ages[] = {10, 20, 40, 60};   // menu selections in asce
 static uint8_t dxc_age;                               // one of above, once set
 #define N_DXCAGES       NARRAY(dxc_ages)              // handy count
 #define MAXKEEP_DT      (60*dxc_ages[N_DXCAGES-1])    // max age to stay on dxc_spots list, secs
+#define DXC_MAXSPOTS    5000                          // max spots kept, oldest are dropped beyond this
+#define DXC_MAXEXPQ     (4*DXC_MAXSPOTS)              // max dxc_expq, stale entries are purged beyond this
 
 // timing
 #define BGCHECK_DT      1000                    // background checkDXCluster period, millis
 #define DXCMSG_DT       500                     // delay before sending each cluster message, millis
 #define HBEAT_MS        60000                   // heatbeat interval, millis
 
+// dxc_index key
+typedef struct {
+    char call[MAX_SPOTCALL_LEN];                // tx_call
+    int band;                                   // HamBandSetting
+} DXCKey;
+
+// dxc_expq entry
+typedef struct {
+    DXCKey key;                                 // spot
+    time_t spotted;                             // spot time when added, stale if spot has since changed
+} DXCExpire;
+
 // state
-static DXSpot *dxc_spots;                       // malloced list of all spots
+static DXSpot *dxc_spots;                       // malloced list of all spots, room for DXC_MAXSPOTS
 static int n_dxspots;                           // n spots in dxc_spots
+static HashSet dxc_index;                       // DXCKey to int index into dxc_spots
+static DXCExpire *dxc_expq;                     // malloced ring of DXC_MAXEXPQ, oldest at dxc_expq0
+static int dxc_expq0, n_dxc_expq;               // index of oldest in dxc_expq, n in use
+static time_t dxc_newest;                       // newest spotted time in dxc_spots
+static LLGrid dxc_grid;                         // spatial index of dxc_spots
 static DXSpot *dxwl_spots;                      // malloced list, filtered for display, count in dxc_ss.n_data
 static ScrollState dxc_ss;                      // scrolling info, and count of dxwl_spots
+static LLGrid dxwl_grid;                        // spatial index of dxwl_spots
 static bool dxc_showbio;                        // whether click shows bio
 static bool dxc_spots_changed;                  // set to rebuild display because dxc_spots changed
 static bool dxc_updateDE;                       // request to send DE location when possible
@@ -88,7 +113,7 @@ static void drawClearListBtn (bool draw)
  */
 static bool showingNewSpot(void)
 {
-    return (scrolledaway_tm > 0 && n_dxspots > 0 && dxc_spots[n_dxspots-1].spotted > scrolledaway_tm);
+    return (scrolledaway_tm > 0 && n_dxspots > 0 && dxc_newest > scrolledaway_tm);
 }
 
 /* rebuild dxwl_spots from dxc_spots
@@ -101,6 +126,7 @@ static void rebuildDXWatchList(void)
     // extract qualifying spots
     time_t oldest = myNow() - 60*dxc_age;               // oldest time to display, seconds
     dxc_ss.n_data = 0;                                  // reset count, don't bother to resize dxwl_spots
+    resetLLGrid (dxwl_grid);
     for (int i = 0; i < n_dxspots; i++) {
         DXSpot &spot = dxc_spots[i];
         if (spot.spotted >= oldest && checkWatchListSpot (WLID_DX, spot) != WLS_NO) {
@@ -186,6 +212,133 @@ static void logDXSpot (const char *label, const DXSpot &spot)
                                 spot_time->tm_hour, spot_time->tm_min);
 }
 
+/* fill key for the given spot, all other bytes 0.
+ */
+static void fillDXCKey (DXCKey &key, const DXSpot &spot)
+{
+    memset (&key, 0, sizeof(key));
+    quietStrncpy (key.call, spot.tx_call, sizeof(key.call));
+    key.band = findHamBand (spot.kHz);
+}
+
+/* return index of spot in dxc_spots with the given key, else -1
+ */
+static int findDXCIndex (const DXCKey &key)
+{
+    int *ip = (int *) findHashSet (dxc_index, &key);
+    return (ip ? *ip : -1);
+}
+
+/* remove dxc_spots[i], moving the last spot into its place.
+ */
+static void rmDXSpot (int i)
+{
+    DXCKey key;
+    fillDXCKey (key, dxc_spots[i]);
+    (void) rmHashSet (dxc_index, &key);
+
+    if (i != --n_dxspots) {
+        dxc_spots[i] = dxc_spots[n_dxspots];
+        fillDXCKey (key, dxc_spots[i]);
+        *(int *) findHashSet (dxc_index, &key) = i;
+    }
+
+    dxc_spots_changed = true;                           // update GUI with updated list
+    resetLLGrid (dxc_grid);
+}
+
+/* return whether the given dxc_expq entry still describes a spot in dxc_spots
+ */
+static bool isDXCExpireCurrent (const DXCExpire &e)
+{
+    int i = findDXCIndex (e.key);
+    return (i >= 0 && dxc_spots[i].spotted == e.spotted);
+}
+
+/* remove the oldest entry from dxc_expq, and its spot too if it has not changed since.
+ * return whether the spot was removed.
+ */
+static bool popDXCExpire (void)
+{
+    DXCExpire &e = dxc_expq[dxc_expq0];
+    dxc_expq0 = (dxc_expq0 + 1) % DXC_MAXEXPQ;
+    n_dxc_expq--;
+
+    if (!isDXCExpireCurrent (e))
+        return (false);                                 // since removed or updated
+    int i = findDXCIndex (e.key);
+    dxcLog ("%s %g: aged out\n", dxc_spots[i].tx_call, dxc_spots[i].kHz);
+    rmDXSpot (i);
+    return (true);
+}
+
+/* note dxc_spots[i] has just been added or updated.
+ */
+static void pushDXCExpire (int i)
+{
+    if (!dxc_expq) {
+        dxc_expq = (DXCExpire *) malloc (DXC_MAXEXPQ * sizeof(DXCExpire));
+        if (!dxc_expq)
+            fatalError ("No memory for %d DX spot times", DXC_MAXEXPQ);
+        dxc_expq0 = n_dxc_expq = 0;
+    }
+    if (n_dxc_expq == DXC_MAXEXPQ) {
+        // purge stale entries, in place and still in order. N.B. at most DXC_MAXSPOTS can be current
+        int n_keep = 0;
+        for (int j = 0; j < n_dxc_expq; j++) {
+            DXCExpire &e = dxc_expq[(dxc_expq0 + j) % DXC_MAXEXPQ];
+            if (isDXCExpireCurrent (e))
+                dxc_expq[(dxc_expq0 + n_keep++) % DXC_MAXEXPQ] = e;
+        }
+        n_dxc_expq = n_keep;
+    }
+
+    DXCExpire &e = dxc_expq[(dxc_expq0 + n_dxc_expq++) % DXC_MAXEXPQ];
+    fillDXCKey (e.key, dxc_spots[i]);
+    e.spotted = dxc_spots[i].spotted;
+    if (e.spotted > dxc_newest)
+        dxc_newest = e.spotted;
+}
+
+/* remove spots that are too old to keep, return whether any.
+ * N.B. dxc_expq is in order of arrival so this is exact unless spots arrive out of time order.
+ */
+static bool expireDXSpots (void)
+{
+    time_t ancient = myNow() - MAXKEEP_DT;
+    bool any = false;
+    while (n_dxc_expq > 0 && dxc_expq[dxc_expq0].spotted < ancient)
+        any |= popDXCExpire();
+    return (any);
+}
+
+/* add the given spot to dxc_spots, dropping the oldest if full.
+ */
+static void appendDXSpot (const DXSpot &new_spot)
+{
+    // make room
+    if (!dxc_spots) {
+        dxc_spots = (DXSpot *) malloc (DXC_MAXSPOTS * sizeof(DXSpot));
+        if (!dxc_spots)
+            fatalError ("No memory for %d DX spots", DXC_MAXSPOTS);
+        n_dxspots = 0;
+    }
+    while (n_dxspots == DXC_MAXSPOTS && n_dxc_expq > 0) {
+        if (popDXCExpire())
+            dxcLog ("oldest spot dropped to make room\n");
+    }
+
+    // add
+    DXCKey key;
+    fillDXCKey (key, new_spot);
+    if (dxc_index.key_len == 0)
+        initHashSet (dxc_index, sizeof(DXCKey), sizeof(int));
+    *(int *) putHashSet (dxc_index, &key) = n_dxspots;
+    dxc_spots[n_dxspots] = new_spot;
+    pushDXCExpire (n_dxspots++);
+    resetLLGrid (dxc_grid);
+}
+
 /* add a potentially new spot to dxc_spots[].
  * set dxc_spots_changed if dxc_spots changed in either content or count.
  * set DX too if asked and desired.
@@ -205,52 +358,43 @@ static void addDXClusterSpot (DXSpot &new_spot, bool set_dx)
     strtoupper (new_spot.rx_call);
     strtoupper (new_spot.tx_call);
 
-    // handy
-    HamBandSetting new_band = findHamBand(new_spot.kHz);
-
-    // check for dup, and remove any ancient spots along the way
-    bool same_spot = false;
-    for (int i = 0; i < n_dxspots; i++) {
-        DXSpot &spot = dxc_spots[i];
-        if (spot.spotted < ancient) {
-            dxcLog ("%s %g: aged out\n", spot.tx_call, spot.kHz);
-            memmove (&dxc_spots[i], &dxc_spots[i+1], (--n_dxspots - i) * sizeof(DXSpot));
-            i -= 1;                                     // examine new [i] again next loop
-            dxc_spots_changed = true;                   // update GUI with updated list
-        } else if (!strcmp (spot.tx_call, new_spot.tx_call) && findHamBand (spot.kHz) == new_band) {
-            // consider dupe if same tx call and band
-            int spt_hr = hour(spot.spotted);
-            int spt_mn = minute(spot.spotted);
-            int new_hr = hour(new_spot.spotted);
-            int new_mn = minute(new_spot.spotted);
-            same_spot = true;
-            if (new_spot.spotted > spot.spotted) {
-                dxcLog ("%s %g: updated %02d%02dZ > %02d%02dZ\n", new_spot.tx_call, new_spot.kHz,
-                                                                new_hr, new_mn, spt_hr, spt_mn);
-                spot = new_spot;                        // update info
-                dxc_spots_changed = true;               // update GUI with new age
-            } else if (new_spot.spotted == spot.spotted) {
-                dxcLog ("%s %g: dup time %02d%02dZ\n", spot.tx_call, spot.kHz, spt_hr, spt_mn);
-            } else {
-                dxcLog ("%s %g: superseded %02d%02dZ < %02d%02dZ\n", spot.tx_call, spot.kHz,
-                                                                new_hr, new_mn, spt_hr, spt_mn);
-            }
+    // remove any ancient spots
+    (void) expireDXSpots();
+
+    // check for dup, consider dupe if same tx call and band
+    DXCKey key;
+    fillDXCKey (key, new_spot);
+    int dup_i = findDXCIndex (key);
+    if (dup_i >= 0) {
+        DXSpot &spot = dxc_spots[dup_i];
+        int spt_hr = hour(spot.spotted);
+        int spt_mn = minute(spot.spotted);
+        int new_hr = hour(new_spot.spotted);
+        int new_mn = minute(new_spot.spotted);
+        if (new_spot.spotted > spot.spotted) {
+            dxcLog ("%s %g: updated %02d%02dZ > %02d%02dZ\n", new_spot.tx_call, new_spot.kHz,
+                                                            new_hr, new_mn, spt_hr, spt_mn);
+            spot = new_spot;                            // update info
+            pushDXCExpire (dup_i);                      // new age
+            dxc_spots_changed = true;                   // update GUI with new age
+            resetLLGrid (dxc_grid);
+        } else if (new_spot.spotted == spot.spotted) {
+            dxcLog ("%s %g: dup time %02d%02dZ\n", spot.tx_call, spot.kHz, spt_hr, spt_mn);
+        } else {
+            dxcLog ("%s %g: superseded %02d%02dZ < %02d%02dZ\n", spot.tx_call, spot.kHz,
+                                                            new_hr, new_mn, spt_hr, spt_mn);
         }
-    }
-    
-    // that's it if already in dxc_spots
-    if (same_spot)
+
+        // that's it if already in dxc_spots
         return;
+    }
 
     // tweak map location for unique picking
     ditherLL (new_spot.tx_ll);
     ditherLL (new_spot.rx_ll);
 
     // append to dxc_spots
-    dxc_spots = (DXSpot *) realloc (dxc_spots, (n_dxspots+1) * sizeof(DXSpot));
-    if (!dxc_spots)
-        fatalError ("No memory for %d DX spots", n_dxspots+1);
-    dxc_spots[n_dxspots++] = new_spot;
+    appendDXSpot (new_spot);
 
     // set new DX if desired
     if (set_dx) {
@@ -264,6 +408,7 @@ static void addDXClusterSpot (DXSpot &new_spot, bool set_dx)
 
     // update GUI with new spot
     dxc_spots_changed = true;
+    scheduleMapOverlays();
 
     // inform others who might care about a new spot
     tellDXPedsSpotChanged();
@@ -404,12 +549,21 @@ static void resetDXMem()
         dxc_spots = NULL;
         n_dxspots = 0;
     }
+    if (dxc_expq) {
+        free (dxc_expq);
+        dxc_expq = NULL;
+        n_dxc_expq = 0;
+    }
+    resetHashSet (dxc_index);
+    dxc_newest = 0;
+    resetLLGrid (dxc_grid);
 
     if (dxwl_spots) {
         free (dxwl_spots);
         dxwl_spots = NULL;
         dxc_ss.n_data = 0;
     }
+    resetLLGrid (dxwl_grid);
 }
 
 /* return whether the given host appears to be a multicast address
@@ -1009,9 +1163,10 @@ bool updateDXCluster (const SBox &box, bool fresh)
 
     if (dxc_ss.atNewest()) {
         // rebuild displayed spots list when master list changes or oldest spot ages out
-        if (dxc_spots_changed || (n_dxspots > 0 && dxc_spots[0].spotted < myNow() - MAXKEEP_DT)) {
+        if (expireDXSpots() || dxc_spots_changed) {
             rebuildDXWatchList();
             dxc_spots_changed = false;
+            scheduleMapOverlays();
             dxc_ss.drawNewSpotsSymbol (false, false);           // insure off
             scrolledaway_tm = 0;
         }
@@ -1226,10 +1381,11 @@ bool getClosestDXCluster (LatLong &ll, DXSpot *sp, LatLong *llp)
     // must use full list if not using DXC pane, else limit to just peds
     DXSpot *spots  = just_dxpeds ? dxc_spots : dxwl_spots;
     int n_spots    = just_dxpeds ? n_dxspots : dxc_ss.n_data;
+    LLGrid &grid   = just_dxpeds ? dxc_grid : dxwl_grid;
     SpotFilter sfp = just_dxpeds ? findDXPedsCall : NULL;
 
     // find closest spot, if any
-    bool found = getClosestSpot (spots, n_spots, sfp, LOME_BOTH, ll, sp, llp);
+    bool found = getClosestSpot (spots, n_spots, grid, sfp, LOME_BOTH, ll, sp, llp);
     if (!found)
         return (false);
 
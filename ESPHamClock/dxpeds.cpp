@@ -55,8 +55,9 @@ static bool watch_cluster;                      // whether to watch cluster for
 static ScrollState dxp_ss;                      // scrolling context, max_vis/2 if showing date
 static DXPCredit *credits;                      // malloced list of each credit
 static int n_credits;                           // n credits
-static ADIFWList *adif_worked;                  // malloced list of ADIF worked band+mode
-static int n_adif_worked;                       // n adif_worked[]
+static ADIFWList *adif_worked;                  // malloced list of unique ADIF worked band+mode
+static int n_adif_worked, n_adif_wmalloc;       // n adif_worked[] used, n malloced
+static HashSet adif_wset;                       // set of each ADIFWList in adif_worked[]
 
 
 // NV_DXPEDS bits
@@ -1014,17 +1015,31 @@ static int qsWorkedCmp (const void *v1, const void *v2)
     return (diff);
 }
 
-/* add the given spot to adif_worked.
+/* add the given spot to adif_worked unless already there.
  * N.B. call for each ADIF spot, regardless of watch list.
  */
 void addDXPedsWorked (const DXSpot &s)
 {
-    adif_worked = (ADIFWList *) realloc (adif_worked, (n_adif_worked+1) * sizeof(ADIFWList));
-    ADIFWList &w = adif_worked[n_adif_worked++];
+    // N.B. zero first so the whole struct can be a HashSet key
+    ADIFWList w;
+    memset (&w, 0, sizeof(w));
     w.dxcc = s.tx_dxcc;
     findCallPrefix (s.tx_call, w.prefix);
     w.worked.hb = findHamBand (s.kHz);
-    strcpy (w.worked.mode, s.mode);
+    quietStrncpy (w.worked.mode, s.mode, sizeof(w.worked.mode));
+
+    if (adif_wset.key_len == 0)
+        initHashSet (adif_wset, sizeof(ADIFWList));
+    if (!addHashSet (adif_wset, &w))
+        return;
+
+    if (n_adif_worked + 1 > n_adif_wmalloc) {
+        n_adif_wmalloc = n_adif_wmalloc ? 2*n_adif_wmalloc : 100;
+        adif_worked = (ADIFWList *) realloc (adif_worked, n_adif_wmalloc * sizeof(ADIFWList));
+        if (!adif_worked)
+            fatalError ("no memory for %d ADIF worked", n_adif_wmalloc);
+    }
+    adif_worked[n_adif_worked++] = w;
 }
 
 /* reset the list of ADIF worked
@@ -1035,7 +1050,9 @@ void resetDXPedsWorked (void)
         free ((void*)adif_worked);
         adif_worked = NULL;
         n_adif_worked = 0;
+        n_adif_wmalloc = 0;
     }
+    resetHashSet (adif_wset);
 }
 
 /* pass back malloced list of sorted unique bands and modes that have worked the given expedition,
@@ -1048,16 +1065,19 @@ int findDXPedsWorked (const DXPedEntry *dxp, DXPedsWorked *&worked)
 
     // init list
     worked = NULL;
-    int n_worked = 0;
+    int n_worked = 0, n_wmalloc = 0;
 
-    // scan list to build worked[]
+    // scan the unique list to build worked[]
     for (int i = 0; i < n_adif_worked; i++) {
         ADIFWList &wl = adif_worked[i];
         if (wl.dxcc == dxp->dxcc || strcasecmp (wl.prefix, dxp->prefix) == 0) {
             // add to worked[]
-            worked = (DXPedsWorked *) realloc (worked, (n_worked + 1) * sizeof(DXPedsWorked));
-            if (!worked)
-                fatalError ("no memory for %d DXPedsWorked", n_worked+1);
+            if (n_worked + 1 > n_wmalloc) {
+                n_wmalloc = n_wmalloc ? 2*n_wmalloc : 32;
+                worked = (DXPedsWorked *) realloc (worked, n_wmalloc * sizeof(DXPedsWorked));
+                if (!worked)
+                    fatalError ("no memory for %d DXPedsWorked", n_wmalloc);
+            }
             worked[n_worked++] = wl.worked;
         }
     }
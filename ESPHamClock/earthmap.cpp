@@ -27,6 +27,7 @@ AstroCir solar_cir;
 SCircle sun_c = {{0,0},SUN_R};                  // screen coords of sun symbol
 LatLong sun_ss_ll;                              // subsolar location
 float csslat, ssslat;                           // handy trig
+static float csslng, ssslng;                    // more handy trig
 
 // moon
 AstroCir lunar_cir;
@@ -38,7 +39,72 @@ uint8_t show_lp;                                // display long path, else short
 
 #define GRAYLINE_COS    (-0.208F)               // cos(90 + grayline angle), we use 12 degs
 #define GRAYLINE_POW    (0.75F)                 // cos power exponent, sqrt is too severe, 1 is too gradual
-static SCoord moremap_s;                        // drawMoreEarth() scanning location 
+static SCoord moremap_s;                        // drawMoreEarth() scanning location
+
+/* map rendering may be performed by a pool of worker threads which each draw rectangular tiles of map_b
+ * directly into the tft canvas. drawMoreEarth() then draws the whole map in one call, waiting until all
+ * tiles are finished so no projection state can change underneath the workers, then publishes the frame.
+ * map_nthreads < 0 means use one worker per cpu core; 0 or 1 retains the original incremental sweep of one
+ * map row per loop() which is kinder to single core systems.
+ */
+int map_nthreads = -1;                          // set with -j
+#define MAPTILE_W       66                      // tile width, app pixels, divides EARTH_W
+#define MAPTILE_H       33                      // tile height, app pixels, divides EARTH_H
+#define MAPTILE_NX      (EARTH_W/MAPTILE_W)     // tiles across
+#define MAPTILE_NY      (EARTH_H/MAPTILE_H)     // tiles down
+#define MAPTILE_N       (MAPTILE_NX*MAPTILE_NY) // tiles per frame
+#define MAPFRAME_MS     1000                    // min interval between fresh frames when threaded, millis
+static pthread_mutex_t maptile_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t maptile_go = PTHREAD_COND_INITIALIZER;    // tell workers a new frame is ready
+static pthread_cond_t maptile_done = PTHREAD_COND_INITIALIZER;  // tell drawMoreEarth() frame is finished
+static int maptile_next = MAPTILE_N;            // index of next tile to draw, MAPTILE_N when none
+static int maptile_busy;                        // n tiles currently being drawn
+static bool maptile_fresh;                      // set to draw a new frame asap
+
+/* the earth pixels swept over the map are also kept by the tft as a separate earth layer. since the earth
+ * only changes as the sun moves, it is swept again only once the sun has moved enough to change the night
+ * shading, or at least each MAPSWEEP_MS for the per-sweep chores. between sweeps each new frame, every
+ * MAPFRAME_MS or as soon as scheduleMapOverlays() asks, restores the earth within just the tiles the previous
+ * frame's overlays touched then draws the overlays again on top, with no projection or blending.
+ */
+#define MAPSWEEP_MS     10000                   // max interval between earth sweeps, millis
+static bool mapoverlays_pending;                // set to draw a new frame of overlays asap
+
+/* cache of the inverse projection of each map_b app pixel, filled in lazily by drawMapCoord() and discarded
+ * by initEarthMap() or whenever the tft earth images change. map_lut holds the MapLUTState of each app pixel
+ * and map_lut_texels holds its SCALESZ x SCALESZ tft earth image texels so steady-state map drawing needs
+ * no projection math at all.
+ */
+typedef enum {
+    MLS_UNKNOWN,                                // not yet computed
+    MLS_OFFMAP,                                 // not over the map
+    MLS_ONMAP,                                  // valid map location
+} MapLUTState;
+static uint8_t *map_lut;                        // EARTH_W x EARTH_H entries or NULL if no memory
+static uint32_t *map_lut_texels;                // SCALESZ*SCALESZ texels for each map_lut entry
+static int map_lut_gen = -1;                    // tft.getEarthPixGen() when map_lut was reset
+
+/* separable sun angle tables indexed by tft earth image row and column so the cosine of the angle from the
+ * subsolar point of each frame buffer texel is just sun_rows[row].a + sun_rows[row].b * sun_cols[col].c.
+ * the trig of each row and column is found by resetMapLUT(), the sun terms once per frame by updateSunTables().
+ * sun_wlut maps the twilight range of cosines from 0 down to GRAYLINE_COS to blend weights.
+ */
+typedef struct {
+    float slat, clat;                           // sin and cos of row latitude
+    float a, b;                                 // ssslat*slat, csslat*clat
+} SunRow;
+typedef struct {
+    float clng, slng;                           // cos and sin of column longitude
+    float c;                                    // cos(sslng-lng)
+} SunCol;
+static SunRow *sun_rows;                        // n_sun_rows, one per earth image row
+static SunCol *sun_cols;                        // n_sun_cols, one per earth image column
+static int n_sun_rows, n_sun_cols;
+#define SUNW_N          1024                    // sun_wlut steps
+static uint16_t sun_wlut[SUNW_N+1];             // blend weight at cos = GRAYLINE_COS*i/SUNW_N
+#define MAP_MAXTEXELS   ((FB_XRES/APP_WIDTH)*(FB_XRES/APP_WIDTH))       // largest SCALESZ*SCALESZ
+
+static void drawMapLUTRow (const SCoord &s0, int n);
 
 // cached grid colors
 uint16_t EARTH_GRIDC, EARTH_GRIDC00;            // main and highlighted
@@ -53,6 +119,23 @@ bool mapmenu_pending;
 #define THETA_GRID      15
 #define FINESTEP_GRID   (1.0F/pan_zoom.zoom)
 
+/* cache of the projected and clipped segments of the map grid lines, built by drawMapGrid() the first time
+ * after anything in GridSegsKey changes or initEarthMap() then just replayed at the end of each map sweep.
+ */
+typedef struct {
+    int16_t x0, y0, x1, y1;                     // raw end points, known to be ok to draw
+    bool axis;                                  // whether equator or prime meridian, drawn in EARTH_GRIDC00
+} GridSeg;
+typedef struct {
+    int proj, style, lw;                        // map_proj, mapgrid_choice and grid line width
+    int zoom, pan_x, pan_y;                     // pan_zoom
+    float de_lat, de_lng;                       // de_ll
+} GridSegsKey;
+static GridSeg *grid_segs;                      // malloced segments
+static int n_grid_segs, n_grid_segs_malloced;  // n used and malloced
+static GridSegsKey grid_segs_key;               // map state when built
+static bool grid_segs_ok;                       // whether grid_segs is built for grid_segs_key
+
 
 // establish EARTH_GRIDC and EARTH_GRIDC00
 static void getGridColorCache()
@@ -400,16 +483,29 @@ static void drawMapPopup(void)
     }
 }
 
-/* draw lat/long with given step sizes (used for ll and maidenhead).
+/* add the given raw segment, already known to be ok to draw, to grid_segs[]
  */
-static void drawLLGrid (int lat_step, int lng_step)
+static void addGridSeg (const SCoord &s0, const SCoord &s1, bool axis)
 {
-    SCoord s0, s1;                                              // end points
+    if (n_grid_segs + 1 > n_grid_segs_malloced) {
+        n_grid_segs_malloced = n_grid_segs_malloced ? 2*n_grid_segs_malloced : 1000;
+        grid_segs = (GridSeg *) realloc (grid_segs, n_grid_segs_malloced * sizeof(GridSeg));
+        if (!grid_segs)
+            fatalError ("No memory for %d map grid segments", n_grid_segs_malloced);
+    }
+    GridSeg &gs = grid_segs[n_grid_segs++];
+    gs.x0 = s0.x;
+    gs.y0 = s0.y;
+    gs.x1 = s1.x;
+    gs.y1 = s1.y;
+    gs.axis = axis;
+}
 
-    // thickness if any
-    int lw = getRawPathWidth (GRID_CSPR);
-    if (lw == 0)
-        return;
+/* add lat/long grid_segs with given step sizes (used for ll and maidenhead).
+ */
+static void buildLLGrid (int lat_step, int lng_step, int lw)
+{
+    SCoord s0, s1;                                              // end points
 
     // lines of latitude, exclude the poles
     for (float lat = -90+lat_step; lat < 90; lat += lat_step) {
@@ -419,7 +515,7 @@ static void drawLLGrid (int lat_step, int lng_step)
             for (float lg = lng-lng_step+FINESTEP_GRID; lg <= lng; lg += FINESTEP_GRID) {
                 ll2sRaw (deg2rad(lat), deg2rad(lg), s1, lw);
                 if (segmentSpanOkRaw (s0, s1, lw))
-                    tft.drawLineRaw (s0.x, s0.y, s1.x, s1.y, lw, lat == 0 ? EARTH_GRIDC00 : EARTH_GRIDC);
+                    addGridSeg (s0, s1, lat == 0);
                 s0 = s1;
             }
             s0 = s1;
@@ -434,7 +530,7 @@ static void drawLLGrid (int lat_step, int lng_step)
             for (float lt = lat-lat_step+FINESTEP_GRID; lt <= lat; lt += FINESTEP_GRID) {
                 ll2sRaw (deg2rad(lt), deg2rad(lng), s1, lw);
                 if (segmentSpanOkRaw (s0, s1, lw))
-                    tft.drawLineRaw (s0.x, s0.y, s1.x, s1.y, lw, lng == 0 ? EARTH_GRIDC00 : EARTH_GRIDC);
+                    addGridSeg (s0, s1, lng == 0);
                 s0 = s1;
             }
             s0 = s1;
@@ -442,9 +538,9 @@ static void drawLLGrid (int lat_step, int lng_step)
     }
 }
 
-/* draw azimuthal grid lines from DE
+/* add azimuthal grid_segs from DE
  */
-static void drawAzimGrid ()
+static void buildAzimGrid (int lw)
 {
     const float min_pole_lat = deg2rad(-89);
     const float max_pole_lat = deg2rad(89);
@@ -454,11 +550,6 @@ static void drawAzimGrid ()
 
     SCoord s0, s1;
 
-    // thickness if any
-    int lw = getRawPathWidth (GRID_CSPR);
-    if (lw == 0)
-        return;
-
     // radial lines
     for (int ti = 0; ti < 360/THETA_GRID; ti++) {
         float t = deg2rad (ti * THETA_GRID);
@@ -479,7 +570,7 @@ static void drawAzimGrid ()
                 float lng = de_ll.lng + B;
                 ll2sRaw (lat, lng, s1, lw);
                 if (segmentSpanOkRaw (s0, s1, lw))
-                    tft.drawLineRaw (s0.x, s0.y, s1.x, s1.y, lw, EARTH_GRIDC);
+                    addGridSeg (s0, s1, false);
                 s0 = s1;
             } else
                 s0.x = 0;
@@ -509,7 +600,7 @@ static void drawAzimGrid ()
                 float lng = de_ll.lng + B;
                 ll2sRaw (lat, lng, s1, lw);
                 if (segmentSpanOkRaw (s0, s1, lw))
-                    tft.drawLineRaw (s0.x, s0.y, s1.x, s1.y, lw, EARTH_GRIDC);
+                    addGridSeg (s0, s1, false);
                 s0 = s1;
             } else
                 s0.x = 0;
@@ -517,15 +608,10 @@ static void drawAzimGrid ()
     }
 }
 
-/* draw tropics grid lines from DE
+/* add tropics grid_segs, unless mercator which is so easy drawTropicsGrid() does it directly
  */
-static void drawTropicsGrid()
+static void buildTropicsGrid (int lw)
 {
-    // thickness if any
-    int lw = getRawPathWidth (GRID_CSPR);
-    if (lw == 0)
-        return;
-
     if (map_proj != MAPP_MERCATOR) {
 
         // just 2 lines at lat +- 23.5
@@ -536,14 +622,25 @@ static void drawTropicsGrid()
             ll2sRaw (deg2rad(-23.5), deg2rad(lng), s01, lw);
             ll2sRaw (deg2rad(23.5), deg2rad(lng), s11, lw);
             if (segmentSpanOkRaw (s00, s01, lw))
-                tft.drawLineRaw (s00.x, s00.y, s01.x, s01.y, lw, EARTH_GRIDC);
+                addGridSeg (s00, s01, false);
             s00 = s01;
             if (segmentSpanOkRaw (s10, s11, lw))
-                tft.drawLineRaw (s10.x, s10.y, s11.x, s11.y, lw, EARTH_GRIDC);
+                addGridSeg (s10, s11, false);
             s10 = s11;
         }
+    }
+}
 
-    } else {
+/* draw tropics grid lines on mercator
+ */
+static void drawTropicsGrid()
+{
+    // thickness if any
+    int lw = getRawPathWidth (GRID_CSPR);
+    if (lw == 0)
+        return;
+
+    if (map_proj == MAPP_MERCATOR) {
 
         // easy! just 2 straight lines
         uint16_t y = map_b.y + map_b.h/2 - 23.5F*map_b.h/180;
@@ -554,6 +651,46 @@ static void drawTropicsGrid()
     }
 }
 
+/* draw grid_segs, first rebuilding them if the map has changed since last time
+ */
+static void drawGridSegs()
+{
+    // thickness if any
+    int lw = getRawPathWidth (GRID_CSPR);
+    if (lw == 0)
+        return;
+
+    // rebuild if anything affecting the segments has changed
+    GridSegsKey key;
+    memset (&key, 0, sizeof(key));                              // N.B. compared with memcmp
+    key.proj = map_proj;
+    key.style = mapgrid_choice;
+    key.lw = lw;
+    key.zoom = pan_zoom.zoom;
+    key.pan_x = pan_zoom.pan_x;
+    key.pan_y = pan_zoom.pan_y;
+    key.de_lat = de_ll.lat;
+    key.de_lng = de_ll.lng;
+    if (!grid_segs_ok || memcmp (&key, &grid_segs_key, sizeof(key)) != 0) {
+        n_grid_segs = 0;
+        switch ((MapGridStyle)mapgrid_choice) {
+        case MAPGRID_MAID:    buildLLGrid (10, 20, lw);                     break;
+        case MAPGRID_LATLNG:  buildLLGrid (LL_LAT_GRID, LL_LNG_GRID, lw);   break;
+        case MAPGRID_TROPICS: buildTropicsGrid (lw);                        break;
+        case MAPGRID_AZIM:    buildAzimGrid (lw);                           break;
+        default:                                                            break;
+        }
+        grid_segs_key = key;
+        grid_segs_ok = true;
+    }
+
+    // draw
+    for (int i = 0; i < n_grid_segs; i++) {
+        const GridSeg &gs = grid_segs[i];
+        tft.drawLineRaw (gs.x0, gs.y0, gs.x1, gs.y1, lw, gs.axis ? EARTH_GRIDC00 : EARTH_GRIDC);
+    }
+}
+
 /* draw the complete proper map grid
  */
 static void drawMapGrid()
@@ -567,22 +704,23 @@ static void drawMapGrid()
     case MAPGRID_MAID:
 
         drawMaidGridKey();
-        drawLLGrid (10, 20);
+        drawGridSegs();
         break;
 
     case MAPGRID_LATLNG:
 
-        drawLLGrid (LL_LAT_GRID, LL_LNG_GRID);
+        drawGridSegs();
         break;
 
     case MAPGRID_TROPICS:
 
         drawTropicsGrid();
+        drawGridSegs();
         break;
 
     case MAPGRID_AZIM:
 
-        drawAzimGrid();
+        drawGridSegs();
         break;
 
     case MAPGRID_CQZONES:
@@ -658,6 +796,22 @@ static void drawAzmStars()
     }
 }
 
+/* update the sun terms of sun_rows and sun_cols for the current subsolar point.
+ * N.B. must not be called while the map threads are drawing
+ */
+static void updateSunTables()
+{
+    for (int i = 0; i < n_sun_rows; i++) {
+        SunRow &r = sun_rows[i];
+        r.a = ssslat*r.slat;
+        r.b = csslat*r.clat;
+    }
+    for (int i = 0; i < n_sun_cols; i++) {
+        SunCol &c = sun_cols[i];
+        c.c = csslng*c.clng + ssslng*c.slng;
+    }
+}
+
 static void updateCircumstances()
 {
     time_t utc = nowWO();
@@ -668,7 +822,10 @@ static void updateCircumstances()
     sun_ss_ll.normalize();
     csslat = cosf(sun_ss_ll.lat);
     ssslat = sinf(sun_ss_ll.lat);
+    csslng = cosf(sun_ss_ll.lng);
+    ssslng = sinf(sun_ss_ll.lng);
     ll2s (sun_ss_ll, sun_c.s, SUN_R+1);
+    updateSunTables();
 
     getLunarCir (utc, de_ll, lunar_cir);
     moon_ss_ll.lat_d = rad2deg(lunar_cir.dec);
@@ -911,6 +1068,77 @@ static void drawMapMenu()
 
 }
 
+/* rebuild the trig of sun_rows and sun_cols to match the current tft earth images, and sun_wlut once.
+ * N.B. must not be called while the map threads are drawing
+ */
+static void resetSunTables()
+{
+    // rows and columns of earth image pixels, see Adafruit_RA8875::getEarthTexels()
+    int w, h;
+    tft.getEarthSize (w, h);
+    if (w != n_sun_cols || h != n_sun_rows) {
+        free (sun_rows);
+        free (sun_cols);
+        sun_rows = (SunRow *) malloc (h * sizeof(SunRow));
+        sun_cols = (SunCol *) malloc (w * sizeof(SunCol));
+        if (!sun_rows || !sun_cols)
+            fatalError ("No memory for %d x %d sun tables", w, h);
+        n_sun_rows = h;
+        n_sun_cols = w;
+    }
+    for (int i = 0; i < n_sun_rows; i++) {
+        float lat = deg2rad (90.0F - i*180.0F/n_sun_rows);
+        sun_rows[i].slat = sinf(lat);
+        sun_rows[i].clat = cosf(lat);
+    }
+    for (int i = 0; i < n_sun_cols; i++) {
+        float lng = deg2rad (i*360.0F/n_sun_cols - 180.0F);
+        sun_cols[i].clng = cosf(lng);
+        sun_cols[i].slng = sinf(lng);
+    }
+
+    // twilight weights never change
+    if (sun_wlut[0] == 0) {
+        for (int i = 0; i <= SUNW_N; i++)
+            sun_wlut[i] = pixBlendWeight (1 - powf((float)i/SUNW_N, GRAYLINE_POW));
+    }
+
+    updateSunTables();
+}
+
+/* discard the inverse projection cache so it will be rebuilt as the map is next drawn.
+ * allocate on first call; just use the original direct method if no memory.
+ * N.B. must not be called while the map threads are drawing
+ */
+static void resetMapLUT()
+{
+    const int n_lut = EARTH_W*EARTH_H;
+    const int n_texels = n_lut*tft.SCALESZ*tft.SCALESZ;
+
+    resetSunTables();
+
+    if (!map_lut) {
+        map_lut = (uint8_t *) malloc (n_lut * sizeof(uint8_t));
+        map_lut_texels = (uint32_t *) malloc (n_texels * sizeof(uint32_t));
+        if (!map_lut || !map_lut_texels) {
+            Serial.printf ("MAP: no memory for projection cache\n");
+            free (map_lut);
+            free (map_lut_texels);
+            map_lut = NULL;
+            map_lut_texels = NULL;
+            return;
+        }
+        Serial.printf ("MAP: projection cache uses %d bytes\n",
+                                (int)(n_lut*sizeof(uint8_t) + n_texels*sizeof(uint32_t)));
+    }
+
+    memset (map_lut, MLS_UNKNOWN, n_lut);
+    map_lut_gen = tft.getEarthPixGen();
+
+    // nothing can be restored until swept again
+    maptile_fresh = true;
+}
+
 /* restart map for current projection and de_ll and dx_ll
  */
 void initEarthMap()
@@ -954,58 +1182,269 @@ void initEarthMap()
     updateZoneSCoords(ZONE_CQ);
     updateZoneSCoords(ZONE_ITU);
 
+    // projection may have changed
+    resetMapLUT();
+    grid_segs_ok = false;
+    resetSpotPaths();
+
     // init scan line in map_b
     moremap_s.x = 0;                    // avoid updateCircumstances() first call to drawMoreEarth()
     moremap_s.y = map_b.y;
+    maptile_fresh = true;
 
     // now main loop can resume with drawMoreEarth()
 }
 
-/* display another earth map row at mmoremap_s.
+/* draw all map pixels within the given tile index.
+ * N.B. called concurrently from the map worker threads so must only draw into the canvas.
  */
-void drawMoreEarth()
+static void drawMapTile (int tile)
 {
+    SCoord s;
+    s.x = map_b.x + (tile % MAPTILE_NX) * MAPTILE_W;
+    uint16_t y0 = map_b.y + (tile / MAPTILE_NX) * MAPTILE_H;
 
-    uint16_t last_x = map_b.x + EARTH_W - 1;
+    for (s.y = y0; s.y < y0 + MAPTILE_H; s.y++)
+        drawMapLUTRow (s, MAPTILE_W);
+}
 
-    // draw next row
-    for (moremap_s.x = map_b.x; moremap_s.x <= last_x; moremap_s.x++)
-        drawMapCoord (moremap_s);               // does not draw grid
+/* forever thread to draw map tiles whenever drawEarthTiles() posts a new frame
+ */
+static void *mapTileThread (void *unused)
+{
+    (void) unused;
+    pthread_detach(pthread_self());
+
+    pthread_mutex_lock (&maptile_lock);
+    for (;;) {
+
+        // wait for work
+        while (maptile_next >= MAPTILE_N)
+            pthread_cond_wait (&maptile_go, &maptile_lock);
+
+        // claim next tile and draw without holding the lock
+        int tile = maptile_next++;
+        maptile_busy++;
+        pthread_mutex_unlock (&maptile_lock);
+        drawMapTile (tile);
+        pthread_mutex_lock (&maptile_lock);
+
+        // report when all tiles are finished
+        if (--maptile_busy == 0 && maptile_next >= MAPTILE_N)
+            pthread_cond_signal (&maptile_done);
+    }
 
-    // advance row, wrap and reset and finish up at the end
-    if ((moremap_s.y += 1) >= map_b.y + EARTH_H) {
+    return (NULL);      // lint
+}
 
-        // draw goodies unless showing CM_USER
-        if (core_map != CM_USER) {
-            drawMapGrid();
-            drawSatPathAndFoot();
-            if (waiting4DXPath())
-                drawDXPath();
-            drawPSKPaths ();
-            drawAllSymbols();
-            drawSatName();
-            drawInfoBox();
+/* return number of map worker threads to use, starting them if not already.
+ * return 0 if the original incremental sweep should be used.
+ */
+static int startMapThreads()
+{
+    static int n_running = -1;
+
+    // out fast if already decided
+    if (n_running >= 0)
+        return (n_running);
+
+    // resolve default as number of cores
+    int n_want = map_nthreads;
+    if (n_want < 0)
+        n_want = sysconf (_SC_NPROCESSORS_ONLN);
+    n_running = 0;
+    if (n_want <= 1) {
+        Serial.printf ("MAP: using incremental sweep\n");
+        return (0);
+    }
+
+    for (int i = 0; i < n_want; i++) {
+        pthread_t tid;
+        int e = pthread_create (&tid, NULL, mapTileThread, NULL);
+        if (e) {
+            Serial.printf ("MAP: thread %d failed: %s\n", i, strerror(e));
+            break;
         }
+        n_running++;
+    }
+    Serial.printf ("MAP: using %d tile threads\n", n_running);
 
-        // draw now
-        tft.drawPR();
+    return (n_running);
+}
+
+/* draw the entire map using the worker threads, wait until all tiles are complete.
+ */
+static void drawEarthTiles()
+{
+    pthread_mutex_lock (&maptile_lock);
+
+        // post new frame
+        maptile_next = 0;
+        maptile_busy = 0;
+        pthread_cond_broadcast (&maptile_go);
+
+        // wait for all tiles to be finished
+        while (maptile_next < MAPTILE_N || maptile_busy > 0)
+            pthread_cond_wait (&maptile_done, &maptile_lock);
+
+    pthread_mutex_unlock (&maptile_lock);
+}
+
+/* draw the overlays over the map, noting where for restoreMapOverlays(), then show the frame.
+ */
+static void drawMapOverlays()
+{
+    // draw goodies unless showing CM_USER
+    tft.trackOverlays (true);
+    if (core_map != CM_USER) {
+        drawMapGrid();
+        drawSatPathAndFoot();
+        if (waiting4DXPath())
+            drawDXPath();
+        drawPSKPaths ();
+        drawAllSymbols();
+        drawSatName();
+        drawInfoBox();
+    }
+    tft.trackOverlays (false);
+
+    // draw now
+    tft.drawPR();
 
-        // check pending events
-        if (mapmenu_pending) {
-            drawMapMenu();
-            mapmenu_pending = false;
+    // check pending events
+    if (mapmenu_pending) {
+        drawMapMenu();
+        mapmenu_pending = false;
+    }
+    if (map_popup.pending) {
+        drawMapPopup();
+        map_popup.pending = false;
+    }
+
+    mapoverlays_pending = false;
+}
+
+/* restore the swept map pixels from the tft earth layer within each tile drawn by the previous
+ * drawMapOverlays(), erasing its overlays but nothing drawn elsewhere.
+ */
+static void restoreMapOverlays()
+{
+    if (!map_lut)
+        return;
+
+    uint8_t ovl_tiles[FB_TILE_N];
+    tft.getOverlayTiles (ovl_tiles);
+
+    for (int ly = 0; ly < EARTH_H; ly++) {
+        const uint8_t *lut_row = &map_lut[ly*EARTH_W];
+        const uint8_t *tile_row = &ovl_tiles[((map_b.y + ly)*tft.SCALESZ/FB_TILE_H)*FB_TILE_NX];
+        int run_0 = 0;                                  // first column of current run
+        int run_n = 0;                                  // n pixels in current run
+        for (int lx = 0; lx <= EARTH_W; lx++) {
+            if (lx < EARTH_W && lut_row[lx] == MLS_ONMAP && tile_row[(map_b.x + lx)*tft.SCALESZ/FB_TILE_W]) {
+                if (run_n == 0)
+                    run_0 = lx;
+                run_n++;
+            } else if (run_n > 0) {
+                tft.restoreEarth (map_b.x + run_0, map_b.y + ly, run_n);
+                run_n = 0;
+            }
         }
-        if (map_popup.pending) {
-            drawMapPopup();
-            map_popup.pending = false;
+    }
+}
+
+/* return whether the sun has moved so far since updateCircumstances() that the earth layer should be swept
+ * again. the cosine of the angle to the sun from any location changes by no more than the angle the sun moves,
+ * so wait for that to reach one sun_wlut step, the finest change in shading a sweep can show anyway.
+ */
+static bool sunHasMoved()
+{
+    if (!night_on)
+        return (false);
+
+    AstroCir cir;
+    getSolarCir (nowWO(), de_ll, cir);
+    LatLong ll;
+    ll.lat_d = rad2deg(cir.dec);
+    ll.lng_d = -rad2deg(cir.gha);
+    ll.normalize();
+
+    float dlat = ll.lat - sun_ss_ll.lat;
+    float dlng = fmodf (ll.lng - sun_ss_ll.lng + 3*M_PIF, 2*M_PIF) - M_PIF;
+    float dlng_gc = dlng * csslat;                      // along the great circle
+    const float step = -GRAYLINE_COS/SUNW_N;
+    return (dlat*dlat + dlng_gc*dlng_gc >= step*step);
+}
+
+/* ask drawMoreEarth() to redraw the map overlays at its next call, such as after new spots arrive.
+ */
+void scheduleMapOverlays()
+{
+    mapoverlays_pending = true;
+}
+
+/* display another portion of the earth map.
+ * if using map threads this is the entire map else just the row at moremap_s.
+ * between sweeps just redraw the overlays over the earth layer when due.
+ */
+void drawMoreEarth()
+{
+    // rebuild projection cache if earth images changed
+    if (map_lut_gen != tft.getEarthPixGen())
+        resetMapLUT();
+
+    // overlays only unless the earth needs sweeping again
+    static uint32_t sweep_ms, frame_ms;
+    bool sweeping = moremap_s.y != map_b.y;            // incremental sweep under way
+    if (map_lut && !maptile_fresh && !sweeping) {
+        if (!mapoverlays_pending && !timesUp (&frame_ms, MAPFRAME_MS))
+            return;
+        if (!timesUp (&sweep_ms, MAPSWEEP_MS) && !sunHasMoved()) {
+            restoreMapOverlays();
+            drawMapOverlays();
+            return;
         }
+        maptile_fresh = true;
+    }
+
+    if (startMapThreads() > 0) {
+
+        // draw complete frame at a leisurely pace unless just initialized
+        if (!maptile_fresh && !timesUp (&frame_ms, MAPFRAME_MS))
+            return;
+        maptile_fresh = false;
+        frame_ms = millis();
+
+        // show the sun where it is now
+        updateCircumstances();
+
+        drawEarthTiles();
+        moremap_s.y = map_b.y + EARTH_H;
+
+    } else {
+
+        // show the sun where it is as the sweep starts
+        if (!sweeping)
+            updateCircumstances();
+
+        // draw next row
+        moremap_s.x = map_b.x;
+        drawMapLUTRow (moremap_s, EARTH_W);     // does not draw grid
+
+        moremap_s.y += 1;
+    }
+
+    // wrap and reset and finish up at the end
+    if (moremap_s.y >= map_b.y + EARTH_H) {
+
+        drawMapOverlays();
 
         // rotate?
         checkBGMap();
 
-        // prep for next
-        updateCircumstances();
         moremap_s.y = map_b.y;
+        maptile_fresh = false;
+        sweep_ms = frame_ms = millis();
 
     // #define TIME_MAP_DRAW                             // RBF
     #if defined(TIME_MAP_DRAW)
@@ -1247,24 +1686,30 @@ float lngDiff (float dlng)
 }
 
 
-/* draw at the given screen location, if it's over the map.
+/* return fraction of sunlight given the cosine of the angle from the subsolar point
  */
-void drawMapCoord (uint16_t x, uint16_t y)
+static float fractDay (float cos_t)
 {
-
-    SCoord s;
-    s.x = x;
-    s.y = y;
-    drawMapCoord (s);
+    if (!night_on || cos_t > 0) {
+        // < 90 deg: sunlit
+        return (1);
+    } else if (cos_t > GRAYLINE_COS) {
+        // blend from day to night
+        return (1 - powf(cos_t/GRAYLINE_COS, GRAYLINE_POW));
+    } else {
+        // night side
+        return (0);
+    }
 }
-void drawMapCoord (const SCoord &s)
-{
-    // draw one map pixel at full screen resolution. requires lat/lng gradients.
 
+/* find lat/lng of s and its neighbors to the right and down as required by tft.plotEarth().
+ * return false if s is not over the map.
+ */
+static bool mapCoordLL (const SCoord &s, LatLong &lls, LatLong &llr, LatLong &lld)
+{
     // find lat/lng at this screen location, bale if not over map
-    LatLong lls;
     if (!s2ll(s,lls))
-        return; 
+        return (false);
 
     /* even though we only draw one application point, s, plotEarth needs points r and d to
      * interpolate to full map resolution.
@@ -1273,7 +1718,6 @@ void drawMapCoord (const SCoord &s)
      *   d
      */
     SCoord sr, sd;
-    LatLong llr, lld;
     sr.x = s.x + 1;
     sr.y = s.y;
     if (!s2ll(sr,llr))
@@ -1283,28 +1727,174 @@ void drawMapCoord (const SCoord &s)
     if (!s2ll(sd,lld))
         lld = lls;
 
+    return (true);
+}
+
+/* draw at s using the original direct method, ie, without map_lut.
+ */
+static void drawMapCoordDirect (const SCoord &s)
+{
+    // draw one map pixel at full screen resolution. requires lat/lng gradients.
+    LatLong lls, llr, lld;
+    if (!mapCoordLL (s, lls, llr, lld))
+        return;
+
     // find angle between subsolar point and any visible near this location
-    // TODO: actually different at each subpixel, this causes striping
+    // N.B. only one value for all subpixels so this stripes at SCALESZ > 1, sunWeights() does each texel
     float clat = cosf(lls.lat);
     float slat = sinf(lls.lat);
     float cos_t = ssslat*slat + csslat*clat*cosf(sun_ss_ll.lng-lls.lng);
 
-    // decide day, night or twilight
-    float fract_day;
-    if (!night_on || cos_t > 0) {
-        // < 90 deg: sunlit
-        fract_day = 1;
-    } else if (cos_t > GRAYLINE_COS) {
-        // blend from day to night
-        fract_day = 1 - powf(cos_t/GRAYLINE_COS, GRAYLINE_POW);
-    } else {
-        // night side
-        fract_day = 0;
-    }
-
     // draw the full res map point
     tft.plotEarth (s.x, s.y, lls.lat_d, lls.lng_d, llr.lat_d - lls.lat_d, llr.lng_d - lls.lng_d,
-                    lld.lat_d - lls.lat_d, lld.lng_d - lls.lng_d, fract_day);
+                    lld.lat_d - lls.lat_d, lld.lng_d - lls.lng_d, fractDay(cos_t));
+}
+
+/* fill in the map_lut state for s and its texels if not yet known.
+ * return whether s is over the map and ready to draw.
+ * N.B. called concurrently from the map threads so must only touch the given map_lut entry.
+ */
+static bool mapLUTReady (const SCoord &s, uint8_t &state, uint32_t *texels)
+{
+    if (state == MLS_UNKNOWN) {
+        LatLong lls, llr, lld;
+        if (!mapCoordLL (s, lls, llr, lld)) {
+            state = MLS_OFFMAP;
+        } else if (tft.getEarthTexels (lls.lat_d, lls.lng_d, llr.lat_d - lls.lat_d, llr.lng_d - lls.lng_d,
+                                lld.lat_d - lls.lat_d, lld.lng_d - lls.lng_d, texels)) {
+            state = MLS_ONMAP;
+        } else {
+            // no earth images yet, try again next time
+            return (false);
+        }
+    }
+
+    return (state == MLS_ONMAP);
+}
+
+/* find the blend weight of each of the n texels from the separable sun tables.
+ */
+static void sunWeights (const uint32_t *texels, uint16_t *weights, int n)
+{
+    if (!night_on) {
+        for (int i = 0; i < n; i++)
+            weights[i] = PIXBLEND_ONE;
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint32_t row = EARTH_TEXEL_R(texels[i]);
+        uint32_t col = EARTH_TEXEL_C(texels[i]);
+        if (row >= (uint32_t)n_sun_rows || col >= (uint32_t)n_sun_cols) {
+            // stale, will be redrawn after resetMapLUT()
+            weights[i] = PIXBLEND_ONE;
+            continue;
+        }
+        const SunRow &sr = sun_rows[row];
+        float cos_t = sr.a + sr.b * sun_cols[col].c;
+        if (cos_t > 0)
+            weights[i] = PIXBLEND_ONE;
+        else if (cos_t > GRAYLINE_COS)
+            weights[i] = sun_wlut[(int)(cos_t*(SUNW_N/GRAYLINE_COS) + 0.5F)];
+        else
+            weights[i] = 0;
+    }
+}
+
+/* draw at s using map_lut, filling in its entry first if not yet known.
+ * N.B. called concurrently from the map threads so must only touch the map_lut entries for s.
+ */
+static void drawMapLUTCoord (const SCoord &s)
+{
+    // use direct method if no cache or not within map_b
+    int lx = (int)s.x - (int)map_b.x;
+    int ly = (int)s.y - (int)map_b.y;
+    if (!map_lut || lx < 0 || lx >= EARTH_W || ly < 0 || ly >= EARTH_H) {
+        drawMapCoordDirect (s);
+        return;
+    }
+
+    const int lut_i = ly*EARTH_W + lx;
+    const int n_texels = tft.SCALESZ*tft.SCALESZ;
+    uint32_t *texels = &map_lut_texels[lut_i*n_texels];
+    if (mapLUTReady (s, map_lut[lut_i], texels)) {
+        uint16_t weights[MAP_MAXTEXELS];
+        sunWeights (texels, weights, n_texels);
+        tft.plotEarthTexels (s.x, s.y, 1, texels, weights);
+    }
+}
+
+/* draw the n map pixels in the row starting at s0 using map_lut, plotting each run over the map at once
+ * so the day/night blend works on whole rows.
+ * N.B. called concurrently from the map threads so must only touch the map_lut entries in this row.
+ */
+static void drawMapLUTRow (const SCoord &s0, int n)
+{
+    // one at a time if no cache or not within map_b
+    int lx = (int)s0.x - (int)map_b.x;
+    int ly = (int)s0.y - (int)map_b.y;
+    if (!map_lut || lx < 0 || lx + n > EARTH_W || ly < 0 || ly >= EARTH_H) {
+        SCoord s = s0;
+        for (int i = 0; i < n; i++, s.x++)
+            drawMapLUTCoord (s);
+        return;
+    }
+
+    const int lut_0 = ly*EARTH_W + lx;
+    const int n_texels = tft.SCALESZ*tft.SCALESZ;
+    uint16_t weights[EARTH_W*MAP_MAXTEXELS];
+    int run_0 = 0;                                      // first lut index of current run
+    int run_n = 0;                                      // n pixels in current run
+
+    SCoord s = s0;
+    for (int i = 0; i <= n; i++, s.x++) {
+        const int lut_i = lut_0 + i;
+        if (i < n && mapLUTReady (s, map_lut[lut_i], &map_lut_texels[lut_i*n_texels])) {
+            if (run_n == 0)
+                run_0 = lut_i;
+            run_n++;
+        } else if (run_n > 0) {
+            const uint32_t *texels = &map_lut_texels[run_0*n_texels];
+            sunWeights (texels, weights, run_n*n_texels);
+            tft.plotEarthTexels (s0.x + (run_0 - lut_0), s0.y, run_n, texels, weights);
+            run_n = 0;
+        }
+    }
+}
+
+/* restore the pixel at s from the tft earth layer if it has already been swept.
+ * return whether it was.
+ */
+static bool restoreMapLUTCoord (const SCoord &s)
+{
+    int lx = (int)s.x - (int)map_b.x;
+    int ly = (int)s.y - (int)map_b.y;
+    if (!map_lut || lx < 0 || lx >= EARTH_W || ly < 0 || ly >= EARTH_H || map_lut[ly*EARTH_W + lx] != MLS_ONMAP)
+        return (false);
+
+    tft.restoreEarth (s.x, s.y, 1);
+    return (true);
+}
+
+/* draw at the given screen location, if it's over the map.
+ */
+void drawMapCoord (uint16_t x, uint16_t y)
+{
+
+    SCoord s;
+    s.x = x;
+    s.y = y;
+    drawMapCoord (s);
+}
+void drawMapCoord (const SCoord &s)
+{
+    // insure cache matches current earth images
+    if (map_lut_gen != tft.getEarthPixGen())
+        resetMapLUT();
+
+    // copy back from the earth layer if already swept, else draw afresh
+    if (!restoreMapLUTCoord (s))
+        drawMapLUTCoord (s);
 }
 
 /* draw sun symbol.
@@ -0,0 +1,174 @@
+/* set of fixed-length keys for O(1) membership tests, optionally with a fixed-length value for each key.
+ *
+ * keys are compared byte for byte so callers should memset each key to 0 before filling it in.
+ * open addressing with linear probing, grown to stay at most half full.
+ */
+
+#include "HamClock.h"
+
+/* return FNV-1a hash of the given key
+ */
+static uint32_t hashKey (const uint8_t *key, int key_len)
+{
+    uint32_t h = 2166136261U;
+    for (int i = 0; i < key_len; i++) {
+        h ^= key[i];
+        h *= 16777619U;
+    }
+    return (h);
+}
+
+/* return home slot of key in hs
+ */
+static int homeSlot (const HashSet &hs, const uint8_t *key)
+{
+    return (hashKey (key, hs.key_len) & (hs.n_slots - 1));
+}
+
+/* return slot index of key in hs, or of the empty slot where it belongs.
+ * N.B. hs must have at least one empty slot
+ */
+static int findSlot (const HashSet &hs, const uint8_t *key)
+{
+    int mask = hs.n_slots - 1;
+    int i = homeSlot (hs, key);
+    while (hs.used[i] && memcmp (&hs.keys[i*hs.key_len], key, hs.key_len) != 0)
+        i = (i + 1) & mask;
+    return (i);
+}
+
+/* copy slot from to slot to in hs, both key and value
+ */
+static void copySlot (HashSet &hs, int to, int from)
+{
+    memcpy (&hs.keys[to*hs.key_len], &hs.keys[from*hs.key_len], hs.key_len);
+    if (hs.val_len)
+        memcpy (&hs.vals[to*hs.val_len], &hs.vals[from*hs.val_len], hs.val_len);
+    hs.used[to] = 1;
+}
+
+/* grow hs to n_slots, a power of 2, and rehash
+ */
+static void growHashSet (HashSet &hs, int n_slots)
+{
+    uint8_t *old_keys = hs.keys;
+    uint8_t *old_vals = hs.vals;
+    uint8_t *old_used = hs.used;
+    int old_n_slots = hs.n_slots;
+
+    hs.keys = (uint8_t *) malloc (n_slots * hs.key_len);
+    hs.vals = hs.val_len ? (uint8_t *) malloc (n_slots * hs.val_len) : NULL;
+    hs.used = (uint8_t *) calloc (n_slots, 1);
+    if (!hs.keys || (hs.val_len && !hs.vals) || !hs.used)
+        fatalError ("No memory for hash set of %d", n_slots);
+    hs.n_slots = n_slots;
+
+    for (int i = 0; i < old_n_slots; i++) {
+        if (old_used[i]) {
+            int j = findSlot (hs, &old_keys[i*hs.key_len]);
+            memcpy (&hs.keys[j*hs.key_len], &old_keys[i*hs.key_len], hs.key_len);
+            if (hs.val_len)
+                memcpy (&hs.vals[j*hs.val_len], &old_vals[i*hs.val_len], hs.val_len);
+            hs.used[j] = 1;
+        }
+    }
+
+    free (old_keys);
+    free (old_vals);
+    free (old_used);
+}
+
+/* init an empty set of keys each key_len bytes long, each with a value val_len bytes long if > 0
+ */
+void initHashSet (HashSet &hs, int key_len, int val_len)
+{
+    memset (&hs, 0, sizeof(hs));
+    hs.key_len = key_len;
+    hs.val_len = val_len;
+}
+
+/* remove all keys and free memory, key_len and val_len remain
+ */
+void resetHashSet (HashSet &hs)
+{
+    free (hs.keys);
+    free (hs.vals);
+    free (hs.used);
+    initHashSet (hs, hs.key_len, hs.val_len);
+}
+
+/* add key to hs, return whether it is new
+ */
+bool addHashSet (HashSet &hs, const void *key)
+{
+    if (2*(hs.n_used + 1) > hs.n_slots)
+        growHashSet (hs, hs.n_slots ? 2*hs.n_slots : 64);
+
+    int i = findSlot (hs, (const uint8_t *)key);
+    if (hs.used[i])
+        return (false);
+    memcpy (&hs.keys[i*hs.key_len], key, hs.key_len);
+    if (hs.val_len)
+        memset (&hs.vals[i*hs.val_len], 0, hs.val_len);
+    hs.used[i] = 1;
+    hs.n_used++;
+    return (true);
+}
+
+/* return whether key is in hs
+ */
+bool inHashSet (const HashSet &hs, const void *key)
+{
+    if (hs.n_used == 0)
+        return (false);
+    return (hs.used[findSlot (hs, (const uint8_t *)key)] != 0);
+}
+
+/* add key to hs if new, with its value all 0, and return pointer to its value.
+ * N.B. hs must have been init with val_len > 0
+ * N.B. pointer is only valid until hs is next changed
+ */
+void *putHashSet (HashSet &hs, const void *key)
+{
+    (void) addHashSet (hs, key);
+    return (&hs.vals[findSlot (hs, (const uint8_t *)key) * hs.val_len]);
+}
+
+/* return pointer to the value of key in hs, else NULL if key is not in hs.
+ * N.B. hs must have been init with val_len > 0
+ * N.B. pointer is only valid until hs is next changed
+ */
+void *findHashSet (const HashSet &hs, const void *key)
+{
+    if (hs.n_used == 0)
+        return (NULL);
+    int i = findSlot (hs, (const uint8_t *)key);
+    return (hs.used[i] ? &hs.vals[i*hs.val_len] : NULL);
+}
+
+/* remove key from hs, return whether it was there.
+ * closes the gap by moving back later keys of the same run that would otherwise no longer be found.
+ */
+bool rmHashSet (HashSet &hs, const void *key)
+{
+    if (hs.n_used == 0)
+        return (false);
+    int i = findSlot (hs, (const uint8_t *)key);
+    if (!hs.used[i])
+        return (false);
+
+    int mask = hs.n_slots - 1;
+    hs.used[i] = 0;
+    hs.n_used--;
+    for (int j = (i + 1) & mask; hs.used[j]; j = (j + 1) & mask) {
+        // move j into the hole at i unless its home slot lies cyclically in (i,j]
+        int home = homeSlot (hs, &hs.keys[j*hs.key_len]);
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            copySlot (hs, i, j);
+            hs.used[j] = 0;
+            i = j;
+        }
+    }
+    return (true);
+}
@@ -62,9 +62,12 @@ char live_html[] =  R"_raw_html_(
             sendWSMsg ("get_live.png?");
         }
 
-        // request an image update
+        // request an image update as a delta message, deflated if we can inflate
         function getUpdate() {
-            sendWSMsg ("get_live.bin?");
+            if (typeof DecompressionStream !== 'undefined')
+                sendWSMsg ("get_live.bin?codec=rlez");
+            else
+                sendWSMsg ("get_live.bin?codec=rle");
         }
         
 
@@ -200,6 +203,91 @@ char live_html[] =  R"_raw_html_(
 
         }
 
+        // return promise of the inflated version of the given deflated uint8
+        function inflate (z8) {
+            const ds = new DecompressionStream ('deflate');
+            return (new Response (new Blob([z8]).stream().pipeThrough(ds)).arrayBuffer()
+                    .then (function(ab) { return new Uint8Array(ab); }));
+        }
+
+        // update given delta message -- see liveweb.cpp::encodeLiveDelta()
+        function drawDelta (msg8) {
+
+            // body follows 'D' and flags
+            let body8 = msg8.subarray(2);
+            let body_p = (msg8[1] & 1) ? inflate (body8) : Promise.resolve (body8);
+
+            body_p.then(function(b8) {
+
+                // same header as drawUpdate
+                if (b8.length < 4)
+                    throw new Error ("short delta header");
+                const blok_w = b8[0];                       // block width, pixels
+                const blok_h = b8[1];                       // block height, pixels
+                const n_regn = (b8[2] << 8) | b8[3];        // n regions, MSB LSB
+                if (b8.length < 4 + 3*n_regn)
+                    throw new Error ("short delta regions");
+                let n_blok = 0;
+                for (let i = 0; i < n_regn; i++)
+                    n_blok += b8[6+3*i];
+
+                if (n_blok > 0) {
+
+                    // expand the run-length pixels into one image blok_h hi of all regions.
+                    // throw rather than read or write out of range if the runs don't exactly fill img.
+                    const img = ctx.createImageData (n_blok*blok_w, blok_h);
+                    const d = img.data;
+                    let p = 4 + 3*n_regn;
+                    let q = 0;
+                    while (q < d.length) {
+                        if (p >= b8.length)
+                            throw new Error ("short delta runs");
+                        const c = b8[p++];
+                        const n_pix = c < 128 ? c+1 : c-126;
+                        if (q + 4*n_pix > d.length || p + (c < 128 ? 3*n_pix : 3) > b8.length)
+                            throw new Error ("bad delta run at " + p);
+                        if (c < 128) {
+                            for (let n = n_pix; n > 0; --n) {
+                                d[q++] = b8[p++];
+                                d[q++] = b8[p++];
+                                d[q++] = b8[p++];
+                                d[q++] = 255;
+                            }
+                        } else {
+                            const r = b8[p++], g = b8[p++], b = b8[p++];
+                            for (let n = n_pix; n > 0; --n) {
+                                d[q++] = r;
+                                d[q++] = g;
+                                d[q++] = b;
+                                d[q++] = 255;
+                            }
+                        }
+                    }
+
+                    // render each region from its portion of img
+                    let regn_x = 0;
+                    for (let i = 0; i < n_regn; i++) {
+                        const cvs_x = b8[4+3*i] * blok_w;
+                        const cvs_y = b8[5+3*i] * blok_h;
+                        const cvs_w = b8[6+3*i] * blok_w;
+                        ctx.putImageData (img, cvs_x - regn_x, cvs_y, regn_x, 0, cvs_w, blok_h);
+                        regn_x += cvs_w;
+                    }
+                }
+
+                if (drawing_verbose)
+                    console.log ("  drawDelta " + msg8.byteLength + "B " +
+                                    n_regn + "/" + n_blok + " of " + blok_w + " x " + blok_h);
+
+                // next only after this one is drawn
+                runSoon (getUpdate);
+            })
+            .catch(function(err) {
+                console.log("delta err: ", err);
+                runSoon (getFullImage);
+            });
+        }
+
         // schedule func() soon
         var upd_tid = 0;                            // update pacing timer id
         function runSoon (func) {
@@ -393,7 +481,10 @@ char live_html[] =  R"_raw_html_(
                     // received whole or update image
 
                     var data8 = new Uint8Array (e.data);
-                    if (data8[0] == 137 && data8[1] == 80 && data8[2] == 78 && data8[3] == 71) {
+                    if (data8[0] == 68) {
+                        // this is a delta update, 'D'; it asks for the next update when done
+                        drawDelta (data8);
+                    } else if (data8[0] == 137 && data8[1] == 80 && data8[2] == 78 && data8[3] == 71) {
                         // this is a PNG image -- show whole if alone else assume its part of an update
                         if (ws_abdata) {
                             drawUpdate (new Uint8Array(ws_abdata), data8);
@@ -3,7 +3,7 @@
  * we listen to liveweb_rw_port and liveweb_ro_port for live.html or web socket upgrades.
  *
  * Browser displays entire HamClock frame buffer. Complete frame is sent initially then only the
- * pixels that change.
+ * pixels that change, either as png or as run-length encoded delta messages if the browser asks.
  *
  * N.B. this server-side code must work in concert with client-side code in liveweb-html.cpp.
  */
@@ -32,6 +32,7 @@ int liveweb_rw_port = LIVEWEB_RW_PORT;                  // r/w server port -- ca
 int liveweb_ro_port = LIVEWEB_RO_PORT;                  // r/o server port -- can be changed with -r
 int liveweb_max = 10;                                   // max allowed connections < ws.h::MAX_CLIENTS
 int liveweb_to;                                         // client inactivity timeout, minutes
+int liveweb_maxfps = 10;                                // max update rate for each client
 const int liveweb_maxmax = MAX_CLIENTS-1;               // max max for -help
 
 
@@ -49,14 +50,137 @@ static char *liveweb_openurl;                           // malloced url to attem
 static pthread_mutex_t lw_url_lock = PTHREAD_MUTEX_INITIALIZER; // thread-safe access for liveweb_openurl
 
 
+// location of connection counter drawn on main page of each live image
+#define CTR_RAWW (3*tft.SCALESZ)
+#define CTR_RAWH (5*tft.SCALESZ)
+#define CTR_RAWX (tft.SCALESZ*(lkscrn_b.x-4))
+#define CTR_RAWY (tft.SCALESZ*(lkscrn_b.y+lkscrn_b.h+3))
+
+
+// we only send small regions that have changed since previous. image is divided into fixed sized blocks
+// and those which have changed are coalesced into regions of height one block but variable length. these
+// are collected and sent as one image of height one block preceded by a header defining the location and
+// size of each region. the coordinates and length of a region are in units of blocks, not pixels, to
+// reduce each value's size to one byte each in the header. smaller regions are more efficient but the
+// coords must fit in 8 bit header value.
+#define BLOK_W      (BUILD_W>1600?16:8)                 // pixels wide
+#define BLOK_H      8                                   // pixels high
+#define BLOK_NCOLS  (BUILD_W/BLOK_W)                    // blocks in each row over entire image
+#define BLOK_NROWS  (BUILD_H/BLOK_H)                    // blocks in each col over entire image
+#define BLOK_NPIX   (BLOK_W*BLOK_H)                     // size of 1 block, pixels
+#define BLOK_NBYTES (BLOK_NPIX*LIVE_BYPPIX)             // size of 1 block, bytes
+#define BLOK_WBYTES (BLOK_W*LIVE_BYPPIX)                // width of 1 block, bytes
+#define MAX_REGNS   (BLOK_NCOLS*BLOK_NROWS)             // worse case number of regions
+#if BLOK_NCOLS > 255                                    // insure fits into uint8_t
+    #error too many block columns
+#endif
+#if BLOK_NROWS > 255                                    // insure fits into uint8_t
+    #error too many block rows
+#endif
+#if MAX_REGNS > 65535                                   // insure fits into uint16_t
+    #error too many live regions
+#endif
+#if (FB_TILE_W % BLOK_W) || (FB_TILE_H % BLOK_H)        // insure each block is within one tile
+    #error tft tiles must be a multiple of live blocks
+#endif
+
+
+// all clients of a port see the same image so they share the work of capturing and encoding it.
+// each new capture is a frame with a new version number. the few most recent frames are kept so the
+// update from each to the newest need only be computed and encoded once regardless of how many clients
+// are at that version. a new frame is captured no more often than LIVE_FRAME_MS so clients polling at
+// about the same time all share it.
+#define LIVE_NFRAMES    3                               // n recent frames kept for diffing
+#define LIVE_NUPDATES   (2*LIVE_NFRAMES)                // n encoded updates kept
+#define LIVE_FRAME_MS   50                              // min interval between new frames
+
+typedef struct {
+    uint32_t version;                                   // frame version, 0 if unused
+    uint32_t stage_seq;                                 // tft stage version captured in pixels
+    uint8_t *pixels;                                    // malloced complete image, or NULL
+} LiveFrame;
+
+// update encodings negotiated by liveweb-html in the get_live.bin codec arg
+typedef enum {
+    LIVE_PNG,                                           // region header message then png of all regions
+    LIVE_RLE,                                           // one delta message with run-length pixels
+    LIVE_RLEZ,                                          // same but deflated when that is smaller
+} LiveCodec;
+
+// first byte of a delta message, distinct from png and from BLOK_W that starts a region header
+#define LIVE_DELTA      'D'
+#define LIVE_DELTA_Z    0x1                             // delta flags: body is deflated
+
+#define LIVE_NMSGS      2                               // max websocket messages in one update
+
+typedef struct {
+    uint32_t from, to;                                  // frame versions, to is 0 if unused
+    LiveCodec codec;                                    // encoding of msgs
+    uint8_t *msgs[LIVE_NMSGS];                          // malloced messages to send in order, else NULL
+    int msgs_l[LIVE_NMSGS];                             // length of each
+} LiveUpdate;
+
+// blocks changed from one frame to another, copied out of the view so they can be encoded unlocked
+typedef struct {
+    uint32_t from, to;                                  // frame versions
+    uint8_t *hdr;                                       // malloced region header
+    int hdr_l;                                          // header length
+    uint8_t *regns;                                     // malloced one row of all changed regions
+    int n_regns, n_bloks;                               // n regions and blocks in regns
+    bool by_tiles;                                      // whether from frame was gone so sent whole tiles
+} LiveDiff;
+
+// location and length of one changed region in units of blocks
+typedef struct {
+    uint8_t x, y, l;
+} RegnLoc;
+
+typedef struct {
+    LiveFrame frames[LIVE_NFRAMES];                     // recent frames, see newest
+    int newest;                                         // index of newest frame
+    uint32_t last_version;                              // most recent version number assigned
+    int counter;                                        // connection count drawn in newest, -1 if none
+    struct timeval capture_tv;                          // when newest was captured
+    LiveUpdate updates[LIVE_NUPDATES];                  // recently encoded updates
+    int next_update;                                    // next updates[] slot to recycle
+    uint8_t *png;                                       // malloced full png image of newest, else NULL
+    int png_l;                                          // png length
+    uint32_t png_version;                               // frame version of png
+} LiveView;
+
+static LiveView live_views[2];                          // [0] for r/w port clients, [1] for r/o
+
+
+// each client is paced to get at most liveweb_maxfps updates per second and, if sending to it is slow,
+// to spend no more than 1/LIVE_DUTY of its time sending. frames that change meanwhile are coalesced.
+// waiting is done with ws_defer() so a paced client never holds up a wsServer worker.
+#define LIVE_DUTY       2                               // min update interval as multiple of send time
+#define LIVE_MAXWAIT_MS 2000                            // longest we ever delay an update
+#define LIVE_BUSY_MS    20                              // recheck interval while previous update still queued
+#define LIVE_EMA_N      8                               // smoothing of client averages
+
 // complete scene on browser for each web socket
 typedef struct {
     ws_cli_conn_t *client;                              // pointer unique to each connection, else NULL
-    uint8_t *pixels;                                    // this client's current display image
+    uint32_t version;                                   // LiveView frame version last sent, 0 if none
+    uint32_t stage_seq;                                 // tft stage version of that frame
+    LiveCodec codec;                                    // update codec last requested
+    time_t open_t;                                      // when connected
+    struct timeval req_tv;                              // when last requested an update, 0 if never
+    struct timeval upd_tv;                              // when last update started
+    struct timeval send_tv;                             // when last update was queued, 0 once all sent
+    struct timeval sent_tv;                             // when last finished sending an update, 0 if never
+    float sent_ms;                                      // average time between updates finished sending
+    float resp_ms;                                      // average time from sending to next request
+    float send_ms;                                      // average time to send one update
+    float upd_bytes;                                    // average bytes per update
+    unsigned long n_updates;                            // total updates sent
+    unsigned long n_dropped;                            // total frames skipped
+    unsigned long n_bytes;                              // total bytes sent
 } SessionInfo;
 static SessionInfo *si_list;                            // malloced list
 static int si_n;                                        // n malloced
-static pthread_mutex_t si_lock = PTHREAD_MUTEX_INITIALIZER;     // atomic updates
+static pthread_mutex_t si_lock = PTHREAD_MUTEX_INITIALIZER;     // atomic si_list and live_views, not encoding
 
 #if defined(__GNUC__)
 static void bye (const char *fmt, ...) __attribute__ ((format (__printf__, 1, 2)));
@@ -119,148 +243,290 @@ static unsigned char * myZDeflate(unsigned char *data, int data_len, int *out_le
     return (out_mem);
 }
 
-/* stbi_write_png_to_func helper to write the given array to the given ws_cli_conn_t in context.
+/* send the given binary message to the given client.
+ * the browser only asks for more after each reply so if the message is dropped because the client is too far
+ * behind it would wait forever; close it instead so it reloads.
  */
-static void wifiSTBWrite_helper (void *context, void *data, int size)
+static void sendClientBin (ws_cli_conn_t *client, const uint8_t *data, int size)
 {
-    ws_cli_conn_t *client = (ws_cli_conn_t *)context;
     int n_sent = ws_sendframe_bin (client, (const char *) data, size);
-    if (n_sent != size)
-        Serial.printf ("LIVE: client %s: wrong png write len: %d != %d\n", ws_getaddress(client), n_sent, size);
-    if (debugLevel (DEBUG_WEB, 2)) {
-        Serial.printf ("LIVE: sent image %d bytes\n", size);
-        if (debugLevel (DEBUG_WEB, 3)) {
-            FILE *fp = fopen ("/tmp/live.png", "w");
-            fwrite (data, size, 1, fp);
-            fclose(fp);
-        }
-    }
+    if (n_sent == 0 && size > 0) {
+        if (ws_get_state (client) != WS_STATE_OPEN)
+            return;                                     // already closing
+        Serial.printf ("LIVE: client %s: too far behind, closing\n", ws_getaddress(client));
+        ws_close_client (client);
+    } else if (n_sent != size)
+        Serial.printf ("LIVE: client %s: wrong write len: %d != %d\n", ws_getaddress(client), n_sent, size);
 }
 
-/* return the pixels pointer for the existing client, else NULL.
- * pixels pointer is safe to use outside si_lock and even if si_list is later realloced (and hence moves).
+/* return the png encoding of the given RGB image, exit if trouble.
+ * N.B. caller must free returned memory.
  */
-static uint8_t *getSIPixels (ws_cli_conn_t *client)
+static uint8_t *encodeLivePNG (const uint8_t *pixels, int w, int h, int stride, int *png_l)
 {
-    // protect list while manipulating -- N.B. unlock before returning!
-    pthread_mutex_lock (&si_lock);
-
-    // scan si_list for client
-    SessionInfo *found_sip = NULL;
-    for (int i = 0; i < si_n; i++) {
-        if (si_list[i].client == client) {
-            found_sip = &si_list[i];
-            break;
+    uint8_t *png = stbi_write_png_to_mem (pixels, stride, w, h, COMP_RGB, png_l);
+    if (!png)
+        bye ("No memory for png %dx%d\n", w, h);
+
+    if (debugLevel (DEBUG_WEB, 3)) {
+        FILE *fp = fopen ("/tmp/live.png", "w");
+        if (fp) {
+            fwrite (png, *png_l, 1, fp);
+            fclose(fp);
         }
     }
 
-    // capture pixels address before unlocking
-    uint8_t *pixels = NULL;
-    if (found_sip)
-        pixels = found_sip->pixels;
-    else
-        Serial.printf ("LIVE: client %s: missing pixels\n", ws_getaddress(client));
+    return (png);
+}
 
-    // unlock
-    pthread_mutex_unlock (&si_lock);
+/* return the SessionInfo for the given client, else NULL.
+ * N.B. we assume si_lock is held and result is only valid while it remains so.
+ */
+static SessionInfo *findSI (ws_cli_conn_t *client)
+{
+    for (int i = 0; i < si_n; i++)
+        if (si_list[i].client == client)
+            return (&si_list[i]);
 
-    // return result
-    return (pixels);
+    Serial.printf ("LIVE: client %s: missing session\n", ws_getaddress(client));
+    return (NULL);
 }
 
-/* send difference between client's last known screen image and the current image,
- * then store current image back in client's SessionInfo.
+/* set tiles[] for the rows of tiles containing the connection counter because it is drawn in the
+ * live image, not on the display, and may come or go.
  */
-static void updateExistingClient (ws_cli_conn_t *client)
+static void markCounterTiles (uint8_t tiles[])
 {
-    // curious how long these steps take
-    struct timeval tv0;
-    gettimeofday (&tv0, NULL);
+    for (int ty = CTR_RAWY/FB_TILE_H; ty <= (CTR_RAWY+CTR_RAWH-1)/FB_TILE_H && ty < FB_TILE_NY; ty++)
+        memset (&tiles[ty*FB_TILE_NX], 1, FB_TILE_NX);
+}
 
-    // find client's current pixels
-    uint8_t *pixels = getSIPixels(client);
-    if (!pixels)
-        return;
+/* draw connection counter for r/o or r/w clients into the given live image.
+ */
+static void drawLiveCounter (uint8_t *img, int counter, bool ro)
+{
+    SBox digit_b = {(uint16_t)CTR_RAWX, (uint16_t)CTR_RAWY, (uint16_t)CTR_RAWW, (uint16_t)CTR_RAWH};
+    if (ro) {
+        static const uint8_t txt_clr[LIVE_BYPPIX] = {255U,50U,50U};
+        if (counter < 10)
+            digit_b.x += CTR_RAWW;
+        drawImgNumber (counter, img, digit_b, txt_clr);
+        digit_b.x += 2*digit_b.w/3;
+        drawImgR (img, digit_b, txt_clr);
+        digit_b.x += 3*digit_b.w/2;
+        drawImgO (img, digit_b, txt_clr);
+    } else {
+        static const uint8_t txt_clr[LIVE_BYPPIX] = {255U,255U,255U};
+        if (counter < 10)
+            digit_b.x += CTR_RAWW;
+        drawImgNumber (counter, img, digit_b, txt_clr);
+        digit_b.x += 2*digit_b.w/3;
+        drawImgR (img, digit_b, txt_clr);
+        digit_b.x += 3*digit_b.w/2;
+        drawImgW (img, digit_b, txt_clr);
+    }
+}
 
-    // make a copy of client's last known image
-    uint8_t *img_client = (uint8_t *) malloc (LIVE_NBYTES);
-    if (!img_client)
-        bye ("No memory for LIVE update\n");
-    memcpy (img_client, pixels, LIVE_NBYTES);
+/* discard all frames and encodings of the given view, such as when its last client closes.
+ * N.B. we assume si_lock is held.
+ */
+static void resetLiveView (LiveView &lv)
+{
+    for (int i = 0; i < LIVE_NFRAMES; i++) {
+        free (lv.frames[i].pixels);
+        lv.frames[i].pixels = NULL;
+        lv.frames[i].version = 0;
+    }
+    for (int i = 0; i < LIVE_NUPDATES; i++) {
+        LiveUpdate &up = lv.updates[i];
+        for (int j = 0; j < LIVE_NMSGS; j++) {
+            free (up.msgs[j]);
+            up.msgs[j] = NULL;
+        }
+        up.to = 0;
+    }
+    free (lv.png);
+    lv.png = NULL;
+    lv.png_version = 0;
+    // N.B. keep last_version so no client can mistake a new frame for one it has
+}
 
-    // replace clients's pixels with current screen contents
-    if (!tft.getRawPix (pixels, LIVE_NPIX))
-        bye ("getRawPix for update failed\n");
-    uint8_t *img_now = pixels;                      // better name
+/* return the newest frame of the given view, first capturing a new one if the display or connection
+ * counter changed and the newest is at least LIVE_FRAME_MS old.
+ * N.B. we assume si_lock is held.
+ */
+static LiveFrame &captureLiveFrame (LiveView &lv, bool ro)
+{
+    LiveFrame &newest = lv.frames[lv.newest];
+    int counter = mainpage_up ? (ro ? n_roweb : n_rwweb) : -1;
+
+    // find which tiles changed since newest, all if none yet.
+    // N.B. stage may change again before getRawPix so seq might be older than the capture, never newer.
+    uint8_t tiles[FB_TILE_N];
+    uint32_t seq = newest.version ? newest.stage_seq : 0;
+    tft.getStageChanges (seq, tiles);
+
+    // reuse newest if still good or too young to replace
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    if (newest.version && ((seq == newest.stage_seq && counter == lv.counter)
+                                || TVDELUS (lv.capture_tv, now) < LIVE_FRAME_MS*1000))
+        return (newest);
+
+    // recycle oldest frame, starting with a copy of newest if any
+    int fi = (lv.newest + 1) % LIVE_NFRAMES;
+    LiveFrame &frame = lv.frames[fi];
+    if (!frame.pixels) {
+        frame.pixels = (uint8_t *) malloc (LIVE_NBYTES);
+        if (!frame.pixels)
+            bye ("No memory for live frame\n");
+    }
+    if (newest.version)
+        memcpy (frame.pixels, newest.pixels, LIVE_NBYTES);
+
+    // update changed tiles including counter
+    markCounterTiles (tiles);
+    if (!tft.getRawPix (frame.pixels, LIVE_NPIX, tiles))
+        bye ("getRawPix for live frame failed\n");
+    if (counter >= 0)
+        drawLiveCounter (frame.pixels, counter, ro);
+
+    // frame is now the newest
+    frame.version = ++lv.last_version;
+    frame.stage_seq = seq;
+    lv.newest = fi;
+    lv.counter = counter;
+    lv.capture_tv = now;
 
     if (debugLevel (DEBUG_WEB, 2)) {
         struct timeval tv1;
         gettimeofday (&tv1, NULL);
-        Serial.printf ("LIVE: client %s: copying img and reading new pixels took %ld usec\n",
-                                ws_getaddress(client), TVDELUS (tv0,tv1));
+        Serial.printf ("LIVE: captured %s frame %u in %ld usec\n", ro ? "R/O" : "R/W", frame.version,
+                                TVDELUS (now, tv1));
     }
 
-    // draw connection counter on main page
-    if (mainpage_up) {
-        #define CTR_RAWW (3*tft.SCALESZ)
-        #define CTR_RAWH (5*tft.SCALESZ)
-        #define CTR_RAWX (tft.SCALESZ*(lkscrn_b.x-4))
-        #define CTR_RAWY (tft.SCALESZ*(lkscrn_b.y+lkscrn_b.h+3))
-        SBox digit_b = {(uint16_t)CTR_RAWX, (uint16_t)CTR_RAWY, (uint16_t)CTR_RAWW, (uint16_t)CTR_RAWH};
-        if (client->port == liveweb_ro_port) {
-            static const uint8_t txt_clr[LIVE_BYPPIX] = {255U,50U,50U};
-            // n_roweb = 1234567890;       // RBF
-            if (n_roweb < 10)
-                digit_b.x += CTR_RAWW;
-            drawImgNumber (n_roweb, img_now, digit_b, txt_clr);
-            digit_b.x += 2*digit_b.w/3;
-            drawImgR (img_now, digit_b, txt_clr);
-            digit_b.x += 3*digit_b.w/2;
-            drawImgO (img_now, digit_b, txt_clr);
+    return (frame);
+}
+
+/* run-length encode the given RGB pixels into out[] which must be at least 3*npix + npix/128 + 1 bytes.
+ * each control byte c < 128 is followed by c+1 literal pixels, else by one pixel repeated c-126 times.
+ * return number of bytes in out.
+ */
+static int rleLivePixels (const uint8_t *pix, int npix, uint8_t *out)
+{
+    #define SAME_PIX(i,j) (pix[3*(i)] == pix[3*(j)] && pix[3*(i)+1] == pix[3*(j)+1] \
+                                && pix[3*(i)+2] == pix[3*(j)+2])
+
+    uint8_t *out0 = out;
+    int i = 0;
+    while (i < npix) {
+
+        // count identical pixels starting at i
+        int n = 1;
+        while (i+n < npix && n < 129 && SAME_PIX(i,i+n))
+            n++;
+
+        if (n > 1) {
+            // repeat
+            *out++ = 126 + n;
+            memcpy (out, &pix[3*i], 3);
+            out += 3;
         } else {
-            static const uint8_t txt_clr[LIVE_BYPPIX] = {255U,255U,255U};
-            // n_rwweb = 1234567890;       // RBF
-            if (n_rwweb < 10)
-                digit_b.x += CTR_RAWW;
-            drawImgNumber (n_rwweb, img_now, digit_b, txt_clr);
-            digit_b.x += 2*digit_b.w/3;
-            drawImgR (img_now, digit_b, txt_clr);
-            digit_b.x += 3*digit_b.w/2;
-            drawImgW (img_now, digit_b, txt_clr);
+            // literals until the next repeat begins
+            while (i+n < npix && n < 128 && !(i+n+1 < npix && SAME_PIX(i+n,i+n+1)))
+                n++;
+            *out++ = n - 1;
+            memcpy (out, &pix[3*i], 3*n);
+            out += 3*n;
         }
+        i += n;
     }
 
-    // we only send small regions that have changed since previous, ie changes from img_client to img_now.
-    // image is divided into fixed sized blocks and those which have changed are coalesced into regions
-    // of height one block but variable length. these are collected and sent as one image of height one
-    // block preceded by a header defining the location and size of each region. the coordinates and
-    // length of a region are in units of blocks, not pixels, to reduce each value's size to one byte
-    // each in the header. smaller regions are more efficient but the coords must fit in 8 bit header value.
-    #define BLOK_W      (BUILD_W>1600?16:8)             // pixels wide
-    #define BLOK_H      8                               // pixels high
-    #define BLOK_NCOLS  (BUILD_W/BLOK_W)                // blocks in each row over entire image
-    #define BLOK_NROWS  (BUILD_H/BLOK_H)                // blocks in each col over entire image
-    #define BLOK_NPIX   (BLOK_W*BLOK_H)                 // size of 1 block, pixels
-    #define BLOK_NBYTES (BLOK_NPIX*LIVE_BYPPIX)         // size of 1 block, bytes
-    #define BLOK_WBYTES (BLOK_W*LIVE_BYPPIX)            // width of 1 block, bytes
-    #define MAX_REGNS   (BLOK_NCOLS*BLOK_NROWS)         // worse case number of regions
-    #if BLOK_NCOLS > 255                                // insure fits into uint8_t
-        #error too many block columns
-    #endif
-    #if BLOK_NROWS > 255                                // insure fits into uint8_t
-        #error too many block rows
-    #endif
-    #if MAX_REGNS > 65535                               // insure fits into uint16_t
-        #error too many live regions
-    #endif
-
-    // time block creation
-    gettimeofday (&tv0, NULL);
+    #undef SAME_PIX
+
+    return (out - out0);
+}
+
+/* return a malloced delta message containing the given region header and the run-length encoding of
+ * the given regions image, deflated if z and that is smaller:
+ *   LIVE_DELTA, flags, then body of region header exactly as for LIVE_PNG followed by rleLivePixels()
+ */
+static uint8_t *encodeLiveDelta (const uint8_t *hdr, int hdr_l, const uint8_t *regns, int n_pix, bool z,
+    int *msg_l)
+{
+    // body is header then pixels
+    int body_max = hdr_l + 3*n_pix + n_pix/128 + 1;
+    StackMalloc body_mem(body_max);
+    uint8_t *body = (uint8_t *) body_mem.getMem();
+    memcpy (body, hdr, hdr_l);
+    int body_l = hdr_l + rleLivePixels (regns, n_pix, body + hdr_l);
+
+    // deflate if helps
+    uint8_t *zbody = NULL;
+    int zbody_l = 0;
+    if (z) {
+        zbody = myZDeflate (body, body_l, &zbody_l, Z_BEST_SPEED);
+        if (zbody_l >= body_l) {
+            free (zbody);
+            zbody = NULL;
+        }
+    }
+
+    // build message
+    int l = zbody ? zbody_l : body_l;
+    uint8_t *msg = (uint8_t *) malloc (2 + l);
+    if (!msg)
+        bye ("No memory for live delta %d\n", l);
+    msg[0] = LIVE_DELTA;
+    msg[1] = zbody ? LIVE_DELTA_Z : 0;
+    memcpy (msg + 2, zbody ? zbody : body, l);
+    free (zbody);
+
+    *msg_l = 2 + l;
+    return (msg);
+}
+
+/* return the cached update from frame version from to version to using codec, else NULL.
+ * N.B. we assume si_lock is held and the result is only valid while it remains so.
+ */
+static LiveUpdate *findLiveUpdate (LiveView &lv, uint32_t from, uint32_t to, LiveCodec codec)
+{
+    for (int i = 0; i < LIVE_NUPDATES; i++) {
+        LiveUpdate &up = lv.updates[i];
+        if (up.to == to && up.from == from && up.codec == codec)
+            return (&up);
+    }
+    return (NULL);
+}
+
+/* collect the blocks that change a client's image from frame version from, captured at tft stage version
+ * from_seq, to the newest frame of the given view into a private diff that may be encoded without si_lock.
+ * N.B. we assume si_lock is held. caller must free diff.hdr and diff.regns.
+ */
+static void diffLiveFrames (LiveView &lv, uint32_t from, uint32_t from_seq, LiveDiff &diff)
+{
+    LiveFrame &newest = lv.frames[lv.newest];
+
+    // find the from frame if still available
+    const uint8_t *img_from = NULL;
+    for (int i = 0; from && i < LIVE_NFRAMES; i++) {
+        if (lv.frames[i].version == from) {
+            img_from = lv.frames[i].pixels;
+            break;
+        }
+    }
+    const uint8_t *img_now = newest.pixels;
+
+    // find which tiles may have changed since from. if we still have the from frame these are checked
+    // block by block, else every block in these tiles is sent.
+    uint8_t tiles[FB_TILE_N];
+    tft.getStageChanges (from_seq, tiles);
+    markCounterTiles (tiles);
+    bool tile_row[FB_TILE_NY];                      // whether any tile changed in each row of tiles
+    for (int ty = 0; ty < FB_TILE_NY; ty++)
+        tile_row[ty] = memchr (&tiles[ty*FB_TILE_NX], 1, FB_TILE_NX) != NULL;
 
     // set header to location and length of each changed region.
-    typedef struct {
-        uint8_t x, y, l;                                // region location and length in units of blocks
-    } RegnLoc;
     RegnLoc locs[MAX_REGNS];                            // room for max number of header region entries
     uint16_t n_regns = 0;                               // n regions defined so far
     int n_bloks = 0;                                    // n blocks within all regions so far
@@ -268,24 +534,32 @@ static void updateExistingClient (ws_cli_conn_t *client)
     // build locs by checking each region for change across then down
     for (int ry = 0; ry < BLOK_NROWS; ry++) {
 
+        // skip band if no tiles changed anywhere across it
+        const int ty = ry*BLOK_H/FB_TILE_H;
+        if (!tile_row[ty])
+            continue;
+
         // pre-check an image band all the way across BLOK_COLS hi, skip entirely if no change anywhere
         int band_start = ry*LIVE_BYPPIX*BLOK_H*BUILD_W;
-        if (memcmp (&img_now[band_start], &img_client[band_start], LIVE_BYPPIX*BLOK_H*BUILD_W) == 0)
+        if (img_from && memcmp (&img_now[band_start], &img_from[band_start], LIVE_BYPPIX*BLOK_H*BUILD_W) == 0)
             continue;
 
         // something changed, scan across this band checking each block
         locs[n_regns].l = 0;                            // init n contiguous blocks that start here
         for (int rx = 0; rx < BLOK_NCOLS; rx++) {
-            int blok_start = band_start + rx*BLOK_WBYTES;
-            uint8_t *now0 = &img_now[blok_start];       // first pixel in this block of current image
-            uint8_t *pre0 = &img_client[blok_start];    // first pixel in this block of image in client
 
             // check each row of this block for any change, start or add to region 
-            bool blok_changed = false;                  // set if any changed pixels in this block
-            for (int rr = 0; rr < BLOK_H; rr++) {
-                if (memcmp (now0+rr*LIVE_BYPPIX*BUILD_W, pre0+rr*LIVE_BYPPIX*BUILD_W, BLOK_WBYTES) != 0) {
-                    blok_changed = true;
-                    break;
+            bool blok_changed = tiles[ty*FB_TILE_NX + rx*BLOK_W/FB_TILE_W] != 0;
+            if (blok_changed && img_from) {
+                int blok_start = band_start + rx*BLOK_WBYTES;
+                const uint8_t *now0 = &img_now[blok_start];     // first pixel in this block of newest image
+                const uint8_t *pre0 = &img_from[blok_start];    // first pixel in this block of from image
+                blok_changed = false;
+                for (int rr = 0; rr < BLOK_H; rr++) {
+                    if (memcmp (now0+rr*LIVE_BYPPIX*BUILD_W, pre0+rr*LIVE_BYPPIX*BUILD_W, BLOK_WBYTES)) {
+                        blok_changed = true;
+                        break;
+                    }
                 }
             }
 
@@ -320,7 +594,7 @@ static void updateExistingClient (ws_cli_conn_t *client)
     for (int ry = 0; ry < BLOK_H; ry++) {
         for (int i = 0; i < n_regns; i++) {
             RegnLoc *rp = &locs[i];
-            uint8_t *now0 = &img_now[BUILD_W*LIVE_BYPPIX*(ry+BLOK_H*rp->y) + BLOK_WBYTES*rp->x];
+            const uint8_t *now0 = &img_now[BUILD_W*LIVE_BYPPIX*(ry+BLOK_H*rp->y) + BLOK_WBYTES*rp->x];
             memcpy (chg0, now0, BLOK_WBYTES*rp->l);
             chg0 += BLOK_WBYTES*rp->l;
         }
@@ -328,20 +602,11 @@ static void updateExistingClient (ws_cli_conn_t *client)
     if (n_bloks != (chg0-chg_regns)/BLOK_NBYTES)        // assert
         bye ("live regions %d != %d\n", n_bloks, (int)((chg0-chg_regns)/BLOK_NBYTES));
 
-    if (debugLevel (DEBUG_WEB, 2)) {
-        struct timeval tv1;
-        gettimeofday (&tv1, NULL);
-        Serial.printf ("LIVE: client %s: built %d regions from %d blocks in %ld usec\n",
-                        ws_getaddress(client), n_regns, n_bloks, TVDELUS (tv0, tv1));
-    }
-
-    // time header creation and png write
-    gettimeofday (&tv0, NULL);
-
     // build 4-byte header followed by x,y,l of each of n regions in units of blocks.
-    unsigned hdr_l = 4+3*n_regns;
-    StackMalloc hdr_mem(hdr_l);
-    uint8_t *hdr = (uint8_t *) hdr_mem.getMem();
+    int hdr_l = 4+3*n_regns;
+    uint8_t *hdr = (uint8_t *) malloc (hdr_l);
+    if (!hdr)
+        bye ("No memory for live header %d\n", hdr_l);
     hdr[0] = BLOK_W;                            // block width, pixels
     hdr[1] = BLOK_H;                            // block height, pixels
     hdr[2] = n_regns >> 8;                      // n regions, MSB
@@ -354,50 +619,295 @@ static void updateExistingClient (ws_cli_conn_t *client)
             Serial.printf ("   %d,%d %dx%d\n", locs[i].x*BLOK_W, locs[i].y*BLOK_H, locs[i].l*BLOK_W, BLOK_H);
     }
 
-    // always send header
-    unsigned n_hdrsent = ws_sendframe_bin (client, (const char *) hdr, hdr_l);
-    if (n_hdrsent != hdr_l)
-        Serial.printf ("LIVE: client %s: wrong header write %u != %d\n", ws_getaddress(client), n_hdrsent, hdr_l);
+    diff.from = from;
+    diff.to = newest.version;
+    diff.hdr = hdr;
+    diff.hdr_l = hdr_l;
+    diff.regns = chg_regns;
+    diff.n_regns = n_regns;
+    diff.n_bloks = n_bloks;
+    diff.by_tiles = img_from == NULL;
+}
+
+/* encode diff with codec into up, which must be empty. this is the slow part so it is done without si_lock
+ * to let clients encode in parallel.
+ */
+static void encodeLiveUpdate (const LiveDiff &diff, LiveCodec codec, LiveUpdate &up)
+{
+    // curious how long this takes
+    struct timeval tv0;
+    gettimeofday (&tv0, NULL);
 
-    // followed by one image containing one column BLOK_W wide of all changed regions
-    stbi_write_png_to_func (wifiSTBWrite_helper, client, BLOK_W*n_bloks, BLOK_H,
-                            COMP_RGB, chg_regns, BLOK_WBYTES*n_bloks);
+    up.from = diff.from;
+    up.to = diff.to;
+    up.codec = codec;
+
+    if (codec == LIVE_PNG) {
+        // header followed by one image containing one row BLOK_H high of all changed regions
+        up.msgs_l[0] = diff.hdr_l;
+        up.msgs[0] = (uint8_t *) malloc (diff.hdr_l);
+        if (!up.msgs[0])
+            bye ("No memory for live header %d\n", diff.hdr_l);
+        memcpy (up.msgs[0], diff.hdr, diff.hdr_l);
+        up.msgs[1] = encodeLivePNG (diff.regns, BLOK_W*diff.n_bloks, BLOK_H, BLOK_WBYTES*diff.n_bloks,
+                                &up.msgs_l[1]);
+    } else {
+        // header and the same image all in one delta
+        up.msgs[0] = encodeLiveDelta (diff.hdr, diff.hdr_l, diff.regns, diff.n_bloks*BLOK_NPIX,
+                                codec == LIVE_RLEZ, &up.msgs_l[0]);
+    }
 
     if (debugLevel (DEBUG_WEB, 2)) {
         struct timeval tv1;
         gettimeofday (&tv1, NULL);
-        Serial.printf ("LIVE: client %s: write hdr %d bytes and update took %ld usec\n",
-                        ws_getaddress(client), hdr_l, TVDELUS (tv0,tv1));
+        Serial.printf ("LIVE: encoded update %u -> %u%s codec %d with %d regions %d blocks in %d bytes in %ld usec\n",
+                        up.from, up.to, diff.by_tiles ? " by tiles" : "", (int)codec, diff.n_regns,
+                        diff.n_bloks, up.msgs_l[0] + up.msgs_l[1], TVDELUS (tv0, tv1));
     }
+}
 
-    if (debugLevel (DEBUG_WEB, 2))
-        Serial.printf ("LIVE: client %s: sent update with %d regions %d blocks\n",
-                        ws_getaddress(client), n_regns, n_bloks);
+/* save a copy of up in the given view for other clients unless one of them already did meanwhile.
+ * N.B. we assume si_lock is held.
+ */
+static void cacheLiveUpdate (LiveView &lv, const LiveUpdate &up)
+{
+    if (findLiveUpdate (lv, up.from, up.to, up.codec))
+        return;
+
+    // recycle the oldest update slot
+    LiveUpdate &cup = lv.updates[lv.next_update];
+    lv.next_update = (lv.next_update + 1) % LIVE_NUPDATES;
+    for (int i = 0; i < LIVE_NMSGS; i++) {
+        free (cup.msgs[i]);
+        cup.msgs[i] = NULL;
+        cup.msgs_l[i] = 0;
+        if (up.msgs[i]) {
+            cup.msgs[i] = (uint8_t *) malloc (up.msgs_l[i]);
+            if (!cup.msgs[i])
+                bye ("No memory for live update\n");
+            memcpy (cup.msgs[i], up.msgs[i], up.msgs_l[i]);
+            cup.msgs_l[i] = up.msgs_l[i];
+        }
+    }
+    cup.from = up.from;
+    cup.to = up.to;
+    cup.codec = up.codec;
+}
+
+/* add a new sample x to the running average ema, or start with x if no prior samples.
+ */
+static void liveEMA (float &ema, float x, bool first)
+{
+    if (first)
+        ema = x;
+    else
+        ema += (x - ema)/LIVE_EMA_N;
+}
+
+/* once the given client's queued update has all been written, record how long that took.
+ * N.B. call with si_lock held
+ */
+static void noteLiveSent (ws_cli_conn_t *client, SessionInfo *sip)
+{
+    struct timeval drained_tv;
+    if (sip->send_tv.tv_sec && ws_pending (client, &drained_tv) == 0) {
+        liveEMA (sip->send_ms, TVDELUS (sip->send_tv, drained_tv)/1000.0F, sip->n_updates < 2);
+        if (sip->sent_tv.tv_sec)
+            liveEMA (sip->sent_ms, TVDELUS (sip->sent_tv, drained_tv)/1000.0F, sip->n_updates < 3);
+        sip->sent_tv = drained_tv;
+        sip->send_tv.tv_sec = sip->send_tv.tv_usec = 0;
+    }
+}
+
+/* record a request for an update from the given client.
+ */
+static void recordLiveRequest (ws_cli_conn_t *client, LiveCodec codec)
+{
+    struct timeval now;
+    gettimeofday (&now, NULL);
+
+    pthread_mutex_lock (&si_lock);
+    SessionInfo *sip = findSI (client);
+    if (sip) {
+        noteLiveSent (client, sip);
+        if (sip->sent_tv.tv_sec && !sip->send_tv.tv_sec)
+            liveEMA (sip->resp_ms, TVDELUS (sip->sent_tv, now)/1000.0F, sip->n_updates < 2);
+        sip->req_tv = now;
+        sip->codec = codec;
+    }
+    pthread_mutex_unlock (&si_lock);
+}
+
+/* return usecs until the given client may start its next update, 0 if now.
+ */
+static long liveUpdateWait (ws_cli_conn_t *client)
+{
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    long wait_us = 0;
+
+    pthread_mutex_lock (&si_lock);
+    SessionInfo *sip = findSI (client);
+    if (sip && sip->n_updates > 0) {
+        noteLiveSent (client, sip);
+        if (sip->send_tv.tv_sec) {
+            // previous update still queued
+            wait_us = LIVE_BUSY_MS*1000L;
+        } else {
+            long min_us = 1000000L/liveweb_maxfps;
+            long duty_us = (long)(LIVE_DUTY*1000*sip->send_ms);
+            wait_us = (min_us > duty_us ? min_us : duty_us) - TVDELUS (sip->upd_tv, now);
+        }
+        long left_us = LIVE_MAXWAIT_MS*1000L - TVDELUS (sip->req_tv, now);
+        if (wait_us > left_us)
+            wait_us = left_us;
+    }
+    pthread_mutex_unlock (&si_lock);
+
+    return (wait_us);
+}
+
+/* record that we queued n_bytes for the given client starting at tv0.
+ */
+static void recordLiveSend (ws_cli_conn_t *client, int n_bytes, const struct timeval &tv0)
+{
+    pthread_mutex_lock (&si_lock);
+    SessionInfo *sip = findSI (client);
+    if (sip) {
+        liveEMA (sip->upd_bytes, n_bytes, sip->n_updates == 0);
+        sip->send_tv = tv0;
+        sip->n_updates++;
+        sip->n_bytes += n_bytes;
+        noteLiveSent (client, sip);
+    }
+    pthread_mutex_unlock (&si_lock);
+}
+
+/* send difference between client's last known screen image and the current image using the given codec.
+ */
+static void updateExistingClient (ws_cli_conn_t *client, LiveCodec codec)
+{
+    bool ro = client->port == liveweb_ro_port;
+    LiveView &lv = live_views[ro];
+
+    // while locked, copy the update if another client already encoded it else copy out the changed blocks.
+    // encoding and sending are then done unlocked so clients don't wait on each other.
+    LiveUpdate up;
+    memset (&up, 0, sizeof(up));
+    LiveDiff diff;
+    memset (&diff, 0, sizeof(diff));
+    struct timeval tv0;
+    pthread_mutex_lock (&si_lock);
+    SessionInfo *sip = findSI (client);
+    if (sip) {
+        gettimeofday (&tv0, NULL);
+        sip->upd_tv = tv0;
+        LiveFrame &newest = captureLiveFrame (lv, ro);
+        LiveUpdate *cup = findLiveUpdate (lv, sip->version, newest.version, codec);
+        if (cup) {
+            for (int i = 0; i < LIVE_NMSGS && cup->msgs[i]; i++) {
+                up.msgs_l[i] = cup->msgs_l[i];
+                up.msgs[i] = (uint8_t *) malloc (up.msgs_l[i]);
+                if (!up.msgs[i])
+                    bye ("No memory for live update\n");
+                memcpy (up.msgs[i], cup->msgs[i], up.msgs_l[i]);
+            }
+        } else
+            diffLiveFrames (lv, sip->version, sip->stage_seq, diff);
+        if (sip->version && newest.version > sip->version)
+            sip->n_dropped += newest.version - sip->version - 1;
+        sip->version = newest.version;
+        sip->stage_seq = newest.stage_seq;
+    }
+    pthread_mutex_unlock (&si_lock);
+    if (!sip)
+        return;
+
+    // encode if new then share
+    if (diff.hdr) {
+        encodeLiveUpdate (diff, codec, up);
+        free (diff.hdr);
+        free (diff.regns);
+        pthread_mutex_lock (&si_lock);
+        cacheLiveUpdate (lv, up);
+        pthread_mutex_unlock (&si_lock);
+    }
+
+    // send each message in order
+    gettimeofday (&tv0, NULL);
+    for (int i = 0; i < LIVE_NMSGS && up.msgs[i]; i++) {
+        sendClientBin (client, up.msgs[i], up.msgs_l[i]);
+        free (up.msgs[i]);
+    }
+    recordLiveSend (client, up.msgs_l[0] + up.msgs_l[1], tv0);
 
-    // finished with temps
-    free (chg_regns);
-    free (img_client);
+    if (debugLevel (DEBUG_WEB, 2))
+        Serial.printf ("LIVE: client %s: sent update %d + %d bytes\n", ws_getaddress(client),
+                                up.msgs_l[0], up.msgs_l[1]);
 }
 
-/* capture fresh screen image for client and send.
+/* send fresh complete screen image to client.
  */
 static void sendClientPNG (ws_cli_conn_t *client)
 {
-    // get this client's current pixels array
-    uint8_t *pixels = getSIPixels(client);
-    if (!pixels)
+    bool ro = client->port == liveweb_ro_port;
+    LiveView &lv = live_views[ro];
+
+    // while locked, copy the png of the newest frame if already encoded else copy the frame itself.
+    // encoding and sending are then done unlocked so clients don't wait on each other.
+    uint8_t *png = NULL;
+    int png_l = 0;
+    uint8_t *pixels = NULL;
+    uint32_t version = 0;
+    pthread_mutex_lock (&si_lock);
+    SessionInfo *sip = findSI (client);
+    if (sip) {
+        LiveFrame &newest = captureLiveFrame (lv, ro);
+        if (lv.png && lv.png_version == newest.version) {
+            png_l = lv.png_l;
+            png = (uint8_t *) malloc (png_l);
+            if (!png)
+                bye ("No memory for live png\n");
+            memcpy (png, lv.png, png_l);
+        } else {
+            pixels = (uint8_t *) malloc (LIVE_NBYTES);
+            if (!pixels)
+                bye ("No memory for live png frame\n");
+            memcpy (pixels, newest.pixels, LIVE_NBYTES);
+        }
+        version = newest.version;
+        sip->version = newest.version;
+        sip->stage_seq = newest.stage_seq;
+    }
+    pthread_mutex_unlock (&si_lock);
+    if (!sip)
         return;
 
-    // fresh capture
-    if (!tft.getRawPix (pixels, LIVE_NPIX))
-        bye ("getRawPix for png failed\n");
+    // encode if new then share unless another client already stored a newer one
+    if (pixels) {
+        png = encodeLivePNG (pixels, BUILD_W, BUILD_H, LIVE_RBYTES, &png_l);
+        free (pixels);
+        pthread_mutex_lock (&si_lock);
+        if (!lv.png || version > lv.png_version) {
+            free (lv.png);
+            lv.png = (uint8_t *) malloc (png_l);
+            if (!lv.png)
+                bye ("No memory for live png\n");
+            memcpy (lv.png, png, png_l);
+            lv.png_l = png_l;
+            lv.png_version = version;
+        }
+        pthread_mutex_unlock (&si_lock);
+    }
 
-    // convert image to and send as png
-    stbi_write_png_compression_level = 2;       // faster with hardly any increase in size
-    stbi_write_png_to_func (wifiSTBWrite_helper, client, BUILD_W, BUILD_H, COMP_RGB, pixels, LIVE_RBYTES);
+    struct timeval tv0;
+    gettimeofday (&tv0, NULL);
+    sendClientBin (client, png, png_l);
+    free (png);
+    recordLiveSend (client, png_l, tv0);
 
     if (debugLevel (DEBUG_WEB, 1))
-        Serial.printf ("LIVE: client %s: sent full PNG\n", ws_getaddress(client));
+        Serial.printf ("LIVE: client %s: sent full PNG %d bytes\n", ws_getaddress(client), png_l);
 }
 
 /* send message that user wants full screen.
@@ -419,6 +929,28 @@ static void sendURL (ws_cli_conn_t *client, const char *url)
     ws_sendframe_txt (client, opencmd);
 }
 
+/* send the given client an update now if its pacing allows, else arrange to try again later.
+ */
+static void deferredLiveUpdate (ws_cli_conn_t *client, void *arg);
+static void pacedLiveUpdate (ws_cli_conn_t *client, LiveCodec codec)
+{
+    long wait_us = liveUpdateWait (client);
+    if (wait_us > 0) {
+        if (debugLevel (DEBUG_WEB, 2))
+            Serial.printf ("LIVE: client %s: pacing %ld usec\n", ws_getaddress(client), wait_us);
+        (void) ws_defer (client, (wait_us + 999)/1000, deferredLiveUpdate, (void *)(intptr_t)codec);
+        return;
+    }
+    updateExistingClient (client, codec);
+}
+
+/* ws_defer() callback to try again to send a paced update.
+ */
+static void deferredLiveUpdate (ws_cli_conn_t *client, void *arg)
+{
+    pacedLiveUpdate (client, (LiveCodec)(intptr_t)arg);
+}
+
 /* client running liveweb-html.cpp is asking for a complete screen capture as png file.
  */
 static void getLivePNG (ws_cli_conn_t *client, char args[], size_t args_len)
@@ -438,8 +970,21 @@ static void getLivePNG (ws_cli_conn_t *client, char args[], size_t args_len)
  */
 static void getLiveUpdate (ws_cli_conn_t *client, char args[], size_t args_len)
 {
-    (void)args;
-    (void)args_len;
+    // codec offered by liveweb-html, original png if none
+    LiveCodec codec = LIVE_PNG;
+    WebArgs wa;
+    wa.nargs = 0;
+    wa.name[wa.nargs++] = "codec";
+    if (!parseWebCommand (wa, args, args_len))
+        Serial.printf ("LIVE: get_live.bin garbled: %s\n", args);
+    else if (wa.found[0] && wa.value[0]) {
+        if (strcmp (wa.value[0], "rlez") == 0)
+            codec = LIVE_RLEZ;
+        else if (strcmp (wa.value[0], "rle") == 0)
+            codec = LIVE_RLE;
+        else if (strcmp (wa.value[0], "png") != 0)
+            Serial.printf ("LIVE: unknown codec %s, using png\n", wa.value[0]);
+    }
 
     // inform we want full screen
     if (liveweb_fs_ready && getWebFullScreen())
@@ -477,7 +1022,8 @@ static void getLiveUpdate (ws_cli_conn_t *client, char args[], size_t args_len)
     }
 
     // finally: what we came here for :-)
-    updateExistingClient (client);
+    recordLiveRequest (client, codec);
+    pacedLiveUpdate (client, codec);
 }
 
 /* client running liveweb-html.cpp sending us a character to act on as if typed locally.
@@ -689,7 +1235,7 @@ static void sendLiveFavicon (FILE *sockfp)
 }
 
 /* callback when browser asks for a new websocket connection.
- * assign a fresh si_list for keeping track its pixels.
+ * assign a fresh si_list entry for keeping track of what it has seen.
  */
 static void ws_onopen(ws_cli_conn_t *client)
 {
@@ -704,11 +1250,6 @@ static void ws_onopen(ws_cli_conn_t *client)
         SessionInfo *sip = &si_list[i];
         if (!sip->client) {
             new_sip = sip;
-            // insure no stale pixels
-            if (new_sip->pixels) {
-                free (new_sip->pixels);
-                new_sip->pixels = NULL;
-            }
             break;
         }
     }
@@ -728,12 +1269,11 @@ static void ws_onopen(ws_cli_conn_t *client)
         }
     }
 
-    // init including memory for pixels but don't capture until client asks for them
+    // init but don't capture until client asks
     if (new_sip) {
+        memset (new_sip, 0, sizeof (*new_sip));
         new_sip->client = client;
-        new_sip->pixels = (uint8_t *) malloc (LIVE_NBYTES);
-        if (!new_sip->pixels)
-            bye ("No memory for new live session pixels\n");
+        new_sip->open_t = time(NULL);
 
         // increment appropriate counter
         if (client->port == liveweb_ro_port) {
@@ -756,31 +1296,35 @@ static void ws_onopen(ws_cli_conn_t *client)
  */
 static void ws_onclose (ws_cli_conn_t *client)
 {
+    // protect list while manipulating -- N.B. unlock before returning!
+    pthread_mutex_lock (&si_lock);
+
     // remove from si_list
     for (int i = 0; i < si_n; i++) {
         SessionInfo *sip = &si_list[i];
         if (sip->client == client) {
             sip->client = NULL;
 
-            // recycle pixel memory
-            if (sip->pixels) {
-                free (sip->pixels);
-                sip->pixels = NULL;
-            }
-
-            // decrement appropriate counter
+            // decrement appropriate counter, recycle shared frames when none left
             if (client->port == liveweb_ro_port) {
                 n_roweb -= 1;
                 Serial.printf ("LIVE: RO client %s disconnected, now %d\n", ws_getaddress(client), n_roweb);
+                if (n_roweb == 0)
+                    resetLiveView (live_views[1]);
             } else {
                 n_rwweb -= 1;
                 Serial.printf ("LIVE: RW client %s disconnected, now %d\n", ws_getaddress(client), n_rwweb);
+                if (n_rwweb == 0)
+                    resetLiveView (live_views[0]);
             }
 
+            pthread_mutex_unlock (&si_lock);
             return;
         }
     }
 
+    pthread_mutex_unlock (&si_lock);
+
     // if get here, client was not found in si_list -- usually just because closed because too many open
     // Serial.printf ("LIVE: client %s: disappeared after closing websocket\n", ws_getaddress(client));
 }
@@ -887,6 +1431,9 @@ void initLiveWeb (bool verbose)
         // handle all write errors inline
         signal (SIGPIPE, SIG_IGN);
 
+        // png are encoded in parallel so set this once: faster with hardly any increase in size
+        stbi_write_png_compression_level = 2;
+
         // actually start stuff unless not wanted
 
         // R/W service
@@ -948,3 +1495,42 @@ bool isLiveWebTouch (void)
 {
     return (lastest_ws_touch_client != NULL);
 }
+
+/* pass back a malloced list of stats for each live web client, return count.
+ * N.B. caller must free *stats even if returning 0.
+ */
+int getLiveWebStats (LiveWebStats **stats)
+{
+    static const char *codec_names[] = {"png", "rle", "rlez"};
+
+    pthread_mutex_lock (&si_lock);
+
+    LiveWebStats *list = (LiveWebStats *) malloc ((si_n > 0 ? si_n : 1) * sizeof(LiveWebStats));
+    if (!list)
+        bye ("No memory for %d live stats\n", si_n);
+    int n_list = 0;
+    time_t now = time(NULL);
+
+    for (int i = 0; i < si_n; i++) {
+        SessionInfo *sip = &si_list[i];
+        if (!sip->client)
+            continue;
+        LiveWebStats &ls = list[n_list++];
+        quietStrncpy (ls.addr, ws_getaddress(sip->client), sizeof(ls.addr));
+        ls.ro = sip->client->port == liveweb_ro_port;
+        ls.codec = codec_names[sip->codec];
+        ls.age_s = now - sip->open_t;
+        ls.fps = sip->sent_ms > 0 ? 1000.0F/sip->sent_ms : 0;
+        ls.kbps = ls.fps * sip->upd_bytes / 1000.0F;
+        ls.send_ms = sip->send_ms;
+        ls.resp_ms = sip->resp_ms;
+        ls.n_updates = sip->n_updates;
+        ls.n_dropped = sip->n_dropped;
+        ls.n_bytes = sip->n_bytes;
+    }
+
+    pthread_mutex_unlock (&si_lock);
+
+    *stats = list;
+    return (n_list);
+}
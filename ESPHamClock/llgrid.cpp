@@ -0,0 +1,132 @@
+/* spatial index of points on the earth for quickly finding those near a given location.
+ *
+ * points are bucketed into cells of LLG_DEG degrees of lat and lng, so a search need only look at the few
+ * cells around the location regardless of how many points there are. Each point carries an id of the
+ * caller's choosing, typically an index into its own list. Points may be added at any time; they are sorted
+ * into their cells on the next visit, so adding a whole list then searching costs one counting sort.
+ *
+ * usage: the owner of a list of locations keeps an LLGrid, calls resetLLGrid() whenever the list changes and,
+ * if !filled, adds each location then sets filled before calling visitLLGrid().
+ */
+
+#include "HamClock.h"
+
+#define LLG_DEG         2                               // cell size, degrees
+#define LLG_ROWS        (180/LLG_DEG)                   // n cells in lat
+#define LLG_COLS        (360/LLG_DEG)                   // n cells in lng
+#define LLG_NCELLS      (LLG_ROWS*LLG_COLS)             // total cells
+
+/* return cell row containing the given latitude, degrees
+ */
+static int llgRow (float lat_d)
+{
+    int row = (int) floorf ((lat_d + 90) / LLG_DEG);
+    return (row < 0 ? 0 : (row >= LLG_ROWS ? LLG_ROWS-1 : row));
+}
+
+/* return cell column containing the given longitude, degrees, any range
+ */
+static int llgCol (float lng_d)
+{
+    int col = (int) floorf ((lng_d + 180) / LLG_DEG);
+    col %= LLG_COLS;
+    return (col < 0 ? col + LLG_COLS : col);
+}
+
+/* forget all points but keep memory for the next batch
+ */
+void resetLLGrid (LLGrid &g)
+{
+    g.n_pts = 0;
+    g.sorted = false;
+    g.filled = false;
+}
+
+/* add a point with the given id
+ */
+void addLLGrid (LLGrid &g, const LatLong &ll, int id)
+{
+    if (g.n_pts + 1 > g.n_malloced) {
+        g.n_malloced += 1000;
+        g.pt_cells = (int *) realloc (g.pt_cells, g.n_malloced * sizeof(int));
+        g.pt_ids = (int *) realloc (g.pt_ids, g.n_malloced * sizeof(int));
+        g.ids = (int *) realloc (g.ids, g.n_malloced * sizeof(int));
+        if (!g.pt_cells || !g.pt_ids || !g.ids)
+            fatalError ("No memory for %d grid points", g.n_malloced);
+    }
+    g.pt_cells[g.n_pts] = llgRow (ll.lat_d) * LLG_COLS + llgCol (ll.lng_d);
+    g.pt_ids[g.n_pts] = id;
+    g.n_pts++;
+    g.sorted = false;
+}
+
+/* counting sort pt_ids into ids[] grouped by cell, with cell0[] the ids index of first in each cell
+ */
+static void sortLLGrid (LLGrid &g)
+{
+    if (!g.cell0) {
+        g.cell0 = (int *) malloc ((LLG_NCELLS+1) * sizeof(int));
+        if (!g.cell0)
+            fatalError ("No memory for grid cells");
+    }
+
+    // count each cell, then convert to starting index
+    memset (g.cell0, 0, (LLG_NCELLS+1) * sizeof(int));
+    for (int i = 0; i < g.n_pts; i++)
+        g.cell0[g.pt_cells[i]+1]++;
+    for (int c = 0; c < LLG_NCELLS; c++)
+        g.cell0[c+1] += g.cell0[c];
+
+    // place each, using cell0[c] as the next slot then shift back
+    for (int i = 0; i < g.n_pts; i++)
+        g.ids[g.cell0[g.pt_cells[i]]++] = g.pt_ids[i];
+    for (int c = LLG_NCELLS; c > 0; c--)
+        g.cell0[c] = g.cell0[c-1];
+    g.cell0[0] = 0;
+
+    g.sorted = true;
+}
+
+/* call fp with the id of each point that might be within dlat_d and dlng_d degrees of ll, along with arg.
+ * N.B. fp is called for a superset: it must still check each id for itself.
+ */
+void visitLLGrid (LLGrid &g, const LatLong &ll, float dlat_d, float dlng_d, LLGridVisitor fp, void *arg)
+{
+    if (g.n_pts == 0)
+        return;
+    if (!g.sorted)
+        sortLLGrid (g);
+
+    int row0 = llgRow (ll.lat_d - dlat_d);
+    int row1 = llgRow (ll.lat_d + dlat_d);
+    int col0, n_cols;
+    if (2*dlng_d >= 360 - LLG_DEG) {                   // else both ends could wrap into the same column
+        col0 = 0;
+        n_cols = LLG_COLS;
+    } else {
+        col0 = llgCol (ll.lng_d - dlng_d);
+        n_cols = (llgCol (ll.lng_d + dlng_d) - col0 + LLG_COLS) % LLG_COLS + 1;
+    }
+
+    for (int row = row0; row <= row1; row++) {
+        for (int i = 0; i < n_cols; i++) {
+            int c = row * LLG_COLS + (col0 + i) % LLG_COLS;
+            for (int j = g.cell0[c]; j < g.cell0[c+1]; j++)
+                (*fp)(g.ids[j], arg);
+        }
+    }
+}
+
+/* handy longitude half-width, degrees, of the box around ll that contains all points within r_d degrees
+ * of great circle distance, or 180 if it includes a pole.
+ */
+float llGridLngRadius (const LatLong &ll, float r_d)
+{
+    float max_lat = fabsf (ll.lat_d) + r_d;
+    if (max_lat >= 90)
+        return (180);
+    float sin_dlng = sinf (deg2rad(r_d)) / cosf (deg2rad(max_lat));
+    if (sin_dlng >= 1)
+        return (180);
+    return (rad2deg (asinf (sin_dlng)));
+}
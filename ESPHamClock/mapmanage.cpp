@@ -22,6 +22,7 @@
 static FILE *day_fp, *night_fp;                         // open day and night files
 static int day_nbytes, night_nbytes;                    // bytes mmap'ed
 static char *day_pixels, *night_pixels;                 // pixels mmap'ed
+static char day_pinned[100], night_pinned[100];         // files pinned in cache while installed, if any
 
 
 // BMP file format parameters
@@ -88,6 +89,16 @@ static void invalidatePixels()
         // disconnect from tft thread
         tft.setEarthPix (NULL, NULL, 0, 0);
 
+        // files may now age out of the cache
+        if (day_pinned[0]) {
+            pinCacheFile (day_pinned, false);
+            day_pinned[0] = '\0';
+        }
+        if (night_pinned[0]) {
+            pinCacheFile (night_pinned, false);
+            night_pinned[0] = '\0';
+        }
+
         if (getGrayDisplay() == GRAY_OFF) {
             // unmap pixel arrays
             if (day_pixels) {
@@ -107,17 +118,6 @@ static void invalidatePixels()
         }
 }
 
-/* convert the given RGB565 from color to gray
- */
-static uint16_t RGB565TOGRAY (uint16_t c)
-{
-        uint16_t r = RGB565_R(c);
-        uint16_t g = RGB565_G(c);
-        uint16_t b = RGB565_B(c);
-        uint16_t gray = RGB2GRAY(r,g,b);
-        return (RGB565 (gray, gray, gray));
-}
-
 /* make the day and night file names for the given map style
  */
 static void mkMapFilenames (CoreMaps cm, char dfile[], char nfile[], int zoom, size_t fn_l)
@@ -188,16 +188,14 @@ static bool installFilePixels (const char *dfile, const char *nfile)
                 uint16_t *tdp = (uint16_t *) (mem_day_pixels);
                 uint16_t *tnp = (uint16_t *) (mem_night_pixels);
 
-                // convert each pixel
+                // convert all pixels
                 int n_mem_pix = n_mem_bytes/2;
                 struct timeval tv0, tv1;
                 gettimeofday (&tv0, NULL);
-                while (--n_mem_pix >= 0) {
-                    *tdp++ = RGB565TOGRAY(*fdp++);
-                    *tnp++ = RGB565TOGRAY(*fnp++);
-                }
+                grayRGB565Row (fdp, tdp, n_mem_pix);
+                grayRGB565Row (fnp, tnp, n_mem_pix);
                 gettimeofday (&tv1, NULL);
-                Serial.printf ("gray conversion took %ld us\n",
+                Serial.printf ("gray conversion using %s took %ld us\n", pixBlendKernel(),
                                             (tv1.tv_sec-tv0.tv_sec)*1000000 + (tv1.tv_usec - tv0.tv_usec));
 
                 // replace mmap with gray memory copy
@@ -214,6 +212,12 @@ static bool installFilePixels (const char *dfile, const char *nfile)
                 tft.setEarthPix (day_pixels+BHDRSZ, night_pixels+BHDRSZ, ZOOM_W, ZOOM_H);
             }
 
+            // keep the cache from removing files in use however long they are displayed
+            quietStrncpy (day_pinned, dfile, sizeof(day_pinned));
+            pinCacheFile (day_pinned, true);
+            quietStrncpy (night_pinned, nfile, sizeof(night_pinned));
+            pinCacheFile (night_pinned, true);
+
         } else {
 
             // no go -- clean up
@@ -327,11 +331,13 @@ long max_age)
              }
         }
 
+        bool downloaded = false;
         if (ok) {
             Serial.printf ("%s: using local D and N files\n", style);
         } else {
             // download new twin voacap maps
             Serial.printf ("%s: downloading fresh D and N files\n", style);
+            downloaded = true;
             updateClocks(false);
             WiFiClient client;
             if (client.connect(backend_host, backend_port)) {
@@ -361,6 +367,8 @@ long max_age)
         if (ok) {
             day_fp = fopenOurs (q_dfn, "r");
             night_fp = fopenOurs (q_nfn, "r");
+            noteCacheFile (q_dfn, CC_MAP, downloaded);
+            noteCacheFile (q_nfn, CC_MAP, downloaded);
             ok = installFilePixels (q_dfn, q_nfn);
         }
 
@@ -379,6 +387,7 @@ static FILE *openMapFile (CoreMaps cm, const char *filename, const char *title)
 {
         // trust but verify
         bool ok = true;
+        bool downloaded = false;
 
         // open local file
         FILE *fp = fopenOurs (filename, "r");
@@ -449,8 +458,10 @@ static FILE *openMapFile (CoreMaps cm, const char *filename, const char *title)
                     httpHCGET (client, backend_host, url);
                     char c_l[100];
                     if (httpSkipHeader (client, "Content-Length: ", c_l, sizeof(c_l)) &&
-                                                    downloadZFile (client, filename, atol(c_l)))
+                                                    downloadZFile (client, filename, atol(c_l))) {
                         fp = fopenOurs (filename, "r");
+                        downloaded = true;
+                    }
                     client.stop();
                 }
                 if (!fp)
@@ -458,6 +469,10 @@ static FILE *openMapFile (CoreMaps cm, const char *filename, const char *title)
             }
         }
 
+        // CM_USER images are not downloads
+        if (fp && cm != CM_USER)
+            noteCacheFile (filename, CC_MAP, downloaded);
+
         // return result, open if good or closed if not
         return (fp);
 }
@@ -55,11 +55,21 @@ static uint8_t onta_age;                                // one of above, once se
 static DXSpot *onta_spots;                              // malloced list, complete
 static int n_ontaspots;                                 // n spots in onta_spots
 static DXSpot *ontawl_spots;                            // filtered malloced list, count in onta_ss.n_data
+static LLGrid ontawl_grid;                              // spatial index of ontawl_spots
 static ScrollState onta_ss;                             // scrolling state
 static uint8_t onta_sortby;                             // one of ONTASort
 static bool onta_showbio;                               // whether click shows bio
 static uint32_t spots_hash, hash_atscroll;              // hash of onta_spots, value when scrolled away
 #define NEW_SPOTS()     (spots_hash != hash_atscroll)       // handy test for new spots pending
+static time_t onta_next_update;                         // when onta_spots are due to be refreshed
+static bool onta_io_ok;                                 // whether the latest download was ok
+
+// one background download, owned by the job until doneONTA()
+typedef struct {
+    DXSpot *spots;                                      // malloced list, DXCC and rx_ll not yet set
+    int n_spots;                                        // n in spots
+} ONTAFetch;
+static const char onta_fetch_name[] = "ONTA";
 
 /* return a simple hash of the given spots array
  */
@@ -382,6 +392,7 @@ static void rebuildONTAWatchList(void)
     // extract qualifying spots from onta_spots into ontawl_spots
     time_t oldest = myNow() - 60*onta_age;               // minutes to seconds
     onta_ss.n_data = 0;                                  // reset count, don't bother to resize ontawl_spots
+    resetLLGrid (ontawl_grid);
     int n_old = 0, n_no_org = 0, n_no_wl = 0;
     for (int i = 0; i < n_ontaspots; i++) {
         DXSpot &spot = onta_spots[i];
@@ -540,13 +551,11 @@ static void runONTASortMenu (const SBox &box)
     free (wl_mt.text);
 }
 
-/* reset storage and prep for box
+/* reset display storage and prep for box.
+ * N.B. onta_spots are left for doneONTA() to replace
  */
 static void resetONTAStorage (const SBox &box)
 {
-    free (onta_spots);
-    onta_spots = NULL;
-    n_ontaspots = 0;
     free (ontawl_spots);
     ontawl_spots = NULL;
     onta_ss.init ((box.h - LISTING_Y0)/LISTING_DY, 0, 0, onta_ss.DIR_FROMSETUP);
@@ -554,15 +563,12 @@ static void resetONTAStorage (const SBox &box)
     onta_ss.initNewSpotsSymbol (box, ONTA_COLOR);
 }
 
-/* download all spots into onta_spots, regardless of watch etc.
+/* BGFetchFP to download all spots into ofp->spots, regardless of watch etc.
  * return whether io ok, even if no data.
  */
-static bool retrieveONTA (void)
+static bool fetchONTA (void *data)
 {
-    // reset
-    free (onta_spots);
-    onta_spots = NULL;
-    n_ontaspots = 0;
+    ONTAFetch *ofp = (ONTAFetch *)data;
 
     // go
     FILE *fp = openCachedFile (onta_file, onta_page, ONTA_INTERVAL, 0);
@@ -570,9 +576,6 @@ static bool retrieveONTA (void)
 
     if (fp) {
 
-        // look alive
-        updateClocks(false);
-
         // add each spot
         char line[100];
         while (fgets (line, sizeof(line), fp)) {
@@ -585,10 +588,10 @@ static bool retrieveONTA (void)
                 continue;
 
             // prep next spot but don't count until known good
-            onta_spots = (DXSpot*) realloc (onta_spots, (n_ontaspots+1)*sizeof(DXSpot));
-            if (!onta_spots)
-                fatalError ("No room for %d ONTA spots", n_ontaspots+1);
-            DXSpot &new_sp = onta_spots[n_ontaspots];
+            ofp->spots = (DXSpot*) realloc (ofp->spots, (ofp->n_spots+1)*sizeof(DXSpot));
+            if (!ofp->spots)
+                fatalError ("No room for %d ONTA spots", ofp->n_spots+1);
+            DXSpot &new_sp = ofp->spots[ofp->n_spots];
             new_sp = {};
 
             // parse
@@ -624,19 +627,12 @@ static bool retrieveONTA (void)
                 continue;
             }
 
-            // DXCC
-            if (!call2DXCC (dxcall, new_sp.tx_dxcc)) {
-                Serial.printf ("ONTA: no DXCC for %s\n", dxcall);
-                continue;
-            }
-
             // fill new_sp, repurpose rx_call for id and rx_grid for program name
             quietStrncpy (new_sp.tx_call, dxcall, sizeof(new_sp.tx_call));
             quietStrncpy (new_sp.tx_grid, dxgrid, sizeof(new_sp.tx_grid));
             quietStrncpy (new_sp.rx_call, id, sizeof(new_sp.rx_call));
             quietStrncpy (new_sp.rx_grid, prog, sizeof(new_sp.rx_grid));
             quietStrncpy (new_sp.mode, mode, sizeof(new_sp.mode));
-            new_sp.rx_ll = de_ll;                      // us?
             new_sp.tx_ll.lat_d = lat_d;
             new_sp.tx_ll.lng_d = lng_d;
             new_sp.tx_ll.normalize();
@@ -644,23 +640,79 @@ static bool retrieveONTA (void)
             new_sp.spotted = unx;
 
             // ok! append to spots[]
-            n_ontaspots += 1;
+            ofp->n_spots += 1;
         }
 
         // io ok, even if none found
         ok = true;
+
+        fclose (fp);
     }
 
     // done
-    Serial.printf ("ONTA: read %d spots\n", n_ontaspots);
-    fclose (fp);
+    Serial.printf ("ONTA: read %d spots\n", ofp->n_spots);
 
     // result
     return (ok);
 }
 
+/* BGDoneFP to install the spots downloaded by fetchONTA() with known DXCC into onta_spots.
+ */
+static void doneONTA (void *data, bool ok)
+{
+    ONTAFetch *ofp = (ONTAFetch *)data;
+
+    // reset
+    free (onta_spots);
+    onta_spots = NULL;
+    n_ontaspots = 0;
+
+    // keep each with known DXCC, compacting in place
+    for (int i = 0; ok && i < ofp->n_spots; i++) {
+        DXSpot &new_sp = ofp->spots[i];
+        if (!call2DXCC (new_sp.tx_call, new_sp.tx_dxcc)) {
+            Serial.printf ("ONTA: no DXCC for %s\n", new_sp.tx_call);
+            continue;
+        }
+        new_sp.rx_ll = de_ll;                          // us?
+        ofp->spots[n_ontaspots++] = new_sp;
+    }
+
+    // take over the list
+    if (ok) {
+        onta_spots = ofp->spots;
+        ofp->spots = NULL;
+    }
+
+    // record when to refresh
+    onta_io_ok = ok;
+    onta_next_update = ok ? myNow() + ONTA_INTERVAL : nextWiFiRetry (PLOT_CH_ONTA);
+
+    free (ofp->spots);
+    free (ofp);
+}
+
+/* return whether onta_spots are current and may be drawn.
+ * if not, start downloading them in the background if not already.
+ */
+bool ontaReady (void)
+{
+    if (myNow() < onta_next_update)
+        return (true);
+
+    if (!isBGFetchBusy (onta_fetch_name)) {
+        ONTAFetch *ofp = (ONTAFetch *) calloc (1, sizeof(ONTAFetch));
+        if (!ofp)
+            fatalError ("No memory for ONTA download");
+        (void) startBGFetch (onta_fetch_name, fetchONTA, doneONTA, ofp);
+    }
+
+    return (false);
+}
+
 /* called occsionally to draw ONTA pane in box.
  * return whether io ok.
+ * N.B. onta_spots are refreshed in the background, see ontaReady().
  */
 bool updateOnTheAir (const SBox &box, bool fresh)
 {
@@ -671,9 +723,9 @@ bool updateOnTheAir (const SBox &box, bool fresh)
         loadONTASettings();
     }
 
-    // always update raw onta_spots, but don't transfer to ontawl_spots if scrolled away
+    // raw onta_spots are always fresh, but don't transfer to ontawl_spots if scrolled away
 
-    bool ok = retrieveONTA();
+    bool ok = onta_io_ok;
     if (ok) {
         spots_hash = spotsHash (onta_spots, n_ontaspots);
         if (onta_ss.atNewest()) {
@@ -787,7 +839,7 @@ void drawOnTheAirSpotsOnMap (void)
 bool getClosestOnTheAirSpot (LatLong &ll, DXSpot *onta_closest, LatLong *ll_closest)
 {
     return (ontawl_spots && findPaneForChoice (PLOT_CH_ONTA) != PANE_NONE && getSpotLabelType() != LBL_NONE
-            && getClosestSpot (ontawl_spots, onta_ss.n_data, NULL, LOME_TXEND, ll, onta_closest, ll_closest));
+            && getClosestSpot (ontawl_spots, onta_ss.n_data, ontawl_grid, NULL, LOME_TXEND, ll, onta_closest, ll_closest));
 }
 
 /* return spot in our pane if under ms 
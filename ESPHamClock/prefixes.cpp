@@ -7,7 +7,7 @@
 #include "HamClock.h"
 
 
-/* prefixes are cached with fast radix access
+/* prefixes are cached in a trie with fast radix access to its first level, and recent calls in a small memo.
  */
 
 static char cty_page[] = "/cty/cty_wt_mod-ll-dxcc.txt";         // web page to download
@@ -16,14 +16,35 @@ static char cty_fn[] = "cty-ll-dxcc.txt";                       // local cache c
 typedef struct {
     char call[MAX_SPOTCALL_LEN];                // mostly prefixes, a few calls; sorted ala strcmp
     float lat_d, lng_d;                         // +N +E degrees
-    int call_len;                               // handy strlen(call)
     int dxcc;                                   // DXCC number
 } CtyLoc;
 static CtyLoc *cty_list;                        // malloced list
 static int n_cty, n_malloc;                     // n entries used, n malloced
+
+// one trie node per distinct leading portion of a cty_list call
+typedef struct {
+    int child;                                  // cty_trie index of first next character, else -1
+    int sibling;                                // cty_trie index of next alternative, ascending c, else -1
+    int cty_i;                                  // cty_list index of call ending here, else -1
+    char c;                                     // this character
+} CtyNode;
+static CtyNode *cty_trie;                       // malloced trie
+static int n_trie, n_trie_malloc;               // n nodes used, n malloced
 #define _N_RADIX ('Z' - '0' + 1)                // radix range, 
-static int cty_radix[_N_RADIX];                 // table of cty_list index from first character
-static char prev_radix;                         // used to detect change in radis index
+static int cty_radix[_N_RADIX];                 // cty_trie index of each first character, else -1
+
+// memo of recent call lookups, N_CTYMEMO_WAYS entries for each hash so least recently used is replaced
+typedef struct {
+    char call[NV_CALLSIGN_LEN];                 // call as given, "" if unused
+    char dx_call[NV_CALLSIGN_LEN];              // its dx portion from splitCallSign()
+    int cty_i;                                  // cty_list index of its best match, else -1
+    uint32_t used;                              // memo_clock when last used
+} CtyMemo;
+#define N_CTYMEMO_SETS  256                     // n hash sets
+#define N_CTYMEMO_WAYS  4                       // entries per set
+static CtyMemo cty_memo[N_CTYMEMO_SETS][N_CTYMEMO_WAYS];
+static uint32_t memo_clock;                     // lookup counter for LRU
+
 static time_t next_refresh;                     // time of next download
 #define MAX_CTY_AGE     (1*24*3600)             // normally update city file this often, secs
 #define MIN_CTY_SIZ     800000                  // min believable file size
@@ -674,35 +695,65 @@ static const SmallPrefix small_prefs[] = {
 #define N_SMALLPREFS NARRAY(small_prefs)
 
 
+// spatial index of small_prefs, ids are indices
+static LLGrid small_prefs_grid;
+
+// state while visiting candidates for ll2Prefix()
+typedef struct {
+    const LatLong *llp;                                 // target
+    float coslat;                                       // handy cos of target lat
+    float mind;                                         // min linear degree separation so far
+    int closest_smpref;                                 // small_prefs index of closest entry, else -1
+} ClosestPrefix;
+
+/* LLGridVisitor for ll2Prefix(), ties go to lowest index as in a linear search.
+ */
+static void visitClosestPrefix (int i, void *arg)
+{
+    ClosestPrefix &cp = *(ClosestPrefix *)arg;
+
+    // use simple linear approx
+    float dlat = fabsf (cp.llp->lat_d - 0.01F * small_prefs[i].lat);
+    if (dlat <= cp.mind) {                              // dont bother adding dlng if already > mind
+        float dlng = cp.coslat * fabsf (lngDiff (cp.llp->lng_d - 0.01F * small_prefs[i].lng));
+        float d = dlat + dlng;
+        if (d < cp.mind || (d == cp.mind && i < cp.closest_smpref)) {
+            cp.mind = d;
+            cp.closest_smpref = i;
+        }
+    }
+}
+
 /* find nearest small_prefs to the given LL, if within allowed max
  * N.B. tried cty but it has way too many weird ones, eg it finds AX? instead of VK? and lots of
  *   parochial US calls. Don't try it!
  */
 bool ll2Prefix (const LatLong &ll, char prefix[MAX_PREF_LEN])
 {
-    // scan for closest location -- use simple linear approx
-    float mind = 1e10;                                  // min linear degree separation so far
-    float coslat = cosf(ll.lat);                        // handy
-    uint16_t closest_smpref = 0;                        // small_prefs index of closest entry
-    for (int i = 0; i < N_SMALLPREFS; i++) {
-        float dlat = fabsf (ll.lat_d - 0.01F * small_prefs[i].lat);
-        if (dlat < mind) {                              // dont bother adding dlng if already > mind
-            float dlng = coslat * fabsf (lngDiff (ll.lng_d - 0.01F * small_prefs[i].lng));
-            float d = dlat + dlng;
-            if (d < mind) {
-                mind = d;
-                closest_smpref = i;
-            }
+    // index once
+    if (!small_prefs_grid.filled) {
+        for (int i = 0; i < N_SMALLPREFS; i++) {
+            LatLong pll;
+            pll.lat_d = 0.01F * small_prefs[i].lat;
+            pll.lng_d = 0.01F * small_prefs[i].lng;
+            pll.normalize();
+            addLLGrid (small_prefs_grid, pll, i);
         }
+        small_prefs_grid.filled = true;
     }
 
+    // scan for closest location but only those within MAX_DIST can qualify
+    ClosestPrefix cp = {&ll, cosf(ll.lat), 1e10, -1};
+    float dlng = cp.coslat > MAX_DIST/180.0F ? MAX_DIST / cp.coslat : 180;
+    visitLLGrid (small_prefs_grid, ll, MAX_DIST, dlng, visitClosestPrefix, &cp);
+
     // fail if too far away
-    if (mind > MAX_DIST)
+    if (cp.closest_smpref < 0 || cp.mind > MAX_DIST)
         return (false);
 
     // save in prefix[] as legitimate string
     memset (prefix, 0, MAX_PREF_LEN);
-    memcpy (prefix, small_prefs[closest_smpref].pref, SMALL_PREF_LEN);
+    memcpy (prefix, small_prefs[cp.closest_smpref].pref, SMALL_PREF_LEN);
 
     // good
     return (true);
@@ -819,9 +870,75 @@ static void initCty(void)
     cty_list = NULL;
     n_cty = 0;
     n_malloc = 0;
+
+    if (cty_trie)
+        free (cty_trie);
+    cty_trie = NULL;
+    n_trie = 0;
+    n_trie_malloc = 0;
+    for (int i = 0; i < _N_RADIX; i++)
+        cty_radix[i] = -1;
+
+    memset (cty_memo, 0, sizeof(cty_memo));
+}
+
+/* add a fresh trie node for c, return its cty_trie index
+ */
+static int newCtyNode (char c, int sibling)
+{
+    if (n_trie + 1 > n_trie_malloc) {
+        cty_trie = (CtyNode *) realloc (cty_trie, (n_trie_malloc += 1000) * sizeof(CtyNode));
+        if (!cty_trie)
+            fatalError ("No memory for cty trie %d\n", n_trie_malloc);
+    }
+    CtyNode &n = cty_trie[n_trie];
+    n.child = -1;
+    n.sibling = sibling;
+    n.cty_i = -1;
+    n.c = c;
+    return (n_trie++);
 }
 
-/* crack and add another line to cty_list
+/* add cty_list[cty_i] to the trie
+ */
+static void addCtyTrie (int cty_i)
+{
+    const char *call = cty_list[cty_i].call;
+
+    // first character is found directly
+    int radix_index = call[0] - '0';
+    if (radix_index < 0 || radix_index >= _N_RADIX)
+        fatalError ("cty radix out of range %d %d", radix_index, _N_RADIX);
+    if (cty_radix[radix_index] < 0)
+        cty_radix[radix_index] = newCtyNode (call[0], -1);
+    int node = cty_radix[radix_index];
+
+    // walk down from there adding nodes as needed, keeping each sibling list sorted by c.
+    // N.B. cty_trie may move with each newCtyNode() so use only indices
+    for (const char *cp = call+1; *cp != '\0'; cp++) {
+        int prev = -1;
+        int next = cty_trie[node].child;
+        while (next >= 0 && cty_trie[next].c < *cp) {
+            prev = next;
+            next = cty_trie[next].sibling;
+        }
+        if (next < 0 || cty_trie[next].c != *cp) {
+            int new_node = newCtyNode (*cp, next);
+            if (prev < 0)
+                cty_trie[node].child = new_node;
+            else
+                cty_trie[prev].sibling = new_node;
+            next = new_node;
+        }
+        node = next;
+    }
+
+    // first one wins if duplicated
+    if (cty_trie[node].cty_i < 0)
+        cty_trie[node].cty_i = cty_i;
+}
+
+/* crack and add another line to cty_list and its trie
  */
 static void addCtyLine (char *line)
 {
@@ -842,21 +959,13 @@ static void addCtyLine (char *line)
         if (!cty_list)
             fatalError ("No memory for cty location list %d\n", n_malloc);
     }
-    cl.call_len = strlen(cl.call);
     cty_list[n_cty++] = cl;
 
-    // update radix index when first char changes
-    if (cl.call[0] != prev_radix) {
-        int radix_index = cl.call[0] - '0';
-        if (radix_index < 0 || radix_index >= _N_RADIX)
-            fatalError ("cty radix out of range %d %d", radix_index, _N_RADIX);
-        cty_radix[radix_index] = n_cty - 1;
-        prev_radix = cl.call[0];
-        // printf ("********* radix %c %5d %5d\n",cl.call[0], radix_index, radix[radix_index]);
-    }
+    // and to trie
+    addCtyTrie (n_cty - 1);
 }
 
-/* insure cty_lst and its supporting radix index are ready to use, even if stale if no other way.
+/* insure cty_list and its supporting trie are ready to use, even if stale if no other way.
  * use local file but if absent or too old try to download.
  * return whether cty_list is ready.
  */
@@ -884,37 +993,75 @@ static bool loadCtyFile(void)
     // done
     fclose (fp);
     next_refresh = myNow() + MAX_CTY_AGE;
-    Serial.printf ("CTY: loaded %d locations from %s\n", n_cty, cty_fn);
+    Serial.printf ("CTY: loaded %d locations from %s in %d trie nodes\n", n_cty, cty_fn, n_trie);
 
     // real question is whether cty_list exists
     return (cty_list != NULL);
 }
 
-/* search for best CtyLoc for the given prefix.
+/* search for best CtyLoc for the given prefix, ie, the longest cty_list call that starts prefix.
  * return pointer else NULL
  */
 static const CtyLoc *searchCty (const char *prefix)
 {
-    // start at radix then find longest cty_list call entry that starts with prefix.
-    const CtyLoc *candidate = NULL;
     int radix_index = prefix[0] - '0';
-    if (radix_index >= 0 && radix_index < _N_RADIX) {
-        int start = cty_radix[radix_index];
-        int len_match = 0;                              // find longest match
-        for (int i = start; i < n_cty; i++) {           // start at this radix, go to end or next radix
-            const CtyLoc *cp = &cty_list[i];
-            if (cp->call[0] != prefix[0])
-                break;                                  // end of this radix
-            if (strncmp (cp->call, prefix, cp->call_len) == 0) {
-                int cc_len = strlen(cp->call);
-                if (cc_len > len_match) {
-                    len_match = cc_len;
-                    candidate = cp;
-                    if (debugLevel (DEBUG_CTY, 1))
-                        Serial.printf ("CTY: match for %s now %s length %d\n", prefix, cp->call, len_match);
-                }
-            }
+    if (radix_index < 0 || radix_index >= _N_RADIX)
+        return (NULL);
+
+    // walk down the trie as far as prefix goes, the deepest call along the way is the longest match
+    const CtyLoc *candidate = NULL;
+    int node = cty_radix[radix_index];
+    for (const char *pp = prefix; node >= 0; ) {
+        const CtyNode &n = cty_trie[node];
+        if (n.cty_i >= 0) {
+            candidate = &cty_list[n.cty_i];
+            if (debugLevel (DEBUG_CTY, 1))
+                Serial.printf ("CTY: match for %s now %s length %d\n", prefix, candidate->call,
+                                        (int)(pp - prefix + 1));
+        }
+        if (*++pp == '\0')
+            break;
+        for (node = n.child; node >= 0 && cty_trie[node].c < *pp; node = cty_trie[node].sibling)
+            continue;
+        if (node >= 0 && cty_trie[node].c != *pp)
+            node = -1;
+    }
+
+    return (candidate);
+}
+
+/* find the best CtyLoc for the given call, passing back its dx portion too.
+ * recent calls are remembered in cty_memo.
+ * return pointer else NULL
+ */
+static const CtyLoc *findCty (const char *call, char dx_call[NV_CALLSIGN_LEN])
+{
+    // check the memo set for this call, noting the least recently used in case it is not there
+    CtyMemo *set = cty_memo[stringHash(call) % N_CTYMEMO_SETS];
+    CtyMemo *lru = &set[0];
+    memo_clock++;
+    for (int i = 0; i < N_CTYMEMO_WAYS; i++) {
+        CtyMemo &m = set[i];
+        if (m.used && strcmp (m.call, call) == 0) {
+            m.used = memo_clock;
+            strcpy (dx_call, m.dx_call);
+            return (m.cty_i >= 0 ? &cty_list[m.cty_i] : NULL);
         }
+        if (m.used < lru->used)
+            lru = &m;
+    }
+
+    // use the dx end of a portable call
+    char home_call[NV_CALLSIGN_LEN];
+    splitCallSign (call, home_call, dx_call);
+    const CtyLoc *candidate = searchCty (dx_call);
+
+    // remember unless too long to match again
+    if (strlen (call) < NV_CALLSIGN_LEN) {
+        strcpy (lru->call, call);
+        strcpy (lru->dx_call, dx_call);
+        lru->cty_i = candidate ? candidate - cty_list : -1;
+        lru->used = memo_clock;
     }
 
     return (candidate);
@@ -931,9 +1078,8 @@ bool call2LL (const char *call, LatLong &ll)
         return (false);
 
     // use the dx end of a portable call
-    char home_call[NV_CALLSIGN_LEN];
     char dx_call[NV_CALLSIGN_LEN];
-    splitCallSign (call, home_call, dx_call);
+    const CtyLoc *candidate = findCty (call, dx_call);
 
     // require a digit if 3 or more chars
     if (strlen(dx_call) >= 3 && !strHasDigit(dx_call)) {
@@ -941,8 +1087,6 @@ bool call2LL (const char *call, LatLong &ll)
         return (false);
     }
 
-    const CtyLoc *candidate = searchCty (dx_call);
-
     if (candidate) {
         ll.lat_d = candidate->lat_d;
         ll.lng_d = candidate->lng_d;
@@ -968,11 +1112,8 @@ bool call2DXCC (const char *call, int &dxcc)
         return (false);
 
     // use the dx end of a portable call
-    char home_call[NV_CALLSIGN_LEN];
     char dx_call[NV_CALLSIGN_LEN];
-    splitCallSign (call, home_call, dx_call);
-
-    const CtyLoc *candidate = searchCty (dx_call);
+    const CtyLoc *candidate = findCty (call, dx_call);
 
     if (candidate) {
         dxcc = candidate->dxcc;
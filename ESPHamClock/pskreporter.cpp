@@ -23,6 +23,7 @@ static const char rbn_page[] PROGMEM = "/fetchRBN.pl";
 // private state
 static DXSpot *reports;                         // malloced list of all reports, not just TST_PSKBAND
 static int n_reports;                           // count of reports used in psk_bands, might be < n_malloced
+static LLGrid reports_grid;                     // spatial index of reports
 static int n_malloced;                          // total n malloced in reports[]
 static int spot_maxrpt[HAMBAND_N];              // indices into reports[] for the farthest spot per band
 static PSKBandStats bstats[HAMBAND_N];          // band stats
@@ -218,29 +219,37 @@ static void drawPSKPane (const SBox &box)
     tft.print (label);
 }
 
-/* retrieve spots into reports[] according to current settings.
- * return whether io ok.
+/* one background download of PSK reports.
+ */
+typedef struct {
+    char query[100];                            // page with query
+    char de_maid[MAID_CHARLEN];                 // DE grid, used as tx_grid for RBN
+    bool isrbn;                                 // whether query is for RBN
+    DXSpot *spots;                              // malloced spots with grids and band checked
+    int n_spots;                                // n spots[] in use
+    int n_malloced;                             // n spots[] malloced
+} PSKFetch;
+
+static const char psk_fetch_name[] = "PSK";     // background fetch name
+static char psk_query[100];                     // query used for reports[]
+static LatLong psk_de_ll;                       // DE used for bstats[] distances
+static time_t psk_next_update;                  // when reports[] should be refreshed
+static bool psk_io_ok;                          // whether latest download was ok
+
+/* build the query that would retrieve spots according to the current settings.
  */
-static bool retrievePSK (void)
+static void buildPSKQuery (char query[], size_t query_len, char de_maid[MAID_CHARLEN])
 {
-    // get fresh
-    WiFiClient psk_client;
-    bool ok = false;
-
-    // query type
     bool ispsk = (psk_mask & PSKMB_SRCMASK) == PSKMB_PSK;
     bool iswspr = (psk_mask & PSKMB_SRCMASK) == PSKMB_WSPR;
-    bool isrbn = (psk_mask & PSKMB_SRCMASK) == PSKMB_RBN;
     bool use_call = (psk_mask & PSKMB_CALL) != 0;
     bool of_de = (psk_mask & PSKMB_OFDE) != 0;
 
-    // handy 4x DE maid if needed
-    char de_maid[MAID_CHARLEN];
+    // get DE maidenhead
     getNVMaidenhead (NV_DE_GRID, de_maid);
     de_maid[4] = '\0';
 
     // build query
-    char query[100];
     if (ispsk)
         strcpy_P (query, psk_page);
     else if (iswspr)
@@ -248,19 +257,30 @@ static bool retrievePSK (void)
     else
         strcpy_P (query, rbn_page);
     int qlen = strlen (query);
-    snprintf (query+qlen, sizeof(query)-qlen, "?%s%s=%s&maxage=%d",
+    snprintf (query+qlen, query_len-qlen, "?%s%s=%s&maxage=%d",
                                         of_de ? "of" : "by",
                                         use_call ? "call" : "grid",
                                         use_call ? getCallsign() : de_maid,
                                         psk_maxage_mins*60 /* wants seconds */);
-    Serial.printf ("PSK: query: %s\n", query);
+}
+
+/* BGFetchFP to download spots for PSKFetch *data.
+ * N.B. runs on a fetch thread so the remaining checks that use shared state are left for donePSK().
+ * return whether io ok.
+ */
+static bool fetchPSK (void *data)
+{
+    PSKFetch &pf = *(PSKFetch *)data;
+    WiFiClient psk_client;
+    bool ok = false;
+
+    Serial.printf ("PSK: query: %s\n", pf.query);
 
-    // fetch and fill reports[]
+    // fetch and fill spots[]
     if (psk_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
-        httpHCGET (psk_client, backend_host, query);
+        httpHCGET (psk_client, backend_host, pf.query);
 
         // skip header
         if (!httpSkipHeader (psk_client)) {
@@ -271,11 +291,6 @@ static bool retrievePSK (void)
         // consider io ok
         ok = true;
 
-        // reset lists
-        n_reports = 0;
-        for (int i = 0; i < HAMBAND_N; i++)
-            bstats[i] = {};
-
         // read lines -- anything unexpected is considered an error message
         char line[100];
         while (getTCPLine (psk_client, line, sizeof(line), NULL)) {
@@ -311,8 +326,8 @@ static bool retrievePSK (void)
             new_sp.kHz = Hz_temp * 1e-3F;
 
             // RBN does not provide tx_grid but it must be us. N.B. this will be blank from rbndaemon
-            if (isrbn)
-                strcpy (new_sp.tx_grid, de_maid);
+            if (pf.isrbn)
+                strcpy (new_sp.tx_grid, pf.de_maid);
 
             // convert grids to ll
             if (!maidenhead2ll (new_sp.tx_ll, new_sp.tx_grid)) {
@@ -325,72 +340,103 @@ static bool retrievePSK (void)
             }
 
             // check for unknown or unsupported band
-            const HamBandSetting band = findHamBand (new_sp.kHz);
-            if (band == HAMBAND_NONE) {
+            if (findHamBand (new_sp.kHz) == HAMBAND_NONE) {
                 Serial.printf ("PSK: band? %s\n", line);
                 continue;
             }
 
-            // DXCC
-            if (!call2DXCC (new_sp.tx_call, new_sp.tx_dxcc)) {
-                Serial.printf ("PSK: no DXCC for %s\n", new_sp.tx_call);
-                continue;
-            }
-            if (!call2DXCC (new_sp.rx_call, new_sp.rx_dxcc)) {
-                Serial.printf ("PSK: no DXCC for %s\n", new_sp.rx_call);
-                continue;
+            // save, grow array if out of room
+            if ( !(pf.n_spots < pf.n_malloced) ) {
+                pf.spots = (DXSpot *) realloc (pf.spots, (pf.n_malloced += 100) * sizeof(DXSpot));
+                if (!pf.spots)
+                    fatalError ("Live Spots: no mem %d", pf.n_malloced);
             }
+            pf.spots[pf.n_spots++] = new_sp;
+        }
 
-            // update stats for this band
-            PSKBandStats &pbs = bstats[band];
+    } else
+        Serial.print ("PSK: Spots connection failed\n");
 
-            // update count of this band
-            pbs.count++;
+out:
 
-            // dither ll for unique selection
-            ditherLL (new_sp.tx_ll);
-            ditherLL (new_sp.rx_ll);
+    psk_client.stop();
 
-            // finally! save new report, grow array if out of room
-            if ( !(n_reports < n_malloced) ) {
-                reports = (DXSpot *) realloc (reports, (n_malloced += 100) * sizeof(DXSpot));
-                if (!reports)
-                    fatalError ("Live Spots: no mem %d", n_malloced);
-            }
-            reports[n_reports] = new_sp;         // N.B. do not inc yet, used last
-
-            // check each end for farthest from DE
-            float tx_dist, rx_dist, bearing;        
-            propDEPath (false, new_sp.tx_ll, &tx_dist, &bearing);
-            propDEPath (false, new_sp.rx_ll, &rx_dist, &bearing);
-            tx_dist *= KM_PER_MI * ERAD_M;                         // convert core angle to surface km
-            rx_dist *= KM_PER_MI * ERAD_M;                         // convert core angle to surface km
-            bool tx_gt_rx = (tx_dist > rx_dist);
-            float max_dist = tx_gt_rx ? tx_dist : rx_dist;
-            if (max_dist > pbs.maxkm) {
-
-                // update pbs for this band with farther spot
-                LatLong max_ll = tx_gt_rx ? new_sp.tx_ll : new_sp.rx_ll;
-                const char *call = tx_gt_rx ? new_sp.tx_call : new_sp.rx_call;
-                pbs.maxkm = max_dist;
-                pbs.maxll = max_ll;
-                if (getSpotLabelType() == LBL_PREFIX)
-                    findCallPrefix (call, pbs.maxcall);
-                else
-                    strcpy (pbs.maxcall, call);
-
-                // newest spot is now farthest for this band
-                spot_maxrpt[band] = n_reports;
-            }
+    return (ok);
+}
 
-            // ok, another report
-            n_reports++;
+/* BGDoneFP to install the spots downloaded by fetchPSK() into reports[] and bstats[].
+ */
+static void donePSK (void *data, bool ok)
+{
+    PSKFetch *pfp = (PSKFetch *)data;
+
+    // reset lists
+    n_reports = 0;
+    resetLLGrid (reports_grid);
+    for (int i = 0; i < HAMBAND_N; i++)
+        bstats[i] = {};
+
+    // add each with known DXCC, finding the farthest in each band
+    for (int i = 0; ok && i < pfp->n_spots; i++) {
+        DXSpot &new_sp = pfp->spots[i];
+
+        // DXCC
+        if (!call2DXCC (new_sp.tx_call, new_sp.tx_dxcc)) {
+            Serial.printf ("PSK: no DXCC for %s\n", new_sp.tx_call);
+            continue;
+        }
+        if (!call2DXCC (new_sp.rx_call, new_sp.rx_dxcc)) {
+            Serial.printf ("PSK: no DXCC for %s\n", new_sp.rx_call);
+            continue;
         }
 
-    } else
-        Serial.print ("PSK: Spots connection failed\n");
+        // update stats for this band, already known to be valid
+        const HamBandSetting band = findHamBand (new_sp.kHz);
+        PSKBandStats &pbs = bstats[band];
+
+        // update count of this band
+        pbs.count++;
+
+        // dither ll for unique selection
+        ditherLL (new_sp.tx_ll);
+        ditherLL (new_sp.rx_ll);
+
+        // finally! save new report, grow array if out of room
+        if ( !(n_reports < n_malloced) ) {
+            reports = (DXSpot *) realloc (reports, (n_malloced += 100) * sizeof(DXSpot));
+            if (!reports)
+                fatalError ("Live Spots: no mem %d", n_malloced);
+        }
+        reports[n_reports] = new_sp;         // N.B. do not inc yet, used last
+
+        // check each end for farthest from DE
+        float tx_dist, rx_dist, bearing;
+        propDEPath (false, new_sp.tx_ll, &tx_dist, &bearing);
+        propDEPath (false, new_sp.rx_ll, &rx_dist, &bearing);
+        tx_dist *= KM_PER_MI * ERAD_M;                         // convert core angle to surface km
+        rx_dist *= KM_PER_MI * ERAD_M;                         // convert core angle to surface km
+        bool tx_gt_rx = (tx_dist > rx_dist);
+        float max_dist = tx_gt_rx ? tx_dist : rx_dist;
+        if (max_dist > pbs.maxkm) {
+
+            // update pbs for this band with farther spot
+            LatLong max_ll = tx_gt_rx ? new_sp.tx_ll : new_sp.rx_ll;
+            const char *call = tx_gt_rx ? new_sp.tx_call : new_sp.rx_call;
+            pbs.maxkm = max_dist;
+            pbs.maxll = max_ll;
+            if (getSpotLabelType() == LBL_PREFIX)
+                findCallPrefix (call, pbs.maxcall);
+            else
+                strcpy (pbs.maxcall, call);
+
+            // newest spot is now farthest for this band
+            spot_maxrpt[band] = n_reports;
+        }
+
+        // ok, another report
+        n_reports++;
+    }
 
-out:
     // reset counts if trouble
     if (!ok) {
         n_reports = 0;
@@ -400,51 +446,53 @@ out:
         }
     }
 
-    // finish up
-    psk_client.stop();
-    Serial.printf ("PSK: found %d %s reports %s %s\n",
-                        n_reports,
-                        (ispsk ? "PSK" : (iswspr ? "WSPR" : "RBN")),
-                        of_de ? "of" : "by",
-                        use_call ? getCallsign() : de_maid);
+    Serial.printf ("PSK: found %d reports for %s\n", n_reports, pfp->query);
 
-    // already logged any problems
-    return (ok);
+    // record what reports[] now hold and when to refresh
+    strcpy (psk_query, pfp->query);
+    psk_de_ll = de_ll;
+    psk_io_ok = ok;
+    psk_next_update = ok ? myNow() + PSK_INTERVAL : nextWiFiRetry (PLOT_CH_PSK);
+
+    free (pfp->spots);
+    free (pfp);
 }
 
-/* query PSK reporter etc for new reports, draw results and return whether all ok
+/* return whether reports[] are current for the current settings and may be drawn.
+ * if not, start downloading them in the background if not already.
  */
-bool updatePSKReporter (const SBox &box, bool force)
+bool pskReady (void)
 {
-    // save last retrieval settings to know whether reports[] can be reused
-    static time_t next_update;                          // don't update faster than PSK_INTERVAL
-    static uint8_t my_psk_mask;                         // setting used for reports[]
-    static uint32_t my_psk_bands;                       // setting used for reports[]
-    static uint16_t my_psk_maxage_mins;                 // setting used for reports[]
-    static bool last_ok;                                // used to force retry
-
-    // just use cache if settings all match and not too old
-    if (!force && last_ok && reports && n_malloced > 0 && myNow() < next_update
-                            && my_psk_mask == psk_mask && my_psk_maxage_mins == psk_maxage_mins
-                            && my_psk_bands == psk_bands) {
-        drawPSKPane (box);
+    char query[sizeof(psk_query)];
+    char de_maid[MAID_CHARLEN];
+    buildPSKQuery (query, sizeof(query), de_maid);
+
+    // ready if current and made with the same query from the same DE
+    if (myNow() < psk_next_update && strcmp (query, psk_query) == 0
+                        && psk_de_ll.lat_d == de_ll.lat_d && psk_de_ll.lng_d == de_ll.lng_d)
         return (true);
-    }
 
-    // save settings
-    my_psk_mask = psk_mask;
-    my_psk_maxage_mins = psk_maxage_mins;
-    my_psk_bands = psk_bands;
-    next_update = myNow() + PSK_INTERVAL;;
+    // start another unless one is already underway
+    if (!isBGFetchBusy (psk_fetch_name)) {
+        PSKFetch *pfp = (PSKFetch *) calloc (1, sizeof(PSKFetch));
+        if (!pfp)
+            fatalError ("Live Spots: no mem for query");
+        strcpy (pfp->query, query);
+        strcpy (pfp->de_maid, de_maid);
+        pfp->isrbn = (psk_mask & PSKMB_SRCMASK) == PSKMB_RBN;
+        (void) startBGFetch (psk_fetch_name, fetchPSK, donePSK, pfp);
+    }
 
-    // get fresh
-    last_ok = retrievePSK();
+    return (false);
+}
 
-    // display whatever we got regardless
+/* draw reports[] in the PSK pane and return whether the latest download was ok.
+ * N.B. reports[] are refreshed in the background, see pskReady().
+ */
+bool updatePSKReporter (const SBox &box)
+{
     drawPSKPane (box);
-
-    // reply
-    return (last_ok);
+    return (psk_io_ok);
 }
 
 /* check for tap at s known to be within a PLOT_CH_PSK box.
@@ -605,8 +653,9 @@ bool checkPSKTouch (const SCoord &s, const SBox &box)
             // persist
             savePSKState();
 
-            // refresh with new criteria
-            updatePSKReporter (box, true);
+            // show new criteria now, fresh reports follow from the background
+            drawPSKPane (box);
+            scheduleNewPlot (PLOT_CH_PSK);
         }
     }
 
@@ -688,6 +737,13 @@ void drawPSKPaths ()
     }
 }
 
+/* SpotFilter for spots in displayed bands
+ */
+static bool pskBandOk (const DXSpot *sp)
+{
+    return (TST_PSKBAND(findHamBand(sp->kHz)));
+}
+
 /* report spot closest to ll and which end to mark on map, if any within MAX_CSR_DIST.
  */
 bool getClosestPSK (LatLong &ll, DXSpot *sp, LatLong *mark_ll)
@@ -723,29 +779,10 @@ bool getClosestPSK (LatLong &ll, DXSpot *sp, LatLong *mark_ll)
     
     } else {
 
-        // check all spots in displayed ham_bands.
-        // N.B. can't use getClosestSpot() because of TST_PSKBAND
+        // check all spots in displayed ham_bands
 
-        float min_d = 0;
-        int min_i = -1;
-        for (int i = 0; i < n_reports; i++) {
-            DXSpot &s = reports[i];
-            if (TST_PSKBAND(findHamBand(s.kHz))) {
-                float d = ll.GSD(s.rx_ll);
-                if (min_i < 0 || d < min_d) {
-                    min_d = d;
-                    min_i = i;
-                }
-                d = ll.GSD(s.tx_ll);
-                if (min_i < 0 || d < min_d) {
-                    min_d = d;
-                    min_i = i;
-                }
-            }
-        }
-
-        if (min_i >= 0 && min_d*ERAD_M < MAX_CSR_DIST) {
-            *sp = reports[min_i];
+        LatLong closest_ll;
+        if (getClosestSpot (reports, n_reports, reports_grid, pskBandOk, LOME_BOTH, ll, sp, &closest_ll)) {
             *mark_ll = of_de ? sp->rx_ll : sp->tx_ll;
             return (true);
         }
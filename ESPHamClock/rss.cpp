@@ -17,24 +17,31 @@ static char *rss_tapurl;                        // malloced URL if tapped, if an
 static uint8_t rss_ntitles, rss_title_i;        // n titles and rolling index
 static time_t rss_next;                         // when to retrieve next set
 
-/* download more RSS titles.
+/* one background download of RSS titles
+ */
+typedef struct {
+    char *titles[RSS_MAXN];                     // malloced titles
+    uint8_t n_titles;                           // n titles[] in use
+} RSSFetch;
+
+static const char rss_fetch_name[] = "RSS";     // background fetch name
+static bool rss_arrived;                        // set when a download is ready to show
+static bool rss_io_ok;                          // whether the latest download was ok
+
+/* BGFetchFP to download more RSS titles into RSSFetch *data.
  * return whether io ok, even if no new titles.
  */
-static bool retrieveRSS (void)
+static bool fetchRSS (void *data)
 {
     // prep
+    RSSFetch &rf = *(RSSFetch *)data;
     WiFiClient rss_client;
     char line[256];
     bool ok = false;
 
-    // reset count and index
-    rss_ntitles = rss_title_i = 0;
-
     Serial.println(rss_page);
     if (rss_client.connect(backend_host, backend_port)) {
 
-        updateClocks(false);
-
         // fetch feed page
         httpHCGET (rss_client, backend_host, rss_page);
 
@@ -47,14 +54,12 @@ static bool retrieveRSS (void)
         // io ok
         ok = true;
 
-        // get up to RSS_MAXN more rss_titles[]
-        for (rss_ntitles = 0; rss_ntitles < RSS_MAXN; rss_ntitles++) {
+        // get up to RSS_MAXN more titles[]
+        for (rf.n_titles = 0; rf.n_titles < RSS_MAXN; rf.n_titles++) {
             if (!getTCPLine (rss_client, line, sizeof(line), NULL))
                 goto out;
-            if (rss_titles[rss_ntitles])
-                free (rss_titles[rss_ntitles]);
-            rss_titles[rss_ntitles] = strdup (line);
-            // Serial.printf ("RSS[%d] len= %d\n", rss_ntitles, strlen(rss_titles[rss_ntitles]));
+            rf.titles[rf.n_titles] = strdup (line);
+            // Serial.printf ("RSS[%d] len= %d\n", rf.n_titles, strlen(rf.titles[rf.n_titles]));
         }
     }
 
@@ -65,6 +70,48 @@ static bool retrieveRSS (void)
     return (ok);
 }
 
+/* BGDoneFP to replace rss_titles[] with those downloaded by fetchRSS() and show them now.
+ */
+static void doneRSS (void *data, bool ok)
+{
+    RSSFetch *rfp = (RSSFetch *)data;
+
+    // discard if no longer wanted
+    if (!rss_on || rss_local) {
+        for (int i = 0; i < rfp->n_titles; i++)
+            free (rfp->titles[i]);
+        free (rfp);
+        return;
+    }
+
+    // replace
+    for (int i = 0; i < RSS_MAXN; i++) {
+        free (rss_titles[i]);
+        rss_titles[i] = i < rfp->n_titles ? rfp->titles[i] : NULL;
+    }
+    rss_ntitles = rfp->n_titles;
+    rss_title_i = 0;
+    free (rfp);
+
+    // show now
+    rss_io_ok = ok;
+    rss_arrived = true;
+    scheduleRSSNow();
+}
+
+/* start downloading more RSS titles in the background unless already underway.
+ */
+static void startRSSFetch (void)
+{
+    if (isBGFetchBusy (rss_fetch_name))
+        return;
+
+    RSSFetch *rfp = (RSSFetch *) calloc (1, sizeof(RSSFetch));
+    if (!rfp)
+        fatalError ("No memory for RSS");
+    (void) startBGFetch (rss_fetch_name, fetchRSS, doneRSS, rfp);
+}
+
 /* display next RSS feed item if on, retrieving more as needed.
  * if local always return true, else return whether retrieval io was ok.
  */
@@ -78,16 +125,27 @@ static bool updateRSS (void)
                 rss_titles[rss_ntitles] = NULL;
             }
         }
+        rss_arrived = false;
+        return (true);
+    }
+
+    // note whether doneRSS() just refilled rss_titles[]
+    bool arrived = rss_arrived;
+    rss_arrived = false;
+
+    // refill rss_titles[] from network in the background if empty and wanted, meanwhile leave banner as is
+    if (!rss_local && rss_title_i >= rss_ntitles && !arrived) {
+        startRSSFetch();
         return (true);
     }
 
-    // prepare background to show life before possibly lengthy net update
+    // prepare background
     fillSBox (rss_bnr_b, RSS_BG_COLOR);
     tft.drawLine (rss_bnr_b.x, rss_bnr_b.y, rss_bnr_b.x+rss_bnr_b.w, rss_bnr_b.y, GRAY);
 
-    // fill rss_titles[] from network if empty and wanted
-    if (!rss_local && rss_title_i >= rss_ntitles) {
-        bool ok = retrieveRSS();
+    // check the new download
+    if (arrived) {
+        bool ok = rss_io_ok;
 
         // display err msg if still no rss_titles
         if (!ok || rss_ntitles == 0) {
@@ -77,6 +77,15 @@ static const char *sdo_file[SDOT_N] = {
 #define _SDO_ROT_INIT   10
 static uint8_t sdo_choice, sdo_rotating = _SDO_ROT_INIT; // rot is always 0 or 1, init with anything else
 
+// one background download, owned by the job until doneSDO()
+typedef struct {
+    uint8_t choice;                             // sdo_choice when queued
+    char path[1000];                            // local file
+    char *bmp;                                  // malloced copy of the downloaded BMP file
+    long n_bmp;                                 // bytes in bmp
+} SDOFetch;
+static const char sdo_fetch_name[] = "SDO";
+
 /* save image choice and whether rotating to nvram
  */
 static void saveSDOChoice (void)
@@ -114,7 +123,6 @@ static bool retrieveSDO (const char *fn, const char *save_fn)
 
     Serial.println (url);
     if (client.connect(backend_host, backend_port)) {
-        updateClocks(false);
     
         // query web page
         httpHCGET (client, backend_host, url);
@@ -144,10 +152,128 @@ static bool retrieveSDO (const char *fn, const char *save_fn)
     return (ok);
 }
 
-/* render sdo_choice, downloading fresh if not found or stale.
+/* draw the az/el and next rise or set of the sun at DE in the corners of box, layout similar to moon
+ */
+static void drawSDOInfo (const SBox &box)
+{
+    // current user's time
+    time_t t0 = nowWO();
+
+    // fresh info at user's effective time
+    getSolarCir (t0, de_ll, solar_cir);
+
+    // draw corners, similar to moon
+
+    char str[128];
+    selectFontStyle (LIGHT_FONT, FAST_FONT);
+    tft.setTextColor (DE_COLOR);
+
+    snprintf (str, sizeof(str), "Az:%.0f", rad2deg(solar_cir.az));
+    tft.setCursor (box.x+1, box.y+2);
+    tft.print (str);
+
+    snprintf (str, sizeof(str), "El:%.0f", rad2deg(solar_cir.el));
+    tft.setCursor (box.x+box.w-getTextWidth(str)-1, box.y+2);
+    tft.print (str);
+
+    // show which ever rise or set event comes next
+    time_t rise, set;
+    int detz = getTZ (de_tz);
+    getSolarRS (t0, de_ll, &rise, &set);
+    if (rise > t0 && (set < t0 || rise - t0 < set - t0))
+        snprintf (str, sizeof(str), "R@%02d:%02d", hour(rise+detz), minute (rise+detz));
+    else if (set > t0 && (rise < t0 || set - t0 < rise - t0))
+        snprintf (str, sizeof(str), "S@%02d:%02d", hour(set+detz), minute (set+detz));
+    else
+        strcpy (str, "No R/S");
+    tft.setCursor (box.x+1, box.y+box.h-10);
+    tft.print (str);
+
+    snprintf (str, sizeof(str), "%.0fm/s", solar_cir.vel);;
+    tft.setCursor (box.x+box.w-getTextWidth(str)-1, box.y+box.h-10);
+    tft.print (str);
+}
+
+/* render the BMP image from gr in box with info on top.
  * use plotMessage if error.
  * return whether ok.
  */
+static bool drawSDOBMP (GenReader &gr, const SBox &box)
+{
+    Message ynot;
+    if (!installBMPBox (gr, box, FIT_CROP, ynot)) {
+        plotMessage (box, SDO_COLOR, ynot.get());
+        return (false);
+    }
+    drawSDOInfo (box);
+    return (true);
+}
+
+/* BGFetchFP to download the image for sfp->choice then read the whole file into sfp->bmp.
+ */
+static bool fetchSDO (void *data)
+{
+    SDOFetch *sfp = (SDOFetch *)data;
+    const char *fn = sdo_file[sfp->choice];
+
+    if (!retrieveSDO (fn, sfp->path))
+        return (false);
+
+    FILE *fp = fopen (sfp->path, "r");
+    if (!fp) {
+        Serial.printf ("SDO: %s: %s\n", sfp->path, strerror(errno));
+        return (false);
+    }
+
+    struct stat sbuf;
+    bool ok = fstat (fileno(fp), &sbuf) == 0 && sbuf.st_size > 0;
+    if (ok) {
+        sfp->bmp = (char *) malloc (sbuf.st_size);
+        if (!sfp->bmp)
+            fatalError ("No memory for %ld byte SDO image", (long)sbuf.st_size);
+        sfp->n_bmp = fread (sfp->bmp, 1, sbuf.st_size, fp);
+        ok = sfp->n_bmp == sbuf.st_size;
+    }
+    fclose (fp);
+
+    return (ok);
+}
+
+/* BGDoneFP to draw the image downloaded by fetchSDO() if the SDO pane still wants it.
+ */
+static void doneSDO (void *data, bool ok)
+{
+    SDOFetch *sfp = (SDOFetch *)data;
+
+    if (ok)
+        noteCacheFile (sdo_file[sfp->choice], CC_SDO, true);
+
+    PlotPane pp = findPaneChoiceNow (PLOT_CH_SDO);
+    if (pp != PANE_NONE) {
+        const SBox &box = plot_b[pp];
+        if (sfp->choice != sdo_choice) {
+            // changed while downloading so start over with the new choice
+            scheduleNewPlot (PLOT_CH_SDO);
+        } else {
+            if (ok) {
+                GenReader gr (sfp->bmp, sfp->n_bmp);
+                ok = drawSDOBMP (gr, box);
+            } else
+                plotMessage (box, SDO_COLOR, "SDO download failed");
+            if (!ok)
+                next_update[pp] = nextWiFiRetry (PLOT_CH_SDO);
+        }
+    }
+
+    free (sfp->bmp);
+    free (sfp);
+}
+
+/* render sdo_choice in box now if the local file is fresh, else start downloading it in the background
+ * for doneSDO() to draw when it arrives.
+ * use plotMessage if error.
+ * return whether ok so far.
+ */
 static bool drawSDOImage (const SBox &box)
 {
     // get corresponding file name
@@ -159,33 +285,30 @@ static bool drawSDOImage (const SBox &box)
     struct stat sbuf;
     bool need_fresh = stat (local_path, &sbuf) < 0 || myNow() > sbuf.st_mtime + SDO_IMG_INTERVAL;
 
-    // assume download bad until proven otherwise
-    bool ok = !need_fresh;
-
-    // download if time to refresh
+    // download in the background if time to refresh
     if (need_fresh) {
-        ok = retrieveSDO (fn, local_path);
-        if (!ok)
-            plotMessage (box, SDO_COLOR, "SDO download failed");
+        if (!isBGFetchBusy (sdo_fetch_name)) {
+            SDOFetch *sfp = (SDOFetch *) calloc (1, sizeof(SDOFetch));
+            if (!sfp)
+                fatalError ("No memory for SDO download");
+            sfp->choice = sdo_choice;
+            quietStrncpy (sfp->path, local_path, sizeof(sfp->path));
+            (void) startBGFetch (sdo_fetch_name, fetchSDO, doneSDO, sfp);
+        }
+        return (true);
     }
 
     // display local file
-    if (ok) {
-        Serial.printf ("reading local %s\n", fn);
-        FILE *fp = fopen (local_path, "r");
-        if (!fp) {
-            plotMessage (box, SDO_COLOR, "local SDO file is missing");
-            ok = false;
-        } else {
-            GenReader gr(fp);
-            Message ynot;
-            if (!installBMPBox (gr, box, FIT_CROP, ynot)) {
-                plotMessage (box, SDO_COLOR, ynot.get());
-                ok = false;
-            }
-            fclose (fp);
-        }
+    Serial.printf ("reading local %s\n", fn);
+    FILE *fp = fopen (local_path, "r");
+    if (!fp) {
+        plotMessage (box, SDO_COLOR, "local SDO file is missing");
+        return (false);
     }
+    GenReader gr(fp);
+    bool ok = drawSDOBMP (gr, box);
+    fclose (fp);
+    noteCacheFile (fn, CC_SDO, false);
 
     return (ok);
 }
@@ -199,7 +322,8 @@ bool isSDORotating(void)
 }
 
 
-/* update SDO pane
+/* update SDO pane.
+ * return whether ok so far, a fresh image is drawn when its download finishes.
  */
 bool updateSDOPane (const SBox &box)
 {
@@ -210,51 +334,8 @@ bool updateSDOPane (const SBox &box)
     }
 
 
-    // draw image
-    bool ok = drawSDOImage(box);
-
-    // draw info if ok, layout similar to moon
-    if (ok) {
-
-        // current user's time
-        time_t t0 = nowWO();
-
-        // fresh info at user's effective time
-        getSolarCir (t0, de_ll, solar_cir);
-
-        // draw corners, similar to moon
-
-        char str[128];
-        selectFontStyle (LIGHT_FONT, FAST_FONT);
-        tft.setTextColor (DE_COLOR);
-
-        snprintf (str, sizeof(str), "Az:%.0f", rad2deg(solar_cir.az));
-        tft.setCursor (box.x+1, box.y+2);
-        tft.print (str);
-
-        snprintf (str, sizeof(str), "El:%.0f", rad2deg(solar_cir.el));
-        tft.setCursor (box.x+box.w-getTextWidth(str)-1, box.y+2);
-        tft.print (str);
-
-        // show which ever rise or set event comes next
-        time_t rise, set;
-        int detz = getTZ (de_tz);
-        getSolarRS (t0, de_ll, &rise, &set);
-        if (rise > t0 && (set < t0 || rise - t0 < set - t0))
-            snprintf (str, sizeof(str), "R@%02d:%02d", hour(rise+detz), minute (rise+detz));
-        else if (set > t0 && (rise < t0 || set - t0 < rise - t0))
-            snprintf (str, sizeof(str), "S@%02d:%02d", hour(set+detz), minute (set+detz));
-        else
-            strcpy (str, "No R/S");
-        tft.setCursor (box.x+1, box.y+box.h-10);
-        tft.print (str);
-
-        snprintf (str, sizeof(str), "%.0fm/s", solar_cir.vel);;
-        tft.setCursor (box.x+box.w-getTextWidth(str)-1, box.y+box.h-10);
-        tft.print (str);
-    }
-
-    return (ok);
+    // draw image, or start downloading it
+    return (drawSDOImage(box));
 }
 
 /* attempt to show the movie for sdo_choice
@@ -27,6 +27,7 @@ static DRAPData drap_cache;
 static XRayData xray_cache;
 static KpData kp_cache;
 static NOAASpaceWxData noaasw_cache = {0, false, {'R', 'S', 'G'}, {}};
+static const char noaasw_cats[N_NOAASW_C] = {'R', 'S', 'G'};
 static AuroraData aurora_cache;
 static DSTData dst_cache;
 
@@ -345,16 +346,13 @@ time_t nextRetrieval (PlotChoice pc, int interval)
 }
 
 
-/* retrieve sun spot and SPCWX_SSN if it's time, else use cache.
+/* download fresh sun spot into fresh and the current SPCWX_SSN into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveSunSpots (SunSpotData &ssn)
+static bool fetchSunSpots (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < ssn_cache.next_update) {
-        ssn = ssn_cache;
-        return (true);
-    }
+    SunSpotData &ssn = *(SunSpotData *)fresh;
 
     // get fresh
     char line[100];
@@ -362,12 +360,10 @@ bool retrieveSunSpots (SunSpotData &ssn)
     bool ok = false;
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_SSN].value_ok = false;
-    ssn.data_ok = ssn_cache.data_ok = false;
+    ssn.data_ok = false;
 
     Serial.println(ssn_page);
     if (ss_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (ss_client, backend_host, ssn_page);
@@ -384,20 +380,16 @@ bool retrieveSunSpots (SunSpotData &ssn)
         // read lines into ssn array and build corresponding time value
         int8_t ssn_i;
         for (ssn_i = 0; ssn_i < SSN_NV && getTCPLine (ss_client, line, sizeof(line), NULL); ssn_i++) {
-            ssn_cache.x[ssn_i] = 1-SSN_NV + ssn_i;
-            ssn_cache.ssn[ssn_i] = atof(line+11);
+            ssn.x[ssn_i] = 1-SSN_NV + ssn_i;
+            ssn.ssn[ssn_i] = atof(line+11);
         }
 
-        updateClocks(false);
-
         // ok if all received
         if (ssn_i == SSN_NV) {
 
             // capture latest
-            space_wx[SPCWX_SSN].value = ssn_cache.ssn[SSN_NV-1];
-            space_wx[SPCWX_SSN].value_ok = true;
-            ssn_cache.data_ok = true;
-            ssn = ssn_cache;
+            value = ssn.ssn[SSN_NV-1];
+            ssn.data_ok = true;
 
         } else {
 
@@ -411,37 +403,19 @@ bool retrieveSunSpots (SunSpotData &ssn)
 
 out:
 
-    // set next update
-    ssn_cache.next_update = ok ? nextRetrieval (PLOT_CH_SSN, SSN_INTERVAL) : nextWiFiRetry(PLOT_CH_SSN);
-
     // clean up
-    updateClocks(false);
     ss_client.stop();
     return (ok);
 }
 
 
-/* return whether new SPCWX_SSN data are ready, even if bad.
- */
-static bool checkForNewSunSpots (void)
-{
-    if (myNow() < ssn_cache.next_update)
-        return (false);
-
-    SunSpotData ssn;
-    return (retrieveSunSpots (ssn));
-}
-
-/* retrieve solar flux and SPCWX_FLUX if it's time, else use cache.
+/* download fresh solar flux into fresh and the current SPCWX_FLUX into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveSolarFlux (SolarFluxData &sf)
+static bool fetchSolarFlux (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < sf_cache.next_update) {
-        sf = sf_cache;
-        return (true);
-    }
+    SolarFluxData &sf = *(SolarFluxData *)fresh;
 
     // get fresh
     char line[120];
@@ -449,12 +423,10 @@ bool retrieveSolarFlux (SolarFluxData &sf)
     bool ok = false;
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_FLUX].value_ok = false;
-    sf.data_ok = sf_cache.data_ok = false;
+    sf.data_ok = false;
 
     Serial.println (sf_page);
     if (sf_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (sf_client, backend_host, sf_page);
@@ -471,20 +443,16 @@ bool retrieveSolarFlux (SolarFluxData &sf)
         // read lines into flux array and build corresponding time value
         int8_t sf_i;
         for (sf_i = 0; sf_i < SFLUX_NV && getTCPLine (sf_client, line, sizeof(line), NULL); sf_i++) {
-            sf_cache.x[sf_i] = (sf_i - (SFLUX_NV-9-1))/3.0F; // 3x(30 days history + 3 days predictions)
-            sf_cache.sflux[sf_i] = atof(line);
+            sf.x[sf_i] = (sf_i - (SFLUX_NV-9-1))/3.0F; // 3x(30 days history + 3 days predictions)
+            sf.sflux[sf_i] = atof(line);
         }
 
-        updateClocks(false);
-
         // ok if found all
         if (sf_i == SFLUX_NV) {
 
             // capture current value (not predictions)
-            space_wx[SPCWX_FLUX].value = sf_cache.sflux[SFLUX_NV-10];
-            space_wx[SPCWX_FLUX].value_ok = true;
-            sf_cache.data_ok = true;
-            sf = sf_cache;
+            value = sf.sflux[SFLUX_NV-10];
+            sf.data_ok = true;
 
         } else {
 
@@ -498,37 +466,19 @@ bool retrieveSolarFlux (SolarFluxData &sf)
 
 out:
 
-    // set next update
-    sf_cache.next_update = ok ? nextRetrieval (PLOT_CH_FLUX, SFLUX_INTERVAL) : nextWiFiRetry (PLOT_CH_FLUX);
-
     // clean up
-    updateClocks(false);
     sf_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_FLUX data are ready, even if bad.
- */
-static bool checkForNewSolarFlux (void)
-{
-    if (myNow() < sf_cache.next_update)
-        return (false);
-
-    SolarFluxData sf;
-    return (retrieveSolarFlux (sf));
-}
-
 
-/* retrieve DRAP and SPCWX_DRAP if it's time, else use cache.
+/* download fresh DRAP into fresh and the current SPCWX_DRAP into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveDRAP (DRAPData &drap)
+static bool fetchDRAP (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < drap_cache.next_update) {
-        drap = drap_cache;
-        return (true);
-    }
+    DRAPData &drap = *(DRAPData *)fresh;
 
     // get fresh
 
@@ -540,18 +490,16 @@ bool retrieveDRAP (DRAPData &drap)
     bool ok = false;                                                    // set iff all ok
 
     // want to find any holes in data so init x values to all 0
-    memset (drap_cache.x, 0, DRAPDATA_NPTS*sizeof(float));
+    memset (drap.x, 0, DRAPDATA_NPTS*sizeof(float));
 
     // want max in each interval so init y values to all 0
-    memset (drap_cache.y, 0, DRAPDATA_NPTS*sizeof(float));
+    memset (drap.y, 0, DRAPDATA_NPTS*sizeof(float));
 
     // mark data as bad until proven otherwise
-    space_wx[SPCWX_DRAP].value_ok = false;
-    drap.data_ok = drap_cache.data_ok = false;
+    drap.data_ok = false;
 
     Serial.println (drap_page);
     if (drap_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (drap_client, backend_host, drap_page);
@@ -589,31 +537,28 @@ bool retrieveDRAP (DRAPData &drap)
                 // Serial.printf ("DRAP: skipping age %g hrs\n", age/3600.0F);
                 continue;
             }
-            drap_cache.x[xi] = age/(-3600.0F);                             // seconds to hours ago
+            drap.x[xi] = age/(-3600.0F);                             // seconds to hours ago
 
             // set in array if larger
-            if (max > drap_cache.y[xi]) {
+            if (max > drap.y[xi]) {
                 // if (y[xi] > 0)
                     // Serial.printf ("DRAP: saw xi %d utime %ld age %d again\n", xi, utime, age);
-                drap_cache.y[xi] = max;
+                drap.y[xi] = max;
             }
 
             // Serial.printf ("DRAP: %3d %6d: %g %g\n", xi, age, x[xi], y[xi]);
         }
         Serial.printf ("DRAP: read %d lines\n", n_lines);
 
-        // look alive
-        updateClocks(false);
-
         // check for missing data
         int n_missing = 0;
         int maxi_good = 0;
         for (int i = 0; i < DRAPDATA_NPTS; i++) {
-            if (drap_cache.x[i] == 0) {
-                drap_cache.x[i] = (DRAPDATA_PERIOD - i*DRAPDATA_PERIOD/DRAPDATA_NPTS)/-3600.0F;
+            if (drap.x[i] == 0) {
+                drap.x[i] = (DRAPDATA_PERIOD - i*DRAPDATA_PERIOD/DRAPDATA_NPTS)/-3600.0F;
                 if (i > 0)
-                    drap_cache.y[i] = drap_cache.y[i-1];                      // fill with previous
-                // Serial.printf ("DRAP: filling missing interval %d at age %g hrs to %g\n", i, drap_cache.x[i], drap_cache.y[i]);
+                    drap.y[i] = drap.y[i-1];                      // fill with previous
+                // Serial.printf ("DRAP: filling missing interval %d at age %g hrs to %g\n", i, drap.x[i], drap.y[i]);
                 n_missing++;
             } else {
                 maxi_good = i;
@@ -631,10 +576,8 @@ bool retrieveDRAP (DRAPData &drap)
         }
 
         // ok! capture current value
-        space_wx[SPCWX_DRAP].value = drap_cache.y[DRAPDATA_NPTS-1];
-        space_wx[SPCWX_DRAP].value_ok = true;
-        drap_cache.data_ok = true;
-        drap = drap_cache;
+        value = drap.y[DRAPDATA_NPTS-1];
+        drap.data_ok = true;
 
     } else {
 
@@ -643,37 +586,18 @@ bool retrieveDRAP (DRAPData &drap)
 
 out:
 
-    // set next update
-    drap_cache.next_update = ok ? nextRetrieval (PLOT_CH_DRAP, DRAPPLOT_INTERVAL)
-                                : nextWiFiRetry (PLOT_CH_DRAP);
-
     // clean up
-    updateClocks(false);
     drap_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_DRAP data are ready, even if bad.
- */
-bool checkForNewDRAP ()
-{
-    if (myNow() < drap_cache.next_update)
-        return (false);
-
-    DRAPData drap;
-    return (retrieveDRAP (drap));
-}
-
-/* retrieve Kp and SPCWX_KP if it's time, else use cache.
+/* download fresh Kp into fresh and the current SPCWX_KP into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveKp (KpData &kp)
+static bool fetchKp (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < kp_cache.next_update) {
-        kp = kp_cache;
-        return (true);
-    }
+    KpData &kp = *(KpData *)fresh;
 
     // get fresh
     WiFiClient kp_client;                               // wifi client connection
@@ -682,12 +606,10 @@ bool retrieveKp (KpData &kp)
     bool ok = false;                                    // set if no network errors
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_KP].value_ok = false;
-    kp.data_ok = kp_cache.data_ok = false;
+    kp.data_ok = false;
 
     Serial.println(kp_page);
     if (kp_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (kp_client, backend_host, kp_page);
@@ -704,18 +626,16 @@ bool retrieveKp (KpData &kp)
         // read lines into kp array and build x
         const int now_i = KP_NHD*KP_VPD-1;              // last historic is now
         for (kp_i = 0; kp_i < KP_NV && getTCPLine (kp_client, line, sizeof(line), NULL); kp_i++) {
-            kp_cache.x[kp_i] = (kp_i-now_i)/(float)KP_VPD;
-            kp_cache.p[kp_i] = atof(line);
+            kp.x[kp_i] = (kp_i-now_i)/(float)KP_VPD;
+            kp.p[kp_i] = atof(line);
         }
 
         // record sw
         if (kp_i == KP_NV) {
 
             // save current (not last!) value
-            space_wx[SPCWX_KP].value = kp_cache.p[now_i];
-            space_wx[SPCWX_KP].value_ok = true;
-            kp_cache.data_ok = true;
-            kp = kp_cache;
+            value = kp.p[now_i];
+            kp.data_ok = true;
 
         } else {
 
@@ -729,36 +649,18 @@ bool retrieveKp (KpData &kp)
 
 out:
 
-    // set next update
-    kp_cache.next_update = ok ? nextRetrieval (PLOT_CH_KP, KP_INTERVAL) : nextWiFiRetry(PLOT_CH_KP);
-
     // clean up
-    updateClocks(false);
     kp_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_KP data are ready, even if bad.
- */
-static bool checkForNewKp (void)
-{
-    if (myNow() < kp_cache.next_update)
-        return (false);
-
-    KpData kp;
-    return (retrieveKp (kp));
-}
-
-/* retrieve DST and SPCWX_DST if it's time, else use cache.
+/* download fresh DST into fresh and the current SPCWX_DST into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveDST (DSTData &dst)
+static bool fetchDST (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < dst_cache.next_update) {
-        dst = dst_cache;
-        return (true);
-    }
+    DSTData &dst = *(DSTData *)fresh;
 
     // get fresh
     WiFiClient dst_client;                              // wifi client connection
@@ -766,12 +668,10 @@ bool retrieveDST (DSTData &dst)
     bool ok = false;                                    // set if no network errors
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_DST].value_ok = false;
-    dst.data_ok = dst_cache.data_ok = false;
+    dst.data_ok = false;
 
     Serial.println(dst_page);
     if (dst_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (dst_client, backend_host, dst_page);
@@ -805,18 +705,16 @@ bool retrieveDST (DSTData &dst)
                 break;
             }
 
-            dst_cache.age_hrs[dst_i] = age_hrs;
-            dst_cache.values[dst_i] = atof(line + 19);
+            dst.age_hrs[dst_i] = age_hrs;
+            dst.values[dst_i] = atof(line + 19);
         }
 
         // record sw
         if (dst_i == DST_NV) {
 
             // save current (not last!) value
-            space_wx[SPCWX_DST].value = dst_cache.values[DST_NV-1];
-            space_wx[SPCWX_DST].value_ok = true;
-            dst_cache.data_ok = true;
-            dst = dst_cache;
+            value = dst.values[DST_NV-1];
+            dst.data_ok = true;
 
         } else {
 
@@ -830,36 +728,18 @@ bool retrieveDST (DSTData &dst)
 
 out:
 
-    // set next update
-    dst_cache.next_update = ok ? nextRetrieval (PLOT_CH_DST, DST_INTERVAL) : nextWiFiRetry(PLOT_CH_DST);
-
     // clean up
-    updateClocks(false);
     dst_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_DST data are ready, even if bad.
- */
-static bool checkForNewDST (void)
-{
-    if (myNow() < dst_cache.next_update)
-        return (false);
-
-    DSTData dst;
-    return (retrieveDST (dst));
-}
-
-/* retrieve XRay and SPCWX_XRAY if it's time, else use cache.
+/* download fresh XRay into fresh and the current SPCWX_XRAY into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveXRay (XRayData &xray)
+static bool fetchXRay (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < xray_cache.next_update) {
-        xray = xray_cache;
-        return (true);
-    }
+    XRayData &xray = *(XRayData *)fresh;
 
     // get fresh
     WiFiClient xray_client;
@@ -868,12 +748,10 @@ bool retrieveXRay (XRayData &xray)
     bool ok = false;
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_XRAY].value_ok = false;
-    xray.data_ok = xray_cache.data_ok = false;
+    xray.data_ok = false;
 
     Serial.println(xray_page);
     if (xray_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (xray_client, backend_host, xray_page);
@@ -898,17 +776,17 @@ bool retrieveXRay (XRayData &xray)
                 float s = atof(line+35);
                 if (s <= 0)                             // missing values are set to -1.00e+05, also guard 0
                     s = 1e-9;
-                xray_cache.s[xray_i] = log10f(s);
+                xray.s[xray_i] = log10f(s);
 
                 // long
                 float l = atof(line+47);
                 if (l <= 0)                             // missing values are set to -1.00e+05, also guard 0
                     l = 1e-9;
-                xray_cache.l[xray_i] = log10f(l);
+                xray.l[xray_i] = log10f(l);
                 raw_lxray = l;                          // last one will be current
 
                 // time in hours back from 0
-                xray_cache.x[xray_i] = (xray_i-XRAY_NV)/6.0;       // 6 entries per hour
+                xray.x[xray_i] = (xray_i-XRAY_NV)/6.0;       // 6 entries per hour
 
                 // good
                 xray_i++;
@@ -919,10 +797,8 @@ bool retrieveXRay (XRayData &xray)
         if (xray_i == XRAY_NV) {
 
             // capture
-            space_wx[SPCWX_XRAY].value = raw_lxray;
-            space_wx[SPCWX_XRAY].value_ok = true;
-            xray_cache.data_ok = true;
-            xray = xray_cache;
+            value = raw_lxray;
+            xray.data_ok = true;
 
 
         } else {
@@ -937,36 +813,18 @@ bool retrieveXRay (XRayData &xray)
 
 out:
 
-    // set next update
-    xray_cache.next_update = ok ? nextRetrieval (PLOT_CH_XRAY, XRAY_INTERVAL) : nextWiFiRetry(PLOT_CH_XRAY);
-
     // clean up
-    updateClocks(false);
     xray_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_XRAY data are ready, even if bad.
- */
-static bool checkForNewXRay (void)
-{
-    if (myNow() < xray_cache.next_update)
-        return (false);
-
-    XRayData xray;
-    return (retrieveXRay (xray));
-}
-
-/* retrieve BzBt data and SPCWX_BZBT if it's time, else use cache.
+/* download fresh BzBt data into fresh and the current SPCWX_BZ into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveBzBt (BzBtData &bzbt)
+static bool fetchBzBt (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < bzbt_cache.next_update) {
-        bzbt = bzbt_cache;
-        return (true);
-    }
+    BzBtData &bzbt = *(BzBtData *)fresh;
 
     // get fresh
     int bzbt_i;                                     // next index to use
@@ -976,12 +834,10 @@ bool retrieveBzBt (BzBtData &bzbt)
     time_t t0 = myNow();
 
     // mark data as bad until proven otherwise
-    space_wx[SPCWX_BZ].value_ok = false;
-    bzbt.data_ok = bzbt_cache.data_ok = false;
+    bzbt.data_ok = false;
 
     Serial.println(bzbt_page);
     if (bzbt_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (bzbt_client, backend_host, bzbt_page);
@@ -1011,31 +867,29 @@ bool retrieveBzBt (BzBtData &bzbt)
             }
 
             // store at bzbt_i
-            bzbt_cache.bz[bzbt_i] = this_bz;
-            bzbt_cache.bt[bzbt_i] = this_bt;
+            bzbt.bz[bzbt_i] = this_bz;
+            bzbt.bt[bzbt_i] = this_bt;
 
             // time in hours back from now but clamp at 0 in case we are slightly late
-            bzbt_cache.x[bzbt_i] = unix < t0 ? (unix - t0)/3600.0 : 0;
+            bzbt.x[bzbt_i] = unix < t0 ? (unix - t0)/3600.0 : 0;
 
             // n read
             bzbt_i++;
         }
 
         // proceed iff we found all and current
-        if (bzbt_i == BZBT_NV && bzbt_cache.x[BZBT_NV-1] > -0.25F) {
+        if (bzbt_i == BZBT_NV && bzbt.x[BZBT_NV-1] > -0.25F) {
 
             // capture latest
-            space_wx[SPCWX_BZ].value = bzbt_cache.bz[BZBT_NV-1];
-            space_wx[SPCWX_BZ].value_ok = true;
-            bzbt_cache.data_ok = true;
-            bzbt = bzbt_cache;
+            value = bzbt.bz[BZBT_NV-1];
+            bzbt.data_ok = true;
 
         } else {
 
             if (bzbt_i < BZBT_NV)
                 Serial.printf ("BZBT: data short %d of %d\n", bzbt_i, BZBT_NV);
             else
-                Serial.printf ("BZBT: data %g hrs old\n", -bzbt_cache.x[BZBT_NV-1]);
+                Serial.printf ("BZBT: data %g hrs old\n", -bzbt.x[BZBT_NV-1]);
         }
 
     } else {
@@ -1045,36 +899,19 @@ bool retrieveBzBt (BzBtData &bzbt)
 
 out:
 
-    // set next update
-    bzbt_cache.next_update = ok ? nextRetrieval (PLOT_CH_BZBT, BZBT_INTERVAL) : nextWiFiRetry(PLOT_CH_BZBT);
-
     // clean up
-    updateClocks(false);
     bzbt_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_BZBT data are ready, even if bad.
- */
-static bool checkForNewBzBt(void)
-{
-    if (myNow() < bzbt_cache.next_update)
-        return (false);
-    BzBtData bzbt;
-    return (retrieveBzBt (bzbt));
-}
 
-
-/* retrieve solar wind and SPCWX_SOLWIND if it's time, else use cache.
+/* download fresh solar wind into fresh and the current SPCWX_SOLWIND into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveSolarWind(SolarWindData &sw)
+static bool fetchSolarWind (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < sw_cache.next_update) {
-        sw = sw_cache;
-        return (true);
-    }
+    SolarWindData &sw = *(SolarWindData *)fresh;
 
     // get fresh
     WiFiClient swind_client;
@@ -1082,12 +919,10 @@ bool retrieveSolarWind(SolarWindData &sw)
     bool ok = false;
 
     // mark value as bad until proven otherwise
-    space_wx[SPCWX_SOLWIND].value_ok = false;
-    sw.data_ok = sw_cache.data_ok = false;
+    sw.data_ok = false;
 
     Serial.println (swind_page);
     if (swind_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (swind_client, backend_host, swind_page);
@@ -1106,7 +941,7 @@ bool retrieveSolarWind(SolarWindData &sw)
         time_t start_t = t0 - SWIND_PER;
         time_t prev_unixs = 0;
         float max_y = 0;
-        for (sw_cache.n_values = 0; sw_cache.n_values < SWIND_MAXN
+        for (sw.n_values = 0; sw.n_values < SWIND_MAXN
                                                 && getTCPLine (swind_client, line, sizeof(line), NULL); ) {
             // Serial.printf ("SolWind: %3d: %s\n", nsw, line);
             long unixs;         // unix seconds
@@ -1125,30 +960,26 @@ bool retrieveSolarWind(SolarWindData &sw)
                 max_y = this_y;
 
             // skip until find within period and new interval or always included last
-            if ((unixs < start_t || unixs - prev_unixs < SWIND_DT) && sw_cache.n_values != SWIND_MAXN-1)
+            if ((unixs < start_t || unixs - prev_unixs < SWIND_DT) && sw.n_values != SWIND_MAXN-1)
                 continue;
             prev_unixs = unixs;
 
             // want x axis to be hours back from now
-            sw_cache.x[sw_cache.n_values] = (t0 - unixs)/(-3600.0F);
-            sw_cache.y[sw_cache.n_values] = max_y;
+            sw.x[sw.n_values] = (t0 - unixs)/(-3600.0F);
+            sw.y[sw.n_values] = max_y;
             // Serial.printf ("SolWind: %3d %5.2f %5.2f\n", nsw, x[nsw], y[nsw]);
 
             // good one
             max_y = 0;
-            sw_cache.n_values++;
+            sw.n_values++;
         }
 
-        updateClocks(false);
-
         // good iff found enough
-        if (sw_cache.n_values >= SWIND_MINN) {
+        if (sw.n_values >= SWIND_MINN) {
 
             // capture latest
-            space_wx[SPCWX_SOLWIND].value = sw_cache.y[sw_cache.n_values-1];
-            space_wx[SPCWX_SOLWIND].value_ok = true;
-            sw_cache.data_ok = true;
-            sw = sw_cache;
+            value = sw.y[sw.n_values-1];
+            sw.data_ok = true;
 
         } else {
             Serial.println ("SolWind:: data error");
@@ -1161,37 +992,18 @@ bool retrieveSolarWind(SolarWindData &sw)
 
 out:
 
-    // set next update
-    sw_cache.next_update = ok ? nextRetrieval (PLOT_CH_SOLWIND, SWIND_INTERVAL)
-                              : nextWiFiRetry(PLOT_CH_SOLWIND);
-
     // clean up
-    updateClocks(false);
     swind_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_SOLWIND data are ready, even if bad.
- */
-static bool checkForNewSolarWind (void)
-{
-    if (myNow() < sw_cache.next_update)
-        return (false);
-
-    SolarWindData sw;
-    return (retrieveSolarWind (sw));
-}
-
-/* retrieve NOAA space weather indices and SPCWX_NOAASPW if it's time, else use cache.
+/* download fresh NOAA space weather indices into fresh and the current SPCWX_NOAASPW into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
+static bool fetchNOAASWx (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < noaasw_cache.next_update) {
-        noaasw = noaasw_cache;
-        return (true);
-    }
+    NOAASpaceWxData &noaasw = *(NOAASpaceWxData *)fresh;
 
     // expecting 3 reply lines of the following form, anything else is an error message
     //  R  0 0 0 0
@@ -1203,16 +1015,14 @@ bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
     bool ok = false;
 
     // mark data as bad until proven otherwise
-    space_wx[SPCWX_NOAASPW].value_ok = false;
-    noaasw.data_ok = noaasw_cache.data_ok = false;
+    noaasw.data_ok = false;
+    memcpy (noaasw.cat, noaasw_cats, sizeof(noaasw.cat));
 
     // read scales
     Serial.println(noaaswx_page);
     char line[100];
     if (noaaswx_client.connect(backend_host, backend_port)) {
 
-        updateClocks(false);
-
         // fetch page
         httpHCGET (noaaswx_client, backend_host, noaaswx_page);
 
@@ -1236,7 +1046,7 @@ bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
                 // Serial.printf ("NOAA: %d %s\n", i, line);
 
                 // category in first char must match
-                if (noaasw_cache.cat[i] != line[0]) {
+                if (noaasw.cat[i] != line[0]) {
                     Serial.printf ("NOAASW: invalid class: %s\n", line);
                     goto out;
                 }
@@ -1247,7 +1057,7 @@ bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
 
                     // convert next int
                     char *endptr;
-                    noaasw_cache.val[i][j] = strtol (lp, &endptr, 10);
+                    noaasw.val[i][j] = strtol (lp, &endptr, 10);
                     if (lp == endptr) {
                         Serial.printf ("NOAASW: invalid line: %s\n", line);
                         goto out;
@@ -1255,17 +1065,15 @@ bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
                     lp = endptr;
 
                     // find max
-                    if (noaasw_cache.val[i][j] > noaasw_max)
-                        noaasw_max = noaasw_cache.val[i][j];
+                    if (noaasw.val[i][j] > noaasw_max)
+                        noaasw_max = noaasw.val[i][j];
                 }
 
             }
 
             // values ok
-            space_wx[SPCWX_NOAASPW].value = noaasw_max;
-            space_wx[SPCWX_NOAASPW].value_ok = true;
-            noaasw_cache.data_ok = true;
-            noaasw = noaasw_cache;
+            value = noaasw_max;
+            noaasw.data_ok = true;
 
         } else {
             Serial.println ("NOAASW: header short");
@@ -1279,37 +1087,19 @@ bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
 
 out:
 
-    // set next update
-    noaasw_cache.next_update = ok ? nextRetrieval (PLOT_CH_NOAASPW, NOAASPW_INTERVAL)
-                                  : nextWiFiRetry(PLOT_CH_NOAASPW);
-
     // clean up
-    updateClocks(false);
     noaaswx_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_NOAASPW data are ready, even if bad.
- */
-static bool checkForNewNOAASWx (void)
-{
-    if (myNow() < noaasw_cache.next_update)
-        return (false);
-    NOAASpaceWxData noaasw;
-    return (retrieveNOAASWx(noaasw));
-}
-
 
-/* retrieve aurora and SPCWX_AURORA if it's time, else use cache.
+/* download fresh aurora into fresh and the current SPCWX_AURORA into value.
+ * N.B. may run on a background fetch thread so must touch nothing else.
  * return whether transaction was ok (even if data was not)
  */
-bool retrieveAurora (AuroraData &aurora)
+static bool fetchAurora (void *fresh, float &value)
 {
-    // check cache first
-    if (myNow() < aurora_cache.next_update) {
-        aurora = aurora_cache;
-        return (true);
-    }
+    AuroraData &aurora = *(AuroraData *)fresh;
 
     // get fresh
     WiFiClient aurora_client;                                           // wifi client connection
@@ -1317,12 +1107,10 @@ bool retrieveAurora (AuroraData &aurora)
     bool ok = false;                                                    // set iff all ok
 
     // mark data as bad until proven otherwise
-    space_wx[SPCWX_AURORA].value_ok = false;
-    aurora.data_ok = aurora_cache.data_ok = false;
+    aurora.data_ok = false;
 
     Serial.println (aurora_page);
     if (aurora_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (aurora_client, backend_host, aurora_page);
@@ -1339,7 +1127,7 @@ bool retrieveAurora (AuroraData &aurora)
         // init state
         time_t t_now = myNow();
         float prev_age = 1e10;
-        aurora_cache.n_points = 0;
+        aurora.n_points = 0;
 
         // read lines keep up to AURORA_NPTS newest
         while (getTCPLine (aurora_client, line, sizeof(line), NULL)) {
@@ -1362,36 +1150,31 @@ bool retrieveAurora (AuroraData &aurora)
             prev_age = age;
 
             // add to list, shift out oldest if full
-            if (aurora_cache.n_points == AURORA_MAXPTS) {
-                memmove (&aurora_cache.age_hrs[0], &aurora_cache.age_hrs[1], (AURORA_MAXPTS-1)*sizeof(float));
-                memmove (&aurora_cache.percent[0], &aurora_cache.percent[1], (AURORA_MAXPTS-1)*sizeof(float));
-                aurora_cache.n_points = AURORA_MAXPTS - 1;
+            if (aurora.n_points == AURORA_MAXPTS) {
+                memmove (&aurora.age_hrs[0], &aurora.age_hrs[1], (AURORA_MAXPTS-1)*sizeof(float));
+                memmove (&aurora.percent[0], &aurora.percent[1], (AURORA_MAXPTS-1)*sizeof(float));
+                aurora.n_points = AURORA_MAXPTS - 1;
             }
-            aurora_cache.age_hrs[aurora_cache.n_points] = -age;               // want "ago"
-            aurora_cache.percent[aurora_cache.n_points] = percent;
-            aurora_cache.n_points++;
+            aurora.age_hrs[aurora.n_points] = -age;               // want "ago"
+            aurora.percent[aurora.n_points] = percent;
+            aurora.n_points++;
         }
 
-        // look alive
-        updateClocks(false);
-
         // require at least a few recent
-        if (aurora_cache.n_points < 5) {
-            Serial.printf ("AURORA: only %d points\n", aurora_cache.n_points);
-        } else if (aurora_cache.age_hrs[aurora_cache.n_points-1] <= -1.0F) {
+        if (aurora.n_points < 5) {
+            Serial.printf ("AURORA: only %d points\n", aurora.n_points);
+        } else if (aurora.age_hrs[aurora.n_points-1] <= -1.0F) {
             Serial.printf ("AURORA: newest is too old: %g hrs\n",
-                                -aurora_cache.age_hrs[aurora_cache.n_points-1]);
+                                -aurora.age_hrs[aurora.n_points-1]);
         } else {
 
             // good
-            Serial.printf ("AURORA: found %d points [%g,%g] hrs old\n", aurora_cache.n_points,
-                    -aurora_cache.age_hrs[0], -aurora_cache.age_hrs[aurora_cache.n_points-1]);
+            Serial.printf ("AURORA: found %d points [%g,%g] hrs old\n", aurora.n_points,
+                    -aurora.age_hrs[0], -aurora.age_hrs[aurora.n_points-1]);
 
             // capture newest value for space wx
-            space_wx[SPCWX_AURORA].value = aurora_cache.percent[aurora_cache.n_points-1];
-            space_wx[SPCWX_AURORA].value_ok = true;
-            aurora_cache.data_ok = true;
-            aurora = aurora_cache;
+            value = aurora.percent[aurora.n_points-1];
+            aurora.data_ok = true;
         }
 
     } else {
@@ -1401,45 +1184,223 @@ bool retrieveAurora (AuroraData &aurora)
 
 out:
 
-    // set next update
-    aurora_cache.next_update = ok ? nextRetrieval (PLOT_CH_AURORA, AURORA_INTERVAL)
-                                  : nextWiFiRetry(PLOT_CH_AURORA);
-
     // clean up
-    updateClocks(false);
     aurora_client.stop();
     return (ok);
 }
 
-/* return whether fresh SPCWX_AURORA data are ready, even if bad.
+/* how to download and cache each type of space weather, in SPCWX_t order.
+ * the cache is only changed on the main thread, downloads are made into a separate fresh copy.
+ */
+typedef struct {
+    bool (*fetch)(void *fresh, float &value);   // download into fresh, return whether io ok
+    void *cache;                                // one of the *_cache, all start with next_update, data_ok
+    size_t size;                                // sizeof(*cache)
+    time_t *next_update;                        // &cache->next_update
+    bool *data_ok;                              // &cache->data_ok
+    int interval;                               // routine refresh period, secs
+    bool io_ok;                                 // whether the latest download was ok
+    bool news;                                  // set when cache changes, reset by checkForNewSpaceWx()
+} SpcWxSource;
+#define _SWSRC(f,c,i) {f, &c, sizeof(c), &c.next_update, &c.data_ok, i, false, false}
+static SpcWxSource spcwx_src[SPCWX_N] = {
+    _SWSRC (fetchSunSpots,  ssn_cache,    SSN_INTERVAL),
+    _SWSRC (fetchXRay,      xray_cache,   XRAY_INTERVAL),
+    _SWSRC (fetchSolarFlux, sf_cache,     SFLUX_INTERVAL),
+    _SWSRC (fetchKp,        kp_cache,     KP_INTERVAL),
+    _SWSRC (fetchSolarWind, sw_cache,     SWIND_INTERVAL),
+    _SWSRC (fetchDRAP,      drap_cache,   DRAPPLOT_INTERVAL),
+    _SWSRC (fetchBzBt,      bzbt_cache,   BZBT_INTERVAL),
+    _SWSRC (fetchNOAASWx,   noaasw_cache, NOAASPW_INTERVAL),
+    _SWSRC (fetchAurora,    aurora_cache, AURORA_INTERVAL),
+    _SWSRC (fetchDST,       dst_cache,    DST_INTERVAL),
+};
+#undef _SWSRC
+
+/* one background download of a space weather source
+ */
+typedef struct {
+    SPCWX_t sw;                                 // which space_wx
+    float value;                                // new space_wx value
+    void *fresh;                                // malloced download buffer
+} SpcWxFetch;
+
+/* install a fresh download of the given space weather into its cache and space_wx.
+ * N.B. main thread only
+ */
+static void acceptSpcWx (SPCWX_t sw, const void *fresh, float value, bool ok)
+{
+    SpcWxSource &src = spcwx_src[sw];
+    SpaceWeather_t &swx = space_wx[sw];
+
+    // data and data_ok come along with the copy
+    memcpy (src.cache, fresh, src.size);
+    swx.value_ok = *src.data_ok;
+    if (swx.value_ok)
+        swx.value = value;
+
+    // schedule next
+    src.io_ok = ok;
+    *src.next_update = ok ? nextRetrieval (swx.pc, src.interval) : nextWiFiRetry (swx.pc);
+    src.news = true;
+}
+
+
+/* BGFetchFP to download a space weather source on a fetch thread
+ */
+static bool bgFetchSpcWx (void *data)
+{
+    SpcWxFetch *fp = (SpcWxFetch *)data;
+    return ((*spcwx_src[fp->sw].fetch) (fp->fresh, fp->value));
+}
+
+/* BGDoneFP to install a space weather source downloaded by bgFetchSpcWx()
+ */
+static void bgDoneSpcWx (void *data, bool ok)
+{
+    SpcWxFetch *fp = (SpcWxFetch *)data;
+    acceptSpcWx (fp->sw, fp->fresh, fp->value, ok);
+    free (fp->fresh);
+    free (fp);
+}
+
+/* start a background refresh of the given space weather if it is stale and not already underway.
+ * return whether cache is current.
+ */
+static bool refreshSpcWx (SPCWX_t sw)
+{
+    SpcWxSource &src = spcwx_src[sw];
+
+    if (myNow() < *src.next_update)
+        return (true);
+
+    const char *name = space_wx[sw].name;
+    if (!isBGFetchBusy (name)) {
+        SpcWxFetch *fp = (SpcWxFetch *) calloc (1, sizeof(SpcWxFetch));
+        void *fresh = calloc (1, src.size);
+        if (!fp || !fresh)
+            fatalError ("No memory for %s download", name);
+        fp->sw = sw;
+        fp->fresh = fresh;
+        (void) startBGFetch (name, bgFetchSpcWx, bgDoneSpcWx, fp);
+    }
+
+    return (false);
+}
+
+/* copy the cached space weather sw into out, starting a background refresh if it is stale.
+ * never waits for the network: panes call spcWxReady() first so the cache is current by the time they
+ * get here; other callers, such as the web server, just report the latest that has arrived.
+ * return whether the latest transaction was ok (even if data was not)
+ */
+static bool retrieveSpcWx (SPCWX_t sw, void *out)
+{
+    SpcWxSource &src = spcwx_src[sw];
+
+    (void) refreshSpcWx (sw);
+
+    memcpy (out, src.cache, src.size);
+    return (src.io_ok);
+}
+
+/* return whether the data for pane choice pc may be drawn without waiting for the network.
+ * if pc shows space weather that is stale, start refreshing it in the background and return false;
+ * the pane should check again later. all other choices are always ready.
+ */
+bool spcWxReady (PlotChoice pc)
+{
+    for (int i = 0; i < SPCWX_N; i++)
+        if (space_wx[i].pc == pc)
+            return (refreshSpcWx ((SPCWX_t)i));
+    return (true);
+}
+
+/* typed retrieveSpcWx() for each source
+ */
+
+bool retrieveSunSpots (SunSpotData &ssn)
+{
+    return (retrieveSpcWx (SPCWX_SSN, &ssn));
+}
+
+bool retrieveSolarFlux (SolarFluxData &sf)
+{
+    return (retrieveSpcWx (SPCWX_FLUX, &sf));
+}
+
+bool retrieveDRAP (DRAPData &drap)
+{
+    return (retrieveSpcWx (SPCWX_DRAP, &drap));
+}
+
+bool retrieveKp (KpData &kp)
+{
+    return (retrieveSpcWx (SPCWX_KP, &kp));
+}
+
+bool retrieveDST (DSTData &dst)
+{
+    return (retrieveSpcWx (SPCWX_DST, &dst));
+}
+
+bool retrieveXRay (XRayData &xray)
+{
+    return (retrieveSpcWx (SPCWX_XRAY, &xray));
+}
+
+bool retrieveBzBt (BzBtData &bzbt)
+{
+    return (retrieveSpcWx (SPCWX_BZ, &bzbt));
+}
+
+bool retrieveSolarWind (SolarWindData &sw)
+{
+    return (retrieveSpcWx (SPCWX_SOLWIND, &sw));
+}
+
+bool retrieveNOAASWx (NOAASpaceWxData &noaasw)
+{
+    return (retrieveSpcWx (SPCWX_NOAASPW, &noaasw));
+}
+
+bool retrieveAurora (AuroraData &aurora)
+{
+    return (retrieveSpcWx (SPCWX_AURORA, &aurora));
+}
+
+/* refresh SPCWX_DRAP in the background if stale.
+ * return whether it has changed since checkForNewSpaceWx() last looked.
+ */
+bool checkForNewDRAP ()
+{
+    (void) refreshSpcWx (SPCWX_DRAP);
+    return (spcwx_src[SPCWX_DRAP].news);
+}
+
+/* refresh SPCWX_AURORA in the background if stale.
+ * return whether it has changed since checkForNewSpaceWx() last looked.
  */
 bool checkForNewAurora ()
 {
-    if (myNow() < aurora_cache.next_update)
-        return (false);
-    AuroraData a;
-    return (retrieveAurora(a));
+    (void) refreshSpcWx (SPCWX_AURORA);
+    return (spcwx_src[SPCWX_AURORA].news);
 }
 
-/* update all space_wx stats but no faster than their respective panes would do.
- * return whether any actually updated.
+/* refresh all space_wx stats in the background but no faster than their respective panes would do.
+ * return whether any have been updated since the previous call.
  */
 bool checkForNewSpaceWx()
 {
-    // check each
-    bool sf = checkForNewSolarFlux();
-    bool kp = checkForNewKp();
-    bool ds = checkForNewDST();
-    bool xr = checkForNewXRay();
-    bool bz = checkForNewBzBt();
-    bool dr = checkForNewDRAP();
-    bool sw = checkForNewSolarWind();
-    bool ss = checkForNewSunSpots();
-    bool na = checkForNewNOAASWx();
-    bool au = checkForNewAurora();
-
-    // check whether any changed
-    bool any_new = sf || ds || kp || xr || bz || dr || sw || ss || na || au;
+    // check each, collecting and resetting news
+    bool any_new = false;
+    for (int i = 0; i < SPCWX_N; i++) {
+        SpcWxSource &src = spcwx_src[i];
+        (void) refreshSpcWx ((SPCWX_t)i);
+        if (src.news) {
+            any_new = true;
+            src.news = false;
+        }
+    }
 
     // if so redo ranking unless Auto
     if (any_new && spcwx_chmask == SPCWX_AUTO)
@@ -4,50 +4,71 @@
 #include "HamClock.h"
 
 
+// state while visiting candidates for getClosestSpot()
+typedef struct {
+    DXSpot *list;                               // list being searched
+    int n_list;                                 // n in list
+    SpotFilter sfp;                             // optional filter
+    LabelOnMapEnd which_end;                    // which end(s) to consider
+    LatLong *from_llp;                          // target location
+    float min_d;                                // closest distance so far, rads
+    int min_id;                                 // grid id of closest so far, else -1
+} ClosestSpot;
+
+/* LLGridVisitor for getClosestSpot(), id is list index * 2 + 1 if tx end.
+ * N.B. ties go to lowest id, same as a linear search through the list checking rx then tx.
+ */
+static void visitClosestSpot (int id, void *arg)
+{
+    ClosestSpot &cs = *(ClosestSpot *)arg;
+
+    int i = id / 2;
+    bool tx_end = (id & 1) != 0;
+    if (i >= cs.n_list)
+        return;
+    if (tx_end ? cs.which_end == LOME_RXEND : cs.which_end == LOME_TXEND)
+        return;
+
+    DXSpot *sp = &cs.list[i];
+    if (cs.sfp && !(*cs.sfp)(sp))
+        return;
+
+    float d = (tx_end ? sp->tx_ll : sp->rx_ll).GSD(*cs.from_llp);
+    if (d < cs.min_d || (d == cs.min_d && id < cs.min_id)) {
+        cs.min_d = d;
+        cs.min_id = id;
+    }
+}
+
 /* find list element, subject to possible filtering, that is closest to ll on the given end(s).
+ * grid is the list owner's index of both ends of each element, filled here if empty. Owner must call
+ * resetLLGrid() whenever list changes.
  * return whether found one within MAX_CSR_DIST.
  */
-bool getClosestSpot (DXSpot *list, int n_list, SpotFilter sfp, LabelOnMapEnd which_end,
+bool getClosestSpot (DXSpot *list, int n_list, LLGrid &grid, SpotFilter sfp, LabelOnMapEnd which_end,
 LatLong &from_ll, DXSpot *closest_sp, LatLong *closest_llp)
 {
-    // linear search -- not worth kdtree etc
-    const DXSpot *min_sp = NULL;   
-    float min_d = 1e10;
-    bool min_is_de = false;         
-    for (int i = 0; i < n_list; i++) {
-
-        DXSpot *sp = &list[i];
-
-        // skip if filtered out
-        if (sfp && !(*sfp)(sp))
-            continue;
-
-        // check RX end if used
-        if (which_end == LOME_RXEND || which_end == LOME_BOTH) {
-            float d = sp->rx_ll.GSD(from_ll);
-            if (d < min_d) {
-                min_d = d;
-                min_sp = sp;
-                min_is_de = true;
-            }
-        }
-
-        // check TX end if used
-        if (which_end == LOME_TXEND || which_end == LOME_BOTH) {
-            float d = sp->tx_ll.GSD(from_ll);
-            if (d < min_d) {
-                min_d = d;
-                min_sp = sp;
-                min_is_de = false;
-            }
+    // (re)fill grid if not current
+    if (!grid.filled || grid.n_pts != 2*n_list) {
+        resetLLGrid (grid);
+        for (int i = 0; i < n_list; i++) {
+            addLLGrid (grid, list[i].rx_ll, 2*i);
+            addLLGrid (grid, list[i].tx_ll, 2*i+1);
         }
+        grid.filled = true;
     }
 
+    // check just those near enough to matter
+    ClosestSpot cs = {list, n_list, sfp, which_end, &from_ll, 1e10, -1};
+    float r_d = rad2deg ((float)MAX_CSR_DIST/ERAD_M) + 0.01F;
+    visitLLGrid (grid, from_ll, r_d, llGridLngRadius (from_ll, r_d), visitClosestSpot, &cs);
+
     // use if close enough
-    if (min_sp && min_d*ERAD_M < MAX_CSR_DIST) {
+    if (cs.min_id >= 0 && cs.min_d*ERAD_M < MAX_CSR_DIST) {
 
         // return ll depending on end
-        *closest_llp = min_is_de ? min_sp->rx_ll : min_sp->tx_ll;
+        const DXSpot *min_sp = &list[cs.min_id/2];
+        *closest_llp = (cs.min_id & 1) ? min_sp->tx_ll : min_sp->rx_ll;
 
         // return spot
         *closest_sp = *min_sp;
@@ -128,31 +149,93 @@ void drawSpotLabelOnMap (DXSpot &spot, LabelOnMapEnd txrx, LabelOnMapDot dot)
         drawSpotTXRXOnMap (spot, LOME_RXEND, dot);
 }
 
-/* draw path if enabled as per setup options.
- * N.B. we don't draw ends or labels; use drawSpotLabelOnMap() for those.
+/* cache of the raw screen segments of each spot path drawn by drawSpotPathOnMap() so steady-state map frames
+ * need no great circle or projection math. each path is found by its SpotPathKey in spot_paths, whose value is
+ * its SpotPathLoc in spot_path_xy. all are discarded when anything in SpotPathsView changes, when
+ * initEarthMap() calls resetSpotPaths() or when spot_path_xy grows past SPOTPATH_MAXSEGS as spots come and go.
  */
-void drawSpotPathOnMap (const DXSpot &spot)
+typedef struct {
+    float rx_lat, rx_lng, tx_lat, tx_lng;       // path ends, rads
+    int raw_pw;                                 // raw line width
+    bool dashed;                                // whether every other segment is skipped
+} SpotPathKey;
+typedef struct {
+    int seg0, n_segs;                           // first segment in spot_path_xy and count
+} SpotPathLoc;
+typedef struct {
+    int proj;                                   // map_proj
+    int zoom, pan_x, pan_y;                     // pan_zoom
+    float de_lat, de_lng;                       // de_ll
+} SpotPathsView;
+#define SPOTPATH_MAXSEGS        200000          // start over if more than this many segments
+static HashSet spot_paths;                      // SpotPathKey -> SpotPathLoc
+static int16_t *spot_path_xy;                   // malloced x0 y0 x1 y1 raw coords of each segment
+static int n_spot_path_segs, n_spot_path_malloced;      // segments used and malloced
+static SpotPathsView spot_paths_view;           // map state when built
+static bool spot_paths_ok;                      // whether spot_paths is built for spot_paths_view
+
+/* discard all cached spot paths, such as after the map layout changes.
+ */
+void resetSpotPaths()
 {
-    // raw line size, unless none
-    int raw_pw = getRawBandPathWidth(spot.kHz);
-    if (raw_pw == 0)
-        return;
+    spot_paths_ok = false;
+}
 
-    // printf ("******** pw %d\n", raw_pw);        // RBF
+/* start the spot path cache over if the map view has changed since it was built or it has grown too large.
+ */
+static void checkSpotPathsView()
+{
+    SpotPathsView view;
+    memset (&view, 0, sizeof(view));                            // N.B. compared with memcmp
+    view.proj = map_proj;
+    view.zoom = pan_zoom.zoom;
+    view.pan_x = pan_zoom.pan_x;
+    view.pan_y = pan_zoom.pan_y;
+    view.de_lat = de_ll.lat;
+    view.de_lng = de_ll.lng;
+
+    if (!spot_paths_ok || memcmp (&view, &spot_paths_view, sizeof(view)) != 0
+                                                || n_spot_path_segs > SPOTPATH_MAXSEGS) {
+        if (spot_paths.key_len == 0)
+            initHashSet (spot_paths, sizeof(SpotPathKey), sizeof(SpotPathLoc));
+        else
+            resetHashSet (spot_paths);
+        n_spot_path_segs = 0;
+        spot_paths_view = view;
+        spot_paths_ok = true;
+    }
+}
 
-    const uint16_t color = getBandColor(spot.kHz);
+/* add one raw segment to spot_path_xy
+ */
+static void addSpotPathSeg (const SCoord &s0, const SCoord &s1)
+{
+    if (n_spot_path_segs == n_spot_path_malloced) {
+        n_spot_path_malloced += 1024;
+        spot_path_xy = (int16_t *) realloc (spot_path_xy, n_spot_path_malloced * 4 * sizeof(int16_t));
+        if (!spot_path_xy)
+            fatalError ("No memory for %d spot path segments", n_spot_path_malloced);
+    }
+    int16_t *xy = &spot_path_xy[4*n_spot_path_segs++];
+    xy[0] = s0.x;
+    xy[1] = s0.y;
+    xy[2] = s1.x;
+    xy[3] = s1.y;
+}
 
-    // draw from rx to tx
+/* append to spot_path_xy each raw segment of the great circle path of spot that should be drawn.
+ */
+static void buildSpotPath (const DXSpot &spot, int raw_pw, bool dashed)
+{
+    // walk from rx to tx
     float slat = sinf (spot.rx_ll.lat);
     float clat = cosf (spot.rx_ll.lat);
     float dist, bear;
     propPath (false, spot.rx_ll, slat, clat, spot.tx_ll, &dist, &bear);
     const int n_step = ((int)ceilf(dist/deg2rad(PATH_SEGLEN))) | 1;     // always odd so both ends are drawn
     const float step = dist/n_step;
-    const bool dashed = getBandPathDashed (spot.kHz);
     SCoord prev_s = {0, 0};                                             // .x == 0 means don't show
 
-
     for (int i = 0; i <= n_step; i++) {                                 // fence posts
         float r = i*step;
         float ca, B;
@@ -162,7 +245,7 @@ void drawSpotPathOnMap (const DXSpot &spot)
         if (prev_s.x > 0) {
             if (segmentSpanOkRaw(prev_s, s, raw_pw)) {
                 if (!dashed || n_step < 7 || (i & 1))
-                    tft.drawLineRaw (prev_s.x, prev_s.y, s.x, s.y, raw_pw, color);
+                    addSpotPathSeg (prev_s, s);
             } else
                s.x = 0;
         }
@@ -170,6 +253,46 @@ void drawSpotPathOnMap (const DXSpot &spot)
     }
 }
 
+/* draw path if enabled as per setup options.
+ * the segments are found once then drawn from spot_paths until the map view changes.
+ * N.B. we don't draw ends or labels; use drawSpotLabelOnMap() for those.
+ */
+void drawSpotPathOnMap (const DXSpot &spot)
+{
+    // raw line size, unless none
+    int raw_pw = getRawBandPathWidth(spot.kHz);
+    if (raw_pw == 0)
+        return;
+
+    // printf ("******** pw %d\n", raw_pw);        // RBF
+
+    const uint16_t color = getBandColor(spot.kHz);
+    const bool dashed = getBandPathDashed (spot.kHz);
+
+    // find segments, building if new
+    checkSpotPathsView();
+    SpotPathKey key;
+    memset (&key, 0, sizeof(key));                              // N.B. compared with memcmp
+    key.rx_lat = spot.rx_ll.lat;
+    key.rx_lng = spot.rx_ll.lng;
+    key.tx_lat = spot.tx_ll.lat;
+    key.tx_lng = spot.tx_ll.lng;
+    key.raw_pw = raw_pw;
+    key.dashed = dashed;
+    SpotPathLoc *lp = (SpotPathLoc *) findHashSet (spot_paths, &key);
+    if (!lp) {
+        int seg0 = n_spot_path_segs;
+        buildSpotPath (spot, raw_pw, dashed);
+        lp = (SpotPathLoc *) putHashSet (spot_paths, &key);
+        lp->seg0 = seg0;
+        lp->n_segs = n_spot_path_segs - seg0;
+    }
+
+    // draw all at once
+    if (lp->n_segs > 0)
+        tft.drawLinesRaw (&spot_path_xy[4*lp->seg0], lp->n_segs, raw_pw, color);
+}
+
 /* draw the given spot in the given pane row with given bg color, known to be visible.
  */
 void drawSpotOnList (const SBox &box, const DXSpot &spot, int row, uint16_t bg_col)
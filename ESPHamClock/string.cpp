@@ -224,14 +224,43 @@ void chompString (char *str)
 
 /* shorten str IN PLACE as needed to be less than maxw pixels wide.
  * return final width in pixels.
+ * widths never shrink as chars are added so binary search for the longest prefix that fits rather than
+ * trimming one char at a time, which costs O(n^2) glyph lookups on long strings.
  */
 uint16_t maxStringW (char *str, uint16_t maxw)
 {
-    uint8_t strl = strlen (str);
-    uint16_t bw = 0;
+    int strl = strlen (str);
+    if (strl == 0)
+        return (0);
+
+    // full length already fits?
+    uint16_t bw = getTextWidth (str);
+    if (bw < maxw)
+        return (bw);
+
+    // longest prefix length in [lo,hi) that fits, lo fits or is 0, hi does not fit
+    int lo = 0, hi = strl;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        char save = str[mid];
+        str[mid] = '\0';
+        bool fits = getTextWidth (str) < maxw;
+        str[mid] = save;
+        if (fits)
+            lo = mid;
+        else
+            hi = mid;
+    }
 
-    while (strl > 0 && (bw = getTextWidth(str)) >= maxw)
-        str[--strl] = '\0';
+    // nothing fits: str becomes empty and we report the width of its first char
+    if (lo == 0) {
+        str[1] = '\0';
+        bw = getTextWidth (str);
+        str[0] = '\0';
+    } else {
+        str[lo] = '\0';
+        bw = getTextWidth (str);
+    }
 
     return (bw);
 }
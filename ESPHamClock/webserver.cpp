@@ -834,6 +834,40 @@ static bool getWiFiLiveStats (WiFiClient &client, char *line, size_t line_len)
     return (true);
 }
 
+/* remote report statistics for each live web connection.
+ */
+static bool getWiFiLiveWeb (WiFiClient &client, char *unused_line, size_t line_len)
+{
+    (void)(unused_line);
+    (void)(line_len);
+
+    // fetch
+    LiveWebStats *stats;
+    int n_stats = getLiveWebStats (&stats);
+
+    // start reply
+    startPlainText (client);
+
+    // heading
+    char buf[200];
+    client.print ("#Address                  Port Codec    Age  FPS   kB/s SendMs RespMs  Updates  Dropped      kB\n");
+
+    // table
+    for (int i = 0; i < n_stats; i++) {
+        LiveWebStats &s = stats[i];
+        snprintf (buf, sizeof(buf), "%-25s %4s %-5s %6ld %4.1f %6.1f %6.1f %6.0f %8lu %8lu %7lu\n",
+                s.addr, s.ro ? "R/O" : "R/W", s.codec, s.age_s, s.fps, s.kbps, s.send_ms, s.resp_ms,
+                s.n_updates, s.n_dropped, s.n_bytes/1000);
+        client.print (buf);
+    }
+    if (n_stats == 0)
+        client.print ("no live web connections\n");
+
+    // done
+    free (stats);
+    return (true);
+}
+
 /* remote report current known set of contests.
  */
 static bool getWiFiContests (WiFiClient &client, char *unused_line, size_t line_len)
@@ -1645,6 +1679,24 @@ static bool getWiFiSys (WiFiClient &client, char *unused_line, size_t line_len)
         client.print (buf);
     }
 
+    // show download cache
+    CacheStats cstats[CC_N];
+    getCacheStats (cstats);
+    long long c_bytes = 0;
+    for (int i = 0; i < CC_N; i++)
+        c_bytes += cstats[i].n_bytes;
+    snprintf (buf, sizeof(buf), "Cache    %.1f of %d MB\n", c_bytes/1e6, cache_budget_mb);
+    client.print (buf);
+    snprintf (buf, sizeof(buf), "%9s%-5s %6s %9s %7s %6s %6s %7s %7s\n", "", "Class", "Files", "MB", "TTL-d",
+                        "Hits", "Downld", "Evicted", "Expired");
+    client.print (buf);
+    for (int i = 0; i < CC_N; i++) {
+        const CacheStats &cs = cstats[i];
+        snprintf (buf, sizeof(buf), "%9s%-5s %6d %9.1f %7ld %6d %6d %7d %7d\n", "", cs.name, cs.n_files,
+                        cs.n_bytes/1e6, cs.ttl/(24*3600L), cs.n_hits, cs.n_downloads, cs.n_evicted, cs.n_expired);
+        client.print (buf);
+    }
+
     // show file system info
     int n_info;
     DSZ_t fs_size, fs_used;
@@ -4303,6 +4355,7 @@ static const CmdTble command_table[] = {
     { "get_gpio?",          getWiFiGPIO,           "pin=MCP&latched=[true,false]" }, // params!
     { "get_livespots.txt ", getWiFiLiveSpots,      "get live spots list" },
     { "get_livestats.txt ", getWiFiLiveStats,      "get live spots statistics" },
+    { "get_liveweb.txt ",   getWiFiLiveWeb,        "get live web connection statistics" },
     { "get_ontheair.txt ",  getWiFiOnTheAir,       "get POTA/SOTA activators" },
     { "get_satellite.txt ", getWiFiSatellite,      "get current sat info" },
     { "get_satellites.txt ",getWiFiAllSatellites,  "get list of all sats" },
@@ -33,6 +33,10 @@ uint16_t bc_powers[] = {1, 5, 10, 50, 100, 500, 1000};
 const int n_bc_powers = NARRAY(bc_powers);
 static const char bc_page[] = "/fetchBandConditions.pl";
 static time_t bc_time;                          // nowWO() when bc_matrix was loaded
+static char bc_query[sizeof(bc_page) + 200];    // query that last loaded bc_matrix
+static char bc_config[100];                     // config line that came with bc_matrix
+static bool bc_io_ok;                           // whether the latest download was ok
+static const char bc_fetch_name[] = "VOACAP";
 BandCdtnMatrix bc_matrix;                       // percentage reliability for each band
 uint16_t bc_power;                              // VOACAP power setting
 float bc_toa;                                   // VOACAP take off angle
@@ -679,12 +683,13 @@ static void checkAutoMap()
     if (!autoMap())
         return;
 
-    DRAPData drap;
-    if (retrieveDRAP(drap) && space_wx[SPCWX_DRAP].value_ok)
+    // use the latest values while any fresh ones are downloading
+    (void) checkForNewDRAP();
+    if (space_wx[SPCWX_DRAP].value_ok)
         doAutoMap (CM_DRAP, space_wx[SPCWX_DRAP].value, DRAP_AUTOMAP_ON, DRAP_AUTOMAP_OFF);
 
-    AuroraData a;
-    if (retrieveAurora(a) && space_wx[SPCWX_AURORA].value_ok)
+    (void) checkForNewAurora();
+    if (space_wx[SPCWX_AURORA].value_ok)
         doAutoMap (CM_AURORA, space_wx[SPCWX_AURORA].value, AURORA_AUTOMAP_ON, AURORA_AUTOMAP_OFF);
 }
 
@@ -772,35 +777,38 @@ char *xrayLevel (char *buf, const SpaceWeather_t &xray)
 }
 
 
-/* retrieve bc_matrix and optional config line underneath PLOT_CH_BC.
- * return whether at least config line was received (even if data was not)
+// one background download, owned by the job until doneBandConditions()
+typedef struct {
+    char query[sizeof(bc_query)];               // query for the current circumstances
+    BandCdtnMatrix matrix;                      // matrix, ok only if complete
+    char config[sizeof(bc_config)];             // config line underneath PLOT_CH_BC
+} BCFetch;
+
+/* build the VOACAP query for the current circumstances and settings.
  */
-static bool retrieveBandConditions (char *config)
+static void buildBCQuery (char *query, size_t q_len)
 {
-    WiFiClient bc_client;
-    bool ok = false;
-
-    // init data unknown
-    bc_matrix.ok = false;
-
-    // start by cleaning cache.
-    // N.B. make sure search string match name we use below
-    (void) cleanCache ("bc-", BC_INTERVAL);
-
-    // build query
     time_t t = nowWO();
-    char query[sizeof(bc_page) + 200];
-    snprintf (query, sizeof(query),
+    snprintf (query, q_len,
         "%s?YEAR=%d&MONTH=%d&RXLAT=%.3f&RXLNG=%.3f&TXLAT=%.3f&TXLNG=%.3f&UTC=%d&PATH=%d&POW=%d&MODE=%d&TOA=%.1f",
         bc_page, year(t), month(t), dx_ll.lat_d, dx_ll.lng_d, de_ll.lat_d, de_ll.lng_d,
         hour(t), show_lp, bc_power, bc_modevalue, bc_toa);
+}
+
+/* BGFetchFP to retrieve bcfp->matrix and config line for bcfp->query.
+ * return whether at least config line was received (even if data was not)
+ */
+static bool fetchBandConditions (void *data)
+{
+    BCFetch *bcfp = (BCFetch *)data;
+    bool ok = false;
 
     // build local cache file name
     char cache_fn[100];
-    snprintf (cache_fn, sizeof(cache_fn), "bc-%010u.txt", stringHash(query)); // N.B. see cleanCache() above
+    snprintf (cache_fn, sizeof(cache_fn), "bc-%010u.txt", stringHash(bcfp->query)); // N.B. see bcReady()
 
     // open cache or get fresh
-    FILE *fp = openCachedFile (cache_fn, query, 12*3600L, 100);
+    FILE *fp = openCachedFile (cache_fn, bcfp->query, 12*3600L, 100);
     if (fp) {
 
         char buf[100];
@@ -811,15 +819,13 @@ static bool retrieveBandConditions (char *config)
             goto out;
         }
 
-        // next line is configuration summary, save if interested
+        // next line is configuration summary
         if (!fgets (buf, sizeof(buf), fp)) {
             Serial.println ("BC: No config line");
             goto out;
         }
-        if (config) {
-            chompString (buf);
-            strcpy (config, buf);
-        }
+        chompString (buf);
+        quietStrncpy (bcfp->config, buf, sizeof(bcfp->config));
 
         // transaction for at least config is ok
         ok = true;
@@ -850,21 +856,18 @@ static bool retrieveBandConditions (char *config)
 
             // add to bc_matrix as integer percent
             for (int c = 0; c < BMTRX_COLS; c++)
-                bc_matrix.m[utc_hr][c] = (uint8_t)(100*rel[c]);
+                bcfp->matrix.m[utc_hr][c] = (uint8_t)(100*rel[c]);
         }
 
         // #define _TEST_BAND_MATRIX
         #if defined(_TEST_BAND_MATRIX)
             for (int r = 0; r < BMTRX_ROWS; r++)                    // time 0 .. 23
                 for (int c = 0; c < BMTRX_COLS; c++)                // band 80 .. 10
-                    bc_matrix.m[r][c] = 100*r*c/BMTRX_ROWS/BMTRX_COLS;
+                    bcfp->matrix.m[r][c] = 100*r*c/BMTRX_ROWS/BMTRX_COLS;
         #endif
 
         // matrix ok
-        bc_matrix.ok = true;
-
-        // finished with file
-        fclose(fp);
+        bcfp->matrix.ok = true;
 
     } else {
         Serial.println ("VOACAP connection failed");
@@ -872,10 +875,64 @@ static bool retrieveBandConditions (char *config)
 
 out:
 
+    // finished with file
+    if (fp)
+        fclose(fp);
+
     // out
     return (ok);
 }
 
+/* BGDoneFP to install the results of fetchBandConditions() in bc_matrix.
+ */
+static void doneBandConditions (void *data, bool ok)
+{
+    BCFetch *bcfp = (BCFetch *)data;
+
+    // matrix is only valid if complete but config line is kept from last time if missing
+    bc_matrix = bcfp->matrix;
+    if (ok)
+        strcpy (bc_config, bcfp->config);
+    bc_matrix.next_update = ok ? nextRetrieval (PLOT_CH_BC, BC_INTERVAL) : nextWiFiRetry(PLOT_CH_BC);
+    bc_io_ok = ok;
+
+    // note query and time of attempt to coordinate with maps
+    strcpy (bc_query, bcfp->query);
+    bc_time = nowWO();
+
+    free (bcfp);
+}
+
+/* return whether bc_matrix is current and may be drawn.
+ * if not, start downloading it in the background if not already.
+ */
+static bool bcReady (void)
+{
+    char query[sizeof(bc_query)];
+    buildBCQuery (query, sizeof(query));
+
+    // ready unless settings changed or out of sync with prop map or it's just been a while
+    if (strcmp (query, bc_query) == 0 && !(CM_PMACTIVE() && tdiff(bc_time,map_time) >= 3600)
+                        && tdiff (nowWO(), bc_time) < 3600 && myNow() < bc_matrix.next_update)
+        return (true);
+
+    // start another unless one is already underway
+    if (!isBGFetchBusy (bc_fetch_name)) {
+
+        // start by cleaning cache.
+        // N.B. make sure search string match name used in fetchBandConditions()
+        (void) cleanCache ("bc-", BC_INTERVAL);
+
+        BCFetch *bcfp = (BCFetch *) calloc (1, sizeof(BCFetch));
+        if (!bcfp)
+            fatalError ("No memory for VOACAP download");
+        strcpy (bcfp->query, query);
+        (void) startBGFetch (bc_fetch_name, fetchBandConditions, doneBandConditions, bcfp);
+    }
+
+    return (false);
+}
+
 /* convert an array of 4 big-endian network-order bytes into a uint32_t
  */
 static uint32_t crackBE32 (uint8_t bp[])
@@ -1172,17 +1229,16 @@ bool getTCPChar (WiFiClient &client, char *cp)
     return (true);
 }
 
-/* send User-Agent to client
+/* build the complete User-Agent header line in ua[ua_len].
+ * N.B. main thread only, it reports much of the current state
  */
-void sendUserAgent (WiFiClient &client)
+void buildUserAgent (char *ua, size_t ua_len)
 {
     // don't send full list until first time main page is up to insure all subsystems are up.
     static bool ready;
     if (mainpage_up)
         ready = true;
 
-    char ua[400];
-
     if (logUsageOk() && ready) {
 
         // display mode: 0=X11 1=fb0 2=X11full 3=X11+live 4=X11full+live 5=noX
@@ -1364,7 +1420,7 @@ void sendUserAgent (WiFiClient &client)
         (void) autoUpgrade (aup_hr);
 
 
-        snprintf (ua, sizeof(ua),
+        snprintf (ua, ua_len,
             "User-Agent: %s/%s (id %u up %lld) crc %d "
                 "LV7 %s %d %d %d %d %d %d %d %d %d %d %d %d %d %.2f %.2f %d %d %d %d "
                 "%d %d %d %d %d %d %d %d %d %d %d %d "
@@ -1395,34 +1451,53 @@ void sendUserAgent (WiFiClient &client)
             aup_hr, 0);
 
     } else {
-        snprintf (ua, sizeof(ua), "User-Agent: %s/%s (id %u up %lld) crc %d\r\n",
+        snprintf (ua, ua_len, "User-Agent: %s/%s (id %u up %lld) crc %d\r\n",
             platform, hc_version, ESP.getChipId(), (long long)getUptime(NULL,NULL,NULL,NULL), flash_crc_ok);
     }
+}
 
-    // send
+/* send User-Agent to client.
+ * a background fetch uses the one built when it was queued, see bgfetch.cpp.
+ */
+void sendUserAgent (WiFiClient &client)
+{
+    char ua[USER_AGENT_LEN];
+    if (!getBGFetchUserAgent (ua, sizeof(ua)))
+        buildUserAgent (ua, sizeof(ua));
     client.print(ua);
-
 }
 
-/* issue an HTTP Get for an arbitary page
+/* issue an HTTP Get for an arbitary page.
+ * ask to keep the connection open so the next request to server can skip the connect, and for gzip
+ * unless page is already compressed; httpSkipHeader() then arranges for client to undo both.
  */
-static void httpGET (WiFiClient &client, const char *server, const char *page)
+static void httpGET (WiFiClient &client, const char *server, const char *page, const char *xhdrs)
 {
-    client.print ("GET "); client.print (page); client.print (" HTTP/1.0\r\n");
+    const char *query = strchr (page, '?');
+    size_t path_len = query ? query - page : strlen (page);
+    bool is_z = path_len > 2 && strncmp (page + path_len - 2, ".z", 2) == 0;
+
+    client.print ("GET "); client.print (page); client.print (" HTTP/1.1\r\n");
     client.print ("Host: "); client.println (server);
     sendUserAgent (client);
-    client.print ("Connection: close\r\n\r\n");
+    if (!is_z)
+        client.print ("Accept-Encoding: gzip\r\n");
+    if (xhdrs)
+        client.print (xhdrs);
+    client.print ("Connection: keep-alive\r\n\r\n");
+    client.setHTTPKeepAlive (true);
 }
 
-/* issue an HTTP Get to a /ham/HamClock page named in ram
+/* issue an HTTP Get to a /ham/HamClock page named in ram.
+ * xhdrs, unless NULL, are more complete header lines to include in the request.
  */
-void httpHCGET (WiFiClient &client, const char *server, const char *hc_page)
+void httpHCGET (WiFiClient &client, const char *server, const char *hc_page, const char *xhdrs)
 {
     static const char hc[] = "/ham/HamClock";
     StackMalloc full_mem(strlen(hc_page) + sizeof(hc));         // sizeof includes the EOS
     char *full_hc_page = (char *) full_mem.getMem();
     snprintf (full_hc_page, full_mem.getSize(), "%s%s", hc, hc_page);
-    httpGET (client, server, full_hc_page);
+    httpGET (client, server, full_hc_page, xhdrs);
 }
 
 /* issue an HTTPS Get to a /ham/HamClock page named in ram by using a curl command
@@ -1443,39 +1518,95 @@ bool connecthttpsHCGET (WiFiClient &client, const char *server, const char *hc_p
 }
 /* skip the given wifi client stream ahead to just after the first blank line, return whether ok.
  * this is often used so subsequent stop() on client doesn't slam door in client's face with RST.
- * Along the way, if find a header field with the given name (unless NULL) return value in the given string.
- * if header is not found, we still return true but value[0] will be '\0'.
+ * Along the way, return the value of each of the n_hdrs header fields named in headers[] in values[],
+ * each value_len long, and the HTTP status code in *status unless NULL.
+ * if a header is not found, we still return true but its value[0] will be '\0'.
  */
-bool httpSkipHeader (WiFiClient &client, const char *header, char *value, int value_len)
+bool httpSkipHeader (WiFiClient &client, int *status, int n_hdrs, const char *headers[], char *values[], int value_len)
 {
     char line[200];
 
     // prep
-    int hdr_len = header ? strlen(header) : 0;
-    if (value)
-        value[0] = '\0';
+    for (int i = 0; i < n_hdrs; i++)
+        values[i][0] = '\0';
+    if (status)
+        *status = 0;
     char *hdr;
 
+    // if the request was sent by httpGET() also find where the body ends and how it is encoded
+    bool keep_alive = client.getHTTPKeepAlive();
+    bool status_line = true;
+    bool http10 = false, ka_hdr = false, close_hdr = false;
+    bool no_body = false, chunked = false, gzip = false;
+    long content_length = -1;
+
     // read until find a blank line
     do {
         if (!getTCPLine (client, line, sizeof(line), NULL))
             return (false);
         // Serial.println (line);
 
-        if (header && value && (hdr = strstr (line, header)) != NULL)
-            snprintf (value, value_len, "%s", hdr + hdr_len);
+        for (int i = 0; i < n_hdrs; i++)
+            if ((hdr = strstr (line, headers[i])) != NULL)
+                snprintf (values[i], value_len, "%s", hdr + strlen(headers[i]));
+
+        if (status_line) {
+            int code = 0;
+            http10 = strncmp (line, "HTTP/1.0", 8) == 0;
+            sscanf (line, "HTTP/%*s %d", &code);
+            no_body = code/100 == 1 || code == 204 || code == 304;
+            if (status)
+                *status = code;
+            status_line = false;
+        } else if (keep_alive) {
+            if (strncasecmp (line, "Content-Length:", 15) == 0)
+                content_length = atol (line+15);
+            else if (strncasecmp (line, "Transfer-Encoding:", 18) == 0)
+                chunked = strcasestr (line+18, "chunked") != NULL;
+            else if (strncasecmp (line, "Content-Encoding:", 17) == 0)
+                gzip = strcasestr (line+17, "gzip") != NULL;
+            else if (strncasecmp (line, "Connection:", 11) == 0) {
+                ka_hdr = strcasestr (line+11, "keep-alive") != NULL;
+                close_hdr = strcasestr (line+11, "close") != NULL;
+            }
+        }
 
     } while (line[0] != '\0');  // getTCPLine absorbs \r\n so this tests for a blank line
 
+    if (keep_alive) {
+        if (no_body) {
+            content_length = 0;
+            chunked = false;
+        }
+        client.setHTTPBody (content_length, chunked, gzip, http10 ? ka_hdr : !close_hdr);
+
+        // Content-Length is of the compressed body so it means nothing to the caller
+        for (int i = 0; gzip && i < n_hdrs; i++)
+            if (strncasecmp (headers[i], "Content-Length", 14) == 0)
+                values[i][0] = '\0';
+    }
+
     return (true);
 }
 
+/* same but for just one header field, unless header or value is NULL
+ */
+bool httpSkipHeader (WiFiClient &client, const char *header, char *value, int value_len)
+{
+    int n_hdrs = header && value ? 1 : 0;
+    return (httpSkipHeader (client, NULL, n_hdrs, &header, &value, value_len));
+}
+
 /* same but when we don't care about any header field;
- * so we pick up Remote_Addr for postDiags()
+ * so we pick up Remote_Addr for postDiags(), by way of pollBGFetch() if called from a background fetch.
  */
 bool httpSkipHeader (WiFiClient &client)
 {
-    return (httpSkipHeader (client, "Remote_Addr: ", remote_addr, sizeof(remote_addr)));
+    char raddr[sizeof(remote_addr)];
+    bool ok = httpSkipHeader (client, "Remote_Addr: ", raddr, sizeof(raddr));
+    if (!setBGFetchRemoteAddr (raddr))
+        quietStrncpy (remote_addr, raddr, sizeof(remote_addr));
+    return (ok);
 }
 
 /* retrieve and plot latest and predicted DRAP indices, return whether io ok
@@ -1485,8 +1616,6 @@ static bool updateDRAP (const SBox &box)
     DRAPData drap;
     bool ok = retrieveDRAP (drap);
 
-    updateClocks(false);
-
     if (ok) {
 
         if (!drap.data_ok) {
@@ -1518,8 +1647,6 @@ static bool updateKp(const SBox &box)
 
     bool ok = retrieveKp (kp);
 
-    updateClocks(false);
-
     if (ok) {
 
         if (!kp.data_ok) {
@@ -1549,8 +1676,6 @@ static bool updateDST(const SBox &box)
 
     bool ok = retrieveDST (dst);
 
-    updateClocks(false);
-
     if (ok) {
 
         if (!dst.data_ok) {
@@ -1581,8 +1706,6 @@ static bool updateXRay(const SBox &box)
 
     bool ok = retrieveXRay (xray);
 
-    updateClocks(false);
-
     if (ok) {
 
         if (!xray.data_ok) {
@@ -1615,8 +1738,6 @@ static bool updateSunSpots (const SBox &box)
 
     bool ok = retrieveSunSpots (ssn);
 
-    updateClocks(false);
-
     if (ok) {
 
         if (!ssn.data_ok) {
@@ -1648,8 +1769,6 @@ static bool updateSolarFlux(const SBox &box)
 
     bool ok = retrieveSolarFlux(sf);
 
-    updateClocks(false);
-
     if (ok) {
         if (!sf.data_ok) {
             plotMessage (box, SFLUX_COLOR, "Solar Flux data invalid");
@@ -1751,48 +1870,36 @@ static bool updateBzBt (const SBox &box)
     return (ok);
 }
 
-/* retrieve and draw latest band conditions in box b if needed or requested.
+/* draw latest band conditions in box b.
  * return whether io ok.
+ * N.B. bc_matrix is refreshed in the background, see bcReady().
  */
-static bool updateBandConditions(const SBox &box, bool force)
+static bool updateBandConditions(const SBox &box)
 {
-    // update if asked to or out of sync with prop map or it's just been a while
-    bool update_bc = force || (CM_PMACTIVE() && tdiff(bc_time,map_time) >= 3600)
-                           || (tdiff (nowWO(), bc_time) >= 3600)
-                           || myNow() >= bc_matrix.next_update;
-
-    static char config[100];    // retain value after each retrieval
-
-    // download if so and note whether io ok
-    bool io_ok = true;
-    if (update_bc) {
-
-        // fresh download
-        if (retrieveBandConditions (config))
-            bc_matrix.next_update = nextRetrieval (PLOT_CH_BC, BC_INTERVAL);
-        else {
-            bc_matrix.next_update = nextWiFiRetry(PLOT_CH_BC);
-            io_ok = false;
-        }
-
-        // note time of attemp to coordinate with maps
-        bc_time = nowWO();
-    }
-
     // plot
     if (bc_matrix.ok) {
 
-        plotBandConditions (box, 0, &bc_matrix, config);
+        plotBandConditions (box, 0, &bc_matrix, bc_config);
 
     } else {
 
         plotMessage (box, RA8875_RED, "No VOACAP data");
 
-        // if problem persists more than an hour, this prevents the tdiff's above from being true every time
+        // if problem persists more than an hour, this prevents the tdiff's in bcReady() from being true every time
         map_time = bc_time = nowWO() - 1000;
     }
 
-    return (io_ok);
+    return (bc_io_ok);
+}
+
+/* redraw band conditions in box b, such as to erase a menu, and if changed draw again when fresh data
+ * for the new settings arrive.
+ */
+static void redrawBandConditions (const SBox &b, bool changed)
+{
+    (void) updateBandConditions (b);
+    if (changed)
+        scheduleNewPlot (PLOT_CH_BC);
 }
 
 /* display the RSG NOAA solar environment scale values in the given box.
@@ -1800,7 +1907,6 @@ static bool updateBandConditions(const SBox &box, bool force)
  */
 static bool updateNOAASWx(const SBox &box)
 {
-    updateClocks(false);
     return (plotNOAASWx (box));
 }
 
@@ -1935,7 +2041,7 @@ bool checkBCTouch (const SCoord &s, const SBox &b)
             if (CM_PMACTIVE())
                 scheduleNewCoreMap(core_map);
         }
-        (void) updateBandConditions (b, power_changed);
+        redrawBandConditions (b, power_changed);
 
     } else if (inBox (s, mode_b)) {
 
@@ -1970,7 +2076,7 @@ bool checkBCTouch (const SCoord &s, const SBox &b)
             if (CM_PMACTIVE())
                 scheduleNewCoreMap(core_map);
         }
-        (void) updateBandConditions (b, mode_changed);
+        redrawBandConditions (b, mode_changed);
 
     } else if (inBox (s, toa_b)) {
 
@@ -2007,7 +2113,7 @@ bool checkBCTouch (const SCoord &s, const SBox &b)
             if (CM_PMACTIVE())
                 scheduleNewCoreMap(core_map);
         }
-        (void) updateBandConditions (b, toa_changed);
+        redrawBandConditions (b, toa_changed);
 
     } else if (inBox (s, splp_b)) {
 
@@ -2017,7 +2123,7 @@ bool checkBCTouch (const SCoord &s, const SBox &b)
         if (CM_PMACTIVE())
             scheduleNewCoreMap(core_map);
         drawDXInfo ();
-        (void) updateBandConditions (b, true);
+        redrawBandConditions (b, true);
 
     } else if (inBox (s, tl_b)) {
 
@@ -2080,6 +2186,23 @@ bool checkBCTouch (const SCoord &s, const SBox &b)
     return (true);
 }
 
+/* return whether the data for pane choice pc may be drawn now without waiting for the network.
+ * if not, a background download has been started and we should check again later.
+ */
+static bool paneDataReady (PlotChoice pc)
+{
+    switch (pc) {
+    case PLOT_CH_BC:
+        return (bcReady());
+    case PLOT_CH_ONTA:
+        return (ontaReady());
+    case PLOT_CH_PSK:
+        return (pskReady());
+    default:
+        return (spcWxReady (pc));
+    }
+}
+
 /* check if it is time to update any info via wifi.
  * proceed even if no wifi to allow subsystems to update.
  */
@@ -2117,12 +2240,16 @@ void updateWiFi(void)
             next_update[pp] = 0;
         }
 
+        // if due but its data are still downloading in the background then check again next time
+        if (t0 >= next_update[pp] && !paneDataReady (pc))
+            continue;
+
 
         switch (pc) {
 
         case PLOT_CH_BC:
             if (t0 >= next_update[pp]) {
-                if (updateBandConditions (box, fresh_redraw[pc])) {
+                if (updateBandConditions (box)) {
                     next_update[pp] = nextPaneUpdate (pc, BC_INTERVAL);
                     fresh_redraw[pc] = false;
                 } else
@@ -2272,7 +2399,7 @@ void updateWiFi(void)
 
         case PLOT_CH_PSK:
             if (t0 >= next_update[pp]) {
-                if (updatePSKReporter(box, fresh_redraw[pc])) {
+                if (updatePSKReporter(box)) {
                     next_update[pp] = nextPaneUpdate (pc, PSK_INTERVAL);
                     fresh_redraw[pc] = false;
                 } else
@@ -2359,25 +2486,13 @@ void updateWiFi(void)
  */
 bool getTCPLine (WiFiClient &client, char line[], uint16_t line_len, uint16_t *ll)
 {
-    // decrement available length so there's always room to add '\0'
-    line_len -= 1;
-
-    uint16_t i = 0;
-    while (true) {
-        char c;
-        if (!getTCPChar (client, &c))
-            return (false);
-        if (c == '\r')
-            continue;
-        if (c == '\n') {
-            line[i] = '\0';
-            if (ll)
-                *ll = i;
-            // Serial.println(line);
-            return (true);
-        } else if (i < line_len)
-            line[i++] = c;
-    }
+    int n;
+    if (!client.readLine (line, line_len, &n))
+        return (false);
+    if (ll)
+        *ll = n;
+    // Serial.println(line);
+    return (true);
 }
 
 /* arrange for everything to update immediately
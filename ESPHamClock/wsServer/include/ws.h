@@ -37,6 +37,8 @@ extern "C" {
         #include <arpa/inet.h>
         #include <sys/socket.h>
         #include <netinet/in.h>
+        #include <pthread.h>
+        #include <sys/time.h>
 
 	/**
 	 * @name Global configurations
@@ -47,6 +49,17 @@ extern "C" {
 	 */
 	#define MAX_CLIENTS    101      // so max live is a nicer 100
 
+	/**
+	 * @brief Number of worker threads that run the event callbacks.
+	 */
+	#define WS_WORKERS     4
+
+	/**
+	 * @brief Bytes queued for one client beyond which new frames are dropped
+	 * rather than queued, a few frames' worth.
+	 */
+	#define WS_MAX_OUTQ    (1024*1024)
+
 	/**
 	 * @name Key and message configurations.
 	 */
@@ -219,28 +232,56 @@ extern "C" {
 	#endif
 	/**@}*/
 
-	#define SEND(client,buf,len) send_all((client), (buf), (len), MSG_NOSIGNAL)
-	#define RECV(fd,buf,len) recv((fd)->client_sock, (buf), (len), 0)
+        /* forward declaration for the job and timer lists. */
+        struct ws_job;
 
         /**
-         * @brief Client socks.
+         * @brief Client connection.
+         *
+         * Each is malloced when accepted and freed after its onclose event has run. The
+         * reactor owns the input side, the output queue is shared with the workers under
+         * mtx_snd.
          */
         struct ws_connection
         {
                 int client_sock; /**< Client socket FD.        */
                 int state;       /**< WebSocket current state. */
 
-                /* Timeout thread and locks. */
+                /* State lock. */
                 pthread_mutex_t mtx_state;
-                pthread_cond_t cnd_state_close;
-                pthread_t thrd_tout;
-                bool close_thrd;
 
                 /* malloced http header down through and including blank line */
                 char *header;
 
-                /* Send lock. */
+                /* events of the listening socket that accepted us */
+                const struct ws_events *evs;
+
+                /* Input not yet parsed and the data message being reassembled, reactor only. */
+                unsigned char *in;
+                size_t in_n, in_max;
+                unsigned char *msg;
+                uint64_t msg_n;
+                int msg_type;
+
+                /* Output not yet sent, starting at out_off, and when it last became empty. */
                 pthread_mutex_t mtx_snd;
+                unsigned char *out;
+                size_t out_off, out_n, out_max;
+                struct timeval drain_tv;
+                bool want_out;
+                bool out_broken;
+
+                /* Callbacks waiting to run, in order, and whether we are on the worker run queue. */
+                struct ws_job *jobs, *jobs_tail;
+                bool scheduled;
+                struct ws_connection *run_next;
+
+                /* set once the reactor lets go, after which only our final job may run */
+                bool retired;
+                bool opened;
+
+                /* all clients list */
+                struct ws_connection *prev, *next;
 
                 /* IP address and port. */
                 char ip[INET6_ADDRSTRLEN];
@@ -302,6 +343,9 @@ extern "C" {
 	extern int ws_close_client(ws_cli_conn_t *cli);
 	extern int ws_socket(struct ws_events *evs, uint16_t port, int thread_loop,
 		uint32_t timeout_ms);
+	extern size_t ws_pending(ws_cli_conn_t *cli, struct timeval *drained_tv);
+	extern int ws_defer(ws_cli_conn_t *cli, uint32_t ms,
+		void (*fn)(ws_cli_conn_t *cli, void *arg), void *arg);
 
 	/* Ping routines. */
 	extern void ws_ping(ws_cli_conn_t *cli, int threshold);
@@ -27,21 +27,19 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
-
-/* clang-format off */
-#ifndef _WIN32
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+
+/* epoll where we have it, else plain poll(2). -DWS_USE_POLL forces the latter. */
+#if defined(__linux__) && !defined(WS_USE_POLL)
+#define WS_USE_EPOLL
+#include <sys/epoll.h>
 #else
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <windows.h>
-typedef int socklen_t;
+#include <poll.h>
 #endif
-/* clang-format on */
 
-/* Windows and macOS seems to not have MSG_NOSIGNAL */
+/* macOS seems to not have MSG_NOSIGNAL */
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL 0
 #endif
@@ -61,110 +59,168 @@ extern void fatalError (const char *fmt, ...);
 #endif
 
 
-
-/**
- * pass sock and port to ws_accept()
- */
-struct ws_accept_info {
-    int sock;
-    int port;
-};
-
 /**
  * @dir src/
  * @brief wsServer source code
  *
  * @file ws.c
  * @brief wsServer main routines.
+ *
+ * All sockets are watched by one reactor thread which accepts new connections,
+ * reads and parses frames and writes queued output as sockets allow. The event
+ * callbacks run on a small fixed pool of worker threads, one at a time per client
+ * and in the order the reactor queued them, so they may block or take a while to
+ * encode without holding up the other clients. Sending never blocks: frames go
+ * straight to the socket if it will take them, the rest waits in a per-client
+ * output queue that the reactor drains.
  */
 
 /**
- * @brief Websocket events.
+ * @brief Max listening sockets, one per ws_socket() call.
  */
-static struct ws_events cli_events;
+#define WS_MAX_LISTENERS 4
 
 /**
- * @brief Clients list.
+ * @brief Max reactor events handled per wakeup.
  */
-static struct ws_connection client_socks[MAX_CLIENTS];
+#define WS_NEVENTS 64
 
 /**
- * @brief Timeout to a single send().
+ * @brief Bytes we try to read from a client at once.
  */
-static uint32_t timeout;
+#define WS_READ_CHUNK 16384
 
 /**
- * @brief Client validity macro
+ * @brief Longest http header we accept.
  */
-#define CLIENT_VALID(cli)                          \
-	((cli) != NULL && (cli) >= &client_socks[0] && \
-		(cli) <= &client_socks[MAX_CLIENTS - 1] && \
-		(cli)->client_sock > -1)
+#define WS_MAX_HEADER 16384
 
 /**
- * @brief WebSocket frame data
+ * @brief Kinds of worker jobs.
  */
-struct ws_frame_data
+enum ws_job_type
 {
-	/**
-	 * @brief Frame read.
-	 */
-	unsigned char frm[MESSAGE_LENGTH];
-	/**
-	 * @brief Processed message at the moment.
-	 */
-	unsigned char *msg;
-	/**
-	 * @brief Control frame payload
-	 */
-	unsigned char msg_ctrl[125];
-	/**
-	 * @brief Current byte position.
-	 */
-	size_t cur_pos;
-	/**
-	 * @brief Amount of read bytes.
-	 */
-	size_t amt_read;
-	/**
-	 * @brief Frame type, like text or binary.
-	 */
-	int frame_type;
-	/**
-	 * @brief Frame size.
-	 */
-	uint64_t frame_size;
-	/**
-	 * @brief Error flag, set when a read was not possible.
-	 */
-	int error;
-	/**
-	 * @brief Client connection structure.
-	 */
-	ws_cli_conn_t *client;
+	WS_JOB_OPEN,    /**< Call onopen.                                  */
+	WS_JOB_MESSAGE, /**< Call onmessage.                               */
+	WS_JOB_CALL,    /**< Call a ws_defer() function.                   */
+	WS_JOB_CLOSE,   /**< Call onclose if opened, then free the client. */
+	WS_JOB_NONWS    /**< Call onnonws, then free the client.           */
+};
+
+/**
+ * @brief One callback waiting to run for a client.
+ */
+struct ws_job
+{
+	int type;                                   /**< ws_job_type.                 */
+	unsigned char *msg;                         /**< malloced message, if MESSAGE */
+	uint64_t msg_size;                          /**< message length.              */
+	int msg_type;                               /**< text or binary.              */
+	void (*fn)(ws_cli_conn_t *cli, void *arg);  /**< function, if CALL.           */
+	void *arg;                                  /**< its argument.                */
+	struct ws_job *next;                        /**< next for the same client.    */
+};
+
+/**
+ * @brief Kinds of reactor timers.
+ */
+enum ws_timer_type
+{
+	WS_TIMER_CLOSE, /**< Give up waiting for the close response. */
+	WS_TIMER_CALL   /**< Queue a ws_defer() function.            */
+};
+
+/**
+ * @brief One pending timer.
+ */
+struct ws_timer
+{
+	struct timeval when;                        /**< when due.          */
+	int type;                                   /**< ws_timer_type.     */
+	ws_cli_conn_t *client;                      /**< client it is for.  */
+	void (*fn)(ws_cli_conn_t *cli, void *arg);  /**< function, if CALL. */
+	void *arg;                                  /**< its argument.      */
+	struct ws_timer *next;                      /**< next timer.        */
+};
+
+/**
+ * @brief One listening socket and the events for the clients it accepts.
+ */
+struct ws_listener
+{
+	int sock;
+	int port;
+	struct ws_events evs;
 };
 
 /**
- * @brief Global mutex.
+ * @brief Listening sockets.
+ */
+static struct ws_listener listeners[WS_MAX_LISTENERS];
+static int n_listeners;
+
+/**
+ * @brief All clients, most recent first.
+ */
+static ws_cli_conn_t *clients;
+static int n_clients;
+
+/**
+ * @brief Clients with jobs waiting for a worker.
+ */
+static ws_cli_conn_t *run_head, *run_tail;
+
+/**
+ * @brief Pending timers, in no particular order.
+ */
+static struct ws_timer *timers;
+
+/**
+ * @brief Guards the lists above plus each client's jobs, scheduled and retired.
  */
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ * @brief Signaled when run_head gains a client.
+ */
+static pthread_cond_t cnd_work = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Pipe used to wake the reactor.
+ */
+static int wake_fds[2] = {-1, -1};
+
+#ifdef WS_USE_EPOLL
+/**
+ * @brief Reactor epoll instance.
+ */
+static int epoll_fd = -1;
+#endif
+
+/**
+ * @brief Whether the reactor is running.
+ */
+static bool reactor_running;
+
+/**
+ * @brief Timeout to a single send() of a non-websocket reply.
+ */
+static uint32_t timeout;
+
+/**
+ * @brief Client validity macro
+ */
+#define CLIENT_VALID(cli) ((cli) != NULL && (cli)->client_sock > -1)
+
 /**
  * @brief Shutdown and close a given socket.
  *
  * @param fd Socket file descriptor to be closed.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
  */
 static void close_socket(int fd)
 {
-#ifndef _WIN32
 	shutdown(fd, SHUT_RDWR);
 	close(fd);
-#else
-	closesocket(fd);
-#endif
 }
 
 /**
@@ -174,9 +230,6 @@ static void close_socket(int fd)
  * @param client Client structure.
  *
  * @return Returns the client state, -1 otherwise.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
  */
 static int get_client_state(ws_cli_conn_t *client)
 {
@@ -199,9 +252,6 @@ static int get_client_state(ws_cli_conn_t *client)
  * @param state State to be set.
  *
  * @return Returns 0 if success, -1 otherwise.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
  */
 static int set_client_state(ws_cli_conn_t *client, int state)
 {
@@ -218,173 +268,407 @@ static int set_client_state(ws_cli_conn_t *client, int state)
 }
 
 /**
- * @brief Send a given message @p buf on a socket @p sockfd.
+ * @brief Sets or clears O_NONBLOCK on a socket.
+ *
+ * @param fd Socket.
+ * @param on Whether to set.
+ */
+static void set_nonblocking(int fd, bool on)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	if (flags < 0)
+		return;
+	if (on)
+		flags |= O_NONBLOCK;
+	else
+		flags &= ~O_NONBLOCK;
+	fcntl(fd, F_SETFL, flags);
+}
+
+/**
+ * @brief Wakes the reactor so it rechecks its timers and, with poll, what to watch.
+ */
+static void wake_reactor(void)
+{
+	char c = 0;
+
+	if (write(wake_fds[1], &c, 1) < 0 && errno != EAGAIN)
+	{
+		DEBUG("Could not wake reactor: %s\n", strerror(errno));
+	}
+}
+
+/**
+ * @brief Tells the reactor whether @p client has output waiting.
+ *
+ * @param client Client connection.
+ *
+ * @note Called with mtx_snd held so this agrees with want_out.
+ */
+static void watch_client(ws_cli_conn_t *client)
+{
+#ifdef WS_USE_EPOLL
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | (client->want_out ? (uint32_t)EPOLLOUT : 0);
+	ev.data.ptr = client;
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->client_sock, &ev);
+#else
+	(void)client;
+	wake_reactor();
+#endif
+}
+
+/**
+ * @brief Shuts down a client socket after an error so the reactor sees it
+ * end and closes the client in the usual way.
  *
- * @param client Target client.
- * @param buf Message to be sent.
- * @param len Message length.
- * @param flags Send flags.
+ * @param client Client connection.
+ *
+ * @note Called with mtx_snd held.
+ */
+static void abort_client(ws_cli_conn_t *client)
+{
+	client->out_broken = true;
+	client->out_off = client->out_n = 0;
+	shutdown(client->client_sock, SHUT_RDWR);
+}
+
+/**
+ * @brief Appends @p len bytes to the client output queue.
+ *
+ * @param client Client connection.
+ * @param buf Data.
+ * @param len Length.
+ *
+ * @return Returns 0 if success, -1 otherwise.
  *
- * @return If success (i.e: all message was sent), returns
- * the amount of bytes sent. Otherwise, -1.
+ * @note Called with mtx_snd held.
+ */
+static int append_output(ws_cli_conn_t *client, const void *buf, size_t len)
+{
+	unsigned char *tmp;
+	size_t new_max;
+
+	/* reuse the space already sent before growing */
+	if (client->out_n + len > client->out_max && client->out_off > 0)
+	{
+		memmove(client->out, client->out + client->out_off,
+			client->out_n - client->out_off);
+		client->out_n -= client->out_off;
+		client->out_off = 0;
+	}
+
+	if (client->out_n + len > client->out_max)
+	{
+		new_max = 2 * client->out_max;
+		if (new_max < client->out_n + len)
+			new_max = client->out_n + len;
+		tmp = (unsigned char *) realloc(client->out, new_max);
+		if (!tmp)
+			return (-1);
+		client->out = tmp;
+		client->out_max = new_max;
+	}
+
+	memcpy(client->out + client->out_n, buf, len);
+	client->out_n += len;
+	return (0);
+}
+
+/**
+ * @brief Sends a header and data to a client without blocking, queueing
+ * whatever the socket will not take now for the reactor to send later.
  *
- * @note Technically this shouldn't be necessary, since send() should
- * block until all content is sent, since _we_ don't use 'O_NONBLOCK'.
- * However, it was reported (issue #22 on GitHub) that this was
- * happening, so just to be cautious, I will keep using this routine.
+ * @param client Client connection.
+ * @param hdr Header, may be NULL if @p hdr_len is 0.
+ * @param hdr_len Header length.
+ * @param data Data, may be NULL if @p data_len is 0.
+ * @param data_len Data length.
+ * @param droppable Whether to drop rather than queue if the client is far behind.
+ *
+ * @return Returns 0 if success, 1 if dropped because the client is already
+ * more than WS_MAX_OUTQ behind, -1 if the client is gone.
  */
-static ssize_t send_all(
-	ws_cli_conn_t *client, const void *buf, size_t len, int flags)
+static int queue_output(ws_cli_conn_t *client, const void *hdr, size_t hdr_len,
+	const void *data, size_t data_len, bool droppable)
 {
+	const char *parts[2];
+	size_t lens[2];
 	const char *p;
-	ssize_t ret;
+	size_t len;
 	ssize_t r;
+	int i;
 
-	ret = 0;
+	parts[0] = (const char *)hdr;
+	lens[0] = hdr_len;
+	parts[1] = (const char *)data;
+	lens[1] = data_len;
 
-	/* Sanity check. */
-	if (!CLIENT_VALID(client))
+	pthread_mutex_lock(&client->mtx_snd);
+
+	if (client->out_broken)
+	{
+		pthread_mutex_unlock(&client->mtx_snd);
 		return (-1);
+	}
 
-	p = (const char *) buf;
-	/* clang-format off */
-	pthread_mutex_lock(&client->mtx_snd);
-		while (len)
+	/*
+	 * Backpressure: a client this far behind gets nothing more until it
+	 * catches up, so memory stays bounded by the cap plus one frame.
+	 */
+	if (droppable && client->out_n - client->out_off > WS_MAX_OUTQ)
+	{
+		DEBUG("Client %d output queue full, dropping frame\n", client->client_sock);
+		pthread_mutex_unlock(&client->mtx_snd);
+		return (1);
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		p = parts[i];
+		len = lens[i];
+
+		/* Write directly while nothing is already waiting ahead of us. */
+		while (len > 0 && client->out_off == client->out_n)
 		{
-			r = ::send(client->client_sock, p, len, flags);
-			if (r == -1)
+			r = ::send(client->client_sock, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+			if (r < 0)
 			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					break;
+				abort_client(client);
 				pthread_mutex_unlock(&client->mtx_snd);
 				return (-1);
 			}
 			p   += r;
 			len -= r;
-			ret += r;
 		}
+
+		if (len > 0 && append_output(client, p, len) < 0)
+		{
+			DEBUG("Cannot allocate output queue for client %d\n", client->client_sock);
+			abort_client(client);
+			pthread_mutex_unlock(&client->mtx_snd);
+			return (-1);
+		}
+	}
+
+	if (client->out_off == client->out_n)
+		gettimeofday(&client->drain_tv, NULL);
+	else if (!client->want_out)
+	{
+		client->want_out = true;
+		watch_client(client);
+	}
+
 	pthread_mutex_unlock(&client->mtx_snd);
-	/* clang-format on */
-	return (ret);
+	return (0);
 }
 
 /**
- * @brief Close client connection (no close handshake, this should
- * be done earlier), set appropriate state and destroy mutexes.
+ * @brief Sends as much of the client output queue as the socket will take.
  *
  * @param client Client connection.
- * @param lock Should lock the global mutex?.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
  */
-static void close_client(ws_cli_conn_t *client, int lock)
+static void flush_output(ws_cli_conn_t *client)
 {
-	if (!CLIENT_VALID(client))
-		return;
+	ssize_t r;
 
-	set_client_state(client, WS_STATE_CLOSED);
+	pthread_mutex_lock(&client->mtx_snd);
 
-        free (client->header);
+	while (client->out_off < client->out_n)
+	{
+		r = ::send(client->client_sock, client->out + client->out_off,
+			client->out_n - client->out_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				abort_client(client);
+			break;
+		}
+		client->out_off += r;
+	}
 
-	close_socket(client->client_sock);
+	if (client->out_off == client->out_n)
+	{
+		client->out_off = client->out_n = 0;
+		gettimeofday(&client->drain_tv, NULL);
+		if (client->want_out)
+		{
+			client->want_out = false;
+			watch_client(client);
+		}
+	}
 
-	/* Destroy client mutexes and clear fd 'slot'. */
-	/* clang-format off */
-	if (lock)
-		pthread_mutex_lock(&mutex);
-			client->client_sock = -1;
-			pthread_cond_destroy(&client->cnd_state_close);
-			pthread_mutex_destroy(&client->mtx_state);
-			pthread_mutex_destroy(&client->mtx_snd);
-			pthread_mutex_destroy(&client->mtx_ping);
-	if (lock)
-		pthread_mutex_unlock(&mutex);
-	/* clang-format on */
+	pthread_mutex_unlock(&client->mtx_snd);
 }
 
 /**
- * @brief Close time-out thread.
- *
- * For a given client, this routine sleeps until
- * TIMEOUT_MS and closes the connection or returns
- * sooner if already closed connection.
- *
- * @param p ws_connection/ws_cli_conn_t Structure Pointer.
+ * @brief Allocates a worker job.
  *
- * @return Always NULL.
+ * @param type Job type.
  *
- * @attention This is part of the internal API and is documented just
- * for completeness.
+ * @return Returns the zeroed job.
  */
-static void *close_timeout(void *p)
+static struct ws_job *new_job(int type)
 {
-	ws_cli_conn_t *conn = (ws_cli_conn_t *) p;
-	struct timespec ts;
-	int state;
+	struct ws_job *job = (struct ws_job *) calloc(1, sizeof(struct ws_job));
 
-	pthread_mutex_lock(&conn->mtx_state);
+	if (!job)
+		fatalError("No memory for websocket job");
+	job->type = type;
+	return (job);
+}
 
-	clock_gettime(CLOCK_REALTIME, &ts);
-	ts.tv_nsec += MS_TO_NS(TIMEOUT_MS);
+/**
+ * @brief Appends a job for a client and insures a worker will get to it.
+ *
+ * @param client Client connection.
+ * @param job Job, now owned by the client.
+ *
+ * @note Called with mutex held.
+ */
+static void add_job(ws_cli_conn_t *client, struct ws_job *job)
+{
+	job->next = NULL;
+	if (client->jobs_tail)
+		client->jobs_tail->next = job;
+	else
+		client->jobs = job;
+	client->jobs_tail = job;
 
-	/* Normalize the time. */
-	while (ts.tv_nsec >= 1000000000)
+	/* A scheduled client is on the run queue or running, the worker requeues it. */
+	if (!client->scheduled)
 	{
-		ts.tv_sec++;
-		ts.tv_nsec -= 1000000000;
+		client->scheduled = true;
+		client->run_next = NULL;
+		if (run_tail)
+			run_tail->run_next = client;
+		else
+			run_head = client;
+		run_tail = client;
+		pthread_cond_signal(&cnd_work);
 	}
+}
 
-	while (conn->state != WS_STATE_CLOSED &&
-		   pthread_cond_timedwait(&conn->cnd_state_close, &conn->mtx_state, &ts) !=
-			   ETIMEDOUT)
-		;
-
-	state = conn->state;
-	pthread_mutex_unlock(&conn->mtx_state);
+/**
+ * @brief Adds a timer for a client.
+ *
+ * @param client Client connection.
+ * @param ms Milliseconds from now.
+ * @param type Timer type.
+ * @param fn Function, if WS_TIMER_CALL.
+ * @param arg Its argument.
+ *
+ * @note Called with mutex held.
+ */
+static void add_timer(ws_cli_conn_t *client, uint32_t ms, int type,
+	void (*fn)(ws_cli_conn_t *cli, void *arg), void *arg)
+{
+	struct ws_timer *tp;
 
-	/* If already closed. */
-	if (state == WS_STATE_CLOSED)
-		goto quit;
+	tp = (struct ws_timer *) calloc(1, sizeof(struct ws_timer));
+	if (!tp)
+		fatalError("No memory for websocket timer");
 
-	DEBUG("Timer expired, closing client %d\n", conn->client_sock);
+	gettimeofday(&tp->when, NULL);
+	tp->when.tv_sec += ms / 1000;
+	tp->when.tv_usec += (ms % 1000) * 1000;
+	if (tp->when.tv_usec >= 1000000)
+	{
+		tp->when.tv_sec++;
+		tp->when.tv_usec -= 1000000;
+	}
+	tp->type = type;
+	tp->client = client;
+	tp->fn = fn;
+	tp->arg = arg;
 
-	close_client(conn, 1);
-quit:
-	return (NULL);
+	tp->next = timers;
+	timers = tp;
 }
 
 /**
- * @brief For a valid client index @p client, starts
- * the timeout thread and set the current state
- * to 'CLOSING'.
+ * @brief Reactor lets go of a client: it is no longer watched and its
+ * final job is queued behind any it already has.
  *
  * @param client Client connection.
+ * @param job_type WS_JOB_CLOSE or WS_JOB_NONWS.
  *
- * @return Returns 0 if success, -1 otherwise.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
+ * @note The client may be freed by a worker as soon as this returns.
  */
-static int start_close_timeout(ws_cli_conn_t *client)
+static void retire_client(ws_cli_conn_t *client, int job_type)
 {
-	if (!CLIENT_VALID(client))
-		return (-1);
+	struct ws_timer **tpp, *tp;
 
-	pthread_mutex_lock(&client->mtx_state);
+#ifdef WS_USE_EPOLL
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->client_sock, NULL);
+#endif
+
+	set_client_state(client, WS_STATE_CLOSED);
 
-	if (client->state != WS_STATE_OPEN)
-		goto out;
+	pthread_mutex_lock(&mutex);
 
-	client->state = WS_STATE_CLOSING;
+	client->retired = true;
 
-	if (pthread_create(&client->thrd_tout, NULL, close_timeout, client))
+	/* Its timers can never matter now. */
+	for (tpp = &timers; (tp = *tpp) != NULL;)
 	{
-		pthread_mutex_unlock(&client->mtx_state);
-		fatalError("Unable to create timeout thread");
+		if (tp->client == client)
+		{
+			*tpp = tp->next;
+			free(tp);
+		}
+		else
+			tpp = &tp->next;
 	}
-	client->close_thrd = true;
-out:
-	pthread_mutex_unlock(&client->mtx_state);
-	return (0);
+
+	add_job(client, new_job(job_type));
+
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Frees a client after its final job.
+ *
+ * @param client Client connection.
+ */
+static void free_client(ws_cli_conn_t *client)
+{
+	/* Last chance for eg a close frame still waiting. */
+	if (client->client_sock > -1)
+		flush_output(client);
+
+	/* clang-format off */
+	pthread_mutex_lock(&mutex);
+		if (client->prev)
+			client->prev->next = client->next;
+		else
+			clients = client->next;
+		if (client->next)
+			client->next->prev = client->prev;
+		n_clients--;
+		if (client->client_sock > -1)
+			close_socket(client->client_sock);
+		client->client_sock = -1;
+	pthread_mutex_unlock(&mutex);
+	/* clang-format on */
+
+	free(client->header);
+	free(client->in);
+	free(client->msg);
+	free(client->out);
+	pthread_mutex_destroy(&client->mtx_state);
+	pthread_mutex_destroy(&client->mtx_snd);
+	pthread_mutex_destroy(&client->mtx_ping);
+	free(client);
 }
 
 /**
@@ -440,21 +724,19 @@ char *ws_getaddress(ws_cli_conn_t *client)
  * @param size   Binary message size.
  * @param type   Frame type.
  *
- * @return Returns the number of msg bytes written, -1 if error.
+ * @return Returns the number of bytes accepted for sending, 0 if the frame
+ * was dropped, -1 if error.
  *
- * @note If @p size is -1, it is assumed that a text frame is being sent,
- * otherwise, a binary frame. In the later case, the @p size is used.
+ * @note The frame is queued if the socket can not take it all now so this
+ * never blocks. Data frames for a client already more than WS_MAX_OUTQ behind
+ * are dropped, see @ref ws_pending to avoid that. Control frames never are.
  */
 int ws_sendframe(ws_cli_conn_t *client, const char *msg, uint64_t size, int type)
 {
-	unsigned char *response; /* Response data.     */
 	unsigned char frame[10]; /* Frame.             */
 	uint8_t idx_first_rData; /* Index data.        */
 	uint64_t length;         /* Message length.    */
-	int idx_response;        /* Index response.    */
-	ssize_t output;          /* Bytes sent.        */
-	ssize_t send_ret;        /* Ret send function  */
-	uint64_t i;              /* Loop index.        */
+	int output;              /* Bytes sent.        */
 	ws_cli_conn_t *cli;      /* Client.            */
 
 	frame[0] = (WS_FIN | type);
@@ -491,57 +773,31 @@ int ws_sendframe(ws_cli_conn_t *client, const char *msg, uint64_t size, int type
 		idx_first_rData = 10;
 	}
 
-	/* Add frame bytes. */
-	idx_response = 0;
-	response = (unsigned char *) malloc(sizeof(unsigned char) * (idx_first_rData + length + 1));
-	if (!response)
-		return (-1);
-
-	for (i = 0; i < idx_first_rData; i++)
+	/* Send to the client if there is one. */
+	if (client)
 	{
-		response[i] = frame[i];
-		idx_response++;
+		if (!CLIENT_VALID(client))
+			return (-1);
+		output = queue_output(client, frame, idx_first_rData, msg, length,
+			!(type & 0x8));
+		if (output < 0)
+			return (-1);
+		return (output > 0 ? 0 : (int)length);
 	}
 
-	/* Add data bytes. */
-	for (i = 0; i < length; i++)
+	/* If no client specified, broadcast to everyone. */
+	output = (int)length;
+	pthread_mutex_lock(&mutex);
+	for (cli = clients; cli; cli = cli->next)
 	{
-		response[idx_response] = msg[i];
-		idx_response++;
+		if (!cli->retired && get_client_state(cli) == WS_STATE_OPEN &&
+			queue_output(cli, frame, idx_first_rData, msg, length, !(type & 0x8)) < 0)
+			output = -1;
 	}
+	pthread_mutex_unlock(&mutex);
 
-	response[idx_response] = '\0';
-
-	/* Send to the client if there is one. */
-	output = 0;
-	if (client)
-		output = SEND(client, response, idx_response);
-
-	/* If no client specified, broadcast to everyone. */
-	if (!client)
-	{
-		pthread_mutex_lock(&mutex);
-
-		for (i = 0; i < MAX_CLIENTS; i++)
-		{
-			cli = &client_socks[i];
-			if ((cli->client_sock > -1) && get_client_state(cli) == WS_STATE_OPEN)
-			{
-				if ((send_ret = SEND(cli, response, idx_response)) != -1)
-					output += send_ret;
-				else
-				{
-					output = -1;
-					break;
-				}
-			}
-		}
-		pthread_mutex_unlock(&mutex);
-	}
-
-	free(response);
-	return ((int)(output - idx_first_rData));
-}
+	return (output);
+}
 
 /**
  * @brief Given a PONG message, decodes the content
@@ -581,13 +837,10 @@ static inline void int32_to_ping_msg(int32_t ping_id, uint8_t *msg)
  * the threshold imposed.
  *
  * @param cli Client to be sent.
- * @param threshold How many pings can miss?.
- * @param lock Should lock global mutex or not?.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
+ * @param threshold How many pings can fail to be replied before
+ * the client is closed.
  */
-static void send_ping_close(ws_cli_conn_t *cli, int threshold, int lock)
+static void send_ping_close(ws_cli_conn_t *cli, int threshold)
 {
 	uint8_t ping_msg[4];
 
@@ -605,7 +858,11 @@ static void send_ping_close(ws_cli_conn_t *cli, int threshold, int lock)
 
 		/* Check previous PONG: if greater than threshold, abort. */
 		if ((cli->current_ping_id - cli->last_pong_id) > threshold)
-			close_client(cli, lock);
+		{
+			pthread_mutex_lock(&cli->mtx_snd);
+			abort_client(cli);
+			pthread_mutex_unlock(&cli->mtx_snd);
+		}
 
 	pthread_mutex_unlock(&cli->mtx_ping);
 	/* clang-format on */
@@ -620,26 +877,13 @@ static void send_ping_close(ws_cli_conn_t *cli, int threshold, int lock)
  * client does not respond up to @p threshold PINGs, the connection
  * is aborted.
  *
- * ws_ping() is not automatic: the user who wants to send keep-alive
- * PINGs *must* call this routine in a timely manner, whether on
- * a different thread or inside an event.
- *
- * See examples/ping/ping.c for a minimal example usage.
- *
- * @param cli       Client to be sent, if NULL, broadcast.
+ * @param cli Client to be sent, if NULL, broadcast.
  * @param threshold How many ignored PINGs should tolerate? (should be
- *                  positive and greater than 0).
- *
- * @note It should be noted that the time between each call to
- * ws_ping() is the timeout itself for receiving the PONG.
- *
- * It is also important to note that for devices with unstable
- * connections (such as a weak WiFi signal or 3/4/5G from a cell phone),
- * a threshold greater than 1 is advisable.
+ * positive and greater than 0).
  */
 void ws_ping(ws_cli_conn_t *cli, int threshold)
 {
-	int i;
+	ws_cli_conn_t *c;
 
 	/* Sanity check. */
 	if (threshold <= 0)
@@ -647,15 +891,16 @@ void ws_ping(ws_cli_conn_t *cli, int threshold)
 
 	/* PING a single client. */
 	if (cli)
-		send_ping_close(cli, threshold, 1);
+		send_ping_close(cli, threshold);
 
 	/* PING broadcast. */
 	else
 	{
 		/* clang-format off */
 		pthread_mutex_lock(&mutex);
-			for (i = 0; i < MAX_CLIENTS; i++)
-				send_ping_close(&client_socks[i], threshold, 0);
+			for (c = clients; c; c = c->next)
+				if (!c->retired)
+					send_ping_close(c, threshold);
 		pthread_mutex_unlock(&mutex);
 		/* clang-format on */
 	}
@@ -667,7 +912,8 @@ void ws_ping(ws_cli_conn_t *cli, int threshold)
  * @param client Target to be send. If NULL, broadcast the message.
  * @param msg    Message to be send, null terminated.
  *
- * @return Returns the number of bytes written, -1 if error.
+ * @return Returns the number of bytes accepted for sending, 0 if the frame
+ * was dropped, -1 if error.
  */
 int ws_sendframe_txt(ws_cli_conn_t *client, const char *msg)
 {
@@ -681,7 +927,8 @@ int ws_sendframe_txt(ws_cli_conn_t *client, const char *msg)
  * @param msg    Message to be send.
  * @param size   Binary message size.
  *
- * @return Returns the number of bytes written, -1 if error.
+ * @return Returns the number of bytes accepted for sending, 0 if the frame
+ * was dropped, -1 if error.
  */
 int ws_sendframe_bin(ws_cli_conn_t *client, const char *msg, uint64_t size)
 {
@@ -707,6 +954,83 @@ int ws_get_state(ws_cli_conn_t *client)
 	return (get_client_state(client));
 }
 
+/**
+ * @brief Returns how many bytes are queued for a client but not yet written
+ * to its socket, and optionally when its queue last became empty.
+ *
+ * Callers producing a stream of frames can use this to hold off while a
+ * client is still behind.
+ *
+ * @param client Client connection.
+ * @param drained_tv If not NULL, set to when the queue last became empty.
+ *
+ * @return Returns the number of bytes waiting.
+ */
+size_t ws_pending(ws_cli_conn_t *client, struct timeval *drained_tv)
+{
+	size_t n;
+
+	if (!CLIENT_VALID(client))
+		return (0);
+
+	pthread_mutex_lock(&client->mtx_snd);
+	n = client->out_n - client->out_off;
+	if (drained_tv)
+		*drained_tv = client->drain_tv;
+	pthread_mutex_unlock(&client->mtx_snd);
+
+	return (n);
+}
+
+/**
+ * @brief Arranges for @p fn to be called for @p client after @p ms milliseconds.
+ *
+ * The function runs on a worker in order with the client's other events, so
+ * never at the same time as one of them. Use this rather than sleeping in an
+ * event, which would hold up a worker.
+ *
+ * @param client Client connection.
+ * @param ms Milliseconds from now.
+ * @param fn Function to call.
+ * @param arg Its argument.
+ *
+ * @return Returns 0 if success, -1 if the client is closing in which case
+ * @p fn is never called.
+ */
+int ws_defer(ws_cli_conn_t *client, uint32_t ms,
+	void (*fn)(ws_cli_conn_t *cli, void *arg), void *arg)
+{
+	struct ws_job *job;
+
+	if (!CLIENT_VALID(client) || !fn)
+		return (-1);
+
+	pthread_mutex_lock(&mutex);
+
+	if (client->retired)
+	{
+		pthread_mutex_unlock(&mutex);
+		return (-1);
+	}
+
+	if (ms == 0)
+	{
+		job = new_job(WS_JOB_CALL);
+		job->fn = fn;
+		job->arg = arg;
+		add_job(client, job);
+	}
+	else
+		add_timer(client, ms, WS_TIMER_CALL, fn, arg);
+
+	pthread_mutex_unlock(&mutex);
+
+	if (ms > 0)
+		wake_reactor();
+
+	return (0);
+}
+
 /**
  * @brief Close the client connection for the given @p
  * client with normal close code (1000) and no reason
@@ -723,10 +1047,11 @@ int ws_get_state(ws_cli_conn_t *client)
 int ws_close_client(ws_cli_conn_t *client)
 {
 	unsigned char clse_code[2];
+	bool start_timer;
 	int cc;
 
 	/* Check if client is a valid and connected client. */
-	if (!CLIENT_VALID(client) || client->client_sock == -1)
+	if (!CLIENT_VALID(client))
 		return (-1);
 
 	/*
@@ -745,11 +1070,24 @@ int ws_close_client(ws_cli_conn_t *client)
 	}
 
 	/*
-	 * Starts the timeout thread: if the client did not send
-	 * a close frame in TIMEOUT_MS milliseconds, the server
-	 * will close the connection with error code (1002).
+	 * Instead of waiting for the client close frame, have the reactor
+	 * time out and close the connection if it never arrives.
 	 */
-	start_close_timeout(client);
+	pthread_mutex_lock(&client->mtx_state);
+	start_timer = client->state == WS_STATE_OPEN;
+	if (start_timer)
+		client->state = WS_STATE_CLOSING;
+	pthread_mutex_unlock(&client->mtx_state);
+
+	if (start_timer)
+	{
+		pthread_mutex_lock(&mutex);
+		if (!client->retired)
+			add_timer(client, TIMEOUT_MS, WS_TIMER_CLOSE, NULL, NULL);
+		pthread_mutex_unlock(&mutex);
+		wake_reactor();
+	}
+
 	return (0);
 }
 
@@ -771,99 +1109,42 @@ static inline int is_control_frame(int frame)
 }
 
 /**
- * @brief Do the handshake process.
- *
- * @param wfd Websocket Frame Data.
- *
- * @return Returns 0 if success, a negative number otherwise.
- *
- * @attention This is part of the internal API and is documented just
- * for completeness.
- */
-static int do_handshake(struct ws_frame_data *wfd)
-{
-	char *response; /* Handshake response message. */
-
-	/* Advance our pointers after the header */
-	wfd->amt_read = strlen ((char*)wfd->frm);
-	wfd->cur_pos = wfd->amt_read;
-
-	/* Get response. */
-	if (get_handshake_response((char *)wfd->frm, &response) < 0)
-	{
-		DEBUG("Cannot get handshake response, request was: %s\n", wfd->frm);
-		return (-1);
-	}
-
-	/* Valid request. */
-	DEBUG("Handshaked, response: \n"
-		  "------------------------------------\n"
-		  "%s"
-		  "------------------------------------\n",
-		response);
-
-	/* Send handshake. */
-	if (SEND(wfd->client, response, strlen(response)) < 0)
-	{
-		free(response);
-		DEBUG("As error has occurred while handshaking!\n");
-		return (-1);
-	}
-
-	/* Change state. */
-	set_client_state(wfd->client, WS_STATE_OPEN);
-
-	/* Trigger events and clean up buffers. */
-	cli_events.onopen(wfd->client);
-	free(response);
-	return (0);
-}
-
-/**
- * @brief Sends a close frame, accordingly with the @p close_code
- * or the message inside @p wfd.
+ * @brief Sends a close frame in response to the one received, accordingly
+ * with the close code it carried.
  *
- * @param wfd Websocket Frame Data.
- * @param close_code Websocket close code.
+ * @param client Client connection.
+ * @param payload Close frame payload.
+ * @param len Payload length.
  *
- * @return Returns 0 if success, a negative number otherwise.
+ * @return Returns 0 on success, a negative number otherwise.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static int do_close(struct ws_frame_data *wfd, int close_code)
+static int do_close(ws_cli_conn_t *client, const unsigned char *payload, uint64_t len)
 {
-	int cc; /* Close code.           */
-
-	/* If custom close-code. */
-	if (close_code != -1)
-	{
-		cc = close_code;
-		goto custom_close;
-	}
+	unsigned char clse_code[2]; /* Close frame payload. */
+	int cc;                     /* Close code.          */
 
 	/* If empty or have a close reason, just re-send. */
-	if (wfd->frame_size == 0 || wfd->frame_size > 2)
+	if (len == 0 || len > 2)
 		goto send;
 
-	/* Parse close code and check if valid, if not, we issue an protocol error.
-	 */
-	if (wfd->frame_size == 1)
-		cc = wfd->msg_ctrl[0];
+	/* Parse close code and check if valid, if not, we issue an protocol error. */
+	if (len == 1)
+		cc = payload[0];
 	else
-		cc = ((int)wfd->msg_ctrl[0]) << 8 | wfd->msg_ctrl[1];
+		cc = ((int)payload[0]) << 8 | payload[1];
 
 	/* Check if it's not valid, if so, we send a protocol error (1002). */
 	if ((cc < 1000 || cc > 1003) && (cc < 1007 || cc > 1011) &&
 		(cc < 3000 || cc > 4999))
 	{
 		cc = WS_CLSE_PROTERR;
+		clse_code[0] = (cc >> 8);
+		clse_code[1] = (cc & 0xFF);
 
-	custom_close:
-		wfd->msg_ctrl[0] = (cc >> 8);
-		wfd->msg_ctrl[1] = (cc & 0xFF);
-
-		if (ws_sendframe(wfd->client, (const char *)wfd->msg_ctrl, sizeof(char) * 2,
+		if (ws_sendframe(client, (const char *)clse_code, sizeof(char) * 2,
 				WS_FR_OP_CLSE) < 0)
 		{
 			DEBUG("An error has occurred while sending closing frame!\n");
@@ -872,10 +1153,9 @@ static int do_close(struct ws_frame_data *wfd, int close_code)
 		return (0);
 	}
 
-	/* Send the data inside wfd->msg_ctrl. */
+	/* Send the payload back. */
 send:
-	if (ws_sendframe(wfd->client, (const char *)wfd->msg_ctrl, wfd->frame_size,
-			WS_FR_OP_CLSE) < 0)
+	if (ws_sendframe(client, (const char *)payload, len, WS_FR_OP_CLSE) < 0)
 	{
 		DEBUG("An error has occurred while sending closing frame!\n");
 		return (-1);
@@ -884,702 +1164,829 @@ send:
 }
 
 /**
- * @brief Send a pong frame in response to a ping frame.
- *
- * Accordingly to the RFC, a pong frame must have the same
- * data payload as the ping frame, so we just send a
- * ordinary frame with PONG opcode.
+ * @brief Acts on one complete frame.
  *
- * @param wfd Websocket frame data.
+ * Data frames are collected until FIN then queued for onmessage, control
+ * frames are answered right here.
  *
- * @param frame_size Pong frame size.
+ * @param client Client connection.
+ * @param fin FIN bit.
+ * @param opcode Frame opcode.
+ * @param data Masked payload, unmasked in place.
+ * @param len Payload length.
+ * @param masks Masking key.
  *
- * @return Returns 0 if success and a negative number
- * otherwise.
+ * @return Returns 0 to keep going, 1 if the client was retired, -1 on a
+ * protocol error.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static int do_pong(struct ws_frame_data *wfd, uint64_t frame_size)
+static int do_frame(ws_cli_conn_t *client, int fin, int opcode, unsigned char *data,
+	uint64_t len, const uint8_t *masks)
 {
-	if (ws_sendframe(
-			wfd->client, (const char *)wfd->msg_ctrl, frame_size, WS_FR_OP_PONG) < 0)
+	unsigned char *tmp;    /* Grown message.  */
+	struct ws_job *job;    /* Message job.    */
+	int32_t pong_id;       /* PONG id.        */
+	uint64_t i;            /* Loop index.     */
+
+	for (i = 0; i < len; i++)
+		data[i] ^= masks[i % 4];
+
+	/* If we're closing we only expect the close response. */
+	if (get_client_state(client) == WS_STATE_CLOSING && opcode != WS_FR_OP_CLSE)
 	{
-		wfd->error = 1;
-		DEBUG("An error has occurred while ponging!\n");
+		DEBUG("Unexpected frame received, expected CLOSE (%d), "
+			  "received: (%d)",
+			WS_FR_OP_CLSE, opcode);
+		return (-1);
+	}
+
+	/* Control frames can not be fragmented nor larger than 125. */
+	if (is_control_frame(opcode) && (!fin || len > 125))
+	{
+		DEBUG("Control frame bigger than 125 octets or not a FIN frame!\n");
+		return (-1);
+	}
+
+	switch (opcode)
+	{
+	case WS_FR_OP_TXT:
+	case WS_FR_OP_BIN:
+	case WS_FR_OP_CONT:
+		/* A CONT must continue a message, anything else must start one. */
+		if ((client->msg_type == -1 && opcode == WS_FR_OP_CONT) ||
+			(client->msg_type != -1 && opcode != WS_FR_OP_CONT))
+		{
+			DEBUG("Unexpected frame was received!, opcode: %d, previous: %d\n",
+				opcode, client->msg_type);
+			return (-1);
+		}
+		if (opcode != WS_FR_OP_CONT)
+			client->msg_type = opcode;
+
+		tmp = (unsigned char *) realloc(client->msg, client->msg_n + len + 1);
+		if (!tmp)
+		{
+			DEBUG("Cannot allocate memory, requested: %" PRId64 "\n",
+				(client->msg_n + len + 1));
+			return (-1);
+		}
+		client->msg = tmp;
+		memcpy(client->msg + client->msg_n, data, len);
+		client->msg_n += len;
+
+		if (fin)
+		{
+			client->msg[client->msg_n] = '\0';
+			job = new_job(WS_JOB_MESSAGE);
+			job->msg = client->msg;
+			job->msg_size = client->msg_n;
+			job->msg_type = client->msg_type;
+			client->msg = NULL;
+			client->msg_n = 0;
+			client->msg_type = -1;
+
+			pthread_mutex_lock(&mutex);
+			add_job(client, job);
+			pthread_mutex_unlock(&mutex);
+		}
+		return (0);
+
+	/* We should answer to a PING frame as soon as possible. */
+	case WS_FR_OP_PING:
+		if (ws_sendframe(client, (const char *)data, len, WS_FR_OP_PONG) < 0)
+		{
+			DEBUG("An error has occurred while ponging!\n");
+			return (-1);
+		}
+		return (0);
+
+	/* Our PONG: keep the most recent id, ignore anything else. */
+	case WS_FR_OP_PONG:
+		if (len != sizeof(client->last_pong_id))
+			return (0);
+
+		/* clang-format off */
+		pthread_mutex_lock(&client->mtx_ping);
+			pong_id = pong_msg_to_int32(data);
+			if (pong_id >= 0 && pong_id <= client->current_ping_id)
+				client->last_pong_id = pong_id;
+		pthread_mutex_unlock(&client->mtx_ping);
+		/* clang-format on */
+		return (0);
+
+	/* Answer a CLOSE unless it answers ours, either way we are done. */
+	case WS_FR_OP_CLSE:
+#ifdef VALIDATE_UTF8
+		/* If there is a close reason, check if it is UTF-8 valid. */
+		if (len > 2 && !is_utf8_len(data + 2, len - 2))
+		{
+			DEBUG("Invalid close frame payload reason! (not UTF-8)\n");
+			return (-1);
+		}
+#endif
+		if (get_client_state(client) != WS_STATE_CLOSING)
+		{
+			set_client_state(client, WS_STATE_CLOSING);
+			do_close(client, data, len);
+		}
+		retire_client(client, WS_JOB_CLOSE);
+		return (1);
+
+	/* Anything else (unsupported frames). */
+	default:
+		DEBUG("Unsupported frame opcode: %d\n", opcode);
 		return (-1);
 	}
-	return (0);
 }
 
 /**
- * @brief Read a chunk of bytes and return the next byte
- * belonging to the frame.
+ * @brief Parses all complete frames waiting in the client input buffer.
  *
- * @param wfd Websocket Frame Data.
+ * @param client Client connection.
  *
- * @return Returns the byte read, or -1 if error.
+ * @return Returns 0 to keep going, 1 if the client was retired, -1 on a
+ * protocol error.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static inline int next_byte(struct ws_frame_data *wfd)
+static int read_frames(ws_cli_conn_t *client)
 {
-	ssize_t n;
-
-	/* If empty or full. */
-	if (wfd->cur_pos == 0 || wfd->cur_pos == wfd->amt_read)
+	unsigned char *p; /* Frame start.         */
+	uint8_t masks[4]; /* Masking key.         */
+	uint64_t len;     /* Payload length.      */
+	size_t avail;     /* Bytes unparsed.      */
+	size_t hlen;      /* Frame header length. */
+	size_t pos;       /* Parse position.      */
+	int ret;          /* do_frame() result.   */
+	int i;            /* Loop index.          */
+
+	pos = 0;
+	while ((avail = client->in_n - pos) >= 2)
 	{
-		if ((n = RECV(wfd->client, wfd->frm, sizeof(wfd->frm))) <= 0)
+		p = client->in + pos;
+
+		/*
+		 * We do not support extensions so RSV bits must be 0, see:
+		 * https://tools.ietf.org/html/rfc6455#section-5.2
+		 */
+		if (p[0] & 0x70)
+		{
+			DEBUG("RSV is set while wsServer do not negotiate extensions!\n");
+			return (-1);
+		}
+
+		/* Wait until we have the whole header. */
+		len = p[1] & 0x7F;
+		hlen = 2 + (len == 126 ? 2 : (len == 127 ? 8 : 0)) + 4;
+		if (avail < hlen)
+			break;
+
+		/* Decode length for 16-bit and 64-bit messages. */
+		if (len == 126)
+			len = (((uint64_t)p[2]) << 8) | p[3];
+		else if (len == 127)
+		{
+			len = 0;
+			for (i = 0; i < 8; i++)
+				len = (len << 8) | p[2 + i];
+		}
+
+		/* Check frame and message size against our limit. */
+		if (len > MAX_FRAME_LENGTH || client->msg_n + len > MAX_FRAME_LENGTH)
 		{
-			wfd->error = 1;
-			DEBUG("An error has occurred while trying to read next byte\n");
+			DEBUG("Current frame from client %d, exceeds the maximum\n"
+				  "amount of bytes allowed (%" PRId64 "/%d)!",
+				client->client_sock, client->msg_n + len, MAX_FRAME_LENGTH);
 			return (-1);
 		}
-		wfd->amt_read = (size_t)n;
-		wfd->cur_pos = 0;
+
+		/* Wait until we have the whole payload. */
+		if (avail - hlen < len)
+			break;
+
+		memcpy(masks, p + hlen - 4, 4);
+		pos += hlen + len;
+
+		ret = do_frame(client, p[0] >> WS_FIN_SHIFT, p[0] & 0xF, p + hlen, len, masks);
+		if (ret != 0)
+			return (ret);
 	}
-	return (wfd->frm[wfd->cur_pos++]);
+
+	/* Keep just the unparsed remainder. */
+	if (pos > 0)
+	{
+		memmove(client->in, client->in + pos, client->in_n - pos);
+		client->in_n -= pos;
+	}
+
+	return (0);
 }
 
 /**
- * @brief Reads the current frame isolating data from control frames.
- * The parameters are changed in order to reflect the current state.
+ * @brief Once the client http header is complete, either answer the
+ * websocket handshake or pass it on as a normal http request.
  *
- * @param wfd Websocket Frame Data.
- * @param opcode Frame opcode.
- * @param buf Buffer to be written.
- * @param frame_length Length of the current frame.
- * @param frame_size Total size of the frame (considering CONT frames)
- *                   read until the moment.
- * @param msg_idx Message index, reflects the current buffer pointer state.
- * @param masks Masks vector.
- * @param is_fin Is FIN frame indicator.
+ * @param client Client connection.
  *
- * @return Returns 0 if success, a negative number otherwise.
+ * @return Returns 0 if the header is not complete yet, 1 once the
+ * connection is open, -1 if the client was retired.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static int read_frame(struct ws_frame_data *wfd,
-	int opcode,
-	unsigned char **buf,
-	uint64_t *frame_length,
-	uint64_t *frame_size,
-	uint64_t *msg_idx,
-	uint8_t *masks,
-	int is_fin)
+static int do_handshake(ws_cli_conn_t *client)
 {
-	unsigned char *tmp; /* Tmp message.     */
-	unsigned char *msg; /* Current message. */
-	int cur_byte;       /* Curr byte read.  */
-	uint64_t i;         /* Loop index.      */
-
-	msg = *buf;
-
-	/* Decode masks and length for 16-bit messages. */
-	if (*frame_length == 126)
-		*frame_length = (((uint64_t)next_byte(wfd)) << 8) | next_byte(wfd);
-
-	/* 64-bit messages. */
-	else if (*frame_length == 127)
+	char *response; /* Handshake response message. */
+	char *request;  /* Scratch copy of header.     */
+	size_t hdr_len; /* Header length.              */
+	size_t i;       /* Loop index.                 */
+
+	/* Find the blank line. */
+	hdr_len = 0;
+	for (i = 3; i < client->in_n && !hdr_len; i++)
+		if (memcmp(client->in + i - 3, "\r\n\r\n", 4) == 0)
+			hdr_len = i + 1;
+	if (!hdr_len)
 	{
-		*frame_length =
-			(((uint64_t)next_byte(wfd)) << 56) | /* frame[2]. */
-			(((uint64_t)next_byte(wfd)) << 48) | /* frame[3]. */
-			(((uint64_t)next_byte(wfd)) << 40) | (((uint64_t)next_byte(wfd)) << 32) |
-			(((uint64_t)next_byte(wfd)) << 24) | (((uint64_t)next_byte(wfd)) << 16) |
-			(((uint64_t)next_byte(wfd)) << 8) |
-			(((uint64_t)next_byte(wfd))); /* frame[9]. */
+		if (client->in_n < WS_MAX_HEADER)
+			return (0);
+		DEBUG("Header from client %d too long\n", client->client_sock);
+		retire_client(client, WS_JOB_CLOSE);
+		return (-1);
 	}
 
-	*frame_size += *frame_length;
-
-	/*
-	 * Check frame size
-	 *
-	 * We need to limit the amount supported here, since if
-	 * we follow strictly to the RFC, we have to allow 2^64
-	 * bytes. Also keep in mind that this is still true
-	 * for continuation frames.
-	 */
-	if (*frame_size > MAX_FRAME_LENGTH)
+	/* Save the header, keep anything after it. */
+	client->header = (char *) malloc(hdr_len + 1);
+	request = (char *) malloc(hdr_len + 1);
+	if (!client->header || !request)
+		fatalError("No memory for websocket header");
+	memcpy(client->header, client->in, hdr_len);
+	client->header[hdr_len] = '\0';
+	strcpy(request, client->header);
+	memmove(client->in, client->in + hdr_len, client->in_n - hdr_len);
+	client->in_n -= hdr_len;
+
+	/* Get response, else assume normal http request. */
+	if (get_handshake_response(request, &response) < 0)
 	{
-		DEBUG("Current frame from client %d, exceeds the maximum\n"
-			  "amount of bytes allowed (%" PRId64 "/%d)!",
-			wfd->client->client_sock, *frame_size + *frame_length, MAX_FRAME_LENGTH);
-
-		wfd->error = 1;
+		DEBUG("Cannot get handshake response, request was: %s\n", client->header);
+		free(request);
+		retire_client(client, WS_JOB_NONWS);
 		return (-1);
 	}
+	free(request);
 
-	/* Read masks. */
-	masks[0] = next_byte(wfd);
-	masks[1] = next_byte(wfd);
-	masks[2] = next_byte(wfd);
-	masks[3] = next_byte(wfd);
+	/* Valid request. */
+	DEBUG("Handshaked, response: \n"
+		  "------------------------------------\n"
+		  "%s"
+		  "------------------------------------\n",
+		response);
 
-	/*
-	 * Abort if error.
-	 *
-	 * This is tricky: we may have multiples error codes from the
-	 * previous next_bytes() calls, but, since we're only setting
-	 * variables and flags, there is no major issue in setting
-	 * them wrong _if_ we do not use their values, thing that
-	 * we do here.
-	 */
-	if (wfd->error)
+	/* Send handshake. */
+	if (queue_output(client, response, strlen(response), NULL, 0, false) < 0)
+	{
+		free(response);
+		DEBUG("As error has occurred while handshaking!\n");
+		retire_client(client, WS_JOB_CLOSE);
 		return (-1);
+	}
+	free(response);
 
-	/*
-	 * Allocate memory.
-	 *
-	 * The statement below will allocate a new chunk of memory
-	 * if msg is NULL with size total_length. Otherwise, it will
-	 * resize the total memory accordingly with the message index
-	 * and if the current frame is a FIN frame or not, if so,
-	 * increment the size by 1 to accommodate the line ending \0.
-	 */
-	if (*frame_length > 0)
-	{
-		if (!is_control_frame(opcode))
-		{
-			tmp = (unsigned char *) realloc(
-				msg, sizeof(unsigned char) * (*msg_idx + *frame_length + is_fin));
-			if (!tmp)
-			{
-				DEBUG("Cannot allocate memory, requested: % " PRId64 "\n",
-					(*msg_idx + *frame_length + is_fin));
+	/* Change state and trigger event. */
+	set_client_state(client, WS_STATE_OPEN);
+	pthread_mutex_lock(&mutex);
+	add_job(client, new_job(WS_JOB_OPEN));
+	pthread_mutex_unlock(&mutex);
 
-				wfd->error = 1;
-				return (-1);
-			}
-			msg = tmp;
-			*buf = msg;
-		}
+	return (1);
+}
 
-		/* Copy to the proper location. */
-		for (i = 0; i < *frame_length; i++, (*msg_idx)++)
-		{
-			/* We were able to read? .*/
-			cur_byte = next_byte(wfd);
-			if (cur_byte == -1)
-				return (-1);
+/**
+ * @brief Reads what a client has sent and acts on whatever is now complete.
+ *
+ * @param client Client connection.
+ *
+ * @return Returns 0 if still watching the client, -1 if it was retired.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static int read_client(ws_cli_conn_t *client)
+{
+	unsigned char *tmp;
+	size_t new_max;
+	ssize_t n;
+	int ret;
 
-			msg[*msg_idx] = cur_byte ^ masks[i % 4];
+	/* Insure room for another chunk. */
+	if (client->in_max - client->in_n < WS_READ_CHUNK)
+	{
+		new_max = 2 * client->in_max;
+		if (new_max < client->in_n + WS_READ_CHUNK)
+			new_max = client->in_n + WS_READ_CHUNK;
+		tmp = (unsigned char *) realloc(client->in, new_max);
+		if (!tmp)
+		{
+			DEBUG("Cannot allocate input for client %d\n", client->client_sock);
+			retire_client(client, WS_JOB_CLOSE);
+			return (-1);
 		}
+		client->in = tmp;
+		client->in_max = new_max;
 	}
 
-	/* If we're inside a FIN frame, lets... */
-	if (is_fin && *frame_size > 0)
+	n = recv(client->client_sock, client->in + client->in_n,
+		client->in_max - client->in_n, 0);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return (0);
+	if (n <= 0)
 	{
-		/* Increase memory if our FIN frame is of length 0. */
-		if (!*frame_length && !is_control_frame(opcode))
-		{
-			tmp = (unsigned char *) realloc(msg, sizeof(unsigned char) * (*msg_idx + 1));
-			if (!tmp)
-			{
-				DEBUG("Cannot allocate memory, requested: %" PRId64 "\n",
-					(*msg_idx + 1));
+		retire_client(client, WS_JOB_CLOSE);
+		return (-1);
+	}
+	client->in_n += n;
 
-				wfd->error = 1;
-				return (-1);
-			}
-			msg = tmp;
-			*buf = msg;
-		}
-		msg[*msg_idx] = '\0';
+	if (get_client_state(client) == WS_STATE_CONNECTING)
+	{
+		ret = do_handshake(client);
+		if (ret <= 0)
+			return (ret);
 	}
 
-	return (0);
+	ret = read_frames(client);
+	if (ret < 0)
+		retire_client(client, WS_JOB_CLOSE);
+
+	return (ret ? -1 : 0);
 }
 
 /**
- * @brief Reads the next frame, whether if a TXT/BIN/CLOSE
- * of arbitrary size.
- *
- * @param wfd Websocket Frame Data.
+ * @brief Accepts all waiting connections on a listening socket.
  *
- * @return Returns 0 if success, a negative number otherwise.
+ * @param l Listener.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static int next_frame(struct ws_frame_data *wfd)
+static void accept_clients(struct ws_listener *l)
 {
-	unsigned char *msg_data; /* Data frame.                */
-	unsigned char *msg_ctrl; /* Control frame.             */
-	uint8_t masks_data[4];   /* Masks data frame array.    */
-	uint8_t masks_ctrl[4];   /* Masks control frame array. */
-	uint64_t msg_idx_data;   /* Current msg index.         */
-	uint64_t msg_idx_ctrl;   /* Current msg index.         */
-	uint64_t frame_length;   /* Frame length.              */
-	uint64_t frame_size;     /* Current frame size.        */
-	int32_t pong_id;         /* Current PONG id.           */
-	uint8_t opcode;          /* Frame opcode.              */
-	uint8_t is_fin;          /* Is FIN frame flag.         */
-	uint8_t mask;            /* Mask.                      */
-	int cur_byte;            /* Current frame byte.        */
-
-	msg_data = NULL;
-	msg_ctrl = wfd->msg_ctrl;
-	is_fin = 0;
-	frame_length = 0;
-	frame_size = 0;
-	msg_idx_data = 0;
-	msg_idx_ctrl = 0;
-	wfd->frame_size = 0;
-	wfd->frame_type = -1;
-	wfd->msg = NULL;
-
-	/* Read until find a FIN or a unsupported frame. */
-	do
-	{
-		/*
-		 * Obs: next_byte() can return error if not possible to read the
-		 * next frame byte, in this case, we return an error.
-		 *
-		 * However, please note that this check is only made here and in
-		 * the subsequent next_bytes() calls this also may occur too.
-		 * wsServer is assuming that the client only create right
-		 * frames and we will do not have disconnections while reading
-		 * the frame but just when waiting for a frame.
-		 */
-		cur_byte = next_byte(wfd);
-		if (cur_byte == -1)
-			return (-1);
-
-		is_fin = (cur_byte & 0xFF) >> WS_FIN_SHIFT;
-		opcode = (cur_byte & 0xF);
+	ws_cli_conn_t *client;     /* New client.            */
+	struct timeval time;       /* Client socket timeout. */
+	int new_sock;              /* New opened connection. */
 
-		/*
-		 * Check for RSV field.
-		 *
-		 * Since wsServer do not negotiate extensions if we receive
-		 * a RSV field, we must drop the connection.
-		 */
-		if (cur_byte & 0x70)
+	while (1)
+	{
+		/* Accept. */
+		new_sock = accept(l->sock, NULL, NULL);
+		if (new_sock < 0)
 		{
-			DEBUG("RSV is set while wsServer do not negotiate extensions!\n");
-			wfd->error = 1;
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				break;
+			printf ("Accept() failed: %s\n", strerror(errno));
+			usleep (100000);                    /* eg EMFILE would just repeat */
 			break;
 		}
 
-		/*
-		 * Check if the current opcode makes sense:
-		 * a) If we're inside a cont frame but no previous data frame
-		 *
-		 * b) If we're handling a data-frame and receive another data
-		 *    frame. (it's expected to receive only CONT or control
-		 *    frames).
-		 *
-		 * It is worth to note that in a), we do not need to check
-		 * if the previous frame was FIN or not: if was FIN, an
-		 * on_message event was triggered and this function returned;
-		 * so the only possibility here is a previous non-FIN data
-		 * frame, ;-).
-		 */
-		if ((wfd->frame_type == -1 && opcode == WS_FR_OP_CONT) ||
-			(wfd->frame_type != -1 && !is_control_frame(opcode) &&
-				opcode != WS_FR_OP_CONT))
+		if (n_clients >= MAX_CLIENTS)
 		{
-			DEBUG("Unexpected frame was received!, opcode: %d, previous: %d\n",
-				opcode, wfd->frame_type);
-			wfd->error = 1;
-			break;
+			printf ("More than %d WS connections\n", MAX_CLIENTS);
+			close_socket(new_sock);
+			continue;
 		}
 
-		/* Check if one of the valid opcodes. */
-		if (opcode == WS_FR_OP_TXT || opcode == WS_FR_OP_BIN ||
-			opcode == WS_FR_OP_CONT || opcode == WS_FR_OP_PING ||
-			opcode == WS_FR_OP_PONG || opcode == WS_FR_OP_CLSE)
+		if (timeout)
 		{
+			time.tv_sec = timeout / 1000;
+			time.tv_usec = (timeout % 1000) * 1000;
+
 			/*
-			 * Check our current state: if CLOSING, we only accept close
-			 * frames.
-			 *
-			 * Since the server may, at any time, asynchronously, asks
-			 * to close the client connection, we should terminate
-			 * immediately.
+			 * Only the non-websocket replies are sent with a blocking socket,
+			 * this keeps them from holding up a worker forever.
 			 */
-			if (get_client_state(wfd->client) == WS_STATE_CLOSING &&
-				opcode != WS_FR_OP_CLSE)
-			{
-				DEBUG("Unexpected frame received, expected CLOSE (%d), "
-					  "received: (%d)",
-					WS_FR_OP_CLSE, opcode);
-				wfd->error = 1;
-				break;
-			}
+			setsockopt(new_sock, SOL_SOCKET, SO_SNDTIMEO, &time,
+				sizeof(struct timeval));
+		}
+		set_nonblocking(new_sock, true);
+
+		client = (ws_cli_conn_t *) calloc(1, sizeof(ws_cli_conn_t));
+		if (!client)
+			fatalError("No memory for websocket client");
+		client->client_sock = new_sock;
+		client->state = WS_STATE_CONNECTING;
+		client->evs = &l->evs;
+		client->msg_type = -1;
+		client->last_pong_id = -1;
+		client->current_ping_id = -1;
+		client->port = l->port;
+		set_client_address(client);
+
+		if (pthread_mutex_init(&client->mtx_state, NULL))
+			fatalError("Error on allocating state mutex");
+		if (pthread_mutex_init(&client->mtx_snd, NULL))
+			fatalError("Error on allocating send mutex");
+		if (pthread_mutex_init(&client->mtx_ping, NULL))
+			fatalError("Error on allocating ping/pong mutex");
+
+		/* Adds client to clients list. */
+		pthread_mutex_lock(&mutex);
+		client->next = clients;
+		if (clients)
+			clients->prev = client;
+		clients = client;
+		n_clients++;
+		pthread_mutex_unlock(&mutex);
 
-			/* Only change frame type if not a CONT frame. */
-			if (opcode != WS_FR_OP_CONT && !is_control_frame(opcode))
-				wfd->frame_type = opcode;
+#ifdef WS_USE_EPOLL
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = client;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, new_sock, &ev) < 0)
+			fatalError("epoll_ctl(ADD) failed: %s", strerror(errno));
+#endif
+	}
+}
 
-			mask = next_byte(wfd);
-			frame_length = mask & 0x7F;
-			frame_size = 0;
-			msg_idx_ctrl = 0;
+/**
+ * @brief Runs one client job on a worker.
+ *
+ * @param client Client connection, freed here by the final job.
+ * @param job Job.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static void run_job(ws_cli_conn_t *client, struct ws_job *job)
+{
+	FILE *sockfp;
 
-			/*
-			 * We should deny non-FIN control frames or that have
-			 * more than 125 octets.
-			 */
-			if (is_control_frame(opcode) && (!is_fin || frame_length > 125))
+	switch (job->type)
+	{
+	case WS_JOB_OPEN:
+		client->opened = true;
+		if (client->evs->onopen)
+			client->evs->onopen(client);
+		break;
+
+	case WS_JOB_MESSAGE:
+		if (client->evs->onmessage)
+			client->evs->onmessage(client, job->msg, job->msg_size, job->msg_type);
+		free(job->msg);
+		break;
+
+	case WS_JOB_CALL:
+		job->fn(client, job->arg);
+		break;
+
+	case WS_JOB_CLOSE:
+		if (client->opened && client->evs->onclose)
+			client->evs->onclose(client);
+		free_client(client);
+		break;
+
+	case WS_JOB_NONWS:
+		/* Plain http: hand over the socket, now blocking, as a stream. */
+		if (client->evs->onnonws)
+		{
+			set_nonblocking(client->client_sock, false);
+			sockfp = fdopen(client->client_sock, "w");
+			if (sockfp)
 			{
-				DEBUG("Control frame bigger than 125 octets or not a FIN "
-					  "frame!\n");
-				wfd->error = 1;
-				break;
+				(*client->evs->onnonws) (sockfp, client->header);
+				/* want shutdown() first, then fclose closes the socket */
+				fflush(sockfp);
+				shutdown(client->client_sock, SHUT_RDWR);
+				fclose(sockfp);
+				client->client_sock = -1;
 			}
+		}
+		free_client(client);
+		break;
+	}
+}
 
-			/* Normal data frames. */
-			if (opcode == WS_FR_OP_TXT || opcode == WS_FR_OP_BIN ||
-				opcode == WS_FR_OP_CONT)
-			{
-				if (read_frame(wfd, opcode, &msg_data, &frame_length,
-						&wfd->frame_size, &msg_idx_data, masks_data, is_fin) < 0)
-					break;
+/**
+ * @brief Worker thread: runs jobs, one client at a time and in order per client.
+ *
+ * @param unused Not used.
+ *
+ * @return Never returns.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static void *ws_worker(void *unused)
+{
+	ws_cli_conn_t *client;
+	struct ws_job *job;
+	bool final;
 
-			}
+	(void)unused;
 
-			/*
-			 * We _may_ send a PING frame if the ws_ping() routine was invoked.
-			 *
-			 * If the content is invalid and/or differs the size, ignore it.
-			 * (maybe unsolicited PONG).
-			 */
-			else if (opcode == WS_FR_OP_PONG)
-			{
-				if (read_frame(wfd, opcode, &msg_ctrl, &frame_length, &frame_size,
-						&msg_idx_ctrl, masks_ctrl, is_fin) < 0)
-					break;
+	while (1)
+	{
+		/* Next client with work. */
+		pthread_mutex_lock(&mutex);
+		while (!run_head)
+			pthread_cond_wait(&cnd_work, &mutex);
+		client = run_head;
+		run_head = client->run_next;
+		if (!run_head)
+			run_tail = NULL;
+		job = client->jobs;
+		client->jobs = job->next;
+		if (!client->jobs)
+			client->jobs_tail = NULL;
+		pthread_mutex_unlock(&mutex);
 
-				is_fin = 0;
+		/* Run it, the final job frees the client. */
+		final = job->type == WS_JOB_CLOSE || job->type == WS_JOB_NONWS;
+		run_job(client, job);
+		free(job);
+		if (final)
+			continue;
 
-				/* If there is no content and/or differs the size, ignore it. */
-				if (frame_size != sizeof(wfd->client->last_pong_id))
-					continue;
+		/* Back of the queue if it has more, so clients take turns. */
+		pthread_mutex_lock(&mutex);
+		if (client->jobs)
+		{
+			client->run_next = NULL;
+			if (run_tail)
+				run_tail->run_next = client;
+			else
+				run_head = client;
+			run_tail = client;
+			pthread_cond_signal(&cnd_work);
+		}
+		else
+			client->scheduled = false;
+		pthread_mutex_unlock(&mutex);
+	}
 
-				/*
-				 * Our PONG id should be positive and smaller than our
-				 * current PING id. If not, ignore.
-				 */
-				/* clang-format off */
-				pthread_mutex_lock(&wfd->client->mtx_ping);
-
-					pong_id = pong_msg_to_int32(msg_ctrl);
-					if (pong_id < 0 || pong_id > wfd->client->current_ping_id)
-					{
-						pthread_mutex_unlock(&wfd->client->mtx_ping);
-						continue;
-					}
-					wfd->client->last_pong_id = pong_id;
-
-				pthread_mutex_unlock(&wfd->client->mtx_ping);
-				/* clang-format on */
-				continue;
-			}
+	return (NULL);
+}
 
-			/* We should answer to a PING frame as soon as possible. */
-			else if (opcode == WS_FR_OP_PING)
-			{
-				if (read_frame(wfd, opcode, &msg_ctrl, &frame_length, &frame_size,
-						&msg_idx_ctrl, masks_ctrl, is_fin) < 0)
-					break;
+/**
+ * @brief Returns milliseconds until the next timer is due, or -1 if none.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static int next_timer_ms(void)
+{
+	struct timeval now;
+	struct ws_timer *tp;
+	long ms, min_ms;
 
-				if (do_pong(wfd, frame_size) < 0)
-					break;
+	gettimeofday(&now, NULL);
+	min_ms = -1;
 
-				/* Quick hack to keep our loop. */
-				is_fin = 0;
-			}
+	pthread_mutex_lock(&mutex);
+	for (tp = timers; tp; tp = tp->next)
+	{
+		ms = (tp->when.tv_sec - now.tv_sec) * 1000 +
+			(tp->when.tv_usec - now.tv_usec + 999) / 1000;
+		if (ms < 0)
+			ms = 0;
+		if (min_ms < 0 || ms < min_ms)
+			min_ms = ms;
+	}
+	pthread_mutex_unlock(&mutex);
 
-			/* We interrupt the loop as soon as we find a CLOSE frame. */
-			else
-			{
-				if (read_frame(wfd, opcode, &msg_ctrl, &frame_length, &frame_size,
-						&msg_idx_ctrl, masks_ctrl, is_fin) < 0)
-					break;
+	return ((int)min_ms);
+}
 
-#ifdef VALIDATE_UTF8
-				/* If there is a close reason, check if it is UTF-8 valid. */
-				if (frame_size > 2 && !is_utf8_len(msg_ctrl + 2, frame_size - 2))
-				{
-					DEBUG("Invalid close frame payload reason! (not UTF-8)\n");
-					wfd->error = 1;
-					break;
-				}
-#endif
+/**
+ * @brief Acts on all timers now due.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static void run_timers(void)
+{
+	struct ws_timer **tpp, *tp;
+	struct timeval now;
+	struct ws_job *job;
 
-				/* Since we're aborting, we can scratch the 'data'-related
-				 * vars here. */
-				wfd->frame_size = frame_size;
-				wfd->frame_type = WS_FR_OP_CLSE;
-				free(msg_data);
-				return (0);
-			}
+	gettimeofday(&now, NULL);
+
+	while (1)
+	{
+		/* Unlink the next one due. */
+		pthread_mutex_lock(&mutex);
+		for (tpp = &timers; (tp = *tpp) != NULL; tpp = &tp->next)
+			if (timercmp(&tp->when, &now, <=))
+				break;
+		if (!tp)
+		{
+			pthread_mutex_unlock(&mutex);
+			break;
 		}
+		*tpp = tp->next;
 
-		/* Anything else (unsupported frames). */
+		/* Its client is still ours, else the timer would be gone. */
+		if (tp->type == WS_TIMER_CALL)
+		{
+			job = new_job(WS_JOB_CALL);
+			job->fn = tp->fn;
+			job->arg = tp->arg;
+			add_job(tp->client, job);
+			pthread_mutex_unlock(&mutex);
+		}
 		else
 		{
-			DEBUG("Unsupported frame opcode: %d\n", opcode);
-			/* We should consider as error receive an unknown frame. */
-			wfd->frame_type = opcode;
-			wfd->error = 1;
+			pthread_mutex_unlock(&mutex);
+			DEBUG("Timer expired, closing client %d\n", tp->client->client_sock);
+			retire_client(tp->client, WS_JOB_CLOSE);
 		}
 
-	} while (!is_fin && !wfd->error);
-
-	/* Check for error. */
-	if (wfd->error)
-	{
-		free(msg_data);
-		wfd->msg = NULL;
-		return (-1);
+		free(tp);
 	}
-
-	wfd->msg = msg_data;
-	return (0);
 }
 
 /**
- * @brief read the http header from sock down through and including \r\n\r\n.
- *
- * @param sock web client tcp socket
- *
- * @param header pointer to malloced header pointer.
- *
- * @return Returns 0 if success else -1 if never see final blank line.
- *
- * @note sock is left positioned immediately after the blank line.
- *
- * @note caller must always free *header regrdless of return value.
+ * @brief Returns the listener at @p p, else NULL.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static int readHTTPHeader (int sock, char **header)
+static struct ws_listener *find_listener(void *p)
 {
-        int n_hdr = 0;
-        int n_malloc = 1000;
-        char *hdr = (char *) malloc (n_malloc);
-        int found = -1;
-
-        /* this is not efficient but we must read one char at a time to insure sock is
-         * left positioned just after the blank line.
-         */
-        while (found == -1 && read (sock, &hdr[n_hdr], 1) == 1) {
-            n_hdr++;
-            if (n_hdr == n_malloc - 1)          /* also need room for final \0 */
-                hdr = (char *) realloc (hdr, (n_malloc += 1000));
-            if (n_hdr >= 4 && strncmp (&hdr[n_hdr-4], "\r\n\r\n", 4) == 0)
-                found = 0;
-        }
-
-        hdr[n_hdr] = '\0';
-        *header = hdr;
-        return (found);
+	int i;
+
+	for (i = 0; i < n_listeners; i++)
+		if (p == &listeners[i])
+			return (&listeners[i]);
+	return (NULL);
 }
 
 /**
- * @brief Establishes to connection with the client and trigger
- * events when occurs one or invoke onnonws() for normal http headers.
- *
- * @param vclient Client connection.
- *
- * @return Returns @p vclient.
+ * @brief Acts on one ready socket.
  *
- * @note This will be run on a different thread.
+ * @param p The wake pipe, a listener or a client.
+ * @param readable Whether it can be read or has an error or hangup.
+ * @param writable Whether it can be written.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static void *ws_establishconnection(void *vclient)
+static void dispatch(void *p, bool readable, bool writable)
 {
-	struct ws_frame_data wfd; /* WebSocket frame data.   */
-	ws_cli_conn_t *client;    /* Client structure.       */
-	int clse_thrd;            /* Time-out close thread.  */
-
-	client = (ws_cli_conn_t *) vclient;
-
-        /* read header */
-        if (readHTTPHeader (client->client_sock, &client->header) < 0)
-            goto closed;
-
-	/* Prepare frame data. */
-	memset(&wfd, 0, sizeof(wfd));
-        strncpy ((char*)wfd.frm, client->header, MESSAGE_LENGTH-1);     /* -1 to insure EOS */
-	wfd.client = client;
-
-	/* Do handshake else assume normal http request */
-	if (do_handshake(&wfd) < 0) {
-            if (cli_events.onnonws) {
-                FILE *sockfp = fdopen (client->client_sock, "w");
-                (*cli_events.onnonws) (sockfp, client->header);
-                /* want shutdown() first, then more closes are harmless */
-                fflush(sockfp);
-                close_socket(client->client_sock);
-                fclose (sockfp);
-            }
-            goto closed;
-        }
-
-	/* Read next frame until client disconnects or an error occur. */
-	while (next_frame(&wfd) >= 0)
-	{
-		/* Text/binary event. */
-		if ((wfd.frame_type == WS_FR_OP_TXT || wfd.frame_type == WS_FR_OP_BIN) &&
-			!wfd.error)
-		{
-			cli_events.onmessage(client, wfd.msg, wfd.frame_size, wfd.frame_type);
-		}
-
-		/* Close event. */
-		else if (wfd.frame_type == WS_FR_OP_CLSE && !wfd.error)
-		{
-			/*
-			 * We only send a CLOSE frame once, if we're already
-			 * in CLOSING state, there is no need to send.
-			 */
-			if (get_client_state(client) != WS_STATE_CLOSING)
-			{
-				set_client_state(client, WS_STATE_CLOSING);
+	struct ws_listener *l;
+	char buf[64];
 
-				/* We only send a close frameSend close frame */
-				do_close(&wfd, -1);
-			}
-
-			free(wfd.msg);
-			break;
-		}
-
-		free(wfd.msg);
+	if (p == (void *)wake_fds)
+	{
+		while (read(wake_fds[0], buf, sizeof(buf)) > 0)
+			continue;
 	}
-
-	/*
-	 * on_close events always occur, whether for client closure
-	 * or server closure, as the server is expected to
-	 * always know when the client disconnects.
-	 */
-	cli_events.onclose(client);
-
-closed:
-	clse_thrd = client->close_thrd;
-
-	/* Wait for timeout thread if necessary. */
-	if (clse_thrd)
+	else if ((l = find_listener(p)) != NULL)
+		accept_clients(l);
+	else
 	{
-		pthread_cond_signal(&client->cnd_state_close);
-		pthread_join(client->thrd_tout, NULL);
+		/* N.B. read_client() may retire the client, after which it may be freed any time */
+		if (readable && read_client((ws_cli_conn_t *)p) < 0)
+			return;
+		if (writable)
+			flush_output((ws_cli_conn_t *)p);
 	}
-
-	/* Close connectin properly. */
-	if (get_client_state(client) != WS_STATE_CLOSED)
-		close_client(client, 1);
-
-	return (vclient);
 }
 
 /**
- * @brief Main loop that keeps accepting new connections.
+ * @brief Reactor thread: waits for sockets and timers and acts on them.
  *
- * @param data pointer to malloced ws_accept_info
+ * @param unused Not used.
  *
- * @return Returns NULL but should never.
- *
- * @note This may be run on a different thread.
+ * @return Never returns.
  *
  * @attention This is part of the internal API and is documented just
  * for completeness.
  */
-static void *ws_accept(void *data)
+static void *ws_reactor(void *unused)
 {
-	struct sockaddr_in client; /* Client.                */
-	pthread_t client_thread;   /* Client thread.         */
-	struct timeval time;       /* Client socket timeout. */
-        struct ws_accept_info info;/* passed in sock and port*/
-	int new_sock;              /* New opened connection. */
-	int len;                   /* Length of sockaddr.    */
-	int i;                     /* Loop index.            */
+	int n, i;
+
+	(void)unused;
 
-        // get args
-	memcpy (&info, data, sizeof(struct ws_accept_info));
-        free (data);
+#ifdef WS_USE_EPOLL
 
-	len = sizeof(struct sockaddr_in);
+	struct epoll_event evs[WS_NEVENTS];
 
 	while (1)
 	{
-		/* Accept. */
-		new_sock = accept(info.sock, (struct sockaddr *)&client, (socklen_t *)&len);
-		if (new_sock < 0) {
-                    printf ("Accept() failed: %s\n", strerror(errno));
-                    usleep (1000000);
-                    continue;
-                }
+		n = epoll_wait(epoll_fd, evs, WS_NEVENTS, next_timer_ms());
+		if (n < 0 && errno != EINTR)
+			fatalError("epoll_wait() failed: %s", strerror(errno));
 
-		if (timeout)
-		{
-			time.tv_sec = timeout / 1000;
-			time.tv_usec = (timeout % 1000) * 1000;
+		for (i = 0; i < n; i++)
+			dispatch(evs[i].data.ptr, (evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+				(evs[i].events & EPOLLOUT) != 0);
 
-			/*
-			 * Socket timeout
-			 * This feature seems to be supported on Linux, Windows,
-			 * macOS and FreeBSD.
-			 *
-			 * See:
-			 *   https://linux.die.net/man/3/setsockopt
-			 */
-			setsockopt(new_sock, SOL_SOCKET, SO_SNDTIMEO, &time,
-				sizeof(struct timeval));
-		}
+		run_timers();
+	}
 
-		/* Adds client socket to socks list. */
+#else
+
+	struct pollfd *pfds = NULL;
+	void **ptrs = NULL;
+	ws_cli_conn_t *client;
+	int n_max = 0, n_pfds;
+
+	while (1)
+	{
+		/* Collect the wake pipe, listeners and all clients still ours. */
 		pthread_mutex_lock(&mutex);
-		for (i = 0; i < MAX_CLIENTS; i++)
+		if (n_max < 1 + n_listeners + n_clients)
 		{
-			if (client_socks[i].client_sock == -1)
-			{
-				client_socks[i].client_sock = new_sock;
-				client_socks[i].state = WS_STATE_CONNECTING;
-				client_socks[i].close_thrd = false;
-				client_socks[i].last_pong_id = -1;
-				client_socks[i].current_ping_id = -1;
-				client_socks[i].port = info.port;
-				set_client_address(&client_socks[i]);
-
-				if (pthread_mutex_init(&client_socks[i].mtx_state, NULL))
-					fatalError("Error on allocating close mutex");
-				if (pthread_cond_init(&client_socks[i].cnd_state_close, NULL))
-					fatalError("Error on allocating condition var");
-				if (pthread_mutex_init(&client_socks[i].mtx_snd, NULL))
-					fatalError("Error on allocating send mutex");
-				if (pthread_mutex_init(&client_socks[i].mtx_ping, NULL))
-					fatalError("Error on allocating ping/pong mutex");
-				break;
-			}
+			n_max = 1 + n_listeners + n_clients + 16;
+			pfds = (struct pollfd *) realloc(pfds, n_max * sizeof(struct pollfd));
+			ptrs = (void **) realloc(ptrs, n_max * sizeof(void *));
+			if (!pfds || !ptrs)
+				fatalError("No memory for poll list");
+		}
+		n_pfds = 0;
+		pfds[n_pfds].fd = wake_fds[0];
+		pfds[n_pfds].events = POLLIN;
+		ptrs[n_pfds++] = (void *)wake_fds;
+		for (i = 0; i < n_listeners; i++)
+		{
+			pfds[n_pfds].fd = listeners[i].sock;
+			pfds[n_pfds].events = POLLIN;
+			ptrs[n_pfds++] = &listeners[i];
+		}
+		for (client = clients; client; client = client->next)
+		{
+			if (client->retired)
+				continue;
+			pfds[n_pfds].fd = client->client_sock;
+			pthread_mutex_lock(&client->mtx_snd);
+			pfds[n_pfds].events = POLLIN | (client->want_out ? POLLOUT : 0);
+			pthread_mutex_unlock(&client->mtx_snd);
+			ptrs[n_pfds++] = client;
 		}
 		pthread_mutex_unlock(&mutex);
 
-		/* Client socket added to socks list ? */
-		if (i != MAX_CLIENTS)
-		{
-			if (pthread_create(
-					&client_thread, NULL, ws_establishconnection, &client_socks[i]))
-				fatalError("Could not create the client thread");
+		n = poll(pfds, n_pfds, next_timer_ms());
+		if (n < 0 && errno != EINTR)
+			fatalError("poll() failed: %s", strerror(errno));
 
-			pthread_detach(client_thread);
+		for (i = 0; i < n_pfds && n > 0; i++)
+		{
+			if (!pfds[i].revents)
+				continue;
+			dispatch(ptrs[i], (pfds[i].revents & (POLLIN | POLLERR | POLLHUP)) != 0,
+				(pfds[i].revents & POLLOUT) != 0);
+			n--;
 		}
-		else  {
-                        printf ("More than %d WS connections\n", MAX_CLIENTS);
-			close_socket(new_sock);
-                }
+
+		run_timers();
+	}
+
+#endif
+
+	return (NULL);
+}
+
+/**
+ * @brief Creates the wake pipe, the epoll instance and the worker pool.
+ *
+ * @attention This is part of the internal API and is documented just
+ * for completeness.
+ */
+static void start_reactor(void)
+{
+	pthread_t worker;
+	int i;
+
+	if (pipe(wake_fds) < 0)
+		fatalError("Could not create wake pipe: %s", strerror(errno));
+	set_nonblocking(wake_fds[0], true);
+	set_nonblocking(wake_fds[1], true);
+
+#ifdef WS_USE_EPOLL
+	struct epoll_event ev;
+
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd < 0)
+		fatalError("epoll_create1() failed: %s", strerror(errno));
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = (void *)wake_fds;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fds[0], &ev) < 0)
+		fatalError("epoll_ctl(ADD) failed: %s", strerror(errno));
+#endif
+
+	for (i = 0; i < WS_WORKERS; i++)
+	{
+		if (pthread_create(&worker, NULL, ws_worker, NULL))
+			fatalError("Could not create a worker thread");
+		pthread_detach(worker);
 	}
-	free(data);
-	return (data);
 }
 
 /**
@@ -1587,22 +1994,22 @@ static void *ws_accept(void *data)
  *
  * @param evs  Events structure.
  * @param port Server port.
- * @param thread_loop If any value other than zero, runs
- *                    the accept loop in another thread
- *                    and immediately returns. If 0, runs
- *                    in the same thread and blocks execution.
- *
- * @param timeout_ms  Max timeout if the client is not responding
- *                    (in milliseconds).
+ * @param thread_loop If any value other than zero, runs the reactor
+ * in its own thread, else in the caller and never returns.
+ * @param timeout_ms Timeout for sending a non-websocket reply, 0 for none.
  *
  * @return If @p thread_loop != 0, returns 0. Otherwise, never
  * returns.
+ *
+ * @note All ports share one reactor and worker pool, both started by
+ * the first call.
  */
 int ws_socket(struct ws_events *evs, uint16_t port, int thread_loop,
 	uint32_t timeout_ms)
 {
 	struct sockaddr_in server; /* Server.                */
-	pthread_t accept_thread;   /* Accept thread.         */
+	pthread_t reactor_thread;  /* Reactor thread.        */
+	struct ws_listener *l;     /* New listener.          */
 	int reuse;                 /* Socket option.         */
 	int sock;                  /* Client sock.           */
 
@@ -1612,27 +2019,6 @@ int ws_socket(struct ws_events *evs, uint16_t port, int thread_loop,
 	if (evs == NULL)
 		fatalError("Invalid event list");
 
-	/* Copy events. */
-	memcpy(&cli_events, evs, sizeof(struct ws_events));
-
-#ifdef _WIN32
-	WSADATA wsaData;
-	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
-		fatalError("WSAStartup failed");
-
-	/**
-	 * Sets stdout to be non-buffered.
-	 *
-	 * According to the docs from MSDN (setvbuf page), Windows do not
-	 * really supports line buffering but full-buffering instead.
-	 *
-	 * Quote from the docs:
-	 * "... _IOLBF For some systems, this provides line buffering.
-	 *  However, for Win32, the behavior is the same as _IOFBF"
-	 */
-	setvbuf(stdout, NULL, _IONBF, 0);
-#endif
-
 	/* Create socket. */
 	sock = socket(AF_INET, SOCK_STREAM, 0);
 	if (sock < 0)
@@ -1657,24 +2043,43 @@ int ws_socket(struct ws_events *evs, uint16_t port, int thread_loop,
 
 	/* Listen. */
 	listen(sock, MAX_CLIENTS);
+	set_nonblocking(sock, true);
+
+	/* First time: reactor resources and workers. */
+	if (!reactor_running)
+		start_reactor();
+
+	/* Add listener, copying events. */
+	pthread_mutex_lock(&mutex);
+	if (n_listeners == WS_MAX_LISTENERS)
+		fatalError("More than %d websocket ports", WS_MAX_LISTENERS);
+	l = &listeners[n_listeners];
+	l->sock = sock;
+	l->port = port;
+	memcpy(&l->evs, evs, sizeof(struct ws_events));
+	n_listeners++;
+	pthread_mutex_unlock(&mutex);
+
+#ifdef WS_USE_EPOLL
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = l;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev) < 0)
+		fatalError("epoll_ctl(ADD) failed: %s", strerror(errno));
+#else
+	wake_reactor();
+#endif
 
-	/* Wait for incoming connections. */
-	// printf("Waiting for incoming connections...\n");
-	memset(client_socks, -1, sizeof(client_socks));
-
-        /* malloc arg for ws_accept() who can then free */
-        struct ws_accept_info *info_p = (struct ws_accept_info *) malloc (sizeof(struct ws_accept_info));
-        info_p->sock = sock;
-        info_p->port = port;
-
-	/* Accept connections. */
-	if (!thread_loop)
-		ws_accept((void *)info_p);
-	else
+	/* Start reacting. */
+	if (!reactor_running)
 	{
-		if (pthread_create(&accept_thread, NULL, ws_accept, (void *)info_p))
-			fatalError("Could not create the client thread");
-		pthread_detach(accept_thread);
+		reactor_running = true;
+		if (!thread_loop)
+			ws_reactor(NULL);
+		if (pthread_create(&reactor_thread, NULL, ws_reactor, NULL))
+			fatalError("Could not create the reactor thread");
+		pthread_detach(reactor_thread);
 	}
 
 	return (0);
@@ -91,23 +91,19 @@ static bool windDeg2Name (float deg, char dirname[4])
     return (dirname[0] != '?');
 }
 
-/* download world wx grid data into wwt.table every 
+/* BGFetchFP to download world wx grid data into the fresh WWTable at data.
+ * return whether ok.
  */
-static bool retrieveWorldWx(void)
+static bool fetchWorldWx (void *data)
 {
+    WWTable &t = *(WWTable *)data;
     WiFiClient ww_client;
     bool ok = false;
 
-    // reset table
-    free (wwt.table);
-    wwt.table = NULL;
-    wwt.n_rows = wwt.n_cols = 0;
-
     Serial.printf ("WWX: %s\n", ww_page);
 
     // get
     if (ww_client.connect(backend_host, backend_port)) {
-        updateClocks(false);
 
         // query web page
         httpHCGET (ww_client, backend_host, ww_page);
@@ -161,12 +157,12 @@ static bool retrieveWorldWx(void)
                 // confirm regular spacing
                 if (n_lngcols > 0 && lng != prev_lng) {
                     Serial.printf ("WWX: irregular lng: %d x %d  lng %g != %g\n",
-                                wwt.n_rows, n_lngcols, lng, prev_lng);
+                                t.n_rows, n_lngcols, lng, prev_lng);
                     goto out;
                 }
                 if (n_lngcols > 1 && lat != prev_lat + del_lat) {
                     Serial.printf ("WWX: irregular lat: %d x %d    lat %g != %g + %g\n",
-                                wwt.n_rows, n_lngcols,  lat, prev_lat, del_lat);
+                                t.n_rows, n_lngcols,  lat, prev_lat, del_lat);
                     goto out;
                 }
 
@@ -176,10 +172,10 @@ static bool retrieveWorldWx(void)
                     goto out;
                 }
 
-                // add to wwt.table
+                // add to t.table
                 if (n_wwtable + 1 > n_wwmalloc)
-                    wwt.table = (WXInfo *) realloc (wwt.table, (n_wwmalloc += 100) * sizeof(WXInfo));
-                memcpy (&wwt.table[n_wwtable++], &wx, sizeof(WXInfo));
+                    t.table = (WXInfo *) realloc (t.table, (n_wwmalloc += 100) * sizeof(WXInfo));
+                memcpy (&t.table[n_wwtable++], &wx, sizeof(WXInfo));
 
                 // update walk
                 if (n_lngcols == 0)
@@ -194,17 +190,17 @@ static bool retrieveWorldWx(void)
                 // blank line separates blocks of constant longitude
 
                 // check consistency so far
-                if (wwt.n_rows == 0) {
+                if (t.n_rows == 0) {
                     // we know n cols after completing the first lng block, all remaining must equal this 
-                    wwt.n_cols = n_lngcols;
-                } else if (n_lngcols != wwt.n_cols) {
+                    t.n_cols = n_lngcols;
+                } else if (n_lngcols != t.n_cols) {
                     Serial.printf ("WWX: inconsistent columns %d != %d after %d rows\n",
-                                                n_lngcols, wwt.n_cols, wwt.n_rows);
+                                                n_lngcols, t.n_cols, t.n_rows);
                     goto out;
                 }
 
-                // one more wwt.table row
-                wwt.n_rows++;
+                // one more t.table row
+                t.n_rows++;
 
                 // reset block stats
                 n_lngcols = 0;
@@ -217,23 +213,23 @@ static bool retrieveWorldWx(void)
         }
 
         // final check
-        if (wwt.n_rows != 360/del_lng || wwt.n_cols != 1 + 180/del_lat) {
+        if (t.n_rows != 360/del_lng || t.n_cols != 1 + 180/del_lat) {
             Serial.printf ("WWX: incomplete table: rows %d != 360/%g   cols %d != 1 + 180/%g\n",
-                                        wwt.n_rows, del_lng,  wwt.n_cols, del_lat);
+                                        t.n_rows, del_lng,  t.n_cols, del_lat);
             goto out;
         }
 
         // yah!
         ok = true;
-        Serial.printf ("WWX: fast table %d lat x %d lng\n", wwt.n_cols, wwt.n_rows);
+        Serial.printf ("WWX: fast table %d lat x %d lng\n", t.n_cols, t.n_rows);
 
     out:
 
         if (!ok) {
             // reset table
-            free (wwt.table);
-            wwt.table = NULL;
-            wwt.n_rows = wwt.n_cols = 0;
+            free (t.table);
+            t.table = NULL;
+            t.n_rows = t.n_cols = 0;
         }
 
         ww_client.stop();
@@ -242,6 +238,26 @@ static bool retrieveWorldWx(void)
     return (ok);
 }
 
+/* BGDoneFP to replace wwt with the table downloaded by fetchWorldWx(), or keep it and retry later.
+ */
+static void doneWorldWx (void *data, bool ok)
+{
+    WWTable *tp = (WWTable *)data;
+    static const char wwx_label[] = "FastWXTable";
+
+    if (ok) {
+        free (wwt.table);
+        wwt = *tp;
+        wwt.next_update = myNow() + WWXTBL_INTERVAL;
+        int at = millis()/1000 + WWXTBL_INTERVAL;
+        Serial.printf ("WWX: Next %s update in %d sec at %d\n", wwx_label, WWXTBL_INTERVAL, at);
+    } else {
+        wwt.next_update = nextWiFiRetry (wwx_label);
+    }
+
+    free (tp);
+}
+
 /* download current weather and time info for the given exact location.
  * if wxc.info is filled ok return true, else return false with short reason in wxc.ynot
  */
@@ -673,18 +689,16 @@ const WXInfo *findTZCache (const LatLong &ll, bool is_de, Message &ynot)
  */
 const WXInfo *findWXFast (const LatLong &ll)
 {
-    // update wwt cache if stale
-    if (myNow() > wwt.next_update) {
-        static const char wwx_label[] = "FastWXTable";
-        if (retrieveWorldWx()) {
-            wwt.next_update = myNow() + WWXTBL_INTERVAL;
-            int at = millis()/1000 + WWXTBL_INTERVAL;
-            Serial.printf ("WWX: Next %s update in %d sec at %d\n", wwx_label, WWXTBL_INTERVAL, at);
-        } else {
-            wwt.next_update = nextWiFiRetry (wwx_label);
-            return (NULL);
-        }
+    // refresh wwt in the background if stale, meanwhile use what we have
+    static const char wwx_fetch_name[] = "WorldWx";
+    if (myNow() > wwt.next_update && !isBGFetchBusy (wwx_fetch_name)) {
+        WWTable *tp = (WWTable *) calloc (1, sizeof(WWTable));
+        if (!tp)
+            fatalError ("No memory for world weather");
+        (void) startBGFetch (wwx_fetch_name, fetchWorldWx, doneWorldWx, tp);
     }
+    if (!wwt.table)
+        return (NULL);
 
     // find closest indices
     int row = floorf (wwt.n_rows*(ll.lng_d+180)/360);